@@ -0,0 +1,1382 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/*******************************************************************************
+ * File Name: audio_backend_alsa.c
+ *
+ * Description: This file contains the ALSA audio backend. Each direction is
+ * served by a thread that sleeps in poll() until the device can take or
+ * deliver one block and then calls back into the audio pipeline.
+ * The playback buffer is tuned per sink device during the first call: it
+ * starts small and grows until a window of playback is free of xruns and
+ * device delay dips, the result is kept in HFAG_ALSA_LATENCY_FILE.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ ******************************************************************************/
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "alsa/asoundlib.h"
+#include "audio_backend.h"
+#include "audio_rt.h"
+#include "hfag_config.h"
+#include "hfag_trace.h"
+#include "wiced_bt_trace.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define ALSA_LATENCY_MIN          (20000U) /* device buffer only covers playback
+                                            * thread wake-ups, SCO jitter is
+                                            * absorbed by the jitter buffer */
+#define ALSA_LATENCY_MAX          (200000U)
+#define ALSA_TUNE_WINDOW_MS       (3000U)  /* playback judged per tuning step */
+#define ALSA_TUNE_MAX_SINKS       (32U)    /* entries kept in the tuning file */
+#define ALSA_TUNE_LINE_LEN        (256U)
+#define ALSA_CAPTURE_LATENCY      (40000U)
+#define ALSA_MAX_CHUNK_FRAMES     (1024U)  /* transfer buffer size */
+#define AUDIO_DEVICE_CHANNELS     (1U)
+#define AUDIO_MAX_POLL_FDS        (8U)
+
+#ifndef MIN
+#define MIN(a, b)                 (((a) < (b)) ? (a) : (b))
+#endif
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+/* Audio thread state, one per direction */
+typedef struct
+{
+    snd_pcm_t **pp_handle;                /* &p_alsa_handle or &p_alsa_capture_handle */
+    const char *p_name;
+    pthread_t thread;
+    int event_fd;                         /* wakes the thread for exit */
+    volatile wiced_bool_t running;
+    volatile wiced_bool_t failed;         /* thread exited on an error, not joined yet */
+    audio_backend_cb_t p_cb;              /* audio pipeline */
+    uint32_t chunk_frames;                /* frames per transfer */
+    uint32_t max_frames;                  /* latency deadline of one block */
+    int32_t delay;                        /* last snd_pcm_delay(), -1 if not known */
+    uint32_t xruns;
+    uint32_t errors;                      /* unrecoverable ALSA errors */
+    uint32_t transfers;
+    uint32_t wakeups;
+    uint64_t frames;                      /* frames read or written */
+    uint64_t blocked_ns;                  /* time spent in poll() */
+    uint64_t transfer_ns;                 /* time spent reading or writing */
+} alsa_stream_t;
+
+typedef enum
+{
+    ALSA_TUNE_FIXED,                      /* HFAG_ALSA_LATENCY */
+    ALSA_TUNE_STORED,                     /* read from the tuning file */
+    ALSA_TUNE_RUNNING,
+    ALSA_TUNE_DONE,                       /* tuned by this process */
+} alsa_tune_state_t;
+
+/* Playback buffer tuning of the open sink */
+typedef struct
+{
+    alsa_tune_state_t state;
+    uint32_t latency_us;                  /* playback buffer asked for */
+    wiced_bool_t saved;                   /* DONE result is in the tuning file */
+    char key[ALSA_TUNE_LINE_LEN];         /* device, rate and PCM name */
+    /* Current window, playback thread only */
+    uint32_t frames;
+    uint32_t xruns;                       /* stream xruns at the window start */
+    uint32_t samples;
+    uint64_t delay_sum;                   /* frames */
+    uint64_t delay_sq_sum;
+} alsa_tune_t;
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static char *alsa_device = "default";
+static char *alsa_capture_device = "default";
+snd_pcm_t *p_alsa_handle = NULL;
+snd_pcm_t *p_alsa_capture_handle = NULL; /* Capture Handle */
+snd_pcm_format_t format = SND_PCM_FORMAT_S16_LE;
+static snd_mixer_elem_t* snd_mixer_elem = NULL;
+static snd_mixer_t *snd_mixer_handle = NULL;
+static snd_mixer_selem_id_t *snd_sid = NULL;
+static long vol_max;
+snd_pcm_uframes_t buffer_size = 0;
+snd_pcm_uframes_t period_size = 0;
+static snd_pcm_uframes_t capture_period_size = 0;
+static uint32_t device_rate = 0;
+static alsa_stream_t playback_stream = { .pp_handle = &p_alsa_handle, .p_name = "playback", .event_fd = -1, .delay = -1 };
+static wiced_bool_t playback_mmap = WICED_FALSE; /* SND_PCM_ACCESS_MMAP_INTERLEAVED */
+static alsa_stream_t capture_stream = { .pp_handle = &p_alsa_capture_handle, .p_name = "capture", .event_fd = -1, .delay = -1 };
+static alsa_tune_t playback_tune;
+static const char *alsa_tune_state_names[] = { "fixed", "stored", "tuning", "tuned" };
+
+/*******************************************************************************
+ *       FUNCTION DECLARATION
+ ******************************************************************************/
+static void alsa_volume_driver_deinit(void);
+static void alsa_playback_open(void);
+static int alsa_playback_configure(uint32_t latency_us);
+static void alsa_tune_init(void);
+static wiced_bool_t alsa_tune_load(const char *p_key, uint32_t *p_latency_us);
+static void alsa_tune_save(const char *p_key, uint32_t latency_us);
+static void alsa_tune_restart(alsa_stream_t *p_stream);
+static wiced_bool_t alsa_tune_block(alsa_stream_t *p_stream, uint32_t num_frames);
+static wiced_bool_t alsa_tune_apply(alsa_stream_t *p_stream);
+static void alsa_capture_open(void);
+static uint64_t audio_now_ns(void);
+static wiced_bool_t alsa_stream_recover(alsa_stream_t *p_stream, int err);
+static wiced_bool_t alsa_stream_wait(alsa_stream_t *p_stream);
+static void alsa_stream_set_avail_min(alsa_stream_t *p_stream);
+static wiced_bool_t alsa_stream_start(alsa_stream_t *p_stream, void *(*p_fn)(void *));
+static void alsa_stream_stop(alsa_stream_t *p_stream);
+static int32_t alsa_stream_delay(alsa_stream_t *p_stream);
+static uint32_t alsa_stream_chunk(snd_pcm_uframes_t period, uint32_t max_frames);
+static snd_pcm_sframes_t alsa_playback_write(int16_t* p_pcm, uint32_t num_frames);
+static snd_pcm_sframes_t alsa_playback_mmap_write(uint32_t num_frames);
+static void *alsa_playback_thread(void *arg);
+static void alsa_stream_exit(alsa_stream_t *p_stream);
+static void *alsa_capture_thread(void *arg);
+static wiced_bool_t alsa_backend_open(audio_backend_dir_t dir, uint32_t sample_rate);
+static void alsa_backend_close(audio_backend_dir_t dir);
+static wiced_bool_t alsa_backend_start(audio_backend_dir_t dir, uint32_t max_frames, audio_backend_cb_t p_cb);
+static void alsa_backend_stop(audio_backend_dir_t dir);
+static void alsa_backend_set_volume(uint8_t volume);
+static void alsa_backend_get_stats(audio_backend_dir_t dir, audio_backend_stats_t *p_stats);
+
+const audio_backend_t audio_backend_alsa =
+{
+    .p_name = "alsa",
+    .open = alsa_backend_open,
+    .close = alsa_backend_close,
+    .start = alsa_backend_start,
+    .stop = alsa_backend_stop,
+    .set_volume = alsa_backend_set_volume,
+    .get_stats = alsa_backend_get_stats,
+};
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+/*******************************************************************************
+ * function name: alsa_volume_driver_deinit
+ *******************************************************************************
+ * summary:
+ *   de-initializes the alsa volume driver
+ *
+ * parameters:
+ *   none
+ *
+ * return:
+ *   none
+ *
+ ******************************************************************************/
+static void alsa_volume_driver_deinit(void)
+{
+    if (snd_mixer_handle != NULL)
+    {
+        snd_mixer_close(snd_mixer_handle);
+        snd_mixer_handle = NULL;
+    }
+    if (snd_sid != NULL)
+    {
+        snd_mixer_selem_id_free(snd_sid);
+        snd_sid = NULL;
+    }
+    snd_mixer_elem = NULL;
+}
+
+/*******************************************************************************
+ * Function Name: alsa_volume_driver_init
+ *******************************************************************************
+ * Summary:
+ *   Initializes the ALSA Volume Driver
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+static void alsa_volume_driver_init(void)
+{
+    long vol_min;
+    WICED_BT_TRACE("alsa_volume_driver_init\n");
+
+    alsa_volume_driver_deinit();
+
+    snd_mixer_open(&snd_mixer_handle, 0);
+    if (snd_mixer_handle == NULL)
+    {
+        WICED_BT_TRACE("alsa_volume_driver_init snd_mixer_open Failed\n");
+        return;
+    }
+    snd_mixer_attach(snd_mixer_handle, "default");
+    snd_mixer_selem_register(snd_mixer_handle, NULL, NULL);
+    snd_mixer_load(snd_mixer_handle);
+
+    snd_mixer_selem_id_malloc(&snd_sid);
+    if (snd_sid == NULL)
+    {
+        alsa_volume_driver_deinit();
+        WICED_BT_TRACE("alsa_volume_driver_init snd_mixer_selem_id_alloca Failed\n");
+        return;
+    }
+    snd_mixer_selem_id_set_index(snd_sid, 0);
+    snd_mixer_selem_id_set_name(snd_sid, "Master");
+
+    snd_mixer_elem = snd_mixer_find_selem(snd_mixer_handle, snd_sid);
+
+    if (snd_mixer_elem)
+    {
+        snd_mixer_selem_get_playback_volume_range(snd_mixer_elem, &vol_min, &vol_max);
+        WICED_BT_TRACE("min volume %ld max volume %ld\n", vol_min, vol_max);
+    }
+    else
+    {
+        alsa_volume_driver_deinit();
+        WICED_BT_TRACE("alsa_volume_driver_init snd_mixer_find_selem Failed\n");
+    }
+}
+
+/*******************************************************************************
+ * Function Name: alsa_backend_set_volume
+ *******************************************************************************
+ * Summary:
+ *   Sets the required volume level in the ALSA driver
+ *
+ * Parameters:
+ *   Required volume
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+static void alsa_backend_set_volume(uint8_t volume)
+{
+    WICED_BT_TRACE("alsa_set_volume volume %d",volume);
+    if (snd_mixer_elem)
+    {
+        snd_mixer_selem_set_playback_volume_all(snd_mixer_elem,  volume * vol_max / 100);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: alsa_playback_open
+ *******************************************************************************
+ * Summary:
+ *   Opens and configures the playback PCM at device_rate
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   None
+ ******************************************************************************/
+static void alsa_playback_open(void)
+{
+    int status;
+
+    WICED_BT_TRACE("snd_pcm_open");
+    status = snd_pcm_open(&(p_alsa_handle), alsa_device, SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK);
+
+    if (status < 0)
+    {
+        WICED_BT_TRACE("snd_pcm_open failed: %s", snd_strerror(status));
+        p_alsa_handle = NULL;
+        return;
+    }
+
+    WICED_BT_TRACE("ALSA driver opened");
+    alsa_tune_init();
+    status = alsa_playback_configure(playback_tune.latency_us);
+    if (status < 0)
+    {
+        WICED_BT_TRACE("snd_pcm_set_params failed: %s", snd_strerror(status));
+        snd_pcm_close(p_alsa_handle);
+        p_alsa_handle = NULL;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: alsa_playback_configure
+ *******************************************************************************
+ * Summary:
+ *   Configures the playback PCM at device_rate with a buffer of latency_us.
+ *   mmap access lets the audio pipeline write straight into the device ring,
+ *   read/write access is used if the device does not support it. The PCM
+ *   must not be running.
+ *
+ * Parameters:
+ *   uint32_t latency_us : playback buffer
+ *
+ * Return:
+ *   int : 0 or the negative snd_pcm_set_params() error
+ *
+ ******************************************************************************/
+static int alsa_playback_configure(uint32_t latency_us)
+{
+    int status = 0;
+
+    playback_mmap = WICED_FALSE;
+    if (hfag_config_get_int(HFAG_CONFIG_ALSA_MMAP, 0) != 0)
+    {
+        status = snd_pcm_set_params(p_alsa_handle,
+                                    format,
+                                    SND_PCM_ACCESS_MMAP_INTERLEAVED,
+                                    AUDIO_DEVICE_CHANNELS,
+                                    device_rate,
+                                    1,
+                                    latency_us);
+        if (status < 0)
+        {
+            WICED_BT_TRACE("mmap access not supported (%s), using read/write access",
+                                                                snd_strerror(status));
+        }
+        else
+        {
+            playback_mmap = WICED_TRUE;
+        }
+    }
+    if (!playback_mmap)
+    {
+        status = snd_pcm_set_params(p_alsa_handle,
+                                    format,
+                                    SND_PCM_ACCESS_RW_INTERLEAVED,
+                                    AUDIO_DEVICE_CHANNELS,
+                                    device_rate,
+                                    1,
+                                    latency_us);
+    }
+    if (status < 0)
+    {
+        return status;
+    }
+    snd_pcm_get_params(p_alsa_handle, &buffer_size, &period_size);
+    WICED_BT_TRACE("playback rate %u latency %u us (%s) bs %lu ps %lu", device_rate, latency_us,
+                                        alsa_tune_state_names[playback_tune.state],
+                                        (unsigned long)buffer_size, (unsigned long)period_size);
+    return 0;
+}
+
+/*******************************************************************************
+ * Function Name: alsa_tune_init
+ *******************************************************************************
+ * Summary:
+ *   Selects the playback buffer of the sink that has just been opened:
+ *   HFAG_ALSA_LATENCY if set, else the tuned value stored for the sink, else
+ *   the smallest buffer, grown by the playback thread during the first call.
+ *   A tuning in progress is kept when the same sink is opened again.
+ *
+ ******************************************************************************/
+static void alsa_tune_init(void)
+{
+    snd_pcm_info_t *p_info = NULL;
+    char key[ALSA_TUNE_LINE_LEN];
+    int latency_us;
+
+    snd_pcm_info_malloc(&p_info);
+    snprintf(key, sizeof(key), "%s %u %s", alsa_device, device_rate,
+                ((p_info != NULL) && (snd_pcm_info(p_alsa_handle, p_info) == 0)) ?
+                                    snd_pcm_info_get_name(p_info) : "");
+    if (p_info != NULL)
+    {
+        snd_pcm_info_free(p_info);
+    }
+
+    latency_us = hfag_config_get_int(HFAG_CONFIG_ALSA_LATENCY, 0);
+    if (latency_us > 0)
+    {
+        playback_tune.state = ALSA_TUNE_FIXED;
+        playback_tune.latency_us = (uint32_t)latency_us;
+        return;
+    }
+    if ((strcmp(key, playback_tune.key) == 0) && (playback_tune.state != ALSA_TUNE_FIXED))
+    {
+        return;
+    }
+    snprintf(playback_tune.key, sizeof(playback_tune.key), "%s", key);
+    playback_tune.saved = WICED_FALSE;
+    if (alsa_tune_load(key, &playback_tune.latency_us))
+    {
+        playback_tune.state = ALSA_TUNE_STORED;
+        return;
+    }
+    playback_tune.state = ALSA_TUNE_RUNNING;
+    playback_tune.latency_us = ALSA_LATENCY_MIN;
+    WICED_BT_TRACE("tuning the playback buffer of %s\n", key);
+}
+
+/*******************************************************************************
+ * Function Name: alsa_tune_load
+ *******************************************************************************
+ * Summary:
+ *   Looks up the playback buffer tuned for a sink in the tuning file, one
+ *   "<latency us> <device> <rate> <PCM name>" line per sink
+ *
+ ******************************************************************************/
+static wiced_bool_t alsa_tune_load(const char *p_key, uint32_t *p_latency_us)
+{
+    const char *p_file = hfag_config_get_str(HFAG_CONFIG_ALSA_LATENCY_FILE, "hfag_alsa_latency.conf");
+    char line[ALSA_TUNE_LINE_LEN + 16];
+    wiced_bool_t found = WICED_FALSE;
+    unsigned int latency_us;
+    FILE *p_fp;
+    int pos;
+
+    p_fp = fopen(p_file, "r");
+    if (p_fp == NULL)
+    {
+        return WICED_FALSE;
+    }
+    while (!found && (fgets(line, sizeof(line), p_fp) != NULL))
+    {
+        line[strcspn(line, "\n")] = '\0';
+        if ((sscanf(line, "%u %n", &latency_us, &pos) == 1) && (strcmp(&line[pos], p_key) == 0) &&
+            (latency_us >= ALSA_LATENCY_MIN) && (latency_us <= ALSA_LATENCY_MAX))
+        {
+            *p_latency_us = latency_us;
+            found = WICED_TRUE;
+        }
+    }
+    fclose(p_fp);
+    return found;
+}
+
+/*******************************************************************************
+ * Function Name: alsa_tune_save
+ *******************************************************************************
+ * Summary:
+ *   Stores the playback buffer tuned for a sink. The tuning file is
+ *   rewritten through a temporary file, entries of other sinks are kept.
+ *
+ ******************************************************************************/
+static void alsa_tune_save(const char *p_key, uint32_t latency_us)
+{
+    const char *p_file = hfag_config_get_str(HFAG_CONFIG_ALSA_LATENCY_FILE, "hfag_alsa_latency.conf");
+    char tmp_file[ALSA_TUNE_LINE_LEN];
+    char line[ALSA_TUNE_LINE_LEN + 16];
+    unsigned int old_us;
+    uint32_t sinks = 0;
+    FILE *p_in;
+    FILE *p_out;
+    int pos;
+
+    snprintf(tmp_file, sizeof(tmp_file), "%s.tmp", p_file);
+    p_out = fopen(tmp_file, "w");
+    if (p_out == NULL)
+    {
+        WICED_BT_TRACE("cannot write %s %d\n", tmp_file, errno);
+        return;
+    }
+    fprintf(p_out, "%u %s\n", latency_us, p_key);
+    p_in = fopen(p_file, "r");
+    if (p_in != NULL)
+    {
+        while ((sinks < (ALSA_TUNE_MAX_SINKS - 1)) && (fgets(line, sizeof(line), p_in) != NULL))
+        {
+            line[strcspn(line, "\n")] = '\0';
+            if ((sscanf(line, "%u %n", &old_us, &pos) == 1) && (strcmp(&line[pos], p_key) != 0))
+            {
+                fprintf(p_out, "%s\n", line);
+                sinks++;
+            }
+        }
+        fclose(p_in);
+    }
+    if ((fclose(p_out) != 0) || (rename(tmp_file, p_file) != 0))
+    {
+        WICED_BT_TRACE("cannot write %s %d\n", p_file, errno);
+        remove(tmp_file);
+        return;
+    }
+    WICED_BT_TRACE("playback buffer %u us stored for %s\n", latency_us, p_key);
+}
+
+/*******************************************************************************
+ * Function Name: alsa_capture_open
+ *******************************************************************************
+ * Summary:
+ *   Opens and configures the capture PCM at device_rate. The SCO uplink
+ *   falls back to loopback if this fails.
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   None
+ ******************************************************************************/
+static void alsa_capture_open(void)
+{
+    snd_pcm_uframes_t capture_buffer_size = 0;
+    int status;
+
+    status = snd_pcm_open(&p_alsa_capture_handle, alsa_capture_device, SND_PCM_STREAM_CAPTURE, SND_PCM_NONBLOCK);
+    if (status < 0)
+    {
+        WICED_BT_TRACE("capture snd_pcm_open failed: %s", snd_strerror(status));
+        p_alsa_capture_handle = NULL;
+        return;
+    }
+    status = snd_pcm_set_params(p_alsa_capture_handle,
+                                format,
+                                SND_PCM_ACCESS_RW_INTERLEAVED,
+                                AUDIO_DEVICE_CHANNELS,
+                                device_rate,
+                                1,
+                                ALSA_CAPTURE_LATENCY);
+    if (status < 0)
+    {
+        WICED_BT_TRACE("capture snd_pcm_set_params failed: %s", snd_strerror(status));
+        snd_pcm_close(p_alsa_capture_handle);
+        p_alsa_capture_handle = NULL;
+        return;
+    }
+    snd_pcm_get_params(p_alsa_capture_handle, &capture_buffer_size, &capture_period_size);
+    WICED_BT_TRACE("capture rate %u bs %d ps %d", device_rate, capture_buffer_size, capture_period_size);
+}
+
+/*******************************************************************************
+ * Function Name: audio_now_ns
+ *******************************************************************************
+ * Summary:
+ *   Returns CLOCK_MONOTONIC in nanoseconds
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   uint64_t : monotonic time
+ *
+ ******************************************************************************/
+static uint64_t audio_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000U) + (uint64_t)ts.tv_nsec;
+}
+
+/*******************************************************************************
+ * Function Name: alsa_stream_recover
+ *******************************************************************************
+ * Summary:
+ *   Recovers a PCM from an xrun or suspend
+ *
+ * Parameters:
+ *   alsa_stream_t *p_stream : playback or capture stream
+ *   int err                 : negative error code returned by ALSA
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the error is not recoverable
+ *
+ ******************************************************************************/
+static wiced_bool_t alsa_stream_recover(alsa_stream_t *p_stream, int err)
+{
+    p_stream->xruns++;
+    err = snd_pcm_recover(*p_stream->pp_handle, err, 1);
+    if (err < 0)
+    {
+        WICED_BT_TRACE("alsa %s recover failed %s\n", p_stream->p_name, snd_strerror(err));
+        p_stream->errors++;
+        return WICED_FALSE;
+    }
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: alsa_stream_wait
+ *******************************************************************************
+ * Summary:
+ *   Sleeps in poll() until at least one block can be transferred without
+ *   blocking, or until the stream thread is asked to stop. A PCM that is
+ *   prepared but not started is started here: a playback buffer that is full
+ *   may never line up with the start threshold and capture needs an
+ *   explicit start.
+ *
+ * Parameters:
+ *   alsa_stream_t *p_stream : playback or capture stream
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE when a block can be transferred, WICED_FALSE if
+ *                  the thread has to exit
+ *
+ ******************************************************************************/
+static wiced_bool_t alsa_stream_wait(alsa_stream_t *p_stream)
+{
+    snd_pcm_t *p_handle = *p_stream->pp_handle;
+    struct pollfd fds[AUDIO_MAX_POLL_FDS + 1];
+    unsigned short revents;
+    snd_pcm_sframes_t avail;
+    uint64_t start;
+    int nfds;
+
+    while (p_stream->running)
+    {
+        avail = snd_pcm_avail_update(p_handle);
+        if (avail < 0)
+        {
+            if (!alsa_stream_recover(p_stream, (int)avail))
+            {
+                return WICED_FALSE;
+            }
+            continue;
+        }
+        if (avail >= (snd_pcm_sframes_t)p_stream->chunk_frames)
+        {
+            return WICED_TRUE;
+        }
+        if (snd_pcm_state(p_handle) == SND_PCM_STATE_PREPARED)
+        {
+            snd_pcm_start(p_handle);
+        }
+
+        nfds = snd_pcm_poll_descriptors(p_handle, fds, AUDIO_MAX_POLL_FDS);
+        if (nfds < 0)
+        {
+            WICED_BT_TRACE("snd_pcm_poll_descriptors failed %s\n", snd_strerror(nfds));
+            return WICED_FALSE;
+        }
+        fds[nfds].fd = p_stream->event_fd;
+        fds[nfds].events = POLLIN;
+        fds[nfds].revents = 0;
+
+        start = audio_now_ns();
+        if (poll(fds, nfds + 1, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            WICED_BT_TRACE("%s poll failed %d\n", p_stream->p_name, errno);
+            return WICED_FALSE;
+        }
+        p_stream->blocked_ns += audio_now_ns() - start;
+        p_stream->wakeups++;
+
+        if (fds[nfds].revents != 0)
+        {
+            break;
+        }
+        snd_pcm_poll_descriptors_revents(p_handle, fds, nfds, &revents);
+        if ((revents & POLLERR) != 0)
+        {
+            if (!alsa_stream_recover(p_stream, -EPIPE))
+            {
+                return WICED_FALSE;
+            }
+        }
+    }
+    return WICED_FALSE;
+}
+
+/*******************************************************************************
+ * Function Name: alsa_stream_start
+ *******************************************************************************
+ * Summary:
+ *   Sets the PCM wake-up threshold to one block and starts the stream
+ *   thread with the audio_rt scheduling policy and CPUs.
+ *
+ * Parameters:
+ *   alsa_stream_t *p_stream     : playback or capture stream
+ *   void *(*p_fn)(void *)       : thread function
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the thread is running
+ *
+ ******************************************************************************/
+static wiced_bool_t alsa_stream_start(alsa_stream_t *p_stream, void *(*p_fn)(void *))
+{
+    snd_pcm_t *p_handle = *p_stream->pp_handle;
+    int status;
+
+    if (p_stream->running)
+    {
+        return WICED_TRUE;
+    }
+    if (snd_pcm_poll_descriptors_count(p_handle) > AUDIO_MAX_POLL_FDS)
+    {
+        WICED_BT_TRACE("too many ALSA %s poll descriptors\n", p_stream->p_name);
+        return WICED_FALSE;
+    }
+
+    p_stream->xruns = 0;
+    p_stream->errors = 0;
+    p_stream->transfers = 0;
+    p_stream->wakeups = 0;
+    p_stream->frames = 0;
+    p_stream->delay = -1;
+    p_stream->blocked_ns = 0;
+    p_stream->transfer_ns = 0;
+
+    alsa_stream_set_avail_min(p_stream);
+    p_stream->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (p_stream->event_fd < 0)
+    {
+        WICED_BT_TRACE("%s eventfd failed %d\n", p_stream->p_name, errno);
+        return WICED_FALSE;
+    }
+    p_stream->running = WICED_TRUE;
+
+    status = audio_rt_thread_create(&p_stream->thread, p_stream->p_name, p_fn, p_stream);
+    if (status != 0)
+    {
+        WICED_BT_TRACE("%s thread create failed %d\n", p_stream->p_name, status);
+        p_stream->running = WICED_FALSE;
+        close(p_stream->event_fd);
+        p_stream->event_fd = -1;
+        return WICED_FALSE;
+    }
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: alsa_stream_set_avail_min
+ *******************************************************************************
+ * Summary:
+ *   Has poll() wake the stream thread only once a whole block can be
+ *   transferred
+ *
+ ******************************************************************************/
+static void alsa_stream_set_avail_min(alsa_stream_t *p_stream)
+{
+    snd_pcm_t *p_handle = *p_stream->pp_handle;
+    snd_pcm_sw_params_t *p_sw_params = NULL;
+    int status;
+
+    if (snd_pcm_sw_params_malloc(&p_sw_params) == 0)
+    {
+        snd_pcm_sw_params_current(p_handle, p_sw_params);
+        snd_pcm_sw_params_set_avail_min(p_handle, p_sw_params, p_stream->chunk_frames);
+        status = snd_pcm_sw_params(p_handle, p_sw_params);
+        if (status < 0)
+        {
+            WICED_BT_TRACE("%s snd_pcm_sw_params failed: %s\n", p_stream->p_name, snd_strerror(status));
+        }
+        snd_pcm_sw_params_free(p_sw_params);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: alsa_stream_stop
+ *******************************************************************************
+ * Summary:
+ *   Wakes the stream thread out of poll() and waits for it to exit
+ *
+ * Parameters:
+ *   alsa_stream_t *p_stream : playback or capture stream
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+static void alsa_stream_stop(alsa_stream_t *p_stream)
+{
+    if (!p_stream->running && !p_stream->failed)
+    {
+        return;
+    }
+    p_stream->running = WICED_FALSE;
+    eventfd_write(p_stream->event_fd, 1);
+    pthread_join(p_stream->thread, NULL);
+    close(p_stream->event_fd);
+    p_stream->event_fd = -1;
+    p_stream->failed = WICED_FALSE;
+}
+
+/*******************************************************************************
+ * Function Name: alsa_stream_exit
+ *******************************************************************************
+ * Summary:
+ *   Called by a stream thread on its way out. A thread that was not asked
+ *   to stop has hit an error it cannot recover from: it is marked as not
+ *   running, so that the next start joins it and starts a new one.
+ *
+ ******************************************************************************/
+static void alsa_stream_exit(alsa_stream_t *p_stream)
+{
+    if (!p_stream->running)
+    {
+        WICED_BT_TRACE("%s thread exit\n", p_stream->p_name);
+        return;
+    }
+    WICED_BT_TRACE("%s thread stopped on an error, restarted with the next call\n", p_stream->p_name);
+    __atomic_store_n(&p_stream->failed, WICED_TRUE, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&p_stream->running, WICED_FALSE, __ATOMIC_SEQ_CST);
+}
+
+/*******************************************************************************
+ * Function Name: alsa_playback_write
+ *******************************************************************************
+ * Summary:
+ *   Writes the supplied PCM frames to ALSA driver without blocking. Called
+ *   from the playback thread only.
+ *
+ * Parameters:
+ *   int16_t *p_pcm       : The PCM buffer to be written
+ *   uint32_t num_frames  : Number of frames in p_pcm
+ *
+ * Return:
+ *   snd_pcm_sframes_t : number of frames written, 0 if none could be written
+ *                       and a negative value on unrecoverable errors
+ *
+ ******************************************************************************/
+static snd_pcm_sframes_t alsa_playback_write(int16_t* p_pcm, uint32_t num_frames)
+{
+    snd_pcm_sframes_t alsa_frames;
+    uint64_t start = audio_now_ns();
+
+    alsa_frames = snd_pcm_writei(p_alsa_handle, p_pcm, num_frames);
+    playback_stream.transfer_ns += audio_now_ns() - start;
+    playback_stream.transfers++;
+
+    HFAG_TRACE_DEBUG(HFAG_TRACE_ALSA_WRITE, alsa_frames);
+    if (alsa_frames == -EAGAIN)
+    {
+        return 0;
+    }
+    if (alsa_frames < 0)
+    {
+        return alsa_stream_recover(&playback_stream, (int)alsa_frames) ? 0 : alsa_frames;
+    }
+    playback_stream.frames += (uint64_t)alsa_frames;
+    if (alsa_frames < (snd_pcm_sframes_t)num_frames)
+    {
+        HFAG_TRACE_INFO(HFAG_TRACE_ALSA_SHORT_WRITE, num_frames, alsa_frames);
+    }
+    return alsa_frames;
+}
+
+/*******************************************************************************
+ * Function Name: alsa_playback_mmap_write
+ *******************************************************************************
+ * Summary:
+ *   Has the audio pipeline fill up to num_frames directly in the mmap area
+ *   of the device ring and commits them. Called from the playback thread
+ *   only.
+ *
+ * Parameters:
+ *   uint32_t num_frames  : Number of frames to write
+ *
+ * Return:
+ *   snd_pcm_sframes_t : number of frames written, 0 if none could be written
+ *                       and a negative value on unrecoverable errors
+ *
+ ******************************************************************************/
+static snd_pcm_sframes_t alsa_playback_mmap_write(uint32_t num_frames)
+{
+    const snd_pcm_channel_area_t *p_areas;
+    snd_pcm_uframes_t offset;
+    snd_pcm_uframes_t frames = num_frames;
+    snd_pcm_sframes_t committed;
+    int16_t *p_dst;
+    uint64_t start = audio_now_ns();
+    int err;
+
+    err = snd_pcm_mmap_begin(p_alsa_handle, &p_areas, &offset, &frames);
+    playback_stream.transfer_ns += audio_now_ns() - start;
+    if (err < 0)
+    {
+        return alsa_stream_recover(&playback_stream, err) ? 0 : err;
+    }
+    if ((p_areas[0].step != (8 * sizeof(int16_t))) || ((p_areas[0].first % 8) != 0))
+    {
+        WICED_BT_TRACE("unsupported mmap layout first %u step %u\n", p_areas[0].first, p_areas[0].step);
+        return -EINVAL;
+    }
+
+    p_dst = (int16_t *)((uint8_t *)p_areas[0].addr + ((p_areas[0].first + (offset * p_areas[0].step)) / 8));
+    playback_stream.p_cb(p_dst, (uint32_t)frames, alsa_stream_delay(&playback_stream));
+
+    start = audio_now_ns();
+    committed = snd_pcm_mmap_commit(p_alsa_handle, offset, frames);
+    playback_stream.transfer_ns += audio_now_ns() - start;
+    playback_stream.transfers++;
+
+    if ((committed >= 0) && (committed != (snd_pcm_sframes_t)frames))
+    {
+        committed = -EPIPE;
+    }
+    if (committed < 0)
+    {
+        return alsa_stream_recover(&playback_stream, (int)committed) ? 0 : committed;
+    }
+    playback_stream.frames += (uint64_t)committed;
+    return committed;
+}
+
+/*******************************************************************************
+ * Function Name: alsa_playback_thread
+ *******************************************************************************
+ * Summary:
+ *   Playback thread. Sleeps until the device can take a block, has the
+ *   audio pipeline fill the block and writes it to the ALSA driver, so the
+ *   thread is paced by the device and ALSA stalls never block the Bluetooth
+ *   stack thread.
+ *   In mmap mode the block is filled straight in the device ring. While the
+ *   playback buffer is tuned the thread also grows it between blocks.
+ *
+ * Parameters:
+ *   arg : playback stream
+ *
+ * Return:
+ *   NULL
+ *
+ ******************************************************************************/
+static void *alsa_playback_thread(void *arg)
+{
+    alsa_stream_t *p_stream = (alsa_stream_t *)arg;
+    int16_t pcm[ALSA_MAX_CHUNK_FRAMES];
+    uint32_t offset = 0; /* frames of pcm already written */
+    snd_pcm_sframes_t written;
+
+    while (alsa_stream_wait(p_stream))
+    {
+        if (playback_mmap)
+        {
+            written = alsa_playback_mmap_write(p_stream->chunk_frames);
+            if ((written < 0) || !alsa_tune_block(p_stream, (uint32_t)written))
+            {
+                break;
+            }
+            continue;
+        }
+        if (offset == 0)
+        {
+            p_stream->p_cb(pcm, p_stream->chunk_frames, alsa_stream_delay(p_stream));
+        }
+        written = alsa_playback_write(&pcm[offset], p_stream->chunk_frames - offset);
+        if (written < 0)
+        {
+            break;
+        }
+        offset += (uint32_t)written;
+        if (offset >= p_stream->chunk_frames)
+        {
+            offset = 0;
+            if (!alsa_tune_block(p_stream, p_stream->chunk_frames))
+            {
+                break;
+            }
+        }
+    }
+    alsa_stream_exit(p_stream);
+    return NULL;
+}
+
+/*******************************************************************************
+ * Function Name: alsa_tune_restart
+ *******************************************************************************
+ * Summary:
+ *   Starts a new tuning window
+ *
+ ******************************************************************************/
+static void alsa_tune_restart(alsa_stream_t *p_stream)
+{
+    playback_tune.frames = 0;
+    playback_tune.xruns = p_stream->xruns;
+    playback_tune.samples = 0;
+    playback_tune.delay_sum = 0;
+    playback_tune.delay_sq_sum = 0;
+}
+
+/*******************************************************************************
+ * Function Name: alsa_tune_block
+ *******************************************************************************
+ * Summary:
+ *   Accounts one written block while the playback buffer is tuned. At the
+ *   end of each window the buffer is kept if there was no xrun and the
+ *   device delay before a write stayed three standard deviations above half
+ *   a block, otherwise it is grown by half. Called from the playback thread
+ *   only.
+ *
+ * Parameters:
+ *   alsa_stream_t *p_stream : playback stream
+ *   uint32_t num_frames     : frames written
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the PCM could not be reconfigured
+ *
+ ******************************************************************************/
+static wiced_bool_t alsa_tune_block(alsa_stream_t *p_stream, uint32_t num_frames)
+{
+    alsa_tune_t *p_tune = &playback_tune;
+    uint64_t margin = p_stream->chunk_frames / 2;
+    uint64_t mean;
+    uint64_t spread;
+    wiced_bool_t stable;
+
+    if (p_tune->state != ALSA_TUNE_RUNNING)
+    {
+        return WICED_TRUE;
+    }
+    p_tune->frames += num_frames;
+    if (p_stream->delay >= 0)
+    {
+        p_tune->samples++;
+        p_tune->delay_sum += (uint64_t)p_stream->delay;
+        p_tune->delay_sq_sum += (uint64_t)p_stream->delay * (uint64_t)p_stream->delay;
+    }
+    if (p_tune->frames < (device_rate * ALSA_TUNE_WINDOW_MS / 1000U))
+    {
+        return WICED_TRUE;
+    }
+
+    /* mean - 3 sd >= margin, scaled by samples^2 to stay in integers */
+    stable = (p_stream->xruns == p_tune->xruns) && (p_tune->samples > 0);
+    if (stable)
+    {
+        mean = p_tune->delay_sum / p_tune->samples;
+        spread = (p_tune->samples * p_tune->delay_sq_sum) - (p_tune->delay_sum * p_tune->delay_sum);
+        stable = (mean >= margin) &&
+                 (((mean - margin) * (mean - margin) * p_tune->samples * p_tune->samples) >= (9 * spread));
+    }
+    WICED_BT_TRACE("playback buffer %u us: %u xruns, mean delay %llu frames\n", p_tune->latency_us,
+                                        p_stream->xruns - p_tune->xruns,
+                                        (unsigned long long)((p_tune->samples > 0) ? (p_tune->delay_sum / p_tune->samples) : 0));
+    if (stable || (p_tune->latency_us >= ALSA_LATENCY_MAX))
+    {
+        p_tune->state = ALSA_TUNE_DONE;
+        return WICED_TRUE;
+    }
+    p_tune->latency_us = MIN(p_tune->latency_us + (p_tune->latency_us / 2), ALSA_LATENCY_MAX);
+    return alsa_tune_apply(p_stream);
+}
+
+/*******************************************************************************
+ * Function Name: alsa_tune_apply
+ *******************************************************************************
+ * Summary:
+ *   Drops the queued audio and reconfigures the running playback PCM with
+ *   the tuned buffer. Called from the playback thread only.
+ *
+ ******************************************************************************/
+static wiced_bool_t alsa_tune_apply(alsa_stream_t *p_stream)
+{
+    int status;
+
+    snd_pcm_drop(p_alsa_handle);
+    status = alsa_playback_configure(playback_tune.latency_us);
+    if (status < 0)
+    {
+        WICED_BT_TRACE("snd_pcm_set_params failed: %s\n", snd_strerror(status));
+        p_stream->errors++;
+        return WICED_FALSE;
+    }
+    p_stream->chunk_frames = alsa_stream_chunk(period_size, p_stream->max_frames);
+    alsa_stream_set_avail_min(p_stream);
+    snd_pcm_prepare(p_alsa_handle);
+    alsa_tune_restart(p_stream);
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: alsa_capture_thread
+ *******************************************************************************
+ * Summary:
+ *   Capture thread. Sleeps until a period of microphone audio is available,
+ *   reads it and hands it to the audio pipeline.
+ *
+ * Parameters:
+ *   arg : capture stream
+ *
+ * Return:
+ *   NULL
+ *
+ ******************************************************************************/
+static void *alsa_capture_thread(void *arg)
+{
+    alsa_stream_t *p_stream = (alsa_stream_t *)arg;
+    int16_t pcm[ALSA_MAX_CHUNK_FRAMES];
+    snd_pcm_sframes_t alsa_frames;
+    uint64_t start;
+
+    while (alsa_stream_wait(p_stream))
+    {
+        start = audio_now_ns();
+        alsa_frames = snd_pcm_readi(p_alsa_capture_handle, pcm, p_stream->chunk_frames);
+        p_stream->transfer_ns += audio_now_ns() - start;
+        p_stream->transfers++;
+
+        if (alsa_frames == -EAGAIN)
+        {
+            continue;
+        }
+        if (alsa_frames < 0)
+        {
+            if (!alsa_stream_recover(p_stream, (int)alsa_frames))
+            {
+                break;
+            }
+            continue;
+        }
+        p_stream->frames += (uint64_t)alsa_frames;
+        p_stream->p_cb(pcm, (uint32_t)alsa_frames, -1);
+    }
+    alsa_stream_exit(p_stream);
+    return NULL;
+}
+
+/*******************************************************************************
+ * Function Name: alsa_stream_delay
+ *******************************************************************************
+ * Summary:
+ *   Returns the delay of a PCM in frames, -1 if it is not known, and keeps
+ *   it for the statistics
+ *
+ ******************************************************************************/
+static int32_t alsa_stream_delay(alsa_stream_t *p_stream)
+{
+    snd_pcm_sframes_t delay = 0;
+
+    if ((snd_pcm_delay(*p_stream->pp_handle, &delay) < 0) || (delay < 0))
+    {
+        p_stream->delay = -1;
+    }
+    else
+    {
+        p_stream->delay = (int32_t)delay;
+    }
+    return p_stream->delay;
+}
+
+/*******************************************************************************
+ * Function Name: alsa_stream_chunk
+ *******************************************************************************
+ * Summary:
+ *   Returns the frames per transfer: as many whole periods as the latency
+ *   deadline allows, so that a small period does not cost one wake-up and
+ *   one write per period. A deadline shorter than one period flushes part
+ *   of a period instead.
+ *
+ ******************************************************************************/
+static uint32_t alsa_stream_chunk(snd_pcm_uframes_t period, uint32_t max_frames)
+{
+    max_frames = MIN(max_frames, ALSA_MAX_CHUNK_FRAMES);
+    if ((period == 0) || (period > max_frames))
+    {
+        return max_frames;
+    }
+    return (uint32_t)(period * (max_frames / period));
+}
+
+/*******************************************************************************
+ * Function Name: alsa_backend_open
+ *******************************************************************************
+ * Summary:
+ *   Opens and configures the PCM of one direction, unless it is already open
+ *
+ * Parameters:
+ *   audio_backend_dir_t dir : playback or capture
+ *   uint32_t sample_rate    : device rate
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the PCM is open
+ *
+ ******************************************************************************/
+static wiced_bool_t alsa_backend_open(audio_backend_dir_t dir, uint32_t sample_rate)
+{
+    device_rate = sample_rate;
+    if (dir == AUDIO_BACKEND_PLAYBACK)
+    {
+        if (p_alsa_handle == NULL)
+        {
+            alsa_playback_open();
+        }
+        return (p_alsa_handle != NULL) ? WICED_TRUE : WICED_FALSE;
+    }
+    if (p_alsa_capture_handle == NULL)
+    {
+        alsa_capture_open();
+    }
+    return (p_alsa_capture_handle != NULL) ? WICED_TRUE : WICED_FALSE;
+}
+
+/*******************************************************************************
+ * Function Name: alsa_backend_close
+ *******************************************************************************
+ * Summary:
+ *   Stops and closes the PCM of one direction
+ *
+ * Parameters:
+ *   audio_backend_dir_t dir : playback or capture
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+static void alsa_backend_close(audio_backend_dir_t dir)
+{
+    snd_pcm_t **pp_handle = (dir == AUDIO_BACKEND_PLAYBACK) ? &p_alsa_handle : &p_alsa_capture_handle;
+
+    alsa_backend_stop(dir);
+    if (*pp_handle != NULL)
+    {
+        WICED_BT_TRACE("snd_pcm_close");
+        snd_pcm_close(*pp_handle);
+        *pp_handle = NULL;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: alsa_backend_start
+ *******************************************************************************
+ * Summary:
+ *   Prepares the PCM of one direction and starts its stream thread, which
+ *   transfers whole periods up to the latency deadline
+ *
+ * Parameters:
+ *   audio_backend_dir_t dir : playback or capture
+ *   uint32_t max_frames     : latency deadline of one block
+ *   audio_backend_cb_t p_cb : called for every block
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the stream thread is running
+ *
+ ******************************************************************************/
+static wiced_bool_t alsa_backend_start(audio_backend_dir_t dir, uint32_t max_frames, audio_backend_cb_t p_cb)
+{
+    alsa_stream_t *p_stream = (dir == AUDIO_BACKEND_PLAYBACK) ? &playback_stream : &capture_stream;
+    snd_pcm_uframes_t period = (dir == AUDIO_BACKEND_PLAYBACK) ? period_size : capture_period_size;
+
+    if (*p_stream->pp_handle == NULL)
+    {
+        return WICED_FALSE;
+    }
+    if (p_stream->running)
+    {
+        return WICED_TRUE;
+    }
+    /* Join a thread that exited on an error */
+    alsa_stream_stop(p_stream);
+
+    p_stream->chunk_frames = alsa_stream_chunk(period, max_frames);
+    p_stream->max_frames = max_frames;
+    p_stream->p_cb = p_cb;
+    WICED_BT_TRACE("%s %u frames per transfer, period %lu\n", p_stream->p_name,
+                                        p_stream->chunk_frames, (unsigned long)period);
+
+    snd_pcm_prepare(*p_stream->pp_handle);
+    if (dir == AUDIO_BACKEND_PLAYBACK)
+    {
+        alsa_tune_restart(p_stream);
+    }
+    return alsa_stream_start(p_stream, (dir == AUDIO_BACKEND_PLAYBACK) ? alsa_playback_thread : alsa_capture_thread);
+}
+
+/*******************************************************************************
+ * Function Name: alsa_backend_stop
+ *******************************************************************************
+ * Summary:
+ *   Stops the stream thread of one direction and drops the queued audio.
+ *   The PCM stays open and configured for the next call. A playback buffer
+ *   tuned during the call is stored for the sink.
+ *
+ * Parameters:
+ *   audio_backend_dir_t dir : playback or capture
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+static void alsa_backend_stop(audio_backend_dir_t dir)
+{
+    alsa_stream_t *p_stream = (dir == AUDIO_BACKEND_PLAYBACK) ? &playback_stream : &capture_stream;
+
+    alsa_stream_stop(p_stream);
+    if (*p_stream->pp_handle != NULL)
+    {
+        snd_pcm_drop(*p_stream->pp_handle);
+    }
+    if (dir == AUDIO_BACKEND_PLAYBACK)
+    {
+        alsa_volume_driver_deinit();
+        if ((playback_tune.state == ALSA_TUNE_DONE) && !playback_tune.saved)
+        {
+            alsa_tune_save(playback_tune.key, playback_tune.latency_us);
+            playback_tune.saved = WICED_TRUE;
+        }
+    }
+}
+
+/*******************************************************************************
+ * Function Name: alsa_backend_get_stats
+ *******************************************************************************
+ * Summary:
+ *   Returns the counters of the stream thread of one direction
+ *
+ * Parameters:
+ *   audio_backend_dir_t dir          : playback or capture
+ *   audio_backend_stats_t *p_stats   : filled with the counters
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+static void alsa_backend_get_stats(audio_backend_dir_t dir, audio_backend_stats_t *p_stats)
+{
+    alsa_stream_t *p_stream = (dir == AUDIO_BACKEND_PLAYBACK) ? &playback_stream : &capture_stream;
+
+    p_stats->p_mode = ((dir == AUDIO_BACKEND_PLAYBACK) && playback_mmap) ? "mmap" : "read/write";
+    p_stats->running = p_stream->running;
+    p_stats->chunk_frames = p_stream->chunk_frames;
+    p_stats->latency_us = (p_stream->delay >= 0) ? (int32_t)((int64_t)p_stream->delay * 1000000 / device_rate) : -1;
+    p_stats->buffer_us = -1;
+    p_stats->p_buffer_mode = NULL;
+    if ((dir == AUDIO_BACKEND_PLAYBACK) && (p_alsa_handle != NULL) && (device_rate != 0))
+    {
+        p_stats->buffer_us = (int32_t)((uint64_t)buffer_size * 1000000U / device_rate);
+        p_stats->p_buffer_mode = alsa_tune_state_names[playback_tune.state];
+    }
+    p_stats->xruns = p_stream->xruns;
+    p_stats->errors = p_stream->errors;
+    p_stats->transfers = p_stream->transfers;
+    p_stats->wakeups = p_stream->wakeups;
+    p_stats->frames = p_stream->frames;
+    p_stats->blocked_ns = p_stream->blocked_ns;
+    p_stats->transfer_ns = p_stream->transfer_ns;
+}
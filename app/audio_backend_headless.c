@@ -0,0 +1,486 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/*******************************************************************************
+ * File Name: audio_backend_headless.c
+ *
+ * Description: This file contains the audio backends that run without a
+ * sound card. A thread per direction is paced by CLOCK_MONOTONIC in place of
+ * the device clock. The null backend discards the playback audio and the
+ * file backend records it to a WAV file, both capture silence.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ ******************************************************************************/
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "audio_backend.h"
+#include "audio_rt.h"
+#include "hfag_config.h"
+#include "wiced_bt_trace.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define HEADLESS_MAX_CHUNK_FRAMES (1024U)
+#define HEADLESS_FILE_DEFAULT     "hfag_playback.wav"
+#define WAV_HEADER_LEN            (44U)
+
+#ifndef MIN
+#define MIN(a, b)                 (((a) < (b)) ? (a) : (b))
+#endif
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+/* Stream thread state, one per direction */
+typedef struct
+{
+    const char *p_name;
+    audio_backend_dir_t dir;
+    pthread_t thread;
+    volatile wiced_bool_t running;
+    audio_backend_cb_t p_cb;              /* audio pipeline */
+    uint32_t chunk_frames;                /* frames per block */
+    uint32_t xruns;                       /* blocks started more than one block late */
+    uint32_t errors;                      /* failed file writes */
+    uint32_t transfers;
+    uint32_t wakeups;
+    uint64_t frames;                      /* frames produced or consumed */
+    uint64_t blocked_ns;                  /* time spent sleeping */
+    uint64_t transfer_ns;                 /* time spent writing the file */
+} headless_stream_t;
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static headless_stream_t headless_streams[AUDIO_BACKEND_DIRECTIONS] =
+{
+    { .p_name = "playback", .dir = AUDIO_BACKEND_PLAYBACK },
+    { .p_name = "capture",  .dir = AUDIO_BACKEND_CAPTURE },
+};
+static uint32_t headless_rate = 0;
+static FILE *p_headless_file = NULL;      /* file backend only */
+static uint32_t headless_file_bytes = 0;  /* PCM bytes in the file */
+
+/*******************************************************************************
+ *       FUNCTION DECLARATION
+ ******************************************************************************/
+static uint64_t headless_now_ns(void);
+static void headless_wav_header(void);
+static void *headless_stream_thread(void *arg);
+static wiced_bool_t null_backend_open(audio_backend_dir_t dir, uint32_t sample_rate);
+static wiced_bool_t file_backend_open(audio_backend_dir_t dir, uint32_t sample_rate);
+static void headless_backend_close(audio_backend_dir_t dir);
+static wiced_bool_t headless_backend_start(audio_backend_dir_t dir, uint32_t max_frames, audio_backend_cb_t p_cb);
+static void headless_backend_stop(audio_backend_dir_t dir);
+static void headless_backend_get_stats(audio_backend_dir_t dir, audio_backend_stats_t *p_stats);
+
+const audio_backend_t audio_backend_null =
+{
+    .p_name = "null",
+    .open = null_backend_open,
+    .close = headless_backend_close,
+    .start = headless_backend_start,
+    .stop = headless_backend_stop,
+    .set_volume = NULL,
+    .get_stats = headless_backend_get_stats,
+};
+
+const audio_backend_t audio_backend_file =
+{
+    .p_name = "file",
+    .open = file_backend_open,
+    .close = headless_backend_close,
+    .start = headless_backend_start,
+    .stop = headless_backend_stop,
+    .set_volume = NULL,
+    .get_stats = headless_backend_get_stats,
+};
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: headless_now_ns
+ *******************************************************************************
+ * Summary:
+ *   Returns CLOCK_MONOTONIC in nanoseconds
+ *
+ ******************************************************************************/
+static uint64_t headless_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000U) + (uint64_t)ts.tv_nsec;
+}
+
+/*******************************************************************************
+ * Function Name: headless_wav_header
+ *******************************************************************************
+ * Summary:
+ *   Writes the WAV header of the recorded playback audio, mono 16-bit PCM at
+ *   the device rate, and moves back to the end of the file
+ *
+ ******************************************************************************/
+static void headless_wav_header(void)
+{
+    uint8_t hdr[WAV_HEADER_LEN];
+    const uint32_t fields[][3] =
+    {
+        /* offset, value, length */
+        { 4,  36U + headless_file_bytes,          4 },
+        { 16, 16,                                 4 },
+        { 20, 1,                                  2 }, /* PCM */
+        { 22, 1,                                  2 }, /* mono */
+        { 24, headless_rate,                      4 },
+        { 28, headless_rate * sizeof(int16_t),    4 },
+        { 32, sizeof(int16_t),                    2 },
+        { 34, 16,                                 2 },
+        { 40, headless_file_bytes,                4 },
+    };
+    uint32_t i;
+    uint32_t j;
+
+    memcpy(&hdr[0], "RIFF", 4);
+    memcpy(&hdr[8], "WAVEfmt ", 8);
+    memcpy(&hdr[36], "data", 4);
+    for (i = 0; i < sizeof(fields) / sizeof(fields[0]); i++)
+    {
+        for (j = 0; j < fields[i][2]; j++)
+        {
+            hdr[fields[i][0] + j] = (uint8_t)(fields[i][1] >> (8 * j));
+        }
+    }
+
+    fseek(p_headless_file, 0, SEEK_SET);
+    fwrite(hdr, 1, sizeof(hdr), p_headless_file);
+    fseek(p_headless_file, 0, SEEK_END);
+    fflush(p_headless_file);
+}
+
+/*******************************************************************************
+ * Function Name: headless_stream_thread
+ *******************************************************************************
+ * Summary:
+ *   Stream thread. Sleeps until the next block is due on the monotonic
+ *   clock and calls the audio pipeline with it: playback blocks are
+ *   discarded or appended to the WAV file, capture blocks are silence.
+ *   Deadlines are derived from the frame count so that the rate does not
+ *   drift, a thread held up by more than one block restarts its clock
+ *   instead of catching up in a burst.
+ *
+ * Parameters:
+ *   arg : playback or capture stream
+ *
+ * Return:
+ *   NULL
+ *
+ ******************************************************************************/
+static void *headless_stream_thread(void *arg)
+{
+    headless_stream_t *p_stream = (headless_stream_t *)arg;
+    int16_t pcm[HEADLESS_MAX_CHUNK_FRAMES];
+    uint64_t base_ns = headless_now_ns();
+    uint64_t base_frames = 0;
+    uint64_t block_ns = (uint64_t)p_stream->chunk_frames * 1000000000U / headless_rate;
+    uint64_t deadline_ns;
+    uint64_t start;
+    uint64_t now;
+    struct timespec deadline;
+    size_t len;
+
+    while (p_stream->running)
+    {
+        deadline_ns = base_ns + ((p_stream->frames + p_stream->chunk_frames - base_frames) * 1000000000U / headless_rate);
+        deadline.tv_sec = (time_t)(deadline_ns / 1000000000U);
+        deadline.tv_nsec = (long)(deadline_ns % 1000000000U);
+
+        start = headless_now_ns();
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+        {
+        }
+        now = headless_now_ns();
+        p_stream->blocked_ns += now - start;
+        p_stream->wakeups++;
+        if (!p_stream->running)
+        {
+            break;
+        }
+        if (now > deadline_ns + block_ns)
+        {
+            p_stream->xruns++;
+            base_ns = now;
+            base_frames = p_stream->frames + p_stream->chunk_frames;
+        }
+
+        if (p_stream->dir == AUDIO_BACKEND_CAPTURE)
+        {
+            memset(pcm, 0, p_stream->chunk_frames * sizeof(int16_t));
+            p_stream->p_cb(pcm, p_stream->chunk_frames, -1);
+        }
+        else
+        {
+            p_stream->p_cb(pcm, p_stream->chunk_frames, 0);
+            if (p_headless_file != NULL)
+            {
+                /* host byte order, WAV is little endian like the supported targets */
+                start = headless_now_ns();
+                len = fwrite(pcm, sizeof(int16_t), p_stream->chunk_frames, p_headless_file);
+                p_stream->transfer_ns += headless_now_ns() - start;
+                headless_file_bytes += (uint32_t)(len * sizeof(int16_t));
+                if (len != p_stream->chunk_frames)
+                {
+                    p_stream->errors++;
+                }
+            }
+        }
+        p_stream->transfers++;
+        p_stream->frames += p_stream->chunk_frames;
+    }
+    WICED_BT_TRACE("%s thread exit\n", p_stream->p_name);
+    return NULL;
+}
+
+/*******************************************************************************
+ * Function Name: null_backend_open
+ *******************************************************************************
+ * Summary:
+ *   Sets the rate of the null backend, there is no device to open
+ *
+ * Parameters:
+ *   audio_backend_dir_t dir : playback or capture
+ *   uint32_t sample_rate    : device rate
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE
+ *
+ ******************************************************************************/
+static wiced_bool_t null_backend_open(audio_backend_dir_t dir, uint32_t sample_rate)
+{
+    (void)dir;
+    headless_rate = sample_rate;
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: file_backend_open
+ *******************************************************************************
+ * Summary:
+ *   Creates the WAV file (HFAG_AUDIO_FILE) the playback audio of all calls
+ *   is recorded to. Capture is silent as with the null backend.
+ *
+ * Parameters:
+ *   audio_backend_dir_t dir : playback or capture
+ *   uint32_t sample_rate    : device rate
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the file cannot be created
+ *
+ ******************************************************************************/
+static wiced_bool_t file_backend_open(audio_backend_dir_t dir, uint32_t sample_rate)
+{
+    const char *p_path;
+
+    headless_rate = sample_rate;
+    if ((dir != AUDIO_BACKEND_PLAYBACK) || (p_headless_file != NULL))
+    {
+        return WICED_TRUE;
+    }
+    p_path = hfag_config_get_str(HFAG_CONFIG_AUDIO_FILE, HEADLESS_FILE_DEFAULT);
+    p_headless_file = fopen(p_path, "wb");
+    if (p_headless_file == NULL)
+    {
+        WICED_BT_TRACE("cannot create %s: %d\n", p_path, errno);
+        return WICED_FALSE;
+    }
+    headless_file_bytes = 0;
+    headless_wav_header();
+    WICED_BT_TRACE("recording playback to %s\n", p_path);
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: headless_backend_close
+ *******************************************************************************
+ * Summary:
+ *   Stops one direction and closes the WAV file of the file backend
+ *
+ * Parameters:
+ *   audio_backend_dir_t dir : playback or capture
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+static void headless_backend_close(audio_backend_dir_t dir)
+{
+    headless_backend_stop(dir);
+    if ((dir == AUDIO_BACKEND_PLAYBACK) && (p_headless_file != NULL))
+    {
+        fclose(p_headless_file);
+        p_headless_file = NULL;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: headless_backend_start
+ *******************************************************************************
+ * Summary:
+ *   Starts the stream thread of one direction, one block per latency
+ *   deadline.
+ *
+ * Parameters:
+ *   audio_backend_dir_t dir : playback or capture
+ *   uint32_t max_frames     : latency deadline of one block
+ *   audio_backend_cb_t p_cb : called for every block
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the stream thread is running
+ *
+ ******************************************************************************/
+static wiced_bool_t headless_backend_start(audio_backend_dir_t dir, uint32_t max_frames, audio_backend_cb_t p_cb)
+{
+    headless_stream_t *p_stream = &headless_streams[dir];
+    int status;
+
+    if (p_stream->running)
+    {
+        return WICED_TRUE;
+    }
+    if (headless_rate == 0)
+    {
+        return WICED_FALSE;
+    }
+
+    p_stream->chunk_frames = MIN(max_frames, HEADLESS_MAX_CHUNK_FRAMES);
+    p_stream->p_cb = p_cb;
+    p_stream->xruns = 0;
+    p_stream->errors = 0;
+    p_stream->transfers = 0;
+    p_stream->wakeups = 0;
+    p_stream->frames = 0;
+    p_stream->blocked_ns = 0;
+    p_stream->transfer_ns = 0;
+    p_stream->running = WICED_TRUE;
+
+    status = audio_rt_thread_create(&p_stream->thread, p_stream->p_name, headless_stream_thread, p_stream);
+    if (status != 0)
+    {
+        WICED_BT_TRACE("%s thread create failed %d\n", p_stream->p_name, status);
+        p_stream->running = WICED_FALSE;
+        return WICED_FALSE;
+    }
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: headless_backend_stop
+ *******************************************************************************
+ * Summary:
+ *   Stops the stream thread of one direction, it exits within one block.
+ *   The WAV header is brought up to date so that the file can be played
+ *   between calls.
+ *
+ * Parameters:
+ *   audio_backend_dir_t dir : playback or capture
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+static void headless_backend_stop(audio_backend_dir_t dir)
+{
+    headless_stream_t *p_stream = &headless_streams[dir];
+
+    if (!p_stream->running)
+    {
+        return;
+    }
+    p_stream->running = WICED_FALSE;
+    pthread_join(p_stream->thread, NULL);
+    if ((dir == AUDIO_BACKEND_PLAYBACK) && (p_headless_file != NULL))
+    {
+        headless_wav_header();
+    }
+}
+
+/*******************************************************************************
+ * Function Name: headless_backend_get_stats
+ *******************************************************************************
+ * Summary:
+ *   Returns the counters of the stream thread of one direction
+ *
+ * Parameters:
+ *   audio_backend_dir_t dir          : playback or capture
+ *   audio_backend_stats_t *p_stats   : filled with the counters
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+static void headless_backend_get_stats(audio_backend_dir_t dir, audio_backend_stats_t *p_stats)
+{
+    headless_stream_t *p_stream = &headless_streams[dir];
+
+    if (dir == AUDIO_BACKEND_CAPTURE)
+    {
+        p_stats->p_mode = "silence";
+    }
+    else
+    {
+        p_stats->p_mode = (p_headless_file != NULL) ? "WAV file" : "discard";
+    }
+    p_stats->running = p_stream->running;
+    p_stats->chunk_frames = p_stream->chunk_frames;
+    p_stats->latency_us = -1;
+    p_stats->buffer_us = -1;
+    p_stats->p_buffer_mode = NULL;
+    p_stats->xruns = p_stream->xruns;
+    p_stats->errors = p_stream->errors;
+    p_stats->transfers = p_stream->transfers;
+    p_stats->wakeups = p_stream->wakeups;
+    p_stats->frames = p_stream->frames;
+    p_stats->blocked_ns = p_stream->blocked_ns;
+    p_stats->transfer_ns = p_stream->transfer_ns;
+}
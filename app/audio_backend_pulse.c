@@ -0,0 +1,439 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/*******************************************************************************
+ * File Name: audio_backend_pulse.c
+ *
+ * Description: This file contains the PulseAudio audio backend. It talks to
+ * the sound server natively (libpulse-simple, also served by pipewire-pulse)
+ * instead of going through the ALSA pulse plugin, and asks the server for
+ * buffers of one quantum so that the stream latency stays at two quanta.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ ******************************************************************************/
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <pulse/error.h>
+#include <pulse/simple.h>
+
+#include "audio_backend.h"
+#include "audio_rt.h"
+#include "hfag_config.h"
+#include "wiced_bt_trace.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define PULSE_APP_NAME            "hfag"
+#define PULSE_MAX_CHUNK_FRAMES    (1024U)
+#define PULSE_TARGET_QUANTA       (2U)    /* server side playback buffer */
+
+#ifndef MIN
+#define MIN(a, b)                 (((a) < (b)) ? (a) : (b))
+#endif
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+/* Stream thread state, one per direction */
+typedef struct
+{
+    const char *p_name;
+    pa_stream_direction_t pa_dir;
+    pa_simple *p_pa;                      /* NULL while the stream is closed */
+    pthread_t thread;
+    volatile wiced_bool_t running;
+    volatile wiced_bool_t failed;         /* thread exited on an error, not joined yet */
+    audio_backend_cb_t p_cb;              /* audio pipeline */
+    uint32_t chunk_frames;                /* frames per transfer */
+    volatile int32_t latency_us;          /* server latency, -1 if not known */
+    uint32_t errors;                      /* failed transfers, the thread exits */
+    uint32_t transfers;
+    uint64_t frames;                      /* frames read or written */
+    uint64_t transfer_ns;                 /* time spent in pa_simple_read/write */
+} pulse_stream_t;
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static pulse_stream_t pulse_streams[AUDIO_BACKEND_DIRECTIONS] =
+{
+    { .p_name = "SCO playback", .pa_dir = PA_STREAM_PLAYBACK, .latency_us = -1 },
+    { .p_name = "SCO capture",  .pa_dir = PA_STREAM_RECORD,   .latency_us = -1 },
+};
+static uint32_t pulse_rate = 0;
+static uint32_t pulse_quantum = 0;        /* frames */
+
+/*******************************************************************************
+ *       FUNCTION DECLARATION
+ ******************************************************************************/
+static uint64_t pulse_now_ns(void);
+static int32_t pulse_stream_latency(pulse_stream_t *p_stream);
+static void *pulse_stream_thread(void *arg);
+static wiced_bool_t pulse_backend_open(audio_backend_dir_t dir, uint32_t sample_rate);
+static void pulse_backend_close(audio_backend_dir_t dir);
+static wiced_bool_t pulse_backend_start(audio_backend_dir_t dir, uint32_t max_frames, audio_backend_cb_t p_cb);
+static void pulse_backend_stop(audio_backend_dir_t dir);
+static void pulse_backend_get_stats(audio_backend_dir_t dir, audio_backend_stats_t *p_stats);
+
+const audio_backend_t audio_backend_pulse =
+{
+    .p_name = "pulse",
+    .open = pulse_backend_open,
+    .close = pulse_backend_close,
+    .start = pulse_backend_start,
+    .stop = pulse_backend_stop,
+    .set_volume = NULL,
+    .get_stats = pulse_backend_get_stats,
+};
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: pulse_now_ns
+ *******************************************************************************
+ * Summary:
+ *   Returns CLOCK_MONOTONIC in nanoseconds
+ *
+ ******************************************************************************/
+static uint64_t pulse_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000U) + (uint64_t)ts.tv_nsec;
+}
+
+/*******************************************************************************
+ * Function Name: pulse_stream_latency
+ *******************************************************************************
+ * Summary:
+ *   Returns the latency reported by the server for a stream in frames, -1
+ *   if it is not known, and keeps it for the statistics. For playback this
+ *   is the audio queued in the server and the sink.
+ *
+ ******************************************************************************/
+static int32_t pulse_stream_latency(pulse_stream_t *p_stream)
+{
+    pa_usec_t latency;
+    int error;
+
+    latency = pa_simple_get_latency(p_stream->p_pa, &error);
+    if (latency == (pa_usec_t)-1)
+    {
+        p_stream->latency_us = -1;
+        return -1;
+    }
+    p_stream->latency_us = (int32_t)latency;
+    return (int32_t)(latency * pulse_rate / 1000000U);
+}
+
+/*******************************************************************************
+ * Function Name: pulse_stream_thread
+ *******************************************************************************
+ * Summary:
+ *   Stream thread. pa_simple_write() and pa_simple_read() block until the
+ *   server can take or deliver one block, so the thread is paced by the
+ *   sink and source clocks. Playback blocks are filled with the server
+ *   latency as the device delay.
+ *
+ * Parameters:
+ *   arg : playback or capture stream
+ *
+ * Return:
+ *   NULL
+ *
+ ******************************************************************************/
+static void *pulse_stream_thread(void *arg)
+{
+    pulse_stream_t *p_stream = (pulse_stream_t *)arg;
+    int16_t pcm[PULSE_MAX_CHUNK_FRAMES];
+    size_t len = p_stream->chunk_frames * sizeof(int16_t);
+    uint64_t start;
+    int status;
+    int error = 0;
+
+    while (p_stream->running)
+    {
+        if (p_stream->pa_dir == PA_STREAM_PLAYBACK)
+        {
+            p_stream->p_cb(pcm, p_stream->chunk_frames, pulse_stream_latency(p_stream));
+            start = pulse_now_ns();
+            status = pa_simple_write(p_stream->p_pa, pcm, len, &error);
+            p_stream->transfer_ns += pulse_now_ns() - start;
+        }
+        else
+        {
+            start = pulse_now_ns();
+            status = pa_simple_read(p_stream->p_pa, pcm, len, &error);
+            p_stream->transfer_ns += pulse_now_ns() - start;
+            if (status >= 0)
+            {
+                p_stream->p_cb(pcm, p_stream->chunk_frames, -1);
+            }
+        }
+        if (status < 0)
+        {
+            WICED_BT_TRACE("%s failed: %s\n", p_stream->p_name, pa_strerror(error));
+            p_stream->errors++;
+            break;
+        }
+        p_stream->transfers++;
+        p_stream->frames += p_stream->chunk_frames;
+    }
+    if (p_stream->running)
+    {
+        /* Not asked to stop, the next start joins this thread and starts
+         * a new one */
+        WICED_BT_TRACE("%s thread stopped on an error, restarted with the next call\n", p_stream->p_name);
+        __atomic_store_n(&p_stream->failed, WICED_TRUE, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&p_stream->running, WICED_FALSE, __ATOMIC_SEQ_CST);
+        return NULL;
+    }
+    WICED_BT_TRACE("%s thread exit\n", p_stream->p_name);
+    return NULL;
+}
+
+/*******************************************************************************
+ * Function Name: pulse_backend_open
+ *******************************************************************************
+ * Summary:
+ *   Connects the stream of one direction to the default sink or source,
+ *   unless it is already connected. The playback buffer is capped at
+ *   PULSE_TARGET_QUANTA quanta and refilled one quantum at a time, capture
+ *   is delivered in fragments of one quantum (HFAG_PULSE_QUANTUM, 10 ms by
+ *   default).
+ *
+ * Parameters:
+ *   audio_backend_dir_t dir : playback or capture
+ *   uint32_t sample_rate    : device rate
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the stream is connected
+ *
+ ******************************************************************************/
+static wiced_bool_t pulse_backend_open(audio_backend_dir_t dir, uint32_t sample_rate)
+{
+    pulse_stream_t *p_stream = &pulse_streams[dir];
+    pa_sample_spec spec;
+    pa_buffer_attr attr;
+    uint32_t quantum_bytes;
+    int quantum;
+    int error = 0;
+
+    if (p_stream->p_pa != NULL)
+    {
+        return WICED_TRUE;
+    }
+
+    pulse_rate = sample_rate;
+    quantum = hfag_config_get_int(HFAG_CONFIG_PULSE_QUANTUM, (int)(sample_rate * AUDIO_BACKEND_CHUNK_MS / 1000));
+    if ((quantum <= 0) || (quantum > (int)PULSE_MAX_CHUNK_FRAMES))
+    {
+        WICED_BT_TRACE("unsupported %s %d\n", HFAG_CONFIG_PULSE_QUANTUM, quantum);
+        quantum = (int)(sample_rate * AUDIO_BACKEND_CHUNK_MS / 1000);
+    }
+    pulse_quantum = (uint32_t)quantum;
+    quantum_bytes = pulse_quantum * sizeof(int16_t);
+
+    spec.format = PA_SAMPLE_S16LE;
+    spec.rate = sample_rate;
+    spec.channels = 1;
+
+    /* (uint32_t)-1 leaves a field to the server */
+    attr.maxlength = (uint32_t)-1;
+    attr.tlength = (dir == AUDIO_BACKEND_PLAYBACK) ? (PULSE_TARGET_QUANTA * quantum_bytes) : (uint32_t)-1;
+    attr.prebuf = (uint32_t)-1;
+    attr.minreq = (dir == AUDIO_BACKEND_PLAYBACK) ? quantum_bytes : (uint32_t)-1;
+    attr.fragsize = (dir == AUDIO_BACKEND_CAPTURE) ? quantum_bytes : (uint32_t)-1;
+
+    p_stream->p_pa = pa_simple_new(NULL, PULSE_APP_NAME, p_stream->pa_dir, NULL, p_stream->p_name,
+                                   &spec, NULL, &attr, &error);
+    if (p_stream->p_pa == NULL)
+    {
+        WICED_BT_TRACE("%s pa_simple_new failed: %s\n", p_stream->p_name, pa_strerror(error));
+        return WICED_FALSE;
+    }
+    WICED_BT_TRACE("%s rate %u quantum %u frames\n", p_stream->p_name, sample_rate, pulse_quantum);
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: pulse_backend_close
+ *******************************************************************************
+ * Summary:
+ *   Stops and disconnects the stream of one direction
+ *
+ * Parameters:
+ *   audio_backend_dir_t dir : playback or capture
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+static void pulse_backend_close(audio_backend_dir_t dir)
+{
+    pulse_stream_t *p_stream = &pulse_streams[dir];
+
+    pulse_backend_stop(dir);
+    if (p_stream->p_pa != NULL)
+    {
+        pa_simple_free(p_stream->p_pa);
+        p_stream->p_pa = NULL;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: pulse_backend_start
+ *******************************************************************************
+ * Summary:
+ *   Drops audio left in the server and starts the stream thread of one
+ *   direction, one quantum per block.
+ *
+ * Parameters:
+ *   audio_backend_dir_t dir : playback or capture
+ *   uint32_t max_frames     : latency deadline of one block
+ *   audio_backend_cb_t p_cb : called for every block
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if the stream thread is running
+ *
+ ******************************************************************************/
+static wiced_bool_t pulse_backend_start(audio_backend_dir_t dir, uint32_t max_frames, audio_backend_cb_t p_cb)
+{
+    pulse_stream_t *p_stream = &pulse_streams[dir];
+    int status;
+    int error;
+
+    if (p_stream->p_pa == NULL)
+    {
+        return WICED_FALSE;
+    }
+    if (p_stream->running)
+    {
+        return WICED_TRUE;
+    }
+    /* Join a thread that exited on an error */
+    pulse_backend_stop(dir);
+
+    pa_simple_flush(p_stream->p_pa, &error);
+    p_stream->chunk_frames = MIN(pulse_quantum, MIN(max_frames, PULSE_MAX_CHUNK_FRAMES));
+    p_stream->p_cb = p_cb;
+    p_stream->latency_us = -1;
+    p_stream->errors = 0;
+    p_stream->transfers = 0;
+    p_stream->frames = 0;
+    p_stream->transfer_ns = 0;
+    p_stream->running = WICED_TRUE;
+
+    status = audio_rt_thread_create(&p_stream->thread, p_stream->p_name, pulse_stream_thread, p_stream);
+    if (status != 0)
+    {
+        WICED_BT_TRACE("%s thread create failed %d\n", p_stream->p_name, status);
+        p_stream->running = WICED_FALSE;
+        return WICED_FALSE;
+    }
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: pulse_backend_stop
+ *******************************************************************************
+ * Summary:
+ *   Stops the stream thread of one direction, it exits within one block,
+ *   and drops the audio queued in the server. The stream stays connected
+ *   for the next call.
+ *
+ * Parameters:
+ *   audio_backend_dir_t dir : playback or capture
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+static void pulse_backend_stop(audio_backend_dir_t dir)
+{
+    pulse_stream_t *p_stream = &pulse_streams[dir];
+    int error;
+
+    if (!p_stream->running && !p_stream->failed)
+    {
+        return;
+    }
+    p_stream->running = WICED_FALSE;
+    pthread_join(p_stream->thread, NULL);
+    pa_simple_flush(p_stream->p_pa, &error);
+    p_stream->failed = WICED_FALSE;
+}
+
+/*******************************************************************************
+ * Function Name: pulse_backend_get_stats
+ *******************************************************************************
+ * Summary:
+ *   Returns the counters of the stream thread of one direction. Blocking in
+ *   the server is counted as transfer time.
+ *
+ * Parameters:
+ *   audio_backend_dir_t dir          : playback or capture
+ *   audio_backend_stats_t *p_stats   : filled with the counters
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+static void pulse_backend_get_stats(audio_backend_dir_t dir, audio_backend_stats_t *p_stats)
+{
+    pulse_stream_t *p_stream = &pulse_streams[dir];
+
+    memset(p_stats, 0, sizeof(*p_stats));
+    p_stats->p_mode = "native stream";
+    p_stats->running = p_stream->running;
+    p_stats->chunk_frames = p_stream->chunk_frames;
+    p_stats->latency_us = p_stream->latency_us;
+    p_stats->buffer_us = -1;
+    p_stats->errors = p_stream->errors;
+    p_stats->transfers = p_stream->transfers;
+    p_stats->wakeups = p_stream->transfers;
+    p_stats->frames = p_stream->frames;
+    p_stats->transfer_ns = p_stream->transfer_ns;
+}
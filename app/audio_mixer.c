@@ -0,0 +1,336 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/*******************************************************************************
+ * File Name: audio_mixer.c
+ *
+ * Description: This file contains the implementation of the block based
+ * conference mixer. Streams are scaled by a Q14 gain and summed in 32 bits,
+ * outputs are saturated to 16 bits. An N-1 mix subtracts the scaled stream
+ * from the sum, which is exact, so the mixes of N streams cost O(N) instead
+ * of O(N^2). The kernels use SSE2 or NEON when the compiler targets them.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ ******************************************************************************/
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "audio_mixer.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define AUDIO_MIXER_ROUND           (1 << (AUDIO_MIXER_GAIN_SHIFT - 1))
+#define AUDIO_MIXER_SIMD_FRAMES     (8U)    /* frames per vector iteration */
+
+#ifndef MIN
+#define MIN(a, b)                   (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b)                   (((a) > (b)) ? (a) : (b))
+#endif
+
+/*******************************************************************************
+ *       FUNCTION DECLARATION
+ ******************************************************************************/
+static inline int32_t audio_mixer_scale(int16_t x, int16_t gain);
+static inline int16_t audio_mixer_saturate(int32_t x);
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: audio_mixer_scale
+ *******************************************************************************
+ * Summary:
+ *   Applies a Q14 gain to one sample with rounding, like the vector kernels
+ *
+ ******************************************************************************/
+static inline int32_t audio_mixer_scale(int16_t x, int16_t gain)
+{
+    return (((int32_t)x * gain) + AUDIO_MIXER_ROUND) >> AUDIO_MIXER_GAIN_SHIFT;
+}
+
+/*******************************************************************************
+ * Function Name: audio_mixer_saturate
+ *******************************************************************************
+ * Summary:
+ *   Clamps a mixed sample to the 16-bit range
+ *
+ ******************************************************************************/
+static inline int16_t audio_mixer_saturate(int32_t x)
+{
+    return (int16_t)MAX(MIN(x, INT16_MAX), INT16_MIN);
+}
+
+#if defined(__SSE2__)
+/*******************************************************************************
+ * Function Name: audio_mixer_scale_sse2
+ *******************************************************************************
+ * Summary:
+ *   Applies a Q14 gain to eight samples, giving eight 32-bit products
+ *
+ ******************************************************************************/
+static inline void audio_mixer_scale_sse2(__m128i x, __m128i gain, __m128i *p_lo, __m128i *p_hi)
+{
+    const __m128i round = _mm_set1_epi32(AUDIO_MIXER_ROUND);
+    __m128i lo = _mm_mullo_epi16(x, gain);
+    __m128i hi = _mm_mulhi_epi16(x, gain);
+
+    *p_lo = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), round), AUDIO_MIXER_GAIN_SHIFT);
+    *p_hi = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), round), AUDIO_MIXER_GAIN_SHIFT);
+}
+#elif defined(__ARM_NEON)
+/*******************************************************************************
+ * Function Name: audio_mixer_scale_neon
+ *******************************************************************************
+ * Summary:
+ *   Applies a Q14 gain to eight samples, giving eight 32-bit products
+ *
+ ******************************************************************************/
+static inline void audio_mixer_scale_neon(int16x8_t x, int16_t gain, int32x4_t *p_lo, int32x4_t *p_hi)
+{
+    *p_lo = vrshrq_n_s32(vmull_n_s16(vget_low_s16(x), gain), AUDIO_MIXER_GAIN_SHIFT);
+    *p_hi = vrshrq_n_s32(vmull_n_s16(vget_high_s16(x), gain), AUDIO_MIXER_GAIN_SHIFT);
+}
+#endif
+
+/*******************************************************************************
+ * Function Name: audio_mixer_begin
+ *******************************************************************************
+ * Summary:
+ *   Starts a new block with an empty mix
+ *
+ * Parameters:
+ *   audio_mixer_t *p_mixer : mixer
+ *   uint32_t num_frames    : frames in the block, at most
+ *                            AUDIO_MIXER_MAX_FRAMES
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void audio_mixer_begin(audio_mixer_t *p_mixer, uint32_t num_frames)
+{
+    p_mixer->num_frames = MIN(num_frames, AUDIO_MIXER_MAX_FRAMES);
+    p_mixer->num_streams = 0;
+    memset(p_mixer->acc, 0, p_mixer->num_frames * sizeof(int32_t));
+}
+
+/*******************************************************************************
+ * Function Name: audio_mixer_add
+ *******************************************************************************
+ * Summary:
+ *   Adds one block of a stream to the mix
+ *
+ * Parameters:
+ *   audio_mixer_t *p_mixer : mixer
+ *   const int16_t *p_in    : num_frames frames of the stream
+ *   int16_t gain           : Q14 gain, AUDIO_MIXER_GAIN_UNITY for 0 dB
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void audio_mixer_add(audio_mixer_t *p_mixer, const int16_t *p_in, int16_t gain)
+{
+    int32_t *p_acc = p_mixer->acc;
+    uint32_t n = p_mixer->num_frames;
+    uint32_t i = 0;
+#if defined(__SSE2__)
+    const __m128i g = _mm_set1_epi16(gain);
+    __m128i x;
+    __m128i lo;
+    __m128i hi;
+
+    for (; (i + AUDIO_MIXER_SIMD_FRAMES) <= n; i += AUDIO_MIXER_SIMD_FRAMES)
+    {
+        x = _mm_loadu_si128((const __m128i *)&p_in[i]);
+        if (gain == AUDIO_MIXER_GAIN_UNITY)
+        {
+            /* sign extend */
+            lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+            hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        }
+        else
+        {
+            audio_mixer_scale_sse2(x, g, &lo, &hi);
+        }
+        _mm_storeu_si128((__m128i *)&p_acc[i],
+                         _mm_add_epi32(_mm_loadu_si128((const __m128i *)&p_acc[i]), lo));
+        _mm_storeu_si128((__m128i *)&p_acc[i + 4],
+                         _mm_add_epi32(_mm_loadu_si128((const __m128i *)&p_acc[i + 4]), hi));
+    }
+#elif defined(__ARM_NEON)
+    int32x4_t lo;
+    int32x4_t hi;
+
+    for (; (i + AUDIO_MIXER_SIMD_FRAMES) <= n; i += AUDIO_MIXER_SIMD_FRAMES)
+    {
+        audio_mixer_scale_neon(vld1q_s16(&p_in[i]), gain, &lo, &hi);
+        vst1q_s32(&p_acc[i], vaddq_s32(vld1q_s32(&p_acc[i]), lo));
+        vst1q_s32(&p_acc[i + 4], vaddq_s32(vld1q_s32(&p_acc[i + 4]), hi));
+    }
+#endif
+    for (; i < n; i++)
+    {
+        p_acc[i] += audio_mixer_scale(p_in[i], gain);
+    }
+    p_mixer->num_streams++;
+}
+
+/*******************************************************************************
+ * Function Name: audio_mixer_output
+ *******************************************************************************
+ * Summary:
+ *   Writes the mix of all streams added so far, saturated to 16 bits
+ *
+ * Parameters:
+ *   const audio_mixer_t *p_mixer : mixer
+ *   int16_t *p_out               : num_frames output frames
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void audio_mixer_output(const audio_mixer_t *p_mixer, int16_t *p_out)
+{
+    const int32_t *p_acc = p_mixer->acc;
+    uint32_t n = p_mixer->num_frames;
+    uint32_t i = 0;
+
+#if defined(__SSE2__)
+    for (; (i + AUDIO_MIXER_SIMD_FRAMES) <= n; i += AUDIO_MIXER_SIMD_FRAMES)
+    {
+        _mm_storeu_si128((__m128i *)&p_out[i],
+                         _mm_packs_epi32(_mm_loadu_si128((const __m128i *)&p_acc[i]),
+                                         _mm_loadu_si128((const __m128i *)&p_acc[i + 4])));
+    }
+#elif defined(__ARM_NEON)
+    for (; (i + AUDIO_MIXER_SIMD_FRAMES) <= n; i += AUDIO_MIXER_SIMD_FRAMES)
+    {
+        vst1q_s16(&p_out[i], vcombine_s16(vqmovn_s32(vld1q_s32(&p_acc[i])),
+                                          vqmovn_s32(vld1q_s32(&p_acc[i + 4]))));
+    }
+#endif
+    for (; i < n; i++)
+    {
+        p_out[i] = audio_mixer_saturate(p_acc[i]);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: audio_mixer_output_without
+ *******************************************************************************
+ * Summary:
+ *   Writes the mix of all streams but one, saturated to 16 bits. p_in and
+ *   gain must be the block and gain the stream was added with.
+ *
+ * Parameters:
+ *   const audio_mixer_t *p_mixer : mixer
+ *   const int16_t *p_in          : block of the stream to leave out
+ *   int16_t gain                 : gain of that stream
+ *   int16_t *p_out               : num_frames output frames
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void audio_mixer_output_without(const audio_mixer_t *p_mixer, const int16_t *p_in, int16_t gain,
+                                int16_t *p_out)
+{
+    const int32_t *p_acc = p_mixer->acc;
+    uint32_t n = p_mixer->num_frames;
+    uint32_t i = 0;
+#if defined(__SSE2__)
+    const __m128i g = _mm_set1_epi16(gain);
+    __m128i lo;
+    __m128i hi;
+
+    for (; (i + AUDIO_MIXER_SIMD_FRAMES) <= n; i += AUDIO_MIXER_SIMD_FRAMES)
+    {
+        audio_mixer_scale_sse2(_mm_loadu_si128((const __m128i *)&p_in[i]), g, &lo, &hi);
+        lo = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)&p_acc[i]), lo);
+        hi = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)&p_acc[i + 4]), hi);
+        _mm_storeu_si128((__m128i *)&p_out[i], _mm_packs_epi32(lo, hi));
+    }
+#elif defined(__ARM_NEON)
+    int32x4_t lo;
+    int32x4_t hi;
+
+    for (; (i + AUDIO_MIXER_SIMD_FRAMES) <= n; i += AUDIO_MIXER_SIMD_FRAMES)
+    {
+        audio_mixer_scale_neon(vld1q_s16(&p_in[i]), gain, &lo, &hi);
+        lo = vsubq_s32(vld1q_s32(&p_acc[i]), lo);
+        hi = vsubq_s32(vld1q_s32(&p_acc[i + 4]), hi);
+        vst1q_s16(&p_out[i], vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+    }
+#endif
+    for (; i < n; i++)
+    {
+        p_out[i] = audio_mixer_saturate(p_acc[i] - audio_mixer_scale(p_in[i], gain));
+    }
+}
+
+/*******************************************************************************
+ * Function Name: audio_mixer_simd_name
+ *******************************************************************************
+ * Summary:
+ *   Returns the instruction set used by the mixing kernels
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   const char * : "sse2", "neon" or "scalar"
+ *
+ ******************************************************************************/
+const char *audio_mixer_simd_name(void)
+{
+#if defined(__SSE2__)
+    return "sse2";
+#elif defined(__ARM_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
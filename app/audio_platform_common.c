@@ -34,7 +34,8 @@
  * File Name: audio_platform_common.c
  *
  * Description: This file contains the of wrapper function implementation for
- * Linux platform specific audio framework (ALSA).
+ * Linux platform specific audio framework. The devices are driven by the
+ * audio backend selected with HFAG_AUDIO_BACKEND (ALSA by default).
  *
  * Related Document: See README.md
  *
@@ -43,330 +44,1459 @@
 /*******************************************************************************
  *      INCLUDES
  ******************************************************************************/
-#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <unistd.h>
+#include <string.h>
+#include <time.h>
 
-#include "alsa/asoundlib.h"
+#include "audio_backend.h"
+#include "audio_mixer.h"
 #include "audio_platform_common.h"
-#include "sbc_decoder.h"
-#include "sbc_dec_func_declare.h"
-#include "sbc_dct.h"
-#include "sbc_types.h"
+#include "audio_ring.h"
+#include "audio_rt.h"
+#include "cvsd_codec.h"
+#include "drift_estimator.h"
+#include "hfag_config.h"
+#include "hfag_trace.h"
+#include "jitter_buffer.h"
+#include "latency_hist.h"
+#include "msbc_codec.h"
+#include "resampler.h"
+#include "sco_recorder.h"
 #include "wiced_bt_trace.h"
 
 /*******************************************************************************
  *       MACROS
  ******************************************************************************/
-#define MSBC_STATIC_MEM_SIZE      (1920U) /* BYTES */
-#define MSBC_SCRATCH_MEM_SIZE     (2048U) /* BYTES */
-#define ALSA_LATENCY              (80000U) /* value based on audio playback
-                                            * testing for better audio*/
+#define AUDIO_PLAYBACK_RING_SIZE  (8192U) /* BYTES, ~256 ms of 16 kHz mono */
+#define AUDIO_UPLINK_RING_SIZE    (4096U) /* BYTES, ~128 ms of 16 kHz mono */
+#define AUDIO_MIC_RING_SIZE       (8192U) /* BYTES, ~85 ms at 48 kHz */
+#define AUDIO_UPLINK_MAX_DEPTH_MS (30U)   /* older microphone audio is dropped */
+#define AUDIO_MAX_CHUNK_FRAMES    (1024U) /* transfer buffer size */
+#define AUDIO_BLOCK_MS_MAX        (20U)   /* longest device block */
+#define AUDIO_DEVICE_RATE_DEFAULT (48000U) /* native rate of most sinks */
+#define AUDIO_DEVICE_RATE_MIN     (8000U)
+#define AUDIO_DEVICE_RATE_MAX     (48000U)
+#define AUDIO_CVSD_CHUNK          (128U)  /* CVSD bytes coded per call */
+#define AUDIO_SESSION_INDEX(p)    ((uint8_t)((p) - audio_sessions))
+
+#ifndef MIN
+#define MIN(a, b)                 (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b)                 (((a) > (b)) ? (a) : (b))
+#endif
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+/* Audio state of one Handsfree Unit. The active flags are only changed
+ * under session_lock, the audio threads skip inactive sessions */
+typedef struct
+{
+    wiced_bool_t playback_active;         /* downlink is mixed by the playback thread */
+    wiced_bool_t uplink_active;           /* uplink is mixed by the playback thread */
+    int16_t mix_gain;                     /* Q14 downlink gain in the conference, under session_lock */
+    uint32_t sample_rate;                 /* SCO PCM rate of the call */
+    /* Host side codecs, only used from the Bluetooth stack thread */
+    wiced_bool_t msbc_active;
+    msbc_decoder_t msbc_decoder;
+    msbc_encoder_t msbc_encoder;
+    wiced_bool_t cvsd_active;             /* narrowband SCO in transparent air mode */
+    cvsd_decoder_t cvsd_decoder;
+    cvsd_encoder_t cvsd_encoder;
+    /* SCO to playback thread hand-off */
+    uint8_t playback_ring_mem[AUDIO_PLAYBACK_RING_SIZE];
+    audio_ring_t playback_ring;
+    jitter_buffer_t playback_jb;
+    resampler_t playback_rs;              /* SCO rate to device rate */
+    drift_estimator_t playback_drift;     /* SCO clock against device clock */
+    uint64_t playback_drift_ns;           /* time of the last estimator update */
+    uint32_t playback_drops;              /* packets received with no playback */
+    int16_t downlink[AUDIO_MAX_CHUNK_FRAMES]; /* last block at the device rate */
+    /* Latency histograms, reset for every call */
+    latency_hist_t latency_hist[AUDIO_LATENCY_STAGES];
+    latency_stamps_t latency_stamps;      /* SCO callback to playback thread */
+    uint32_t latency_last_pos;            /* ring offset of the last stamped packet */
+    /* Playback thread to SCO uplink hand-off */
+    uint8_t uplink_ring_mem[AUDIO_UPLINK_RING_SIZE];
+    audio_ring_t uplink_ring;
+    resampler_t capture_rs;               /* device rate to SCO rate */
+    uint32_t uplink_max_depth;            /* bytes */
+    uint32_t uplink_drops;                /* bytes dropped to bound the uplink latency */
+    uint32_t uplink_underruns;            /* uplink packets padded with silence */
+} audio_session_t;
+
+/* Page faults and context switches of an audio thread since its stream
+ * started, updated by the thread itself once per block */
+typedef struct
+{
+    wiced_bool_t started;
+    audio_rt_usage_t start;
+    audio_rt_usage_t now;
+} audio_rt_track_t;
 
 /*******************************************************************************
  *       VARIABLE DEFINITIONS
  ******************************************************************************/
-/* MSBC Static memory */
-static SINT32 static_mem[MSBC_STATIC_MEM_SIZE / sizeof (SINT32)];
-/* MSBC Scratch memory */
-static SINT32 scratch_mem[MSBC_SCRATCH_MEM_SIZE / sizeof (SINT32)];
-static char *alsa_device = "default";
-static int  PcmBytesPerFrame;
-static  SBC_DEC_PARAMS  strDecParams = { 0 };
-snd_pcm_t *p_alsa_handle = NULL;
-snd_pcm_t *p_alsa_capture_handle = NULL; /* Capture Handle */
-snd_pcm_hw_params_t *params; /* sound pcm hardware params */
-snd_pcm_uframes_t frames;
-uint16_t sample_rate = 0;
-snd_pcm_format_t format;
-static snd_mixer_elem_t* snd_mixer_elem = NULL;
-static snd_mixer_t *snd_mixer_handle = NULL;
-static snd_mixer_selem_id_t *snd_sid = NULL;
-static long vol_max;
-snd_pcm_uframes_t buffer_size = 0;
-snd_pcm_uframes_t period_size = 0;
+static const audio_backend_t *audio_backends[] =
+{
+    &audio_backend_alsa,
+#ifdef HFAG_AUDIO_PULSE
+    &audio_backend_pulse,
+#endif
+    &audio_backend_null,
+    &audio_backend_file,
+};
+static const audio_backend_t *p_backend = NULL;
+static wiced_bool_t playback_open = WICED_FALSE;
+static wiced_bool_t capture_open = WICED_FALSE;
+static wiced_bool_t playback_running = WICED_FALSE;
+static wiced_bool_t capture_running = WICED_FALSE;
+static uint32_t playback_chunk = 0;     /* device frames per playback block */
+static uint32_t capture_chunk = 0;      /* device frames per capture block */
+static uint32_t block_frames = 0;       /* latency deadline of one device block */
+static uint32_t device_rate = 0;        /* rate both devices are kept open at */
+/* One session per Handsfree Unit, indexed by the HFP application handle - 1 */
+static audio_session_t audio_sessions[AUDIO_MAX_SESSIONS];
+static pthread_mutex_t session_lock = PTHREAD_MUTEX_INITIALIZER;
+static audio_mixer_t conference_mixer;  /* playback thread only */
+/* Capture thread to playback thread hand-off, at the device rate */
+static uint8_t mic_ring_mem[AUDIO_MIC_RING_SIZE];
+static audio_ring_t mic_ring;
+static wiced_bool_t mic_primed;         /* enough microphone audio queued to mix */
+static uint32_t mic_drops;              /* bytes dropped to bound the latency */
+static uint32_t mic_underruns;          /* blocks mixed without microphone audio */
+static audio_rt_track_t playback_rt;    /* playback thread only */
+static audio_rt_track_t capture_rt;     /* capture thread only */
+static audio_rt_usage_t process_rt;     /* whole process when playback started */
+static const char *latency_stage_names[AUDIO_LATENCY_STAGES] =
+{
+    "SCO callback to queued",
+    "queued to device write",
+    "resampler and device",
+    "SCO callback to DAC",
+};
 
 /*******************************************************************************
  *       FUNCTION DECLARATION
  ******************************************************************************/
-static void alsa_volume_driver_deinit(void);
+static uint64_t audio_now_ns(void);
+static void audio_playback_track_drift(audio_session_t *p_session, int32_t delay, uint32_t num_frames);
+static void audio_playback_render(audio_session_t *p_session, int16_t *p_out, uint32_t num_frames);
+static void audio_playback_fill(int16_t *p_out, uint32_t num_frames, int32_t delay);
+static void audio_playback_track_latency(int32_t delay);
+static void audio_rt_track(audio_rt_track_t *p_track);
+static void audio_rt_print_usage(const char *p_name, const audio_rt_usage_t *p_start, const audio_rt_usage_t *p_now);
+static void audio_playback_start(void);
+static wiced_bool_t audio_session_playback_init(audio_session_t *p_session);
+static void audio_capture_write(int16_t *p_pcm, uint32_t num_frames, int32_t delay);
+static void audio_capture_start(void);
+static wiced_bool_t audio_session_uplink_init(audio_session_t *p_session);
+static void audio_mic_read(int16_t *p_pcm, uint32_t num_frames);
+static void audio_uplink_mix(int16_t *p_mic, uint32_t num_frames);
+static void audio_session_stop(audio_session_t *p_session);
+static wiced_bool_t audio_sessions_idle(void);
+static audio_session_t *audio_session_get(uint8_t session);
+static void audio_latency_queued(audio_session_t *p_session, uint64_t rx_ns);
+static void audio_msbc_decode(audio_session_t *p_session, const uint8_t* p_data, uint16_t len);
+static void audio_cvsd_decode(audio_session_t *p_session, const uint8_t* p_data, uint16_t len);
+static wiced_bool_t audio_capture_read_pcm(audio_session_t *p_session, uint8_t* p_data, uint16_t len);
+static wiced_bool_t audio_msbc_encode(audio_session_t *p_session, uint8_t* p_data, uint16_t len);
+static wiced_bool_t audio_cvsd_encode(audio_session_t *p_session, uint8_t* p_data, uint16_t len);
 
 /*******************************************************************************
  *       FUNCTION DEFINITION
  ******************************************************************************/
 
 /*******************************************************************************
- * function name: alsa_volume_driver_deinit
+ * Function Name: alsa_set_volume
+ *******************************************************************************
+ * Summary:
+ *   Sets the required volume level of the playback device, if the audio
+ *   backend has a volume control
+ *
+ * Parameters:
+ *   Required volume
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void alsa_set_volume(uint8_t volume)
+{
+    if ((p_backend != NULL) && (p_backend->set_volume != NULL))
+    {
+        p_backend->set_volume(volume);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: init_audio
  *******************************************************************************
- * summary:
- *   de-initializes the alsa volume driver
+ * Summary:
+ *   Starts the audio of one Handsfree Unit: initializes its host side codec,
+ *   mSBC for wideband speech or CVSD for narrowband speech in transparent
+ *   air mode, and adds it to the conference of the running audio threads.
+ *   The threads are started with the first session.
  *
- * parameters:
- *   none
+ * Parameters:
+ *   uint8_t session                         : session index, HFP handle - 1
+ *   playback_config_params pb_config_params : alsa configurations to be set
  *
- * return:
- *   none
+ * Return:
+ *   NONE
  *
  ******************************************************************************/
-static void alsa_volume_driver_deinit(void)
+void init_audio(uint8_t session, playback_config_params pb_config_params)
 {
-    if (snd_mixer_handle != NULL)
+    audio_session_t *p_session = audio_session_get(session);
+    wiced_bool_t playback;
+    wiced_bool_t uplink;
+
+    WICED_BT_TRACE("init_audio entry session %u", session);
+    if (p_session == NULL)
+    {
+        return;
+    }
+    audio_session_stop(p_session);
+    sco_recorder_stop(session);
+
+    p_session->sample_rate = (uint32_t)pb_config_params.sampling_freq;
+
+    p_session->msbc_active = pb_config_params.msbc ? WICED_TRUE : WICED_FALSE;
+    if (p_session->msbc_active)
+    {
+        p_session->sample_rate = MSBC_SAMPLE_RATE;
+        msbc_decoder_init(&p_session->msbc_decoder);
+        msbc_encoder_init(&p_session->msbc_encoder);
+    }
+
+    p_session->cvsd_active = (!p_session->msbc_active && pb_config_params.cvsd) ? WICED_TRUE : WICED_FALSE;
+    if (p_session->cvsd_active)
+    {
+        p_session->sample_rate = CVSD_PCM_RATE;
+        cvsd_decoder_init(&p_session->cvsd_decoder);
+        cvsd_encoder_init(&p_session->cvsd_encoder);
+    }
+
+    WICED_BT_TRACE("nblocks %d nchannels %d nsubbands %d ameth %d freq %d msbc %d cvsd %d",
+                        pb_config_params.num_of_blocks, pb_config_params.num_of_channels,
+                        pb_config_params.num_of_subbands, pb_config_params.allocation_method,
+                        p_session->sample_rate, p_session->msbc_active, p_session->cvsd_active);
+
+    /* The devices normally stay open since open_audio_session(), this only
+     * retries a device that could not be opened before */
+    open_audio_session();
+
+    /* The playback thread runs the conference, both directions follow the
+     * device clock */
+    playback = WICED_FALSE;
+    uplink = WICED_FALSE;
+    if (playback_open)
     {
-        snd_mixer_close(snd_mixer_handle);
-        snd_mixer_handle = NULL;
+        audio_playback_start();
+        playback = playback_running && audio_session_playback_init(p_session);
+        uplink = playback && audio_session_uplink_init(p_session);
     }
-    if (snd_sid != NULL)
+    /* Without a microphone the Handsfree Units only hear each other */
+    if (capture_open)
     {
-        snd_mixer_selem_id_free(snd_sid);
-        snd_sid = NULL;
+        audio_capture_start();
     }
-    snd_mixer_elem = NULL;
+
+    sco_recorder_start(session, p_session->sample_rate);
+
+    /* Hand the session over to the audio threads */
+    pthread_mutex_lock(&session_lock);
+    p_session->playback_active = playback;
+    p_session->uplink_active = uplink;
+    pthread_mutex_unlock(&session_lock);
 }
 
 /*******************************************************************************
- * Function Name: alsa_volume_driver_init
+ * Function Name: deinit_audio
  *******************************************************************************
  * Summary:
- *   Initializes the ALSA Volume Driver
+ *   Removes one Handsfree Unit from the audio threads at the end of its call.
+ *   The backend threads are stopped with the last session, the devices stay
+ *   open and configured for the next call.
  *
  * Parameters:
- *   None
+ *   uint8_t session : session index, HFP handle - 1
  *
  * Return:
  *   None
- *
  ******************************************************************************/
-static void alsa_volume_driver_init(void)
+void deinit_audio(uint8_t session)
 {
-    long vol_min;
-    WICED_BT_TRACE("alsa_volume_driver_init\n");
-
-    alsa_volume_driver_deinit();
+    audio_session_t *p_session = audio_session_get(session);
 
-    snd_mixer_open(&snd_mixer_handle, 0);
-    if (snd_mixer_handle == NULL)
+    WICED_BT_TRACE("deinit_audio session %u", session);
+    if (p_session != NULL)
+    {
+        audio_session_stop(p_session);
+    }
+    sco_recorder_stop(session);
+    if (!audio_sessions_idle())
     {
-        WICED_BT_TRACE("alsa_volume_driver_init snd_mixer_open Failed\n");
         return;
     }
-    snd_mixer_attach(snd_mixer_handle, "default");
-    snd_mixer_selem_register(snd_mixer_handle, NULL, NULL);
-    snd_mixer_load(snd_mixer_handle);
-
-    snd_mixer_selem_id_malloc(&snd_sid);
-    if (snd_sid == NULL)
+    if (p_backend == NULL)
     {
-        alsa_volume_driver_deinit();
-        WICED_BT_TRACE("alsa_volume_driver_init snd_mixer_selem_id_alloca Failed\n");
         return;
     }
-    snd_mixer_selem_id_set_index(snd_sid, 0);
-    snd_mixer_selem_id_set_name(snd_sid, "Master");
-
-    snd_mixer_elem = snd_mixer_find_selem(snd_mixer_handle, snd_sid);
+    p_backend->stop(AUDIO_BACKEND_PLAYBACK);
+    p_backend->stop(AUDIO_BACKEND_CAPTURE);
+    playback_running = WICED_FALSE;
+    capture_running = WICED_FALSE;
+}
 
-    if (snd_mixer_elem)
+/*******************************************************************************
+ * Function Name: audio_session_get
+ *******************************************************************************
+ * Summary:
+ *   Returns the session of an index, NULL if the index is out of range
+ *
+ ******************************************************************************/
+static audio_session_t *audio_session_get(uint8_t session)
+{
+    if (session >= AUDIO_MAX_SESSIONS)
     {
-        snd_mixer_selem_get_playback_volume_range(snd_mixer_elem, &vol_min, &vol_max);
-        WICED_BT_TRACE("min volume %ld max volume %ld\n", vol_min, vol_max);
+        HFAG_TRACE_ERROR(HFAG_TRACE_SESSION_INVALID, session);
+        return NULL;
     }
-    else
+    return &audio_sessions[session];
+}
+
+/*******************************************************************************
+ * Function Name: audio_session_stop
+ *******************************************************************************
+ * Summary:
+ *   Takes a session away from the audio threads. Once the lock is released
+ *   neither thread touches the session until it is started again.
+ *
+ ******************************************************************************/
+static void audio_session_stop(audio_session_t *p_session)
+{
+    pthread_mutex_lock(&session_lock);
+    p_session->playback_active = WICED_FALSE;
+    p_session->uplink_active = WICED_FALSE;
+    pthread_mutex_unlock(&session_lock);
+}
+
+/*******************************************************************************
+ * Function Name: audio_sessions_idle
+ *******************************************************************************
+ * Summary:
+ *   Checks whether any Handsfree Unit still has audio
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if no session is active
+ *
+ ******************************************************************************/
+static wiced_bool_t audio_sessions_idle(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < AUDIO_MAX_SESSIONS; i++)
     {
-        alsa_volume_driver_deinit();
-        WICED_BT_TRACE("alsa_volume_driver_init snd_mixer_find_selem Failed\n");
+        if (audio_sessions[i].playback_active || audio_sessions[i].uplink_active)
+        {
+            return WICED_FALSE;
+        }
     }
+    return WICED_TRUE;
 }
 
 /*******************************************************************************
- * Function Name: alsa_set_volume
+ * Function Name: open_audio_session
  *******************************************************************************
  * Summary:
- *   Sets the required volume level in the ALSA driver
+ *   Selects the audio backend (HFAG_AUDIO_BACKEND, ALSA by default) and
+ *   opens the playback and capture devices at their native rate
+ *   (HFAG_ALSA_RATE, 48 kHz by default) for the life of the process, so that
+ *   a call only has to prepare and start them. SCO audio is resampled
+ *   in-process. The real-time settings are applied and the audio state is
+ *   prefaulted before the first call.
  *
  * Parameters:
- *   Required volume
+ *   None
  *
  * Return:
- *   status code
+ *   None
+ ******************************************************************************/
+void open_audio_session(void)
+{
+    const char *p_name;
+    uint32_t i;
+    int rate;
+    int block_ms;
+
+    if (device_rate == 0)
+    {
+        audio_rt_init();
+        audio_rt_prefault(audio_sessions, sizeof(audio_sessions));
+        audio_rt_prefault(&conference_mixer, sizeof(conference_mixer));
+        audio_rt_prefault(mic_ring_mem, sizeof(mic_ring_mem));
+        sco_recorder_init();
+
+        p_name = hfag_config_get_str(HFAG_CONFIG_AUDIO_BACKEND, audio_backend_alsa.p_name);
+        p_backend = &audio_backend_alsa;
+        for (i = 0; i < sizeof(audio_backends) / sizeof(audio_backends[0]); i++)
+        {
+            if (strcmp(p_name, audio_backends[i]->p_name) == 0)
+            {
+                p_backend = audio_backends[i];
+                break;
+            }
+        }
+        if (strcmp(p_name, p_backend->p_name) != 0)
+        {
+            WICED_BT_TRACE("unknown %s %s, using %s\n", HFAG_CONFIG_AUDIO_BACKEND, p_name, p_backend->p_name);
+        }
+
+        rate = hfag_config_get_int(HFAG_CONFIG_ALSA_RATE, AUDIO_DEVICE_RATE_DEFAULT);
+        if ((rate < (int)AUDIO_DEVICE_RATE_MIN) || (rate > (int)AUDIO_DEVICE_RATE_MAX))
+        {
+            WICED_BT_TRACE("unsupported %s %d, using %u\n", HFAG_CONFIG_ALSA_RATE, rate, AUDIO_DEVICE_RATE_DEFAULT);
+            rate = AUDIO_DEVICE_RATE_DEFAULT;
+        }
+        device_rate = (uint32_t)rate;
+        block_ms = hfag_config_get_int(HFAG_CONFIG_AUDIO_BLOCK_MS, AUDIO_BACKEND_CHUNK_MS);
+        if ((block_ms < 1) || (block_ms > (int)AUDIO_BLOCK_MS_MAX))
+        {
+            WICED_BT_TRACE("unsupported %s %d, using %u\n", HFAG_CONFIG_AUDIO_BLOCK_MS, block_ms, AUDIO_BACKEND_CHUNK_MS);
+            block_ms = AUDIO_BACKEND_CHUNK_MS;
+        }
+        block_frames = MIN(device_rate * (uint32_t)block_ms / 1000, AUDIO_MAX_CHUNK_FRAMES);
+        for (i = 0; i < AUDIO_MAX_SESSIONS; i++)
+        {
+            drift_estimator_init(&audio_sessions[i].playback_drift);
+            audio_sessions[i].mix_gain = AUDIO_MIXER_GAIN_UNITY;
+        }
+        audio_ring_init(&mic_ring, mic_ring_mem, sizeof(mic_ring_mem));
+    }
+    playback_open = p_backend->open(AUDIO_BACKEND_PLAYBACK, device_rate);
+    capture_open = p_backend->open(AUDIO_BACKEND_CAPTURE, device_rate);
+}
+
+/*******************************************************************************
+ * Function Name: close_audio_session
+ *******************************************************************************
+ * Summary:
+ *   Stops the audio of every Handsfree Unit and closes the devices
+ *
+ * Parameters:
+ *   None
  *
+ * Return:
+ *   None
  ******************************************************************************/
-void alsa_set_volume(uint8_t volume)
+void close_audio_session(void)
 {
-    WICED_BT_TRACE("alsa_set_volume volume %d",volume);
-    if (snd_mixer_elem)
+    uint8_t i;
+
+    for (i = 0; i < AUDIO_MAX_SESSIONS; i++)
+    {
+        deinit_audio(i);
+    }
+    if (p_backend != NULL)
     {
-        snd_mixer_selem_set_playback_volume_all(snd_mixer_elem,  volume * vol_max / 100);
+        p_backend->close(AUDIO_BACKEND_PLAYBACK);
+        p_backend->close(AUDIO_BACKEND_CAPTURE);
     }
+    sco_recorder_deinit();
+    playback_open = WICED_FALSE;
+    capture_open = WICED_FALSE;
 }
 
 /*******************************************************************************
- * Function Name: init_audio
+ * Function Name: audio_now_ns
  *******************************************************************************
  * Summary:
- *   Initializes the ALSA driver and initializes SBC
+ *   Returns CLOCK_MONOTONIC in nanoseconds
  *
  * Parameters:
- *   playback_config_params pb_config_params : alsa configurations to be set
+ *   None
  *
  * Return:
- *   NONE
+ *   uint64_t : monotonic time
+ *
+ ******************************************************************************/
+static uint64_t audio_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000U) + (uint64_t)ts.tv_nsec;
+}
+
+/*******************************************************************************
+ * Function Name: audio_playback_track_drift
+ *******************************************************************************
+ * Summary:
+ *   Feeds the jitter buffer depth of a session and the device delay to the
+ *   drift estimator of the session and applies its ratio correction to the
+ *   playback resampler. Every Handsfree Unit runs its own SCO clock, so each
+ *   session follows its own clock into the shared device.
+ *   The jitter buffer starts dropping audio once the depth exceeds the
+ *   block, the target and the hysteresis, the peak depth is held half way
+ *   into the hysteresis instead. Called from the playback thread only.
+ *
+ * Parameters:
+ *   audio_session_t *p_session : active session
+ *   int32_t delay              : device delay in frames
+ *   uint32_t num_frames        : device frames about to be produced
+ *
+ * Return:
+ *   None
  *
  ******************************************************************************/
-void init_audio(playback_config_params pb_config_params)
+static void audio_playback_track_drift(audio_session_t *p_session, int32_t delay, uint32_t num_frames)
 {
-    int status;
+    jitter_buffer_level_t level;
+    uint64_t now = audio_now_ns();
+    double dt_ms = (p_session->playback_drift_ns != 0) ?
+                        ((double)(now - p_session->playback_drift_ns) / 1000000.0) : 0.0;
+    double depth_error_ms;
+    int32_t ppb;
+
+    p_session->playback_drift_ns = now;
+    jitter_buffer_get_level(&p_session->playback_jb, &level);
+    depth_error_ms = ((double)level.fill + level.since_arrival
+                            - resampler_input_frames(&p_session->playback_rs, num_frames)
+                            - level.target - (level.hysteresis / 2.0)) * 1000.0 / p_session->sample_rate;
 
-    WICED_BT_TRACE("init_audio entry");
+    ppb = drift_estimator_update(&p_session->playback_drift, depth_error_ms, (double)delay * 1000.0 / device_rate,
+                                 dt_ms, level.playing);
+    resampler_set_drift(&p_session->playback_rs, ppb);
+}
 
-    memset (static_mem, 0, sizeof (static_mem));
-    memset (scratch_mem, 0, sizeof (scratch_mem));
-    memset (&strDecParams, 0, sizeof (strDecParams));
+/*******************************************************************************
+ * Function Name: audio_playback_track_latency
+ *******************************************************************************
+ * Summary:
+ *   Called for every block handed to the device. Records, for every active
+ *   session, the resampler and device delay, and the queueing and
+ *   end-to-end latency of the packets the jitter buffer has fully handed
+ *   out. Called from the playback thread with session_lock held.
+ *
+ * Parameters:
+ *   int32_t delay : device delay in frames once the block is queued
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+static void audio_playback_track_latency(int32_t delay)
+{
+    audio_session_t *p_session;
+    uint64_t now = audio_now_ns();
+    uint64_t device_us;
+    uint64_t rx_ns;
+    uint64_t queued_ns;
+    uint32_t i;
 
-    strDecParams.s32StaticMem  = static_mem;
-    strDecParams.s32ScratchMem = scratch_mem;
+    for (i = 0; i < AUDIO_MAX_SESSIONS; i++)
+    {
+        p_session = &audio_sessions[i];
+        if (!p_session->playback_active)
+        {
+            continue;
+        }
+        /* the resampler holds half of its taps at the SCO rate */
+        device_us = ((uint64_t)delay * 1000000U / device_rate) +
+                    ((uint64_t)(p_session->playback_rs.taps / 2U) * 1000000U / p_session->sample_rate);
+        latency_hist_record(&p_session->latency_hist[AUDIO_LATENCY_DEVICE], device_us);
 
-    strDecParams.numOfBlocks = pb_config_params.num_of_blocks;
-    strDecParams.numOfChannels = pb_config_params.num_of_channels;
-    strDecParams.numOfSubBands =  pb_config_params.num_of_subbands;
-    strDecParams.allocationMethod = pb_config_params.allocation_method;
-    sample_rate = pb_config_params.sampling_freq;
-    format = SND_PCM_FORMAT_S16_LE; /* SND_PCM_FORMAT_U8; */
+        while (latency_stamps_pop(&p_session->latency_stamps, p_session->playback_ring.tail, &rx_ns, &queued_ns))
+        {
+            latency_hist_record(&p_session->latency_hist[AUDIO_LATENCY_QUEUE], (now - queued_ns) / 1000U);
+            latency_hist_record(&p_session->latency_hist[AUDIO_LATENCY_TOTAL], ((now - rx_ns) / 1000U) + device_us);
+        }
+    }
+}
 
-    SBC_Decoder_decode_Init (&strDecParams);
+/*******************************************************************************
+ * Function Name: audio_playback_render
+ *******************************************************************************
+ * Summary:
+ *   Produces num_frames frames at the device rate from the jitter buffer of
+ *   one session, following its SCO clock
+ *
+ ******************************************************************************/
+static void audio_playback_render(audio_session_t *p_session, int16_t *p_out, uint32_t num_frames)
+{
+    int16_t sco_pcm[JB_MAX_CHUNK_SAMPLES];
+    uint32_t need;
+    uint32_t produced;
 
-    WICED_BT_TRACE("nblocks %d nchannels %d nsubbands %d ameth %d freq %d format %d latency = %d",
-                        strDecParams.numOfBlocks , strDecParams.numOfChannels, strDecParams.numOfSubBands,
-                        strDecParams.allocationMethod, sample_rate, format, ALSA_LATENCY);
+    need = MIN(resampler_input_frames(&p_session->playback_rs, num_frames), JB_MAX_CHUNK_SAMPLES);
+    jitter_buffer_get(&p_session->playback_jb, sco_pcm, need);
+    produced = resampler_process(&p_session->playback_rs, sco_pcm, need, p_out, num_frames);
+    if (produced < num_frames)
+    {
+        memset(&p_out[produced], 0, (num_frames - produced) * sizeof(int16_t));
+    }
+}
 
-    PcmBytesPerFrame = strDecParams.numOfBlocks * strDecParams.numOfChannels * strDecParams.numOfSubBands * 2;
-    printf("PcmBytesPerFrame = %d\n",PcmBytesPerFrame);
+/*******************************************************************************
+ * Function Name: audio_playback_fill
+ *******************************************************************************
+ * Summary:
+ *   Playback callback of the audio backend. Produces num_frames frames at
+ *   the device rate: the downlinks of all active sessions mixed with their
+ *   gains, or silence while no Handsfree Unit has audio. The uplinks of the
+ *   same block are mixed on the way. Called from the playback thread only.
+ *
+ * Parameters:
+ *   int16_t *p_out       : output buffer
+ *   uint32_t num_frames  : frames to produce, at most one chunk
+ *   int32_t delay        : device delay in frames, negative if not known
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+static void audio_playback_fill(int16_t *p_out, uint32_t num_frames, int32_t delay)
+{
+    int16_t mic[AUDIO_MAX_CHUNK_FRAMES];
+    audio_session_t *p_session;
+    wiced_bool_t uplink = WICED_FALSE;
+    uint32_t i;
 
-    /* If ALSA PCM driver was already open => close it */
-    if (p_alsa_handle != NULL)
+    pthread_mutex_lock(&session_lock);
+    audio_mixer_begin(&conference_mixer, num_frames);
+    for (i = 0; i < AUDIO_MAX_SESSIONS; i++)
     {
-        WICED_BT_TRACE("snd_pcm_close");
-        snd_pcm_close(p_alsa_handle);
-        p_alsa_handle = NULL;
+        p_session = &audio_sessions[i];
+        if (!p_session->playback_active)
+        {
+            continue;
+        }
+        if (delay >= 0)
+        {
+            audio_playback_track_drift(p_session, delay, num_frames);
+        }
+        audio_playback_render(p_session, p_session->downlink, num_frames);
+        audio_mixer_add(&conference_mixer, p_session->downlink, p_session->mix_gain);
+        uplink = uplink || p_session->uplink_active;
     }
-    WICED_BT_TRACE("snd_pcm_open");
-    status = snd_pcm_open(&(p_alsa_handle), alsa_device, SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK);
+    audio_mixer_output(&conference_mixer, p_out);
 
-    if (status < 0)
+    if (uplink)
     {
-        WICED_BT_TRACE("snd_pcm_open failed: %s", snd_strerror(status));
+        audio_mic_read(mic, num_frames);
+        audio_uplink_mix(mic, num_frames);
     }
-    else
+    audio_playback_track_latency(MAX(delay, 0) + (int32_t)num_frames);
+    pthread_mutex_unlock(&session_lock);
+    audio_rt_track(&playback_rt);
+}
+
+/*******************************************************************************
+ * Function Name: audio_rt_track
+ *******************************************************************************
+ * Summary:
+ *   Samples the page fault and context switch counters of the calling audio
+ *   thread, the first sample of a stream is the baseline
+ *
+ ******************************************************************************/
+static void audio_rt_track(audio_rt_track_t *p_track)
+{
+    audio_rt_get_usage(WICED_TRUE, &p_track->now);
+    if (!p_track->started)
+    {
+        p_track->start = p_track->now;
+        p_track->started = WICED_TRUE;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: audio_mic_read
+ *******************************************************************************
+ * Summary:
+ *   Takes one block of microphone audio out of the mic ring. The ring is
+ *   primed with one capture and one playback block so that the two threads
+ *   can run with different block sizes, audio beyond twice that is dropped.
+ *   Silence is used while no microphone audio is available. Called from the
+ *   playback thread only.
+ *
+ ******************************************************************************/
+static void audio_mic_read(int16_t *p_pcm, uint32_t num_frames)
+{
+    uint32_t len = num_frames * sizeof(int16_t);
+    uint32_t target = (capture_chunk + playback_chunk) * sizeof(int16_t);
+    uint32_t fill = audio_ring_fill(&mic_ring);
+
+    if (fill > (2 * target))
+    {
+        /* keep sample alignment */
+        mic_drops += audio_ring_skip(&mic_ring, (fill - target) & ~1U);
+        fill = audio_ring_fill(&mic_ring);
+    }
+    if (!mic_primed && (fill >= target))
+    {
+        mic_primed = WICED_TRUE;
+    }
+    if (!mic_primed || (fill < len))
+    {
+        memset(p_pcm, 0, len);
+        if (capture_running)
+        {
+            mic_underruns++;
+        }
+        mic_primed = WICED_FALSE;
+        return;
+    }
+    audio_ring_read(&mic_ring, (uint8_t *)p_pcm, len);
+}
+
+/*******************************************************************************
+ * Function Name: audio_uplink_mix
+ *******************************************************************************
+ * Summary:
+ *   Sends every Handsfree Unit the microphone and the downlinks of the other
+ *   units: adds the microphone to the downlink mix of the block and takes
+ *   each unit back out of it, then resamples the result to the SCO rate of
+ *   the unit and queues it for the SCO callback. Called from the playback
+ *   thread with session_lock held, after the downlinks have been mixed.
+ *
+ ******************************************************************************/
+static void audio_uplink_mix(int16_t *p_mic, uint32_t num_frames)
+{
+    int16_t sco_pcm[AUDIO_MAX_CHUNK_FRAMES];
+    audio_session_t *p_session;
+    uint32_t sco_frames;
+    uint32_t i;
+
+    audio_mixer_add(&conference_mixer, p_mic, AUDIO_MIXER_GAIN_UNITY);
+    for (i = 0; i < AUDIO_MAX_SESSIONS; i++)
     {
-        WICED_BT_TRACE("ALSA driver opened");
-        /* Configure ALSA driver with PCM parameters */
-        status = snd_pcm_set_params(p_alsa_handle,
-                                    format,
-                                    SND_PCM_ACCESS_RW_INTERLEAVED,
-                                    strDecParams.numOfChannels,
-                                    sample_rate,
-                                    1,
-                                    ALSA_LATENCY);
-
-        if (status < 0)
+        p_session = &audio_sessions[i];
+        if (!p_session->uplink_active)
         {
-            WICED_BT_TRACE("snd_pcm_set_params failed: %s", snd_strerror(status));
+            continue;
         }
-        snd_pcm_get_params(p_alsa_handle, &buffer_size, &period_size);
-        WICED_BT_TRACE("snd_pcm_get_params150ms bs %d ps %d", buffer_size, period_size);
+        /* p_mic is not needed any more, reuse it for the N-1 mix */
+        audio_mixer_output_without(&conference_mixer, p_session->downlink, p_session->mix_gain, p_mic);
 
+        /* The uplink runs against the same two clocks as the downlink */
+        resampler_set_drift(&p_session->capture_rs, -drift_estimator_get_offset_ppb(&p_session->playback_drift));
+        sco_frames = resampler_process(&p_session->capture_rs, p_mic, num_frames, sco_pcm, AUDIO_MAX_CHUNK_FRAMES);
+        audio_ring_write(&p_session->uplink_ring, (uint8_t *)sco_pcm, sco_frames * sizeof(int16_t));
     }
 }
 
 /*******************************************************************************
- * Function Name: deinit_audio
+ * Function Name: audio_playback_start
  *******************************************************************************
  * Summary:
- *   De-initializes the ALSA driver
+ *   Starts the playback thread of the audio backend, which plays silence
+ *   until a session is added, or restarts it if it stopped on an error.
+ *   One block must not need more SCO frames than one jitter buffer pull,
+ *   at the highest SCO rate and with the longest resampler.
  *
  * Parameters:
  *   None
  *
  * Return:
  *   None
+ *
  ******************************************************************************/
-void deinit_audio(void)
+static void audio_playback_start(void)
 {
-    WICED_BT_TRACE("deinit_audio");
-    if (p_alsa_handle != NULL)
+    audio_backend_stats_t stats;
+    uint32_t max_frames;
+
+    /* A thread that stopped on a device error is started again */
+    if (playback_running)
     {
-        WICED_BT_TRACE("snd_pcm_close");
-        snd_pcm_close(p_alsa_handle);
-        p_alsa_handle = NULL;
+        p_backend->get_stats(AUDIO_BACKEND_PLAYBACK, &stats);
+        if (stats.running)
+        {
+            return;
+        }
     }
-    alsa_volume_driver_deinit();
+
+    max_frames = (JB_MAX_CHUNK_SAMPLES - RESAMPLER_MAX_TAPS) * device_rate / JB_MAX_SAMPLE_RATE;
+    max_frames = MIN(max_frames, block_frames);
+    mic_primed = WICED_FALSE;
+    mic_drops = 0;
+    mic_underruns = 0;
+    playback_rt.started = WICED_FALSE;
+    audio_rt_get_usage(WICED_FALSE, &process_rt);
+
+    playback_running = p_backend->start(AUDIO_BACKEND_PLAYBACK, max_frames, audio_playback_fill);
+    p_backend->get_stats(AUDIO_BACKEND_PLAYBACK, &stats);
+    playback_chunk = stats.chunk_frames;
 }
 
 /*******************************************************************************
- * Function Name: alsa_write_pcm_data
+ * Function Name: audio_session_playback_init
  *******************************************************************************
  * Summary:
- *   Writes the supplied PCM frames to ALSA driver
+ *   Sets up the resampler of a session for the SCO rate of its call and
+ *   resets its SCO ring, jitter buffer and latency histograms. The session
+ *   must not be active.
  *
  * Parameters:
- *   p_rx_media: The PCM buffer to be written
- *   media_len : Length of p_rx_media data
+ *   audio_session_t *p_session : session to set up
  *
  * Return:
- *   NONE
+ *   wiced_bool_t : WICED_FALSE if the SCO rate cannot be played
  *
  ******************************************************************************/
-void alsa_write_pcm_data(uint8_t* p_rx_media, uint16_t media_len)
+static wiced_bool_t audio_session_playback_init(audio_session_t *p_session)
 {
-    /* pOut is pointer to buffer which holds decoded output pcm frames */
-    uint8_t *pOut = p_rx_media;
+    uint32_t i;
 
-    snd_pcm_sframes_t alsa_frames = 0;
-    snd_pcm_sframes_t alsa_frames_to_send = 0;
+    if (!resampler_init(&p_session->playback_rs, p_session->sample_rate, device_rate))
+    {
+        WICED_BT_TRACE("cannot resample %u Hz to %u Hz\n", p_session->sample_rate, device_rate);
+        return WICED_FALSE;
+    }
 
-    if (NULL != p_rx_media)
+    audio_ring_init(&p_session->playback_ring, p_session->playback_ring_mem, sizeof(p_session->playback_ring_mem));
+    jitter_buffer_init(&p_session->playback_jb, &p_session->playback_ring, p_session->sample_rate);
+    for (i = 0; i < AUDIO_LATENCY_STAGES; i++)
     {
-        alsa_frames_to_send = media_len / strDecParams.numOfChannels;
+        latency_hist_reset(&p_session->latency_hist[i]);
+    }
+    latency_stamps_reset(&p_session->latency_stamps);
+    p_session->latency_last_pos = p_session->playback_ring.head;
+    jitter_buffer_set_rate_controlled(&p_session->playback_jb, WICED_TRUE);
+    p_session->playback_drops = 0;
 
-        /*Bits per sample is 16 */
-        alsa_frames_to_send = alsa_frames_to_send / format;
+    /* Start from the clock offset of the previous call */
+    drift_estimator_restart(&p_session->playback_drift);
+    resampler_set_drift(&p_session->playback_rs, drift_estimator_get_correction_ppb(&p_session->playback_drift));
+    p_session->playback_drift_ns = 0;
+    return WICED_TRUE;
+}
 
-        if (p_alsa_handle == NULL)
-        {
-            WICED_BT_TRACE("ALSA is not configured, dropping the data pkt!!!!");
-            return;
-        }
-#ifdef AUDIO_DEBUG
-        WICED_BT_TRACE("alsa_write_pcm_data : Recd a2dp data len %d, alsa_frames_to_send %d\n",
-                                                                    media_len, alsa_frames_to_send);
-#endif
-        while(1)
-        {
-            alsa_frames = snd_pcm_writei(p_alsa_handle, pOut, alsa_frames_to_send);
-#ifdef AUDIO_DEBUG
-            WICED_BT_TRACE("alsa_frames written = %d\n", alsa_frames);
-#endif
+/*******************************************************************************
+ * Function Name: audio_capture_write
+ *******************************************************************************
+ * Summary:
+ *   Capture callback of the audio backend. Queues the microphone audio in
+ *   the mic ring, where the playback thread mixes it into the uplinks of the
+ *   Handsfree Units. Called from the capture thread only.
+ *
+ ******************************************************************************/
+static void audio_capture_write(int16_t *p_pcm, uint32_t num_frames, int32_t delay)
+{
+    (void)delay;
+    audio_ring_write(&mic_ring, (uint8_t *)p_pcm, num_frames * sizeof(int16_t));
+    audio_rt_track(&capture_rt);
+}
 
-            if (alsa_frames < 0)
-            {
-                alsa_frames = snd_pcm_recover(p_alsa_handle, alsa_frames, 0);
-            }
-            if (alsa_frames < 0)
+/*******************************************************************************
+ * Function Name: audio_capture_start
+ *******************************************************************************
+ * Summary:
+ *   Starts the capture thread of the audio backend, or restarts it if it
+ *   stopped on an error. The uplinks carry no microphone audio if this
+ *   fails.
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+static void audio_capture_start(void)
+{
+    audio_backend_stats_t stats;
+
+    if (capture_running)
+    {
+        p_backend->get_stats(AUDIO_BACKEND_CAPTURE, &stats);
+        if (stats.running)
+        {
+            return;
+        }
+    }
+    capture_rt.started = WICED_FALSE;
+    capture_running = p_backend->start(AUDIO_BACKEND_CAPTURE, block_frames, audio_capture_write);
+    p_backend->get_stats(AUDIO_BACKEND_CAPTURE, &stats);
+    capture_chunk = stats.chunk_frames;
+}
+
+/*******************************************************************************
+ * Function Name: audio_session_uplink_init
+ *******************************************************************************
+ * Summary:
+ *   Sets up the uplink resampler of a session for the SCO rate of its call
+ *   and resets its uplink ring. The session must not be active.
+ *
+ * Parameters:
+ *   audio_session_t *p_session : session to set up
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the SCO rate cannot be produced
+ *
+ ******************************************************************************/
+static wiced_bool_t audio_session_uplink_init(audio_session_t *p_session)
+{
+    uint32_t sco_chunk;
+
+    if (!resampler_init(&p_session->capture_rs, device_rate, p_session->sample_rate))
+    {
+        WICED_BT_TRACE("cannot resample %u Hz to %u Hz\n", device_rate, p_session->sample_rate);
+        return WICED_FALSE;
+    }
+    sco_chunk = (playback_chunk * p_session->sample_rate / device_rate) + 1;
+
+    /* Bound the uplink latency, but always leave room for one playback
+     * block and one SCO packet */
+    p_session->uplink_max_depth = p_session->sample_rate * sizeof(int16_t) * AUDIO_UPLINK_MAX_DEPTH_MS / 1000;
+    p_session->uplink_max_depth = MAX(p_session->uplink_max_depth, 2 * sco_chunk * sizeof(int16_t));
+    audio_ring_init(&p_session->uplink_ring, p_session->uplink_ring_mem, sizeof(p_session->uplink_ring_mem));
+    p_session->uplink_drops = 0;
+    p_session->uplink_underruns = 0;
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: audio_latency_queued
+ *******************************************************************************
+ * Summary:
+ *   Records the time taken to decode and queue a received SCO packet and
+ *   stamps the queued audio so the playback thread can time it
+ *
+ ******************************************************************************/
+static void audio_latency_queued(audio_session_t *p_session, uint64_t rx_ns)
+{
+    uint64_t now = audio_now_ns();
+    uint32_t head = p_session->playback_ring.head;
+
+    latency_hist_record(&p_session->latency_hist[AUDIO_LATENCY_INGEST], (now - rx_ns) / 1000U);
+
+    /* a packet may only complete a partial mSBC frame */
+    if (head != p_session->latency_last_pos)
+    {
+        latency_stamps_push(&p_session->latency_stamps, head, rx_ns, now);
+        p_session->latency_last_pos = head;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: audio_msbc_decode
+ *******************************************************************************
+ * Summary:
+ *   Decodes received mSBC and queues the PCM, bad and missing frames are
+ *   queued as lost so that the jitter buffer conceals them
+ *
+ ******************************************************************************/
+static void audio_msbc_decode(audio_session_t *p_session, const uint8_t* p_data, uint16_t len)
+{
+    int16_t pcm[MSBC_SAMPLES_PER_FRAME];
+    msbc_frame_status_t status;
+    uint32_t taken;
+
+    while (len > 0)
+    {
+        taken = msbc_decoder_write(&p_session->msbc_decoder, p_data, len);
+        p_data += taken;
+        len -= taken;
+        while (msbc_decoder_read(&p_session->msbc_decoder, pcm, &status))
+        {
+            if (status == MSBC_FRAME_GOOD)
             {
-                WICED_BT_TRACE("app_avk_uipc_cback snd_pcm_writei failed %s", snd_strerror(alsa_frames));
-                break;
+                sco_recorder_write(AUDIO_SESSION_INDEX(p_session), SCO_RECORDER_DOWNLINK, (uint8_t *)pcm, MSBC_PCM_LEN);
+                jitter_buffer_put(&p_session->playback_jb, (uint8_t *)pcm, MSBC_PCM_LEN);
             }
-            if (alsa_frames > 0 && alsa_frames < alsa_frames_to_send)
+            else
             {
-                WICED_BT_TRACE("app_avk_uipc_cback Short write (expected %li, wrote %li)",
-                    (long) alsa_frames_to_send, alsa_frames);
+                /* lost frames are recorded as silence to keep the timing */
+                sco_recorder_write(AUDIO_SESSION_INDEX(p_session), SCO_RECORDER_DOWNLINK, NULL, MSBC_PCM_LEN);
+                jitter_buffer_put_lost(&p_session->playback_jb, MSBC_PCM_LEN);
             }
-            if ( alsa_frames == alsa_frames_to_send )
+        }
+    }
+}
+
+/*******************************************************************************
+ * Function Name: audio_cvsd_decode
+ *******************************************************************************
+ * Summary:
+ *   Decodes received CVSD and queues the PCM, one sample per byte
+ *
+ ******************************************************************************/
+static void audio_cvsd_decode(audio_session_t *p_session, const uint8_t* p_data, uint16_t len)
+{
+    int16_t pcm[AUDIO_CVSD_CHUNK + 1];
+    uint32_t n;
+    uint32_t got;
+
+    while (len > 0)
+    {
+        n = MIN(len, AUDIO_CVSD_CHUNK);
+        got = cvsd_decode(&p_session->cvsd_decoder, p_data, n, pcm, AUDIO_CVSD_CHUNK + 1);
+        sco_recorder_write(AUDIO_SESSION_INDEX(p_session), SCO_RECORDER_DOWNLINK, (uint8_t *)pcm, got * sizeof(int16_t));
+        jitter_buffer_put(&p_session->playback_jb, (uint8_t *)pcm, got * sizeof(int16_t));
+        p_data += n;
+        len -= n;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: alsa_write_pcm_data
+ *******************************************************************************
+ * Summary:
+ *   Queues received SCO audio in the jitter buffer of a session. This is
+ *   called from the Bluetooth stack thread and never blocks: the data is
+ *   copied into the SCO ring or dropped if the ring is full. mSBC and
+ *   transparent CVSD are decoded first.
+ *
+ * Parameters:
+ *   session   : session index, HFP handle - 1
+ *   p_rx_media: The PCM, mSBC or CVSD buffer to be written
+ *   media_len : Length of p_rx_media data
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+void alsa_write_pcm_data(uint8_t session, uint8_t* p_rx_media, uint16_t media_len)
+{
+    uint64_t rx_ns = audio_now_ns();
+    audio_session_t *p_session = audio_session_get(session);
+
+    if ((NULL == p_session) || (NULL == p_rx_media) || (media_len == 0))
+    {
+        return;
+    }
+    /* SCO data is delivered on a thread of the Bluetooth stack */
+    audio_rt_promote_self("SCO");
+    if (!p_session->playback_active)
+    {
+        p_session->playback_drops++;
+        return;
+    }
+
+    if (p_session->msbc_active)
+    {
+        audio_msbc_decode(p_session, p_rx_media, media_len);
+    }
+    else if (p_session->cvsd_active)
+    {
+        audio_cvsd_decode(p_session, p_rx_media, media_len);
+    }
+    else
+    {
+        sco_recorder_write(session, SCO_RECORDER_DOWNLINK, p_rx_media, media_len);
+        jitter_buffer_put(&p_session->playback_jb, p_rx_media, media_len);
+    }
+    audio_latency_queued(p_session, rx_ns);
+}
+
+/*******************************************************************************
+ * Function Name: audio_capture_read_pcm
+ *******************************************************************************
+ * Summary:
+ *   Takes len bytes of the uplink mix out of the uplink ring. Audio queued
+ *   beyond AUDIO_UPLINK_MAX_DEPTH_MS is dropped to bound the latency,
+ *   missing audio is replaced by silence.
+ *
+ ******************************************************************************/
+static wiced_bool_t audio_capture_read_pcm(audio_session_t *p_session, uint8_t* p_data, uint16_t len)
+{
+    uint32_t fill;
+    uint32_t got;
+
+    if (!p_session->uplink_active)
+    {
+        return WICED_FALSE;
+    }
+
+    fill = audio_ring_fill(&p_session->uplink_ring);
+    if (fill > (p_session->uplink_max_depth + len))
+    {
+        /* keep sample alignment */
+        p_session->uplink_drops += audio_ring_skip(&p_session->uplink_ring,
+                                                   (fill - p_session->uplink_max_depth) & ~1U);
+    }
+
+    got = audio_ring_read(&p_session->uplink_ring, p_data, len);
+    if (got < len)
+    {
+        memset(&p_data[got], 0, len - got);
+        p_session->uplink_underruns++;
+    }
+    sco_recorder_write(AUDIO_SESSION_INDEX(p_session), SCO_RECORDER_UPLINK, p_data, len);
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: audio_msbc_encode
+ *******************************************************************************
+ * Summary:
+ *   Fills an uplink packet with the H2 framed mSBC stream, encoding a frame
+ *   of microphone audio whenever the previous one has been sent
+ *
+ ******************************************************************************/
+static wiced_bool_t audio_msbc_encode(audio_session_t *p_session, uint8_t* p_data, uint16_t len)
+{
+    int16_t pcm[MSBC_SAMPLES_PER_FRAME];
+    uint32_t done = 0;
+
+    while (done < len)
+    {
+        if (msbc_encoder_pending(&p_session->msbc_encoder) == 0)
+        {
+            if (!audio_capture_read_pcm(p_session, (uint8_t *)pcm, MSBC_PCM_LEN))
             {
-                break;
+                return WICED_FALSE;
             }
-            pOut += (alsa_frames*format*strDecParams.numOfChannels);
-            alsa_frames_to_send = alsa_frames_to_send - alsa_frames;
+            msbc_encoder_encode(&p_session->msbc_encoder, pcm);
+        }
+        done += msbc_encoder_read(&p_session->msbc_encoder, &p_data[done], len - done);
+    }
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: audio_cvsd_encode
+ *******************************************************************************
+ * Summary:
+ *   Fills an uplink packet with CVSD, one byte per microphone sample
+ *
+ ******************************************************************************/
+static wiced_bool_t audio_cvsd_encode(audio_session_t *p_session, uint8_t* p_data, uint16_t len)
+{
+    int16_t pcm[AUDIO_CVSD_CHUNK];
+    uint32_t n;
+
+    while (len > 0)
+    {
+        n = MIN(len, AUDIO_CVSD_CHUNK);
+        if (!audio_capture_read_pcm(p_session, (uint8_t *)pcm, n * sizeof(int16_t)))
+        {
+            return WICED_FALSE;
         }
+        cvsd_encode(&p_session->cvsd_encoder, pcm, n, p_data);
+        p_data += n;
+        len -= n;
+    }
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: audio_capture_read
+ *******************************************************************************
+ * Summary:
+ *   Fills one SCO uplink packet of a session with its conference mix, the
+ *   microphone and the other Handsfree Units, encoded in the same format as
+ *   its downlink. Called from the Bluetooth stack thread for every received
+ *   SCO packet, which paces the uplink to the downlink.
+ *
+ * Parameters:
+ *   session: session index, HFP handle - 1
+ *   p_data : buffer for the uplink packet
+ *   len    : length of the uplink packet
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the session has no uplink
+ *
+ ******************************************************************************/
+wiced_bool_t audio_capture_read(uint8_t session, uint8_t* p_data, uint16_t len)
+{
+    audio_session_t *p_session = audio_session_get(session);
+
+    if (p_session == NULL)
+    {
+        return WICED_FALSE;
+    }
+    if (p_session->msbc_active)
+    {
+        return audio_msbc_encode(p_session, p_data, len);
+    }
+    if (p_session->cvsd_active)
+    {
+        return audio_cvsd_encode(p_session, p_data, len);
+    }
+    return audio_capture_read_pcm(p_session, p_data, len);
+}
+
+/*******************************************************************************
+ * Function Name: audio_get_clock_drift_ppb
+ *******************************************************************************
+ * Summary:
+ *   Returns the estimated rate offset of the SCO clock of a session against
+ *   the ALSA device clock, positive when SCO audio arrives faster than it
+ *   is played
+ *
+ * Parameters:
+ *   uint8_t session : session index, HFP handle - 1
+ *
+ * Return:
+ *   int32_t : offset in parts per billion
+ *
+ ******************************************************************************/
+int32_t audio_get_clock_drift_ppb(uint8_t session)
+{
+    audio_session_t *p_session = audio_session_get(session);
+
+    return (p_session != NULL) ? drift_estimator_get_offset_ppb(&p_session->playback_drift) : 0;
+}
+
+/*******************************************************************************
+ * Function Name: audio_set_mix_gain
+ *******************************************************************************
+ * Summary:
+ *   Sets the gain of the downlink of a session in the conference, that is in
+ *   the speaker output and in the uplinks of the other Handsfree Units. Any
+ *   thread may call it.
+ *
+ * Parameters:
+ *   uint8_t session  : session index, HFP handle - 1
+ *   uint16_t percent : gain, 100 for unity, at most AUDIO_MIX_GAIN_MAX
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void audio_set_mix_gain(uint8_t session, uint16_t percent)
+{
+    audio_session_t *p_session = audio_session_get(session);
+    uint32_t gain = (uint32_t)MIN(percent, AUDIO_MIX_GAIN_MAX) * AUDIO_MIXER_GAIN_UNITY / 100U;
+
+    /* The playback thread reads the gain twice per block under the lock, in
+     * the speaker mix and in the N-1 uplink mix, the two must match */
+    if (p_session != NULL)
+    {
+        pthread_mutex_lock(&session_lock);
+        p_session->mix_gain = (int16_t)MIN(gain, AUDIO_MIXER_GAIN_MAX);
+        pthread_mutex_unlock(&session_lock);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: audio_print_stats
+ *******************************************************************************
+ * Summary:
+ *   Prints the playback (SCO ring, jitter buffer, device) and capture counters
+ *   of a session, and the real-time behaviour of the audio threads
+ *
+ * Parameters:
+ *   uint8_t session : session index, HFP handle - 1
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void audio_print_stats(uint8_t session)
+{
+    audio_session_t *p_session = audio_session_get(session);
+    audio_ring_stats_t stats;
+    jitter_buffer_stats_t jb_stats;
+    audio_backend_stats_t playback_stats = { 0 };
+    audio_backend_stats_t capture_stats = { 0 };
+    audio_rt_usage_t process_usage;
+    sco_recorder_stats_t recorder_stats;
+
+    if (p_session == NULL)
+    {
+        return;
+    }
+    if (p_backend != NULL)
+    {
+        p_backend->get_stats(AUDIO_BACKEND_PLAYBACK, &playback_stats);
+        p_backend->get_stats(AUDIO_BACKEND_CAPTURE, &capture_stats);
+    }
+    audio_ring_get_stats(&p_session->playback_ring, &stats);
+    jitter_buffer_get_stats(&p_session->playback_jb, &jb_stats);
+    printf("\n----------------AUDIO PLAYBACK STATISTICS (session %u)------------\n", session);
+    printf("ring fill %u / %u bytes (peak %u)\n", stats.fill, p_session->playback_ring.size, stats.peak_fill);
+    printf("ring overruns %u (%u bytes dropped)\n", stats.overruns, stats.dropped_bytes);
+    printf("jitter buffer depth %u ms target %u ms, jitter %u us\n",
+                                        jb_stats.depth_ms, jb_stats.target_ms, jb_stats.jitter_us);
+    printf("packets %u late %u lost %u, underruns %u, concealed %u ms, dropped %u ms\n",
+                                        jb_stats.packets, jb_stats.late_packets, jb_stats.lost_packets,
+                                        jb_stats.underruns, jb_stats.concealed_ms, jb_stats.dropped_ms);
+    if (p_session->msbc_active)
+    {
+        printf("mSBC frames %u bad %u lost %u, sync losses %u (%u bytes skipped)\n",
+                                        p_session->msbc_decoder.frames, p_session->msbc_decoder.bad_frames,
+                                        p_session->msbc_decoder.lost_frames, p_session->msbc_decoder.sync_losses,
+                                        p_session->msbc_decoder.skipped_bytes);
+    }
+    printf("packets dropped without playback %u, xruns %u, write errors %u\n",
+                                        p_session->playback_drops, playback_stats.xruns, playback_stats.errors);
+    printf("%s backend, %s, %u frames per write, writes %u (%llu frames), wakeups %u, blocked %llu ms, writing %llu ms\n",
+                                        (p_backend != NULL) ? p_backend->p_name : "no",
+                                        (playback_stats.p_mode != NULL) ? playback_stats.p_mode : "closed",
+                                        playback_stats.chunk_frames, playback_stats.transfers, (unsigned long long)playback_stats.frames,
+                                        playback_stats.wakeups,
+                                        (unsigned long long)(playback_stats.blocked_ns / 1000000U),
+                                        (unsigned long long)(playback_stats.transfer_ns / 1000000U));
+    if (playback_stats.latency_us >= 0)
+    {
+        printf("device latency %d us\n", playback_stats.latency_us);
     }
+    if (playback_stats.buffer_us >= 0)
+    {
+        printf("device buffer %d us (%s)\n", playback_stats.buffer_us,
+                                        (playback_stats.p_buffer_mode != NULL) ? playback_stats.p_buffer_mode : "fixed");
+    }
+    printf("device rate %u Hz, SCO rate %u Hz, resampler %u taps (%s)\n",
+                                        device_rate, p_session->sample_rate, p_session->playback_rs.taps,
+                                        resampler_simd_name());
+    printf("clock drift %+.1f ppm (SCO against device), correction %+.1f ppm, %s\n",
+                                        drift_estimator_get_offset_ppb(&p_session->playback_drift) / 1000.0,
+                                        drift_estimator_get_correction_ppb(&p_session->playback_drift) / 1000.0,
+                                        p_session->playback_drift.locked ? "locked" : "settling");
+
+    printf("conference gain %u %%, mixer (%s)\n",
+                                        (uint32_t)p_session->mix_gain * 100U / AUDIO_MIXER_GAIN_UNITY,
+                                        audio_mixer_simd_name());
+
+    audio_ring_get_stats(&p_session->uplink_ring, &stats);
+    printf("----------------AUDIO CAPTURE STATISTICS--------------------------\n");
+    printf("uplink fill %u / %u bytes (peak %u), uplink overruns %u\n",
+                                        stats.fill, p_session->uplink_max_depth, stats.peak_fill, stats.overruns);
+    printf("uplink dropped %u bytes, uplink underruns %u\n",
+                                        p_session->uplink_drops, p_session->uplink_underruns);
+    audio_ring_get_stats(&mic_ring, &stats);
+    printf("capture %s, xruns %u, read errors %u, mic overruns %u, dropped %u bytes, underruns %u\n",
+                                        capture_stats.running ? "running" : "stopped",
+                                        capture_stats.xruns, capture_stats.errors,
+                                        stats.overruns, mic_drops, mic_underruns);
+    if (p_session->msbc_active)
+    {
+        printf("mSBC uplink frames %u, encode errors %u\n",
+                                        p_session->msbc_encoder.frames, p_session->msbc_encoder.errors);
+    }
+    if (p_session->cvsd_active)
+    {
+        printf("CVSD coded on the host, uplink idle bytes %u\n", p_session->cvsd_encoder.underruns);
+    }
+    sco_recorder_get_stats(session, &recorder_stats);
+    if (recorder_stats.enabled)
+    {
+        printf("recorded %u files, %llu bytes, dropped %u bytes, write errors %u\n",
+                                        recorder_stats.files, (unsigned long long)recorder_stats.bytes,
+                                        recorder_stats.dropped_bytes, recorder_stats.write_errors);
+    }
+
+    printf("----------------AUDIO REALTIME STATISTICS-------------------------\n");
+    audio_rt_print_settings();
+    if (playback_rt.started)
+    {
+        audio_rt_print_usage("playback thread", &playback_rt.start, &playback_rt.now);
+        audio_rt_get_usage(WICED_FALSE, &process_usage);
+        audio_rt_print_usage("process", &process_rt, &process_usage);
+    }
+    if (capture_rt.started)
+    {
+        audio_rt_print_usage("capture thread", &capture_rt.start, &capture_rt.now);
+    }
+    printf("--------------------------------------------------------------------\n");
+}
+
+/*******************************************************************************
+ * Function Name: audio_rt_print_usage
+ *******************************************************************************
+ * Summary:
+ *   Prints the page faults and context switches between two samples
+ *
+ ******************************************************************************/
+static void audio_rt_print_usage(const char *p_name, const audio_rt_usage_t *p_start, const audio_rt_usage_t *p_now)
+{
+    printf("%s: page faults %llu minor %llu major, context switches %llu voluntary %llu involuntary\n", p_name,
+                                        (unsigned long long)(p_now->minor_faults - p_start->minor_faults),
+                                        (unsigned long long)(p_now->major_faults - p_start->major_faults),
+                                        (unsigned long long)(p_now->voluntary_switches - p_start->voluntary_switches),
+                                        (unsigned long long)(p_now->involuntary_switches - p_start->involuntary_switches));
+}
+
+/*******************************************************************************
+ * Function Name: audio_print_latency
+ *******************************************************************************
+ * Summary:
+ *   Prints the playback latency per stage of the current or last call of a
+ *   session
+ *
+ * Parameters:
+ *   uint8_t session : session index, HFP handle - 1
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void audio_print_latency(uint8_t session)
+{
+    audio_latency_t latency;
+    const latency_summary_t *p_summary;
+    uint32_t i;
+
+    if (!audio_get_latency(session, &latency))
+    {
+        return;
+    }
+    printf("\n----------------AUDIO LATENCY (us, session %u)--------------------\n", session);
+    printf("%-24s %8s %8s %8s %8s %8s\n", "stage", "samples", "p50", "p99", "max", "mean");
+    for (i = 0; i < AUDIO_LATENCY_STAGES; i++)
+    {
+        p_summary = &latency.stages[i];
+        printf("%-24s %8u %8u %8u %8u %8u\n", latency_stage_names[i], p_summary->samples,
+                                        p_summary->p50_us, p_summary->p99_us, p_summary->max_us, p_summary->mean_us);
+    }
+    printf("packets not tracked %u\n", latency.untracked);
+    printf("--------------------------------------------------------------------\n");
+}
+
+/*******************************************************************************
+ * Function Name: audio_get_latency
+ *******************************************************************************
+ * Summary:
+ *   Summarizes the playback latency per stage of the current or last call
+ *   of a session
+ *
+ * Parameters:
+ *   uint8_t session            : session index, HFP handle - 1
+ *   audio_latency_t *p_latency : filled with the summaries
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the session index is not valid
+ *
+ ******************************************************************************/
+wiced_bool_t audio_get_latency(uint8_t session, audio_latency_t *p_latency)
+{
+    audio_session_t *p_session = audio_session_get(session);
+    uint32_t i;
+
+    if (p_session == NULL)
+    {
+        return WICED_FALSE;
+    }
+    for (i = 0; i < AUDIO_LATENCY_STAGES; i++)
+    {
+        latency_hist_summarize(&p_session->latency_hist[i], &p_latency->stages[i]);
+    }
+    p_latency->untracked = p_session->latency_stamps.skipped;
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: audio_latency_stage_name
+ *******************************************************************************
+ * Summary:
+ *   Returns the printable name of a latency stage
+ *
+ * Parameters:
+ *   audio_latency_stage_t stage : latency stage
+ *
+ * Return:
+ *   const char * : stage name
+ *
+ ******************************************************************************/
+const char *audio_latency_stage_name(audio_latency_stage_t stage)
+{
+    return (stage < AUDIO_LATENCY_STAGES) ? latency_stage_names[stage] : "unknown";
 }
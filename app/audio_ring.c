@@ -0,0 +1,269 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/*******************************************************************************
+ * File Name: audio_ring.c
+ *
+ * Description: This file contains the implementation of the single-producer/
+ * single-consumer lock-free PCM ring. The producer (Bluetooth stack thread)
+ * never blocks: a write that does not fit is rejected as a whole so that the
+ * consumer never sees a partial SCO packet.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ ******************************************************************************/
+#include <string.h>
+
+#include "audio_ring.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define AUDIO_RING_LOAD_ACQUIRE(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define AUDIO_RING_LOAD_RELAXED(p)      __atomic_load_n((p), __ATOMIC_RELAXED)
+#define AUDIO_RING_STORE_RELEASE(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define AUDIO_RING_STORE_RELAXED(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+
+#ifndef MIN
+#define MIN(a, b)                       (((a) < (b)) ? (a) : (b))
+#endif
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: audio_ring_init
+ *******************************************************************************
+ * Summary:
+ *   Initializes the ring on top of the caller supplied buffer
+ *
+ * Parameters:
+ *   audio_ring_t *p_ring : ring control block
+ *   uint8_t *p_buf       : backing buffer
+ *   uint32_t size        : size of p_buf, must be a power of two
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE on success
+ *
+ ******************************************************************************/
+wiced_bool_t audio_ring_init(audio_ring_t *p_ring, uint8_t *p_buf, uint32_t size)
+{
+    if ((p_ring == NULL) || (p_buf == NULL) || (size == 0) || ((size & (size - 1)) != 0))
+    {
+        return WICED_FALSE;
+    }
+
+    memset(p_ring, 0, sizeof(*p_ring));
+    p_ring->p_buf = p_buf;
+    p_ring->size = size;
+    p_ring->mask = size - 1;
+
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: audio_ring_reset
+ *******************************************************************************
+ * Summary:
+ *   Empties the ring and clears the statistics. Must only be called while
+ *   neither the producer nor the consumer is active.
+ *
+ * Parameters:
+ *   audio_ring_t *p_ring : ring control block
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void audio_ring_reset(audio_ring_t *p_ring)
+{
+    AUDIO_RING_STORE_RELAXED(&p_ring->peak_fill, 0);
+    AUDIO_RING_STORE_RELAXED(&p_ring->overruns, 0);
+    AUDIO_RING_STORE_RELAXED(&p_ring->dropped_bytes, 0);
+    AUDIO_RING_STORE_RELAXED(&p_ring->tail, 0);
+    AUDIO_RING_STORE_RELEASE(&p_ring->head, 0);
+}
+
+/*******************************************************************************
+ * Function Name: audio_ring_write
+ *******************************************************************************
+ * Summary:
+ *   Producer side. Copies len bytes into the ring if they fit entirely,
+ *   otherwise the data is dropped and the overrun counters are updated.
+ *
+ * Parameters:
+ *   audio_ring_t *p_ring   : ring control block
+ *   const uint8_t *p_data  : data to be queued
+ *   uint32_t len           : length of p_data
+ *
+ * Return:
+ *   uint32_t : number of bytes queued (len or 0)
+ *
+ ******************************************************************************/
+uint32_t audio_ring_write(audio_ring_t *p_ring, const uint8_t *p_data, uint32_t len)
+{
+    uint32_t head = p_ring->head;
+    uint32_t tail = AUDIO_RING_LOAD_ACQUIRE(&p_ring->tail);
+    uint32_t fill = head - tail;
+    uint32_t offset;
+    uint32_t first;
+
+    if (len > (p_ring->size - fill))
+    {
+        AUDIO_RING_STORE_RELAXED(&p_ring->overruns, p_ring->overruns + 1);
+        AUDIO_RING_STORE_RELAXED(&p_ring->dropped_bytes, p_ring->dropped_bytes + len);
+        return 0;
+    }
+
+    offset = head & p_ring->mask;
+    first = MIN(len, p_ring->size - offset);
+    memcpy(&p_ring->p_buf[offset], p_data, first);
+    memcpy(p_ring->p_buf, p_data + first, len - first);
+
+    AUDIO_RING_STORE_RELEASE(&p_ring->head, head + len);
+
+    fill += len;
+    if (fill > p_ring->peak_fill)
+    {
+        AUDIO_RING_STORE_RELAXED(&p_ring->peak_fill, fill);
+    }
+    return len;
+}
+
+/*******************************************************************************
+ * Function Name: audio_ring_read
+ *******************************************************************************
+ * Summary:
+ *   Consumer side. Copies up to len bytes out of the ring.
+ *
+ * Parameters:
+ *   audio_ring_t *p_ring : ring control block
+ *   uint8_t *p_data      : destination buffer
+ *   uint32_t len         : size of p_data
+ *
+ * Return:
+ *   uint32_t : number of bytes copied
+ *
+ ******************************************************************************/
+uint32_t audio_ring_read(audio_ring_t *p_ring, uint8_t *p_data, uint32_t len)
+{
+    uint32_t tail = p_ring->tail;
+    uint32_t head = AUDIO_RING_LOAD_ACQUIRE(&p_ring->head);
+    uint32_t offset;
+    uint32_t first;
+
+    len = MIN(len, head - tail);
+    if (len == 0)
+    {
+        return 0;
+    }
+
+    offset = tail & p_ring->mask;
+    first = MIN(len, p_ring->size - offset);
+    memcpy(p_data, &p_ring->p_buf[offset], first);
+    memcpy(p_data + first, p_ring->p_buf, len - first);
+
+    AUDIO_RING_STORE_RELEASE(&p_ring->tail, tail + len);
+    return len;
+}
+
+/*******************************************************************************
+ * Function Name: audio_ring_skip
+ *******************************************************************************
+ * Summary:
+ *   Consumer side. Discards up to len bytes from the ring.
+ *
+ * Parameters:
+ *   audio_ring_t *p_ring : ring control block
+ *   uint32_t len         : number of bytes to discard
+ *
+ * Return:
+ *   uint32_t : number of bytes discarded
+ *
+ ******************************************************************************/
+uint32_t audio_ring_skip(audio_ring_t *p_ring, uint32_t len)
+{
+    uint32_t tail = p_ring->tail;
+    uint32_t head = AUDIO_RING_LOAD_ACQUIRE(&p_ring->head);
+
+    len = MIN(len, head - tail);
+    AUDIO_RING_STORE_RELEASE(&p_ring->tail, tail + len);
+    return len;
+}
+
+/*******************************************************************************
+ * Function Name: audio_ring_fill
+ *******************************************************************************
+ * Summary:
+ *   Returns the number of bytes currently queued. Safe to call from any thread.
+ *
+ * Parameters:
+ *   audio_ring_t *p_ring : ring control block
+ *
+ * Return:
+ *   uint32_t : fill level in bytes
+ *
+ ******************************************************************************/
+uint32_t audio_ring_fill(audio_ring_t *p_ring)
+{
+    uint32_t tail = AUDIO_RING_LOAD_ACQUIRE(&p_ring->tail);
+    uint32_t head = AUDIO_RING_LOAD_ACQUIRE(&p_ring->head);
+
+    return head - tail;
+}
+
+/*******************************************************************************
+ * Function Name: audio_ring_get_stats
+ *******************************************************************************
+ * Summary:
+ *   Takes a snapshot of the ring statistics. Safe to call from any thread.
+ *
+ * Parameters:
+ *   audio_ring_t *p_ring         : ring control block
+ *   audio_ring_stats_t *p_stats  : filled with the current statistics
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void audio_ring_get_stats(audio_ring_t *p_ring, audio_ring_stats_t *p_stats)
+{
+    p_stats->fill = audio_ring_fill(p_ring);
+    p_stats->peak_fill = AUDIO_RING_LOAD_RELAXED(&p_ring->peak_fill);
+    p_stats->overruns = AUDIO_RING_LOAD_RELAXED(&p_ring->overruns);
+    p_stats->dropped_bytes = AUDIO_RING_LOAD_RELAXED(&p_ring->dropped_bytes);
+}
@@ -0,0 +1,448 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/*******************************************************************************
+ * File Name: audio_rt.c
+ *
+ * Description: This file contains the real-time setup of the audio path.
+ * The audio threads are created with SCHED_FIFO (HFAG_RT_PRIORITY) and pinned
+ * to HFAG_RT_CPUS, the thread that delivers SCO data is promoted the same way
+ * on its first packet. With HFAG_RT_MLOCK the process memory is locked so
+ * that a call does not page fault.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ ******************************************************************************/
+#define _GNU_SOURCE
+#include <errno.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "audio_rt.h"
+#include "hfag_config.h"
+#include "wiced_bt_trace.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define AUDIO_RT_NAME_LEN         (16U)   /* pthread name limit, with the NUL */
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+/* Handed from audio_rt_thread_create() to the new thread */
+typedef struct
+{
+    void *(*p_fn)(void *);
+    void *p_arg;
+    char name[AUDIO_RT_NAME_LEN];
+} audio_rt_start_t;
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static int rt_priority = AUDIO_RT_PRIORITY_DEFAULT; /* 0 - default policy */
+static cpu_set_t rt_cpus;
+static wiced_bool_t rt_cpus_set = WICED_FALSE;
+static wiced_bool_t rt_locked = WICED_FALSE;
+static const char *p_rt_cpus = NULL;
+
+/*******************************************************************************
+ *       FUNCTION DECLARATION
+ ******************************************************************************/
+static wiced_bool_t audio_rt_parse_cpus(const char *p_list, cpu_set_t *p_cpus);
+static void audio_rt_prefault_stack(void);
+static void *audio_rt_thread_start(void *arg);
+static int audio_rt_thread_spawn(pthread_t *p_thread, int priority, audio_rt_start_t *p_start);
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: audio_rt_init
+ *******************************************************************************
+ * Summary:
+ *   Reads the real-time settings and locks the process memory if asked to.
+ *   Called once at startup, before the audio threads are created. Freed heap
+ *   is kept mapped so that memory locked once stays resident.
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void audio_rt_init(void)
+{
+    rt_priority = hfag_config_get_int(HFAG_CONFIG_RT_PRIORITY, AUDIO_RT_PRIORITY_DEFAULT);
+    if ((rt_priority < 0) || (rt_priority > sched_get_priority_max(SCHED_FIFO)))
+    {
+        WICED_BT_TRACE("unsupported %s %d, using %d\n", HFAG_CONFIG_RT_PRIORITY, rt_priority, AUDIO_RT_PRIORITY_DEFAULT);
+        rt_priority = AUDIO_RT_PRIORITY_DEFAULT;
+    }
+
+    p_rt_cpus = hfag_config_get_str(HFAG_CONFIG_RT_CPUS, NULL);
+    rt_cpus_set = WICED_FALSE;
+    if (p_rt_cpus != NULL)
+    {
+        rt_cpus_set = audio_rt_parse_cpus(p_rt_cpus, &rt_cpus);
+        if (!rt_cpus_set)
+        {
+            WICED_BT_TRACE("invalid %s %s, audio threads are not pinned\n", HFAG_CONFIG_RT_CPUS, p_rt_cpus);
+            p_rt_cpus = NULL;
+        }
+    }
+
+    if ((hfag_config_get_int(HFAG_CONFIG_RT_MLOCK, 0) != 0) && !rt_locked)
+    {
+#ifdef __GLIBC__
+        mallopt(M_TRIM_THRESHOLD, -1);
+        mallopt(M_MMAP_MAX, 0);
+#endif
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        {
+            WICED_BT_TRACE("mlockall failed %d, memory is not locked\n", errno);
+        }
+        else
+        {
+            rt_locked = WICED_TRUE;
+        }
+    }
+}
+
+/*******************************************************************************
+ * Function Name: audio_rt_parse_cpus
+ *******************************************************************************
+ * Summary:
+ *   Parses a CPU list such as "2", "2,3" or "0-1,3"
+ *
+ ******************************************************************************/
+static wiced_bool_t audio_rt_parse_cpus(const char *p_list, cpu_set_t *p_cpus)
+{
+    const char *p = p_list;
+    char *p_end;
+    long first;
+    long last;
+
+    CPU_ZERO(p_cpus);
+    while (*p != '\0')
+    {
+        first = strtol(p, &p_end, 10);
+        if ((p_end == p) || (first < 0))
+        {
+            return WICED_FALSE;
+        }
+        last = first;
+        p = p_end;
+        if (*p == '-')
+        {
+            p++;
+            last = strtol(p, &p_end, 10);
+            if ((p_end == p) || (last < first))
+            {
+                return WICED_FALSE;
+            }
+            p = p_end;
+        }
+        if (last >= CPU_SETSIZE)
+        {
+            return WICED_FALSE;
+        }
+        for (; first <= last; first++)
+        {
+            CPU_SET((int)first, p_cpus);
+        }
+        if (*p == ',')
+        {
+            p++;
+        }
+        else if (*p != '\0')
+        {
+            return WICED_FALSE;
+        }
+    }
+    return (CPU_COUNT(p_cpus) > 0) ? WICED_TRUE : WICED_FALSE;
+}
+
+/*******************************************************************************
+ * Function Name: audio_rt_prefault
+ *******************************************************************************
+ * Summary:
+ *   Touches every page of a buffer so that the audio threads do not take
+ *   the first-touch page faults during a call. The contents are preserved.
+ *
+ * Parameters:
+ *   void *p_mem : buffer
+ *   size_t len  : buffer length in bytes
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void audio_rt_prefault(void *p_mem, size_t len)
+{
+    volatile uint8_t *p = (volatile uint8_t *)p_mem;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t i;
+
+    for (i = 0; i < len; i += page)
+    {
+        p[i] = p[i];
+    }
+    if (len > 0)
+    {
+        p[len - 1] = p[len - 1];
+    }
+}
+
+/*******************************************************************************
+ * Function Name: audio_rt_prefault_stack
+ *******************************************************************************
+ * Summary:
+ *   Touches the first AUDIO_RT_STACK_PREFAULT bytes of the calling thread's
+ *   stack
+ *
+ ******************************************************************************/
+static void audio_rt_prefault_stack(void)
+{
+    volatile uint8_t stack[AUDIO_RT_STACK_PREFAULT];
+    size_t i;
+
+    for (i = 0; i < sizeof(stack); i += 256)
+    {
+        stack[i] = 0;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: audio_rt_thread_start
+ *******************************************************************************
+ * Summary:
+ *   Entry of every audio thread: names the thread, prefaults its stack and
+ *   runs the thread function
+ *
+ ******************************************************************************/
+static void *audio_rt_thread_start(void *arg)
+{
+    audio_rt_start_t start = *(audio_rt_start_t *)arg;
+
+    free(arg);
+    pthread_setname_np(pthread_self(), start.name);
+    audio_rt_prefault_stack();
+    return start.p_fn(start.p_arg);
+}
+
+/*******************************************************************************
+ * Function Name: audio_rt_thread_spawn
+ *******************************************************************************
+ * Summary:
+ *   Creates a thread with SCHED_FIFO at the given priority, or the default
+ *   policy for priority 0, on the configured CPUs
+ *
+ ******************************************************************************/
+static int audio_rt_thread_spawn(pthread_t *p_thread, int priority, audio_rt_start_t *p_start)
+{
+    pthread_attr_t attr;
+    struct sched_param param = { .sched_priority = priority };
+    int status;
+
+    pthread_attr_init(&attr);
+    if (priority > 0)
+    {
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &param);
+    }
+    if (rt_cpus_set)
+    {
+        pthread_attr_setaffinity_np(&attr, sizeof(rt_cpus), &rt_cpus);
+    }
+    status = pthread_create(p_thread, &attr, audio_rt_thread_start, p_start);
+    pthread_attr_destroy(&attr);
+    return status;
+}
+
+/*******************************************************************************
+ * Function Name: audio_rt_thread_create
+ *******************************************************************************
+ * Summary:
+ *   Creates an audio thread. SCHED_FIFO is requested first, the thread falls
+ *   back to the default policy if the process is not allowed to use
+ *   real-time scheduling.
+ *
+ * Parameters:
+ *   pthread_t *p_thread     : created thread
+ *   const char *p_name      : thread name, truncated to 15 characters
+ *   void *(*p_fn)(void *)   : thread function
+ *   void *p_arg             : thread function argument
+ *
+ * Return:
+ *   int : 0 or the pthread_create() error
+ *
+ ******************************************************************************/
+int audio_rt_thread_create(pthread_t *p_thread, const char *p_name, void *(*p_fn)(void *), void *p_arg)
+{
+    audio_rt_start_t *p_start = malloc(sizeof(audio_rt_start_t));
+    int status;
+
+    if (p_start == NULL)
+    {
+        return ENOMEM;
+    }
+    p_start->p_fn = p_fn;
+    p_start->p_arg = p_arg;
+    snprintf(p_start->name, sizeof(p_start->name), "%s", p_name);
+
+    status = audio_rt_thread_spawn(p_thread, rt_priority, p_start);
+    if ((status != 0) && (rt_priority > 0))
+    {
+        WICED_BT_TRACE("%s thread SCHED_FIFO failed (%d), using default policy\n", p_name, status);
+        status = audio_rt_thread_spawn(p_thread, 0, p_start);
+    }
+    if (status != 0)
+    {
+        free(p_start);
+    }
+    return status;
+}
+
+/*******************************************************************************
+ * Function Name: audio_rt_promote_self
+ *******************************************************************************
+ * Summary:
+ *   Gives the calling thread, which is not created by the application, the
+ *   scheduling policy and CPUs of the audio threads. Only the first call of
+ *   each thread has an effect.
+ *
+ * Parameters:
+ *   const char *p_name : thread description for the trace
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void audio_rt_promote_self(const char *p_name)
+{
+    static __thread wiced_bool_t promoted = WICED_FALSE;
+    struct sched_param param = { .sched_priority = rt_priority };
+    int status;
+
+    if (promoted)
+    {
+        return;
+    }
+    promoted = WICED_TRUE;
+
+    if (rt_priority > 0)
+    {
+        status = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (status != 0)
+        {
+            WICED_BT_TRACE("%s thread SCHED_FIFO failed (%d)\n", p_name, status);
+        }
+    }
+    if (rt_cpus_set)
+    {
+        pthread_setaffinity_np(pthread_self(), sizeof(rt_cpus), &rt_cpus);
+    }
+    audio_rt_prefault_stack();
+}
+
+/*******************************************************************************
+ * Function Name: audio_rt_get_usage
+ *******************************************************************************
+ * Summary:
+ *   Returns the page fault and context switch counters of the calling
+ *   thread or of the whole process
+ *
+ * Parameters:
+ *   wiced_bool_t thread        : WICED_TRUE for the calling thread
+ *   audio_rt_usage_t *p_usage  : filled with the counters
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void audio_rt_get_usage(wiced_bool_t thread, audio_rt_usage_t *p_usage)
+{
+    struct rusage usage;
+
+    memset(p_usage, 0, sizeof(*p_usage));
+    if (getrusage(thread ? RUSAGE_THREAD : RUSAGE_SELF, &usage) != 0)
+    {
+        return;
+    }
+    p_usage->minor_faults = (uint64_t)usage.ru_minflt;
+    p_usage->major_faults = (uint64_t)usage.ru_majflt;
+    p_usage->voluntary_switches = (uint64_t)usage.ru_nvcsw;
+    p_usage->involuntary_switches = (uint64_t)usage.ru_nivcsw;
+}
+
+/*******************************************************************************
+ * Function Name: audio_rt_print_settings
+ *******************************************************************************
+ * Summary:
+ *   Prints the scheduling, CPU and memory locking settings in use
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void audio_rt_print_settings(void)
+{
+    if (rt_priority > 0)
+    {
+        printf("audio threads SCHED_FIFO %d", rt_priority);
+    }
+    else
+    {
+        printf("audio threads default policy");
+    }
+    printf(", CPUs %s, memory %s\n", (p_rt_cpus != NULL) ? p_rt_cpus : "any",
+                                     rt_locked ? "locked" : "not locked");
+}
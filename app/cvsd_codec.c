@@ -0,0 +1,271 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/*******************************************************************************
+ * File Name: cvsd_codec.c
+ *
+ * Description: This file contains the host side CVSD codec defined by the
+ * Bluetooth Core specification (Vol 2, Part B, 9.2): syllabic companding
+ * with J = K = 4, accumulator decay h = 1 - 1/32, step size decay
+ * beta = 1 - 1/1024 and step sizes from 10 to 1280. The delta modulator runs
+ * at 64 kHz, the 8 kHz PCM side is converted with the polyphase resampler.
+ * Bits are packed least significant bit first, the order they are sent on
+ * air.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ ******************************************************************************/
+#include <string.h>
+
+#include "cvsd_codec.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define CVSD_Q                      (10)
+#define CVSD_STEP_MIN               (10 * (1 << CVSD_Q))
+#define CVSD_STEP_MAX               (1280 * (1 << CVSD_Q))
+#define CVSD_ACCUM_MAX              (INT16_MAX * (1 << CVSD_Q))
+#define CVSD_ACCUM_MIN              (INT16_MIN * (1 << CVSD_Q))
+#define CVSD_ACCUM_DECAY_SHIFT      (5)     /* h = 1 - 1/32 */
+#define CVSD_STEP_DECAY_SHIFT       (10)    /* beta = 1 - 1/1024 */
+#define CVSD_RUN_MASK               (0xFU)  /* J = 4 equal bits grow the step */
+#define CVSD_IDLE_BYTE              (0x55U) /* alternating bits, silence */
+#define CVSD_CHUNK_BYTES            (128U)  /* bytes per resampler call */
+
+#ifndef MIN
+#define MIN(a, b)                   (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b)                   (((a) > (b)) ? (a) : (b))
+#endif
+
+/*******************************************************************************
+ *       FUNCTION DECLARATION
+ ******************************************************************************/
+static void cvsd_state_init(cvsd_state_t *p_state);
+static inline int32_t cvsd_step(cvsd_state_t *p_state, uint32_t bit);
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: cvsd_state_init
+ *******************************************************************************
+ * Summary:
+ *   Resets the delta modulator to silence
+ *
+ ******************************************************************************/
+static void cvsd_state_init(cvsd_state_t *p_state)
+{
+    p_state->accum = 0;
+    p_state->step = CVSD_STEP_MIN;
+    p_state->bits = CVSD_IDLE_BYTE;
+}
+
+/*******************************************************************************
+ * Function Name: cvsd_step
+ *******************************************************************************
+ * Summary:
+ *   Applies one CVSD bit to the delta modulator. The encoder and the decoder
+ *   run the same update so that their accumulators track each other.
+ *
+ * Return:
+ *   int32_t : reconstructed sample, Q10
+ *
+ ******************************************************************************/
+static inline int32_t cvsd_step(cvsd_state_t *p_state, uint32_t bit)
+{
+    uint32_t run;
+    int32_t y;
+
+    p_state->bits = (p_state->bits << 1) | bit;
+    run = p_state->bits & CVSD_RUN_MASK;
+    if ((run == 0) || (run == CVSD_RUN_MASK))
+    {
+        p_state->step = MIN(p_state->step + CVSD_STEP_MIN, CVSD_STEP_MAX);
+    }
+    else
+    {
+        p_state->step = MAX(p_state->step - (p_state->step >> CVSD_STEP_DECAY_SHIFT), CVSD_STEP_MIN);
+    }
+
+    y = p_state->accum + (bit ? p_state->step : -p_state->step);
+    y = MIN(MAX(y, CVSD_ACCUM_MIN), CVSD_ACCUM_MAX);
+    p_state->accum = y - (y >> CVSD_ACCUM_DECAY_SHIFT);
+    return y;
+}
+
+/*******************************************************************************
+ * Function Name: cvsd_decoder_init
+ *******************************************************************************
+ * Summary:
+ *   Initializes the CVSD decoder
+ *
+ * Parameters:
+ *   cvsd_decoder_t *p_dec : decoder
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the rate converter cannot be set up
+ *
+ ******************************************************************************/
+wiced_bool_t cvsd_decoder_init(cvsd_decoder_t *p_dec)
+{
+    cvsd_state_init(&p_dec->state);
+    return resampler_init(&p_dec->rs, CVSD_BIT_RATE, CVSD_PCM_RATE);
+}
+
+/*******************************************************************************
+ * Function Name: cvsd_decode
+ *******************************************************************************
+ * Summary:
+ *   Decodes received CVSD bytes to 8 kHz PCM. Every byte yields one sample
+ *   on average, the count of a single call can differ by one.
+ *
+ * Parameters:
+ *   cvsd_decoder_t *p_dec  : decoder
+ *   const uint8_t *p_data  : CVSD bytes
+ *   uint32_t len           : length of p_data
+ *   int16_t *p_pcm         : output samples
+ *   uint32_t max_samples   : size of p_pcm, at least len + 1
+ *
+ * Return:
+ *   uint32_t : number of samples written to p_pcm
+ *
+ ******************************************************************************/
+uint32_t cvsd_decode(cvsd_decoder_t *p_dec, const uint8_t *p_data, uint32_t len,
+                     int16_t *p_pcm, uint32_t max_samples)
+{
+    int16_t wide[CVSD_CHUNK_BYTES * CVSD_BITS_PER_SAMPLE];
+    uint32_t produced = 0;
+    uint32_t n;
+    uint32_t i;
+    uint32_t b;
+
+    while (len > 0)
+    {
+        n = MIN(len, CVSD_CHUNK_BYTES);
+        for (i = 0; i < n; i++)
+        {
+            for (b = 0; b < CVSD_BITS_PER_SAMPLE; b++)
+            {
+                wide[(i * CVSD_BITS_PER_SAMPLE) + b] =
+                        (int16_t)(cvsd_step(&p_dec->state, (p_data[i] >> b) & 1U) >> CVSD_Q);
+            }
+        }
+        produced += resampler_process(&p_dec->rs, wide, n * CVSD_BITS_PER_SAMPLE,
+                                      &p_pcm[produced], max_samples - produced);
+        p_data += n;
+        len -= n;
+    }
+    return produced;
+}
+
+/*******************************************************************************
+ * Function Name: cvsd_encoder_init
+ *******************************************************************************
+ * Summary:
+ *   Initializes the CVSD encoder
+ *
+ * Parameters:
+ *   cvsd_encoder_t *p_enc : encoder
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the rate converter cannot be set up
+ *
+ ******************************************************************************/
+wiced_bool_t cvsd_encoder_init(cvsd_encoder_t *p_enc)
+{
+    cvsd_state_init(&p_enc->state);
+    p_enc->underruns = 0;
+    return resampler_init(&p_enc->rs, CVSD_PCM_RATE, CVSD_BIT_RATE);
+}
+
+/*******************************************************************************
+ * Function Name: cvsd_encode
+ *******************************************************************************
+ * Summary:
+ *   Encodes 8 kHz PCM to CVSD, one byte per sample. The up-sampler produces
+ *   exactly 8 samples per input sample, should it ever fall short the byte
+ *   is sent as the idle pattern.
+ *
+ * Parameters:
+ *   cvsd_encoder_t *p_enc  : encoder
+ *   const int16_t *p_pcm   : input samples
+ *   uint32_t num_samples   : number of input samples
+ *   uint8_t *p_data        : num_samples output bytes
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void cvsd_encode(cvsd_encoder_t *p_enc, const int16_t *p_pcm, uint32_t num_samples, uint8_t *p_data)
+{
+    int16_t wide[CVSD_CHUNK_BYTES * CVSD_BITS_PER_SAMPLE];
+    uint32_t got;
+    uint32_t n;
+    uint32_t i;
+    uint32_t b;
+    uint32_t bit;
+    uint8_t byte;
+
+    while (num_samples > 0)
+    {
+        n = MIN(num_samples, CVSD_CHUNK_BYTES);
+        got = resampler_process(&p_enc->rs, p_pcm, n, wide, n * CVSD_BITS_PER_SAMPLE);
+        for (i = 0; i < n; i++)
+        {
+            if (((i + 1) * CVSD_BITS_PER_SAMPLE) > got)
+            {
+                p_data[i] = CVSD_IDLE_BYTE;
+                p_enc->underruns++;
+                continue;
+            }
+            byte = 0;
+            for (b = 0; b < CVSD_BITS_PER_SAMPLE; b++)
+            {
+                bit = ((wide[(i * CVSD_BITS_PER_SAMPLE) + b] * (1 << CVSD_Q)) >= p_enc->state.accum) ? 1U : 0U;
+                cvsd_step(&p_enc->state, bit);
+                byte |= (uint8_t)(bit << b);
+            }
+            p_data[i] = byte;
+        }
+        p_pcm += n;
+        p_data += n;
+        num_samples -= n;
+    }
+}
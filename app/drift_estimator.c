@@ -0,0 +1,213 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/*******************************************************************************
+ * File Name: drift_estimator.c
+ *
+ * Description: This file contains the implementation of the SCO to ALSA clock
+ * drift estimator. Once per playback block the playback thread reports how
+ * far the jitter buffer depth is from its set point, with the SCO arrival
+ * saw-tooth removed, and the ALSA device delay. Their sum is low pass
+ * filtered and fed to a PI controller whose output is the resampler ratio
+ * correction. The integral term converges to the clock offset, it is kept
+ * across calls since both clocks stay the same.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ ******************************************************************************/
+#include <string.h>
+
+#include "drift_estimator.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define DRIFT_SETTLE_MS             (2000U) /* device delay baseline window */
+#define DRIFT_FILTER_MS             (1000.0) /* error low pass time constant */
+#define DRIFT_KP                    (100.0) /* ppm per ms of depth error */
+#define DRIFT_KI                    (2.0)   /* ppm per ms of depth error per second */
+#define DRIFT_MAX_DT_MS             (100.0) /* longer gaps are not integrated */
+
+#define DRIFT_LOAD(p)               __atomic_load_n((p), __ATOMIC_RELAXED)
+#define DRIFT_STORE(p, v)           __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+
+#define DRIFT_CLAMP(v, lim)         (((v) > (lim)) ? (lim) : (((v) < -(lim)) ? -(lim) : (v)))
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: drift_estimator_init
+ *******************************************************************************
+ * Summary:
+ *   Clears the estimator including the clock offset estimate
+ *
+ * Parameters:
+ *   drift_estimator_t *p_de : estimator
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void drift_estimator_init(drift_estimator_t *p_de)
+{
+    memset(p_de, 0, sizeof(*p_de));
+    drift_estimator_restart(p_de);
+}
+
+/*******************************************************************************
+ * Function Name: drift_estimator_restart
+ *******************************************************************************
+ * Summary:
+ *   Unlocks the loop for a new call. The clock offset estimate is kept and
+ *   applied right away, so a new call starts with the previous correction.
+ *
+ * Parameters:
+ *   drift_estimator_t *p_de : estimator
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void drift_estimator_restart(drift_estimator_t *p_de)
+{
+    p_de->error_ms = 0.0;
+    p_de->baseline_ms = 0.0;
+    p_de->delay_sum_ms = 0.0;
+    p_de->delay_samples = 0;
+    p_de->settle_ms = DRIFT_SETTLE_MS;
+    p_de->locked = WICED_FALSE;
+    DRIFT_STORE(&p_de->correction_ppb, (int32_t)(p_de->integral_ppm * 1000.0));
+}
+
+/*******************************************************************************
+ * Function Name: drift_estimator_update
+ *******************************************************************************
+ * Summary:
+ *   Runs one step of the loop. While the jitter buffer is not playing the
+ *   loop holds its last correction. After DRIFT_SETTLE_MS of playback the
+ *   mean device delay becomes the baseline and the loop locks.
+ *
+ * Parameters:
+ *   drift_estimator_t *p_de  : estimator
+ *   double depth_error_ms    : jitter buffer depth minus its set point,
+ *                              positive when too much audio is queued
+ *   double device_delay_ms   : snd_pcm_delay() of the playback device
+ *   double dt_ms             : time since the previous update
+ *   wiced_bool_t playing     : jitter buffer is playing received audio
+ *
+ * Return:
+ *   int32_t : ratio correction in ppb, positive to consume SCO audio faster
+ *
+ ******************************************************************************/
+int32_t drift_estimator_update(drift_estimator_t *p_de, double depth_error_ms, double device_delay_ms,
+                               double dt_ms, wiced_bool_t playing)
+{
+    double correction;
+    double error;
+
+    if (!playing || (dt_ms <= 0.0) || (dt_ms > DRIFT_MAX_DT_MS))
+    {
+        return p_de->correction_ppb;
+    }
+
+    if (!p_de->locked)
+    {
+        p_de->delay_sum_ms += device_delay_ms;
+        p_de->delay_samples++;
+        p_de->settle_ms = (dt_ms >= p_de->settle_ms) ? 0 : (p_de->settle_ms - (uint32_t)dt_ms);
+        if (p_de->settle_ms != 0)
+        {
+            return p_de->correction_ppb;
+        }
+        p_de->baseline_ms = p_de->delay_sum_ms / p_de->delay_samples;
+        p_de->error_ms = depth_error_ms;
+        p_de->locked = WICED_TRUE;
+        p_de->locks++;
+    }
+
+    /* A late wake-up shows up as less device delay and more queued SCO
+     * audio, the sum only moves with the clock offset */
+    error = depth_error_ms + (device_delay_ms - p_de->baseline_ms);
+    p_de->error_ms += (error - p_de->error_ms) * (dt_ms / (DRIFT_FILTER_MS + dt_ms));
+
+    p_de->integral_ppm += DRIFT_KI * p_de->error_ms * (dt_ms / 1000.0);
+    p_de->integral_ppm = DRIFT_CLAMP(p_de->integral_ppm, (double)DRIFT_MAX_PPM);
+    correction = p_de->integral_ppm + (DRIFT_KP * p_de->error_ms);
+    correction = DRIFT_CLAMP(correction, (double)DRIFT_MAX_PPM);
+
+    DRIFT_STORE(&p_de->offset_ppb, (int32_t)(p_de->integral_ppm * 1000.0));
+    DRIFT_STORE(&p_de->correction_ppb, (int32_t)(correction * 1000.0));
+    return p_de->correction_ppb;
+}
+
+/*******************************************************************************
+ * Function Name: drift_estimator_get_offset_ppb
+ *******************************************************************************
+ * Summary:
+ *   Returns the estimated rate offset of the SCO clock against the device
+ *   clock, positive when SCO audio arrives faster than it is played
+ *
+ * Parameters:
+ *   const drift_estimator_t *p_de : estimator
+ *
+ * Return:
+ *   int32_t : offset in ppb
+ *
+ ******************************************************************************/
+int32_t drift_estimator_get_offset_ppb(const drift_estimator_t *p_de)
+{
+    return DRIFT_LOAD(&p_de->offset_ppb);
+}
+
+/*******************************************************************************
+ * Function Name: drift_estimator_get_correction_ppb
+ *******************************************************************************
+ * Summary:
+ *   Returns the resampler ratio correction currently applied to playback
+ *
+ * Parameters:
+ *   const drift_estimator_t *p_de : estimator
+ *
+ * Return:
+ *   int32_t : correction in ppb
+ *
+ ******************************************************************************/
+int32_t drift_estimator_get_correction_ppb(const drift_estimator_t *p_de)
+{
+    return DRIFT_LOAD(&p_de->correction_ppb);
+}
@@ -53,6 +53,14 @@
 #include "wiced_hal_nvram.h"
 #include "wiced_bt_sco.h"
 #include "audio_platform_common.h" /* ALSA */
+#include "hfag_config.h"
+#include "hfag_cmdq.h"
+#include "hfag_console.h"
+#include "hfag_future.h"
+#include "hfag_reconnect.h"
+#include "hfag_sco_data.h"
+#include "hfag_startup.h"
+#include "hfag_trace.h"
 #include <pthread.h>
 #include <time.h>
 
@@ -69,6 +77,8 @@
 /* Correspond's to the number of peer devices */
 #define KEY_INFO_POOL_BUFFER_COUNT              (10U)
 #define INQUIRY_DURATION                        (5U) /* in seconds */
+/* Bonded peers kept from HANDSFREE_AG_NVRAM_ID on, most recently used first */
+#define HFAG_KEY_STORE_SLOTS                    HFAG_RECONNECT_MAX_PEERS
 
 #define HFAG_SAMPLING_WBS_FREQUENCY             (16000U)
 #define HFAG_SAMPLING_NBS_FREQUENCY             (8000U)
@@ -82,8 +92,12 @@
 #define HFAG_EIR_TYPE_FULL_NAME                 (0x09U)
 #define HFAG_EIR_16BIT_UUID_LIST                (0x02U)
 
-#ifdef DUMP_SCO_TO_FILE
-#define SCO_DATA_LEN                            (1024U)
+#define HFAG_MAX_SCO_INDEX                      (16U) /* sco_idx values mapped directly */
+#define HFAG_INIT_PARTS                         (2U)  /* application init and audio devices */
+#define HFAG_INIT_TIMEOUT_S                     (10)  /* default HFAG_INIT_TIMEOUT_S */
+
+#if ( HANDSFREE_AG_NUM_SCB > AUDIO_MAX_SESSIONS )
+#error "HANDSFREE_AG_NUM_SCB exceeds AUDIO_MAX_SESSIONS"
 #endif
 
 /*******************************************************************************
@@ -111,13 +125,14 @@ hfag_nvram_chunk_t *p_nvram_first = NULL;
 wiced_bt_pool_t* p_key_info_pool; /* Pool for storing the key info */
 wiced_bt_voice_path_setup_t ag_sco_path;
 
-#ifdef DUMP_SCO_TO_FILE
-FILE *fp = NULL;
-uint8_t sco_data_copy[SCO_DATA_LEN];
-#endif
+static wiced_bool_t hfag_sco_transparent = WICED_FALSE; /* narrowband CVSD coded on the host */
+/* sco_idx to service control block index, which is also the audio session */
+static uint8_t hfag_sco_scb[HFAG_MAX_SCO_INDEX];
+/* HCI reason of the last ACL disconnection, per service control block */
+static uint8_t hfag_acl_reason[HANDSFREE_AG_NUM_SCB];
 
-pthread_cond_t cond_call_initial = PTHREAD_COND_INITIALIZER;
-pthread_mutex_t cond_lock_initial = PTHREAD_MUTEX_INITIALIZER;
+/* Completed by the BTM_ENABLED_EVT handler and by the audio device thread */
+static hfag_future_t hfag_init_future;
 
 /*******************************************************************************
  *       FUNCTION DECLARATION
@@ -132,6 +147,8 @@ static wiced_result_t hfag_management_callback
                             );
 static wiced_result_t hfag_write_eir( void );
 static void hfag_init( void );
+static void hfag_sco_map( uint16_t sco_idx, uint8_t scb );
+static void hfag_sco_unmap( uint8_t scb );
 static void hfag_event_cback
                            (
                                 wiced_bt_hfp_ag_event_t evt,
@@ -143,7 +160,11 @@ static int hfag_write_nvram(int nvram_id, int data_len, void *p_data);
 static void hfag_delete_nvram( int nvram_id ,wiced_bool_t from_host);
 static int hfag_read_nvram(int nvram_id, void *p_data, int data_len);
 static int hfag_alloc_nvram_id( );
-static const char *hfag_get_ag_event_name( wiced_bt_hfp_ag_event_t event );
+static uint8_t hfag_key_store_load( wiced_bt_device_link_keys_t *p_keys );
+#ifdef SAVE_PAIRING_KEY
+static void hfag_key_store_save( const wiced_bt_device_link_keys_t *p_keys );
+static void hfag_key_store_promote( const wiced_bt_device_address_t bd_addr );
+#endif
 static void hfag_inquiry_result_cback
                             (
                                 wiced_bt_dev_inquiry_scan_result_t *p_inquiry_result,
@@ -155,6 +176,17 @@ static void hfag_sco_data_app_callback
                                 uint16_t length,
                                 uint8_t* p_data
                             );
+static void hfag_connection_status_cback
+                            (
+                                wiced_bt_device_address_t bd_addr,
+                                uint8_t *p_features,
+                                wiced_bool_t is_connected,
+                                uint16_t handle,
+                                wiced_bt_transport_t transport,
+                                uint8_t reason
+                            );
+static void *hfag_open_audio_thread( void *p_arg );
+static void hfag_restore_gap( void );
 
 /*******************************************************************************
  *       FUNCTION DEFINITION
@@ -175,7 +207,25 @@ static void hfag_sco_data_app_callback
  ******************************************************************************/
 void hfag_application_start()
 {
+    pthread_t audio_thread;
+    wiced_bool_t audio_threaded;
+    wiced_result_t status;
+    int timeout_s;
+
     printf("************* Handsfree AG Application Start ************************\n");
+    hfag_startup_mark( HFAG_STARTUP_FIRMWARE );
+
+    hfag_trace_init();
+    hfag_future_init( &hfag_init_future, HFAG_INIT_PARTS );
+
+    /* Keep the audio devices open so that calls do not wait for them. They
+     * are opened while the stack enables the controller */
+    hfag_startup_start( HFAG_STARTUP_AUDIO );
+    audio_threaded = ( pthread_create( &audio_thread, NULL, hfag_open_audio_thread, NULL ) == 0 ) ? WICED_TRUE : WICED_FALSE;
+    if ( !audio_threaded )
+    {
+        (void)hfag_open_audio_thread( NULL );
+    }
 
     /* Register call back and configuration with stack and
      * Check if stack initialization was successful */
@@ -189,6 +239,7 @@ void hfag_application_start()
             printf("create default heap error: size %d\n", BT_STACK_HEAP_SIZE);
             exit(EXIT_FAILURE);
         }
+        hfag_startup_mark( HFAG_STARTUP_STACK );
     }
     else
     {
@@ -196,7 +247,76 @@ void hfag_application_start()
        exit(EXIT_FAILURE);
     }
 
-    wait_init_done();
+    /* Wait for the application init of BTM_ENABLED_EVT and the audio devices */
+    timeout_s = hfag_config_get_int( HFAG_CONFIG_INIT_TIMEOUT_S, HFAG_INIT_TIMEOUT_S );
+    status = hfag_future_wait( &hfag_init_future, ( timeout_s > 0 ) ? (uint32_t)timeout_s * 1000U : 0U );
+    if ( WICED_BT_TIMEOUT == status )
+    {
+        printf("Bluetooth controller or audio devices not ready within %d s\n", timeout_s);
+        exit(EXIT_FAILURE);
+    }
+    if ( WICED_BT_SUCCESS != status )
+    {
+        printf("Bluetooth Enable Failed, status %d\n", status);
+        exit(EXIT_FAILURE);
+    }
+    if ( audio_threaded )
+    {
+        pthread_join( audio_thread, NULL );
+    }
+
+    hfag_restore_gap();
+    hfag_reconnect_start();
+    hfag_startup_mark( HFAG_STARTUP_READY );
+}
+
+/*******************************************************************************
+ * Function Name: hfag_open_audio_thread
+ *******************************************************************************
+ * Summary:
+ *   Opens the audio devices in parallel with the controller enable
+ *
+ ******************************************************************************/
+static void *hfag_open_audio_thread( void *p_arg )
+{
+    open_audio_session();
+    hfag_startup_mark( HFAG_STARTUP_AUDIO );
+    hfag_future_complete( &hfag_init_future, WICED_BT_SUCCESS );
+    return NULL;
+}
+
+/*******************************************************************************
+ * Function Name: hfag_restore_gap
+ *******************************************************************************
+ * Summary:
+ *   Resumes the visibility and pairing modes of the previous run once the
+ *   audio devices are ready to take calls. The modes are set on the stack
+ *   thread through the command queue.
+ *
+ ******************************************************************************/
+static void hfag_restore_gap( void )
+{
+    hfag_cmd_t cmd;
+    uint8_t discoverable, connectable, pairable;
+
+    if ( !hfag_startup_saved_gap( &discoverable, &connectable, &pairable ) )
+    {
+        return;
+    }
+    memset( &cmd, 0, sizeof( cmd ) );
+    if ( ( discoverable != HFAG_STARTUP_GAP_UNSET ) && ( connectable != HFAG_STARTUP_GAP_UNSET ) )
+    {
+        cmd.type = HFAG_CMD_SET_VISIBILITY;
+        cmd.arg[0] = discoverable;
+        cmd.arg[1] = connectable;
+        (void)hfag_cmdq_submit( &cmd );
+    }
+    if ( pairable != HFAG_STARTUP_GAP_UNSET )
+    {
+        cmd.type = HFAG_CMD_SET_PAIRABILITY;
+        cmd.arg[0] = pairable;
+        (void)hfag_cmdq_submit( &cmd );
+    }
 }
 
 /*******************************************************************************
@@ -219,12 +339,14 @@ static wiced_result_t hfag_management_callback(wiced_bt_management_evt_t event,
                                           wiced_bt_management_evt_data_t *p_event_data)
 {
     wiced_bt_device_address_t bda = { 0 };
+    wiced_bt_device_link_keys_t keys[HFAG_KEY_STORE_SLOTS];
     wiced_result_t result = WICED_BT_SUCCESS;
     wiced_bt_dev_pairing_cplt_t *p_pairing_cmpl;
     uint8_t pairing_result;
     wiced_bt_dev_encryption_status_t *p_encryption_status;
     int nvram_id;
     int bytes_written, bytes_read;
+    uint8_t i, count;
     const uint8_t *link_key;
 
     WICED_BT_TRACE( "hfag_management_callback. Event: 0x%x %s\n", event, hfag_get_bt_event_name(event) );
@@ -235,6 +357,9 @@ static wiced_result_t hfag_management_callback(wiced_bt_management_evt_t event,
         /* Bluetooth Controller and Host Stack Enabled */
         if ( WICED_BT_SUCCESS == p_event_data->enabled.status )
         {
+            hfag_startup_mark( HFAG_STARTUP_ENABLE );
+            hfag_startup_controller_ready();
+
             wiced_bt_set_local_bdaddr((uint8_t *)bt_device_address, BLE_ADDR_PUBLIC);
             wiced_bt_dev_read_local_addr( bda );
             printf( "Local Bluetooth Address: " );
@@ -246,9 +371,6 @@ static wiced_result_t hfag_management_callback(wiced_bt_management_evt_t event,
                 WICED_BT_TRACE( "hfag_write_eir failed with result = %x\n", result);
             }
 
-            /* initialize everything */
-            memset( &hfag_control_cb, 0, sizeof( hfag_control_cb ) );
-
             WICED_BT_TRACE("wiced_app_cfg_sdp_record_get_size = %d\n", wiced_app_cfg_sdp_record_get_size());
             /* create SDP records */
             if ( !wiced_bt_sdp_db_init( ( uint8_t * )hfag_sdp_db, wiced_app_cfg_sdp_record_get_size( ) ))
@@ -256,6 +378,8 @@ static wiced_result_t hfag_management_callback(wiced_bt_management_evt_t event,
                 WICED_BT_TRACE( "wiced_bt_sdp_db_init failed\n");
             }
 
+            /* The bonded peers are known before a connection can come in */
+            hfag_reconnect_init( keys, hfag_key_store_load( keys ) );
             hfag_init( );
 
             p_key_info_pool = wiced_bt_create_pool
@@ -266,11 +390,13 @@ static wiced_result_t hfag_management_callback(wiced_bt_management_evt_t event,
                                     NULL
                                 );
             WICED_BT_TRACE( "wiced_bt_create_pool %x\n", p_key_info_pool );
-            notify_init_done();
+            hfag_startup_mark( HFAG_STARTUP_APP );
+            hfag_future_complete( &hfag_init_future, WICED_BT_SUCCESS );
         }
         else
         {
-            printf("Bluetooth Enable Failed \n");
+            hfag_future_complete( &hfag_init_future,
+                                  ( WICED_BT_SUCCESS != p_event_data->enabled.status ) ? p_event_data->enabled.status : WICED_BT_ERROR );
         }
         break;
 
@@ -320,16 +446,12 @@ static wiced_result_t hfag_management_callback(wiced_bt_management_evt_t event,
     case BTM_PAIRED_DEVICE_LINK_KEYS_UPDATE_EVT:
         WICED_BT_TRACE("BTM_PAIRED_DEVICE_LINK_KEYS_UPDATE_EVT\n");
 
-        /* This application supports a single paired host, we can save keys
-         * under the same NVRAM ID overwriting previous pairing if any */
+        /* The keys of the most recent pairing go first, the least recently
+         * used peer is overwritten once every slot is taken */
 #ifdef SAVE_PAIRING_KEY
-        (void)hfag_write_nvram
-                        (
-                            HANDSFREE_AG_NVRAM_ID,
-                            sizeof(wiced_bt_device_link_keys_t),
-                            &p_event_data->paired_device_link_keys_update
-                        );
+        hfag_key_store_save( &p_event_data->paired_device_link_keys_update );
 #endif
+        hfag_reconnect_bonded( p_event_data->paired_device_link_keys_update.bd_addr );
         link_key = p_event_data->paired_device_link_keys_update.key_data.br_edr_key;
         WICED_BT_TRACE(" LinkKey:%02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X\n",
                 link_key[0], link_key[1], link_key[2], link_key[3], link_key[4], link_key[5], link_key[6],
@@ -338,18 +460,21 @@ static wiced_result_t hfag_management_callback(wiced_bt_management_evt_t event,
         break;
 
     case BTM_PAIRED_DEVICE_LINK_KEYS_REQUEST_EVT:
-        // read existing key from the NVRAM
-        if ( hfag_read_nvram (
-                    HANDSFREE_AG_NVRAM_ID,
-                    &p_event_data->paired_device_link_keys_request,
-                    sizeof(wiced_bt_device_link_keys_t)) != 0 )
+        // read existing key of the peer from the NVRAM
+        result = WICED_BT_ERROR;
+        count = hfag_key_store_load( keys );
+        for ( i = 0; i < count; i++ )
         {
-            WICED_BT_TRACE("BTM_PAIRED_DEVICE_LINK_KEYS_REQUEST_EVT: successfully read\n");
-            result = WICED_BT_SUCCESS;
+            if ( memcmp( keys[i].bd_addr, p_event_data->paired_device_link_keys_request.bd_addr, sizeof( wiced_bt_device_address_t ) ) == 0 )
+            {
+                memcpy( &p_event_data->paired_device_link_keys_request, &keys[i], sizeof( wiced_bt_device_link_keys_t ) );
+                WICED_BT_TRACE("BTM_PAIRED_DEVICE_LINK_KEYS_REQUEST_EVT: successfully read\n");
+                result = WICED_BT_SUCCESS;
+                break;
+            }
         }
-        else
+        if ( WICED_BT_SUCCESS != result )
         {
-            result = WICED_BT_ERROR;
             WICED_BT_TRACE("Key retrieval failure\n");
         }
         break;
@@ -386,7 +511,7 @@ static wiced_result_t hfag_management_callback(wiced_bt_management_evt_t event,
  ******************************************************************************/
 static void hfag_event_cback ( wiced_bt_hfp_ag_event_t evt, uint16_t handle, wiced_bt_hfp_ag_event_data_t *p_data )
 {
-    WICED_BT_TRACE( "### %s: evt = %x: %s\n", __FUNCTION__, evt, hfag_get_ag_event_name( evt ) );
+    HFAG_TRACE_INFO( HFAG_TRACE_HFP_EVENT, evt, handle );
     switch( evt )
     {
     case WICED_BT_HFP_AG_EVENT_OPEN:
@@ -395,38 +520,55 @@ static void hfag_event_cback ( wiced_bt_hfp_ag_event_t evt, uint16_t handle, wic
             printf("------------------------------------------------------\n");
             printf("WICED_BT_HFP_AG_EVENT_OPEN: Open status = %s\n", (p_data->open.status == 0) ? "Success" : "Failed");
             printf("------------------------------------------------------\n");
+            hfag_console_event( HFAG_CONSOLE_EVENT_OPEN, handle, p_data->open.status );
+            hfag_reconnect_open( handle, p_data->open.bd_addr, p_data->open.status );
         }
         break;
 
     case WICED_BT_HFP_AG_EVENT_CLOSE:
         hfag_print_hfp_context();
+        hfag_console_event( HFAG_CONSOLE_EVENT_DISCONNECTED, handle, 0 );
+        if ( hfag_validate_app_handle( handle ) )
+        {
+            hfag_reconnect_close( handle, hfag_acl_reason[handle-1] );
+            hfag_acl_reason[handle-1] = HFAG_RECONNECT_REASON_NONE;
+        }
+        else
+        {
+            hfag_reconnect_close( handle, HFAG_RECONNECT_REASON_NONE );
+        }
         break;
 
     case WICED_BT_HFP_AG_EVENT_CONNECTED:
         hfag_print_hfp_context();
+        hfag_console_event( HFAG_CONSOLE_EVENT_CONNECTED, handle, 0 );
+        hfag_reconnect_connected( handle );
+#ifdef SAVE_PAIRING_KEY
+        if ( hfag_validate_app_handle( handle ) )
+        {
+            hfag_key_store_promote( hfag_control_cb.ag_scb[handle-1].hf_addr );
+        }
+#endif
         break;
 
     case WICED_BT_HFP_AG_EVENT_AUDIO_OPEN:
         {
-#ifdef DUMP_SCO_TO_FILE
-            fp = fopen("audio.raw", "wb");
-            if ( fp == NULL )
-            {
-                perror("fopen error: ");
-            }
-#endif
             playback_config_params pb_config_params;
 #if ( BTM_WBS_INCLUDED == WICED_TRUE )
             if ( hfag_control_cb.ag_scb[handle-1].msbc_selected == WICED_TRUE )
             {
                 WICED_BT_TRACE("WBS enabled\n");
                 pb_config_params.sampling_freq = HFAG_SAMPLING_WBS_FREQUENCY; /* 16000 */
+                pb_config_params.msbc = WICED_TRUE;
+                pb_config_params.cvsd = WICED_FALSE;
             }
             else
 #endif
             {
                 WICED_BT_TRACE("NBS enabled\n");
                 pb_config_params.sampling_freq = HFAG_SAMPLING_NBS_FREQUENCY; /*8000 */
+                pb_config_params.msbc = WICED_FALSE;
+                pb_config_params.cvsd = hfag_sco_transparent;
             }
             pb_config_params.channel_mode = HFAG_CHANNEL_MODE; /* Mono */
             pb_config_params.num_of_subbands = HFAG_NUM_SUBBANDS; /* 8 */
@@ -435,20 +577,21 @@ static void hfag_event_cback ( wiced_bt_hfp_ag_event_t evt, uint16_t handle, wic
             pb_config_params.bit_pool = HFAG_BITPOOL; /* 26 */
             pb_config_params.num_of_blocks = HFAG_NUM_BLOCKS; /* 15 */
 
-            init_audio(pb_config_params);
+            hfag_sco_map( hfag_control_cb.ag_scb[handle-1].sco_idx, (uint8_t)( handle - 1 ) );
+            init_audio( (uint8_t)( handle - 1 ), pb_config_params );
 
             hfag_print_hfp_context();
+            hfag_console_event( HFAG_CONSOLE_EVENT_AUDIO_OPEN, handle, 0 );
         }
         break;
 
     case WICED_BT_HFP_AG_EVENT_AUDIO_CLOSE:
-#ifdef DUMP_SCO_TO_FILE
-        if ( fp ) {
-            fclose( fp );
-            fp = NULL;
-        }
-#endif
+        audio_print_stats( (uint8_t)( handle - 1 ) );
+        audio_print_latency( (uint8_t)( handle - 1 ) );
+        deinit_audio( (uint8_t)( handle - 1 ) );
+        hfag_sco_unmap( (uint8_t)( handle - 1 ) );
         hfag_print_hfp_context();
+        hfag_console_event( HFAG_CONSOLE_EVENT_AUDIO_CLOSE, handle, 0 );
         break;
 
     case WICED_BT_HFP_AG_EVENT_AT_CMD:
@@ -528,15 +671,16 @@ static wiced_result_t hfag_write_eir( void )
  ******************************************************************************/
 static void hfag_init( void )
 {
-    /* Currently hfag_control_cb maintains 1 service control block for
-     * connecting with 1 Handsfree Unit. Headset profile is not handled
-     * currently. This can be extended to hold multiple connections and
-     * Headset scb also */
+    /* hfag_control_cb maintains one service control block per connected
+     * Handsfree Unit, each with its own audio session. Headset profile is
+     * not handled currently */
     wiced_bt_hfp_ag_session_cb_t *p_scb = &hfag_control_cb.ag_scb[0];
     wiced_bt_dev_status_t result;
     int i;
 
     memset( &hfag_control_cb, 0, sizeof( hfag_control_cb ) );
+    memset( hfag_sco_scb, HFAG_NO_SCB, sizeof( hfag_sco_scb ) );
+    memset( hfag_acl_reason, HFAG_RECONNECT_REASON_NONE, sizeof( hfag_acl_reason ) );
 
     for ( i = 0; i < HANDSFREE_AG_NUM_SCB; i++, p_scb++ )
     {
@@ -563,7 +707,17 @@ static void hfag_init( void )
     ag_sco_path.p_sco_data_cb = &hfag_sco_data_app_callback;
     result = wiced_bt_sco_setup_voice_path(&ag_sco_path);
 
-    WICED_BT_TRACE("[%s] SCO Setting up voice path = %d\n",__func__, result);
+    /* The reconnect scheduler tells link loss from a disconnection by the
+     * HCI reason of the ACL */
+    wiced_bt_dev_register_connection_status_change( hfag_connection_status_cback );
+
+    /* In transparent air mode narrowband SCO carries the CVSD bits, one byte
+     * per 8 kHz sample instead of two, and the codec runs on the host. The
+     * controller voice setting must select transparent air coding to match */
+    hfag_sco_transparent = ( hfag_config_get_int( HFAG_CONFIG_SCO_TRANSPARENT, 0 ) != 0 ) ? WICED_TRUE : WICED_FALSE;
+
+    WICED_BT_TRACE("[%s] SCO Setting up voice path = %d, narrowband %s\n",__func__, result,
+                                    hfag_sco_transparent ? "transparent (host CVSD)" : "PCM (controller CVSD)");
 }
 
 /*******************************************************************************
@@ -631,6 +785,105 @@ static int hfag_read_nvram(int nvram_id, void *p_data, int data_len)
     return (read_bytes);
 }
 
+/*******************************************************************************
+ * Function Name: hfag_key_store_load
+ *******************************************************************************
+ * Summary:
+ *   Reads the link keys of the bonded peers, most recently used first
+ *
+ * Parameters:
+ *   wiced_bt_device_link_keys_t *p_keys : HFAG_KEY_STORE_SLOTS records
+ *
+ * Return:
+ *   uint8_t : number of records read
+ *
+ ******************************************************************************/
+static uint8_t hfag_key_store_load( wiced_bt_device_link_keys_t *p_keys )
+{
+    uint8_t count = 0;
+    uint8_t slot;
+
+    for ( slot = 0; slot < HFAG_KEY_STORE_SLOTS; slot++ )
+    {
+        if ( hfag_read_nvram( HANDSFREE_AG_NVRAM_ID + slot, &p_keys[count], sizeof( wiced_bt_device_link_keys_t ) ) != 0 )
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+#ifdef SAVE_PAIRING_KEY
+/*******************************************************************************
+ * Function Name: hfag_key_store_save
+ *******************************************************************************
+ * Summary:
+ *   Stores the link keys of a peer in the first slot and moves the others
+ *   down. Only the slots whose record changes are written.
+ *
+ * Parameters:
+ *   const wiced_bt_device_link_keys_t *p_keys : link keys of the peer
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void hfag_key_store_save( const wiced_bt_device_link_keys_t *p_keys )
+{
+    wiced_bt_device_link_keys_t old_keys[HFAG_KEY_STORE_SLOTS];
+    wiced_bt_device_link_keys_t new_keys[HFAG_KEY_STORE_SLOTS];
+    uint8_t old_count, new_count = 1;
+    uint8_t i;
+
+    old_count = hfag_key_store_load( old_keys );
+    memcpy( &new_keys[0], p_keys, sizeof( wiced_bt_device_link_keys_t ) );
+    for ( i = 0; ( i < old_count ) && ( new_count < HFAG_KEY_STORE_SLOTS ); i++ )
+    {
+        if ( memcmp( old_keys[i].bd_addr, p_keys->bd_addr, sizeof( wiced_bt_device_address_t ) ) != 0 )
+        {
+            memcpy( &new_keys[new_count++], &old_keys[i], sizeof( wiced_bt_device_link_keys_t ) );
+        }
+    }
+    for ( i = 0; i < new_count; i++ )
+    {
+        if ( ( i >= old_count ) || ( memcmp( &old_keys[i], &new_keys[i], sizeof( wiced_bt_device_link_keys_t ) ) != 0 ) )
+        {
+            (void)hfag_write_nvram( HANDSFREE_AG_NVRAM_ID + i, sizeof( wiced_bt_device_link_keys_t ), &new_keys[i] );
+        }
+    }
+}
+
+/*******************************************************************************
+ * Function Name: hfag_key_store_promote
+ *******************************************************************************
+ * Summary:
+ *   Makes a bonded peer the most recently used, so that it is paged first
+ *   after the next start
+ *
+ * Parameters:
+ *   const wiced_bt_device_address_t bd_addr : peer address
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void hfag_key_store_promote( const wiced_bt_device_address_t bd_addr )
+{
+    wiced_bt_device_link_keys_t keys[HFAG_KEY_STORE_SLOTS];
+    uint8_t count, i;
+
+    count = hfag_key_store_load( keys );
+    for ( i = 1; i < count; i++ )
+    {
+        if ( memcmp( keys[i].bd_addr, bd_addr, sizeof( wiced_bt_device_address_t ) ) == 0 )
+        {
+            hfag_key_store_save( &keys[i] );
+            break;
+        }
+    }
+}
+#endif
+
 /*******************************************************************************
  *      GAP RELATED FUNCTION DEFINITIONS
  ******************************************************************************/
@@ -681,6 +934,10 @@ wiced_result_t hfag_handle_set_visibility(uint8_t discoverability, uint8_t conne
             {
                 WICED_BT_TRACE("%s: wiced_bt_dev_set_connectability failed. Status = %x\n", __FUNCTION__, result);
             }
+            else
+            {
+                hfag_startup_save_gap( discoverability, connectability, HFAG_STARTUP_GAP_UNSET );
+            }
         }
     }
     return result;
@@ -733,6 +990,7 @@ wiced_result_t hfag_handle_set_pairability (uint8_t allowed)
 
             hfag_control_cb.pairing_allowed = allowed;
             wiced_bt_set_pairable_mode( hfag_control_cb.pairing_allowed, 0 );
+            hfag_startup_save_gap( HFAG_STARTUP_GAP_UNSET, HFAG_STARTUP_GAP_UNSET, allowed );
             WICED_BT_TRACE( " Set the pairing allowed to %d \n", hfag_control_cb.pairing_allowed );
         }
     }
@@ -758,7 +1016,13 @@ wiced_result_t hfag_inquiry(uint8_t enable)
     wiced_result_t result = WICED_BT_SUCCESS;
     wiced_bt_dev_inq_parms_t params; /* params for starting inquiry */
 
-    if ( enable == 1 )
+    if ( ( enable == 1 ) && hfag_reconnect_paging() )
+    {
+        /* Paging and inquiry share the radio, the page ends within seconds */
+        printf("%s: Reconnect in progress, try again\n", __FUNCTION__);
+        result = WICED_BT_BUSY;
+    }
+    else if ( enable == 1 )
     {
         memset(&params, 0, sizeof(params));
 
@@ -768,11 +1032,16 @@ wiced_result_t hfag_inquiry(uint8_t enable)
 
         result = wiced_bt_start_inquiry(&params, &hfag_inquiry_result_cback);
         WICED_BT_TRACE("inquiry started:%d\n", result);
+        if ( ( WICED_BT_PENDING == result ) || ( WICED_BT_SUCCESS == result ) )
+        {
+            hfag_reconnect_inquiry( WICED_TRUE );
+        }
     }
     else if ( enable == 0 )
     {
         result = wiced_bt_cancel_inquiry();
         WICED_BT_TRACE("cancel inquiry:%d\n", result);
+        hfag_reconnect_inquiry( WICED_FALSE );
     }
     else
     {
@@ -801,6 +1070,7 @@ static void hfag_inquiry_result_cback(wiced_bt_dev_inquiry_scan_result_t *p_inqu
     if ( p_inquiry_result == NULL )
     {
         printf("Inquiry Complete \n");
+        hfag_reconnect_inquiry( WICED_FALSE );
     }
     else
     {
@@ -815,6 +1085,49 @@ static void hfag_inquiry_result_cback(wiced_bt_dev_inquiry_scan_result_t *p_inqu
     }
 }
 
+/*******************************************************************************
+ * Function Name: hfag_connection_status_cback
+ *******************************************************************************
+ * Summary:
+ *   ACL connection status callback. Keeps the disconnect reason of the
+ *   service control blocks of the peer for the close event, and passes it
+ *   to the reconnect scheduler in case the profile closed first.
+ *
+ * Parameters:
+ *   wiced_bt_device_address_t bd_addr : peer address
+ *   uint8_t *p_features                : peer features
+ *   wiced_bool_t is_connected          : ACL up or down
+ *   uint16_t handle                    : ACL handle
+ *   wiced_bt_transport_t transport     : BR/EDR or LE
+ *   uint8_t reason                     : HCI disconnect reason
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+static void hfag_connection_status_cback( wiced_bt_device_address_t bd_addr, uint8_t *p_features,
+                                          wiced_bool_t is_connected, uint16_t handle,
+                                          wiced_bt_transport_t transport, uint8_t reason )
+{
+    int i;
+
+    if ( transport != BT_TRANSPORT_BR_EDR )
+    {
+        return;
+    }
+    for ( i = 0; i < HANDSFREE_AG_NUM_SCB; i++ )
+    {
+        if ( memcmp( hfag_control_cb.ag_scb[i].hf_addr, bd_addr, sizeof( wiced_bt_device_address_t ) ) == 0 )
+        {
+            hfag_acl_reason[i] = is_connected ? HFAG_RECONNECT_REASON_NONE : reason;
+        }
+    }
+    if ( !is_connected )
+    {
+        hfag_reconnect_link_down( bd_addr, reason );
+    }
+}
+
 /*******************************************************************************
  *      UTILITY FUNCTION DEFINITIONS
  ******************************************************************************/
@@ -895,37 +1208,6 @@ static const char *hfag_get_bt_event_name( wiced_bt_management_evt_t event )
     return NULL;
 }
 
-/******************************************************************************
- * Function Name: hfag_get_ag_event_name
- ******************************************************************************
- * Summary:
- * The function converts the wiced_bt_hfp_ag_event_t enum value to its
- * corresponding string literal. This will help the programmer to debug easily
- * with log traces without navigating through the source code.
- *
- * Parameters:
- *  wiced_bt_hfp_ag_event_t event: Bluetooth HF AG event type
- *
- * Return:
- *  char *: String for wiced_bt_management_evt_t
- *
- ******************************************************************************/
-static const char *hfag_get_ag_event_name( wiced_bt_hfp_ag_event_t event )
-{
-    switch ( (int)event )
-    {  
-        CASE_RETURN_STR( WICED_BT_HFP_AG_EVENT_OPEN )
-        CASE_RETURN_STR( WICED_BT_HFP_AG_EVENT_CLOSE )
-        CASE_RETURN_STR( WICED_BT_HFP_AG_EVENT_CONNECTED )
-        CASE_RETURN_STR( WICED_BT_HFP_AG_EVENT_AUDIO_OPEN )
-        CASE_RETURN_STR( WICED_BT_HFP_AG_EVENT_AUDIO_CLOSE )
-        CASE_RETURN_STR( WICED_BT_HFP_AG_EVENT_AT_CMD )
-        CASE_RETURN_STR( WICED_BT_HFP_AG_EVENT_CLCC_REQ )
-    }
-
-    return NULL;
-}
-
 /*******************************************************************************
  * Function Name: hfag_print_hfp_context
  *******************************************************************************
@@ -986,77 +1268,103 @@ uint8_t hfag_validate_app_handle( uint16_t handle )
     return valid;
 }
 /*******************************************************************************
- * Function Name: hfag_sco_data_app_callback
+ * Function Name: hfag_sco_map
  *******************************************************************************
  * Summary:
- *   callback function called for incoming pcm data
+ *   Records the service control block of an opened SCO link, so that the
+ *   SCO data callback finds the audio session without a search
  *
  * Parameters:
- *   uint16_t sco_channel : sco channel
- *   uint16_t length : SCO data callback length
- *   uint8_t* p_data : incoming SCO pcm data
+ *   uint16_t sco_idx : sco index of the link
+ *   uint8_t scb      : service control block index, app handle - 1
  *
  * Return:
  *   NONE
  *
  ******************************************************************************/
-static void hfag_sco_data_app_callback(uint16_t sco_channel, uint16_t length, uint8_t* p_data)
+static void hfag_sco_map( uint16_t sco_idx, uint8_t scb )
 {
-#ifdef AUDIO_DEBUG
-    WICED_BT_TRACE("sco_data_app_callback-length =  (%d)\n", length);
-#endif
-    if ( length ) {
-#ifdef DUMP_SCO_TO_FILE
-        /* You can play the audio file generated (audio_mic.raw) using
-         * the following aplay command:
-         * aplay audio_mic.raw -c 1 -f S16_LE -r 8000
-         * Replace 8000 with any frequency with which the alsa
-         * is configured
-         */
-        if ( fp )
+    hfag_sco_unmap( scb );
+    if ( sco_idx < HFAG_MAX_SCO_INDEX )
+    {
+        hfag_sco_scb[sco_idx] = scb;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: hfag_sco_unmap
+ *******************************************************************************
+ * Summary:
+ *   Forgets the SCO link of a service control block
+ *
+ * Parameters:
+ *   uint8_t scb : service control block index, app handle - 1
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void hfag_sco_unmap( uint8_t scb )
+{
+    for ( int i = 0; i < HFAG_MAX_SCO_INDEX; i++ )
+    {
+        if ( hfag_sco_scb[i] == scb )
         {
-            memset(sco_data_copy, 0, SCO_DATA_LEN);
-            memcpy(sco_data_copy, p_data, length);
-            fwrite(sco_data_copy, sizeof(unsigned char), length, fp);
+            hfag_sco_scb[i] = HFAG_NO_SCB;
         }
-#endif
-        alsa_write_pcm_data(p_data, length);
-
-        wiced_result_t result = WICED_ERROR;
+    }
+}
 
-        /* Looping back to sco_idx for which the sco is opened */
-        for ( int i = 0; i < HANDSFREE_AG_NUM_SCB; i++ )
+/*******************************************************************************
+ * Function Name: hfag_sco_lookup
+ *******************************************************************************
+ * Summary:
+ *   Returns the service control block of a SCO link in constant time. A
+ *   link that is not mapped yet, such as data arriving ahead of the audio
+ *   open event, is searched for among the opened links once and cached.
+ *
+ * Parameters:
+ *   uint16_t sco_channel : sco index of the link
+ *
+ * Return:
+ *   uint8_t : service control block index, HFAG_NO_SCB if no link matches
+ *
+ ******************************************************************************/
+uint8_t hfag_sco_lookup( uint16_t sco_channel )
+{
+    if ( ( sco_channel < HFAG_MAX_SCO_INDEX ) && ( hfag_sco_scb[sco_channel] != HFAG_NO_SCB ) )
+    {
+        return hfag_sco_scb[sco_channel];
+    }
+    for ( int i = 0; i < HANDSFREE_AG_NUM_SCB; i++ )
+    {
+        if ( hfag_control_cb.ag_scb[i].b_sco_opened && ( hfag_control_cb.ag_scb[i].sco_idx == sco_channel ) )
         {
-            if ( hfag_control_cb.ag_scb[i].b_sco_opened )
-            {
-                result = wiced_bt_sco_write_buffer( hfag_control_cb.ag_scb[i].sco_idx, p_data, length );
-                if ( WICED_BT_SUCCESS != result )
-                {
-                    WICED_BT_TRACE("wiced_bt_sco_write_buffer error, sco_index = %d, result = %d\n",
-                                                            hfag_control_cb.ag_scb[i].sco_idx, result);
-                }
-                break;
-            }
+            hfag_sco_map( sco_channel, (uint8_t)i );
+            return (uint8_t)i;
         }
     }
+    return HFAG_NO_SCB;
 }
 
-
-void wait_init_done(){
-    //WICED_BT_TRACE("wait_init_done[Waiting...]");
-    //work-around for Hatchet2 autobaud
-    //WICED_BT_TRACE("Please trigger REGON to enable autobaud FW download, and enter any input:()");
-    pthread_mutex_lock(&cond_lock_initial);
-    pthread_cond_wait(&cond_call_initial, &cond_lock_initial);
-    pthread_mutex_unlock(&cond_lock_initial);
-    WICED_BT_TRACE("wait_init_done[Release...]");
+/*******************************************************************************
+ * Function Name: hfag_sco_data_app_callback
+ *******************************************************************************
+ * Summary:
+ *   callback function called for incoming pcm data
+ *
+ * Parameters:
+ *   uint16_t sco_channel : sco channel
+ *   uint16_t length : SCO data callback length
+ *   uint8_t* p_data : incoming SCO pcm data
+ *
+ * Return:
+ *   NONE
+ *
+ ******************************************************************************/
+static void hfag_sco_data_app_callback(uint16_t sco_channel, uint16_t length, uint8_t* p_data)
+{
+    hfag_sco_data_process( sco_channel, length, p_data );
 }
 
-void notify_init_done(){
-    WICED_BT_TRACE("notify_init_done");
-    pthread_mutex_lock(&cond_lock_initial);
-    pthread_cond_signal(&cond_call_initial);
-    pthread_mutex_unlock(&cond_lock_initial);
-
-}
 /* END OF FILE [] */
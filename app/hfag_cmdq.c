@@ -0,0 +1,317 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/*******************************************************************************
+ * File Name: hfag_cmdq.c
+ *
+ * Description: This file contains the control command queue. The Bluetooth
+ * stack and the HFP AG library are not thread safe, and their callbacks run
+ * on the stack thread, so commands of the menu, the control socket or any
+ * other thread are not called directly. They are put in a bounded lock-free
+ * multi-producer single-consumer queue, and one serialized stack thread call
+ * runs everything queued, in order, and reports each result to the command's
+ * completion callback.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ ******************************************************************************/
+#include <string.h>
+
+#include "hfag.h"
+#include "hfag_cmdq.h"
+#include "hfag_reconnect.h"
+#include "wiced_bt_hfp_ag.h"
+#include "wiced_bt_trace.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define CMDQ_LOAD(p)                __atomic_load_n((p), __ATOMIC_RELAXED)
+#define CMDQ_LOAD_ACQUIRE(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define CMDQ_STORE(p, v)            __atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+#define CMDQ_STORE_RELEASE(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define CMDQ_EXCHANGE(p, v)         __atomic_exchange_n((p), (v), __ATOMIC_SEQ_CST)
+#define CMDQ_CLAIM(p, pv, v)        __atomic_compare_exchange_n((p), (pv), (v), WICED_TRUE, \
+                                                                __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+/* A slot is free for the producer of position seq, and holds the command of
+ * position seq - 1 once that producer has published it */
+typedef struct
+{
+    uint32_t seq;
+    hfag_cmd_t cmd;
+} hfag_cmdq_slot_t;
+
+/*******************************************************************************
+ *       FUNCTION DECLARATION
+ ******************************************************************************/
+static wiced_bool_t hfag_cmdq_drain(void *p_data);
+static wiced_result_t hfag_cmdq_execute(const hfag_cmd_t *p_cmd);
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+/* Bluetooth stack porting layer, runs p_func on the stack thread */
+extern wiced_result_t wiced_app_event_serialize(wiced_bool_t (*p_func)(void *), void *p_data);
+
+static hfag_cmdq_slot_t cmdq_slots[HFAG_CMDQ_DEPTH];
+static uint32_t cmdq_head = 0;          /* next position claimed by a producer */
+static uint32_t cmdq_tail = 0;          /* stack thread only */
+static uint32_t cmdq_scheduled = 0;     /* a drain is serialized and has not started */
+
+static const char *const cmdq_names[] =
+{
+    "hfag_handle_set_visibility",
+    "hfag_handle_set_pairability",
+    "hfag_inquiry",
+    "wiced_bt_hfp_ag_connect",
+    "wiced_bt_hfp_ag_disconnect",
+    "wiced_bt_hfp_ag_audio_open",
+    "wiced_bt_hfp_ag_audio_close",
+    "wiced_bt_hfp_ag_send_cmd_str",
+    "hfag_reconnect_page",
+};
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: hfag_cmdq_init
+ *******************************************************************************
+ * Summary:
+ *   Empties the command queue, before the Bluetooth stack is started
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_cmdq_init(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < HFAG_CMDQ_DEPTH; i++)
+    {
+        cmdq_slots[i].seq = i;
+    }
+    cmdq_head = 0;
+    cmdq_tail = 0;
+    cmdq_scheduled = 0;
+}
+
+/*******************************************************************************
+ * Function Name: hfag_cmdq_submit
+ *******************************************************************************
+ * Summary:
+ *   Queues a copy of a command for the Bluetooth stack thread. Safe to call
+ *   from any thread, including the stack thread, where the command runs
+ *   after the current callback returns.
+ *
+ * Parameters:
+ *   const hfag_cmd_t *p_cmd : command and its completion callback
+ *
+ * Return:
+ *   wiced_result_t : WICED_BT_SUCCESS if queued, p_done is called later,
+ *                    WICED_BT_BUSY if the queue is full
+ *
+ ******************************************************************************/
+wiced_result_t hfag_cmdq_submit(const hfag_cmd_t *p_cmd)
+{
+    hfag_cmdq_slot_t *p_slot;
+    uint32_t pos = CMDQ_LOAD(&cmdq_head);
+    int32_t diff;
+
+    for ( ; ; )
+    {
+        p_slot = &cmdq_slots[pos % HFAG_CMDQ_DEPTH];
+        diff = (int32_t)(CMDQ_LOAD_ACQUIRE(&p_slot->seq) - pos);
+        if (diff == 0)
+        {
+            if (CMDQ_CLAIM(&cmdq_head, &pos, pos + 1))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            return WICED_BT_BUSY;
+        }
+        else
+        {
+            pos = CMDQ_LOAD(&cmdq_head);
+        }
+    }
+    memcpy(&p_slot->cmd, p_cmd, sizeof(p_slot->cmd));
+    CMDQ_STORE_RELEASE(&p_slot->seq, pos + 1);
+
+    /* One drain runs everything published before it clears the flag */
+    if (CMDQ_EXCHANGE(&cmdq_scheduled, 1U) == 0)
+    {
+        if (wiced_app_event_serialize(hfag_cmdq_drain, NULL) != WICED_SUCCESS)
+        {
+            /* the command stays queued and runs with the next one */
+            WICED_BT_TRACE("command queue: serialization failed\n");
+            CMDQ_STORE(&cmdq_scheduled, 0U);
+        }
+    }
+    return WICED_BT_SUCCESS;
+}
+
+/*******************************************************************************
+ * Function Name: hfag_cmdq_name
+ *******************************************************************************
+ * Summary:
+ *   Returns the name of the API function a command calls, for error messages
+ *
+ * Parameters:
+ *   hfag_cmd_type_t type : command type
+ *
+ * Return:
+ *   const char * : function name
+ *
+ ******************************************************************************/
+const char *hfag_cmdq_name(hfag_cmd_type_t type)
+{
+    if ((uint32_t)type >= sizeof(cmdq_names) / sizeof(cmdq_names[0]))
+    {
+        return "unknown command";
+    }
+    return cmdq_names[type];
+}
+
+/*******************************************************************************
+ * Function Name: hfag_cmdq_drain
+ *******************************************************************************
+ * Summary:
+ *   Runs the queued commands on the Bluetooth stack thread. Stops at a slot
+ *   that is claimed but not yet published, its producer schedules another
+ *   drain.
+ *
+ ******************************************************************************/
+static wiced_bool_t hfag_cmdq_drain(void *p_data)
+{
+    hfag_cmdq_slot_t *p_slot;
+    hfag_cmd_t cmd;
+    wiced_result_t result;
+
+    CMDQ_STORE(&cmdq_scheduled, 0U);
+    for ( ; ; )
+    {
+        p_slot = &cmdq_slots[cmdq_tail % HFAG_CMDQ_DEPTH];
+        if (CMDQ_LOAD_ACQUIRE(&p_slot->seq) != cmdq_tail + 1)
+        {
+            break;
+        }
+        memcpy(&cmd, &p_slot->cmd, sizeof(cmd));
+        CMDQ_STORE_RELEASE(&p_slot->seq, cmdq_tail + HFAG_CMDQ_DEPTH);
+        cmdq_tail++;
+
+        result = hfag_cmdq_execute(&cmd);
+        if (cmd.p_done != NULL)
+        {
+            cmd.p_done(&cmd, result);
+        }
+    }
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: hfag_cmdq_execute
+ *******************************************************************************
+ * Summary:
+ *   Calls the stack for one command. Handles are checked here, where the
+ *   connections cannot change underneath.
+ *
+ ******************************************************************************/
+static wiced_result_t hfag_cmdq_execute(const hfag_cmd_t *p_cmd)
+{
+    wiced_result_t result = WICED_BT_SUCCESS;
+
+    switch (p_cmd->type)
+    {
+    case HFAG_CMD_SET_VISIBILITY:
+        return hfag_handle_set_visibility(p_cmd->arg[0], p_cmd->arg[1]);
+
+    case HFAG_CMD_SET_PAIRABILITY:
+        return hfag_handle_set_pairability(p_cmd->arg[0]);
+
+    case HFAG_CMD_INQUIRY:
+        result = hfag_inquiry(p_cmd->arg[0]);
+        return (result == WICED_BT_PENDING) ? WICED_BT_SUCCESS : result;
+
+    case HFAG_CMD_CONNECT:
+        wiced_bt_hfp_ag_connect((uint8_t *)p_cmd->bd_addr);
+        return WICED_BT_SUCCESS;
+
+    case HFAG_CMD_RECONNECT:
+        hfag_reconnect_page();
+        return WICED_BT_SUCCESS;
+
+    default:
+        break;
+    }
+
+    if (!hfag_validate_app_handle(p_cmd->handle))
+    {
+        return WICED_BT_BADARG;
+    }
+    switch (p_cmd->type)
+    {
+    case HFAG_CMD_DISCONNECT:
+        hfag_reconnect_disconnect(p_cmd->handle);
+        wiced_bt_hfp_ag_disconnect(p_cmd->handle);
+        break;
+    case HFAG_CMD_AUDIO_OPEN:
+        wiced_bt_hfp_ag_audio_open(p_cmd->handle);
+        break;
+    case HFAG_CMD_AUDIO_CLOSE:
+        wiced_bt_hfp_ag_audio_close(p_cmd->handle);
+        break;
+    case HFAG_CMD_SEND_STR:
+        wiced_bt_hfp_ag_send_cmd_str(p_cmd->handle, (uint8_t *)p_cmd->str, p_cmd->len);
+        break;
+    default:
+        result = WICED_BT_BADARG;
+        break;
+    }
+    return result;
+}
@@ -0,0 +1,107 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: hfag_config.c
+ *
+ * Description: This file contains the runtime settings accessors for the
+ * handsfree AG.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+*      INCLUDES
+*******************************************************************************/
+#include <stdlib.h>
+#include <errno.h>
+#include "hfag_config.h"
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: hfag_config_get_str
+ *******************************************************************************
+ * Summary:
+ *   Returns the value of a string setting
+ *
+ * Parameters:
+ *   const char *p_name     : setting name
+ *   const char *p_default  : value returned if the setting is not set
+ *
+ * Return:
+ *   const char * : setting value
+ *
+ ******************************************************************************/
+const char *hfag_config_get_str( const char *p_name, const char *p_default )
+{
+    const char *p_value = getenv( p_name );
+
+    return ( ( p_value != NULL ) && ( p_value[0] != '\0' ) ) ? p_value : p_default;
+}
+
+/*******************************************************************************
+ * Function Name: hfag_config_get_int
+ *******************************************************************************
+ * Summary:
+ *   Returns the value of an integer setting. Decimal, hexadecimal (0x) and
+ *   octal (0) notations are accepted.
+ *
+ * Parameters:
+ *   const char *p_name  : setting name
+ *   int default_value   : value returned if the setting is not set or invalid
+ *
+ * Return:
+ *   int : setting value
+ *
+ ******************************************************************************/
+int hfag_config_get_int( const char *p_name, int default_value )
+{
+    const char *p_value = hfag_config_get_str( p_name, NULL );
+    char *p_end;
+    long value;
+
+    if ( p_value == NULL )
+    {
+        return default_value;
+    }
+    errno = 0;
+    value = strtol( p_value, &p_end, 0 );
+    if ( ( errno != 0 ) || ( *p_end != '\0' ) )
+    {
+        return default_value;
+    }
+    return ( int )value;
+}
@@ -0,0 +1,1465 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: hfag_console.c
+ *
+ * Description: This file contains the console of the Handsfree Audio
+ * Gateway. A single epoll loop serves the numbered menu on stdin and the
+ * Unix-domain control socket (HFAG_CONTROL_SOCKET), and forwards the
+ * connection and audio events of the Bluetooth stack thread to the control
+ * clients. Menu options prompt for their arguments line by line, so no
+ * input ever blocks the loop. Commands that call the stack go through the
+ * command queue (hfag_cmdq.c) and are answered when the stack thread has run
+ * them; a client's next request is read after that answer.
+ *
+ * Control protocol, one line per message:
+ *   request  : <command> [arguments]
+ *   response : zero or more "= <data>" lines, then "OK" or "ERR <reason>"
+ *   event    : "! <event> <handle> [details]", may precede the response of
+ *              a pending request
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ ******************************************************************************/
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "audio_platform_common.h"
+#include "hfag.h"
+#include "hfag_cmdq.h"
+#include "hfag_config.h"
+#include "hfag_console.h"
+#include "hfag_reconnect.h"
+#include "wiced_bt_hfp_ag.h"
+#include "wiced_bt_trace.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define HFAG_CONSOLE_OUT_LEN            (8192U) /* unsent bytes kept per client */
+#define HFAG_CONSOLE_EVENT_QUEUE        (32U)   /* events waiting for the loop */
+#define HFAG_CONSOLE_POST_SLOTS         (64U)   /* events and replies, a power of two */
+#define HFAG_CONSOLE_MAX_EVENTS         (8U)    /* epoll events per wake-up */
+#define HFAG_CONSOLE_MAX_ARGS           (2U)
+#define HFAG_CONSOLE_BDA_LEN            (6U)
+
+/* epoll tags, clients follow HFAG_CONSOLE_TAG_CLIENT */
+#define HFAG_CONSOLE_TAG_STDIN          (0U)
+#define HFAG_CONSOLE_TAG_EVENT          (1U)
+#define HFAG_CONSOLE_TAG_LISTEN         (2U)
+#define HFAG_CONSOLE_TAG_CLIENT         (16U)
+
+/* Targets of the stack thread posts */
+#define HFAG_CONSOLE_TARGET_ALL         (0xFFU)
+#define HFAG_CONSOLE_TARGET_MENU        (HFAG_CONSOLE_MAX_CLIENTS)
+
+#ifndef MIN
+#define MIN(a, b)                       (((a) < (b)) ? (a) : (b))
+#endif
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+typedef struct
+{
+    int fd;
+    char in[HFAG_CONSOLE_LINE_LEN];
+    uint32_t in_len;
+    wiced_bool_t discarding;            /* skipping the rest of an overlong line */
+    char out[HFAG_CONSOLE_OUT_LEN];
+    uint32_t out_len;
+    uint32_t generation;                /* tells queued replies of earlier clients apart */
+    wiced_bool_t pending;               /* waiting for a queued command, input paused */
+} hfag_console_client_t;
+
+/* Where the response of a command goes, the menu if p_client is NULL */
+typedef struct
+{
+    hfag_console_client_t *p_client;
+    wiced_bool_t failed;
+    wiced_bool_t deferred;              /* completed by the command queue */
+} hfag_console_reply_t;
+
+/* An event for every client, or the completion of a queued command */
+typedef struct
+{
+    char line[HFAG_CONSOLE_LINE_LEN];
+    uint8_t target;
+    uint32_t generation;
+} hfag_console_post_t;
+
+typedef void (hfag_console_handler_t)(hfag_console_reply_t *p_reply, char *argv[]);
+
+/* A control command and its menu option. The last argument takes the rest
+ * of the line, the menu asks for each argument with its prompt */
+typedef struct
+{
+    const char *p_name;
+    uint32_t args;
+    const char *p_usage;
+    hfag_console_handler_t *p_handler;
+    wiced_bool_t show_context;          /* menu prints the connections first */
+    const char *p_prompts[HFAG_CONSOLE_MAX_ARGS];
+} hfag_console_command_t;
+
+/*******************************************************************************
+ *       FUNCTION DECLARATION
+ ******************************************************************************/
+static hfag_console_handler_t hfag_console_cmd_exit;
+static hfag_console_handler_t hfag_console_cmd_help;
+static hfag_console_handler_t hfag_console_cmd_visibility;
+static hfag_console_handler_t hfag_console_cmd_pairing;
+static hfag_console_handler_t hfag_console_cmd_inquiry;
+static hfag_console_handler_t hfag_console_cmd_connect;
+static hfag_console_handler_t hfag_console_cmd_disconnect;
+static hfag_console_handler_t hfag_console_cmd_audio_open;
+static hfag_console_handler_t hfag_console_cmd_audio_close;
+static hfag_console_handler_t hfag_console_cmd_status;
+static hfag_console_handler_t hfag_console_cmd_send;
+static hfag_console_handler_t hfag_console_cmd_latency;
+static hfag_console_handler_t hfag_console_cmd_gain;
+static hfag_console_handler_t hfag_console_cmd_reconnect;
+static void hfag_console_reply_data(hfag_console_reply_t *p_reply, const char *p_format, ...);
+static void hfag_console_reply_error(hfag_console_reply_t *p_reply, const char *p_format, ...);
+static wiced_bool_t hfag_console_parse_uint(const char *p_arg, int base, uint32_t max, uint32_t *p_value);
+static wiced_bool_t hfag_console_parse_handle(hfag_console_reply_t *p_reply, const char *p_arg, uint16_t *p_handle);
+static void hfag_console_submit(hfag_console_reply_t *p_reply, hfag_cmd_t *p_cmd);
+static hfag_cmd_done_t hfag_console_cmd_done;
+static void hfag_console_post(const char *p_line, uint8_t target, uint32_t generation);
+static void hfag_console_execute(hfag_console_reply_t *p_reply, char *p_line);
+static void hfag_console_stdin_line(char *p_line);
+static void hfag_console_stdin_read(void);
+static wiced_bool_t hfag_console_listen(const char *p_path);
+static void hfag_console_accept(void);
+static void hfag_console_client_close(hfag_console_client_t *p_client);
+static void hfag_console_client_flush(hfag_console_client_t *p_client);
+static void hfag_console_client_send(hfag_console_client_t *p_client, const char *p_data, uint32_t len);
+static void hfag_console_client_read(hfag_console_client_t *p_client);
+static void hfag_console_client_process(hfag_console_client_t *p_client);
+static void hfag_console_posts_flush(void);
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+extern hfag_control_cb_t hfag_control_cb;
+
+static const char console_menu[] = "\n\
+---------------------HFAG MENU-----------------------\n\n\
+    0.  Exit \n\
+    1.  Print Menu \n\
+    2.  Set Visibility \n\
+    3.  Set Pairing Mode\n\
+    4.  Set Inquiry \n\
+    5.  HFAG Connect \n\
+    6.  HFAG Disconnect \n\
+    7.  Audio Connect \n\
+    8.  Audio Disconnect \n\
+    9.  Print HFAG Connection Details\n\
+    10. Send AG cmd str\n\
+    11. Print Audio Latency\n\
+    12. Set Conference Gain\n\
+    13. Print Reconnect Status\n\
+Choose option -> ";
+
+#define HANDLE_PROMPT   "Enter the Application Handle as displayed in HFAG CONNECTION DETAILS: "
+
+/* Indexed by menu option */
+static const hfag_console_command_t console_commands[] =
+{
+    { "exit",        0, "",                                      hfag_console_cmd_exit,        WICED_FALSE, { NULL } },
+    { "help",        0, "",                                      hfag_console_cmd_help,        WICED_FALSE, { NULL } },
+    { "visibility",  2, "<discoverable 0|1> <connectable 0|1>",  hfag_console_cmd_visibility,  WICED_FALSE,
+        { "Enter discoverability: 0:Non Discoverable, 1: Discoverable\n",
+          "\nEnter connectability: 0:Non Connectable, 1: Connectable\n" } },
+    { "pairing",     1, "<allowed 0|1>",                         hfag_console_cmd_pairing,     WICED_FALSE,
+        { "Enter if pairing is allowed: 0: Not allowed, 1: Allowed\n" } },
+    { "inquiry",     1, "<enable 0|1>",                          hfag_console_cmd_inquiry,     WICED_FALSE,
+        { "Enter if Inquiry has to be enabled/disabled: 0: Disabled, 1: Enabled\n" } },
+    { "connect",     1, "<bd address, e.g. 11:22:33:44:55:66>",  hfag_console_cmd_connect,     WICED_FALSE,
+        { "Enter Peer BD Address as displayed in Inquiry Results \n(Example: 11 22 33 44 55 66): \n" } },
+    { "disconnect",  1, "<handle>",                              hfag_console_cmd_disconnect,  WICED_TRUE,
+        { "Enter the Application Handle to disconnect as displayed in HFAG CONNECTION DETAILS: " } },
+    { "audio_open",  1, "<handle>",                              hfag_console_cmd_audio_open,  WICED_TRUE,  { HANDLE_PROMPT } },
+    { "audio_close", 1, "<handle>",                              hfag_console_cmd_audio_close, WICED_TRUE,  { HANDLE_PROMPT } },
+    { "status",      0, "",                                      hfag_console_cmd_status,      WICED_FALSE, { NULL } },
+    { "send",        2, "<handle> <AG command string>",          hfag_console_cmd_send,        WICED_TRUE,
+        { HANDLE_PROMPT, "Enter the AG cmd str: " } },
+    { "latency",     0, "",                                      hfag_console_cmd_latency,     WICED_FALSE, { NULL } },
+    { "gain",        2, "<handle> <percent>",                    hfag_console_cmd_gain,        WICED_TRUE,
+        { HANDLE_PROMPT, "Enter the gain in percent (0 - %u, 100 for unity): " } },
+    { "reconnect",   0, "",                                      hfag_console_cmd_reconnect,   WICED_FALSE, { NULL } },
+};
+
+static int console_epoll_fd = -1;
+static int console_event_fd = -1;
+static int console_listen_fd = -1;
+static char console_socket_path[sizeof(((struct sockaddr_un *)NULL)->sun_path)];
+static hfag_console_client_t console_clients[HFAG_CONSOLE_MAX_CLIENTS];
+static wiced_bool_t console_running = WICED_FALSE;
+
+/* Menu on stdin */
+static char console_stdin_buf[HFAG_CONSOLE_LINE_LEN];
+static uint32_t console_stdin_len = 0;
+static const hfag_console_command_t *p_console_prompting = NULL; /* option waiting for arguments */
+static uint32_t console_prompt = 0;
+static char console_menu_line[HFAG_CONSOLE_LINE_LEN];
+
+/* Events and command completions of the Bluetooth stack thread, guarded by
+ * console_event_lock. Events use at most HFAG_CONSOLE_EVENT_QUEUE slots, so
+ * the one reply a client can wait for always fits. */
+static pthread_mutex_t console_event_lock = PTHREAD_MUTEX_INITIALIZER;
+static hfag_console_post_t console_posts[HFAG_CONSOLE_POST_SLOTS];
+static uint32_t console_event_head = 0;
+static uint32_t console_event_tail = 0;
+static uint32_t console_event_drops = 0;
+static wiced_bool_t console_connected[HANDSFREE_AG_NUM_SCB];
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: hfag_console_run
+ *******************************************************************************
+ * Summary:
+ *   Runs the main loop until the exit command: prints the menu, opens the
+ *   control socket if HFAG_CONTROL_SOCKET is set and serves both from one
+ *   epoll set
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   int : exit status of the application
+ *
+ ******************************************************************************/
+int hfag_console_run(void)
+{
+    struct epoll_event ev;
+    struct epoll_event events[HFAG_CONSOLE_MAX_EVENTS];
+    const char *p_path = hfag_config_get_str(HFAG_CONFIG_CONTROL_SOCKET, NULL);
+    uint32_t tag;
+    uint32_t i;
+    int n;
+
+    for (i = 0; i < HFAG_CONSOLE_MAX_CLIENTS; i++)
+    {
+        console_clients[i].fd = -1;
+    }
+    console_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    console_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if ((console_epoll_fd < 0) || (console_event_fd < 0))
+    {
+        printf("console setup failed: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    ev.events = EPOLLIN;
+    ev.data.u64 = HFAG_CONSOLE_TAG_EVENT;
+    epoll_ctl(console_epoll_fd, EPOLL_CTL_ADD, console_event_fd, &ev);
+    ev.data.u64 = HFAG_CONSOLE_TAG_STDIN;
+    if (epoll_ctl(console_epoll_fd, EPOLL_CTL_ADD, STDIN_FILENO, &ev) != 0)
+    {
+        printf("stdin cannot be polled (%s), menu disabled\n", strerror(errno));
+    }
+    if ((p_path != NULL) && !hfag_console_listen(p_path))
+    {
+        return EXIT_FAILURE;
+    }
+
+    printf("%s", console_menu);
+    fflush(stdout);
+    console_running = WICED_TRUE;
+    while (console_running)
+    {
+        n = epoll_wait(console_epoll_fd, events, HFAG_CONSOLE_MAX_EVENTS, -1);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            printf("epoll_wait failed: %s\n", strerror(errno));
+            break;
+        }
+        for (i = 0; (i < (uint32_t)n) && console_running; i++)
+        {
+            tag = (uint32_t)events[i].data.u64;
+            if (tag == HFAG_CONSOLE_TAG_STDIN)
+            {
+                hfag_console_stdin_read();
+            }
+            else if (tag == HFAG_CONSOLE_TAG_EVENT)
+            {
+                hfag_console_posts_flush();
+            }
+            else if (tag == HFAG_CONSOLE_TAG_LISTEN)
+            {
+                hfag_console_accept();
+            }
+            else if (console_clients[tag - HFAG_CONSOLE_TAG_CLIENT].fd >= 0)
+            {
+                if (events[i].events & EPOLLOUT)
+                {
+                    hfag_console_client_flush(&console_clients[tag - HFAG_CONSOLE_TAG_CLIENT]);
+                }
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                {
+                    hfag_console_client_read(&console_clients[tag - HFAG_CONSOLE_TAG_CLIENT]);
+                }
+            }
+        }
+        fflush(stdout);
+    }
+
+    for (i = 0; i < HFAG_CONSOLE_MAX_CLIENTS; i++)
+    {
+        if (console_clients[i].fd >= 0)
+        {
+            hfag_console_client_close(&console_clients[i]);
+        }
+    }
+    if (console_listen_fd >= 0)
+    {
+        close(console_listen_fd);
+        unlink(console_socket_path);
+    }
+    close(console_event_fd);
+    close(console_epoll_fd);
+    console_event_fd = -1;
+    return EXIT_SUCCESS;
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_event
+ *******************************************************************************
+ * Summary:
+ *   Notifies the control clients of a connection or audio event. Called from
+ *   the Bluetooth stack thread, the event is queued for the main loop.
+ *
+ * Parameters:
+ *   hfag_console_event_t event : event
+ *   uint16_t handle            : HFP application handle
+ *   int status                 : status of HFAG_CONSOLE_EVENT_OPEN, 0 on success
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_console_event(hfag_console_event_t event, uint16_t handle, int status)
+{
+    const wiced_bt_hfp_ag_session_cb_t *p_scb;
+    char line[HFAG_CONSOLE_LINE_LEN];
+
+    if ((handle == 0) || (handle > HANDSFREE_AG_NUM_SCB))
+    {
+        return;
+    }
+    p_scb = &hfag_control_cb.ag_scb[handle - 1];
+    switch (event)
+    {
+    case HFAG_CONSOLE_EVENT_OPEN:
+        snprintf(line, sizeof(line), "! open %X %d\n", handle, status);
+        break;
+    case HFAG_CONSOLE_EVENT_CONNECTED:
+        snprintf(line, sizeof(line), "! connected %X %02X:%02X:%02X:%02X:%02X:%02X\n", handle,
+                 p_scb->hf_addr[0], p_scb->hf_addr[1], p_scb->hf_addr[2],
+                 p_scb->hf_addr[3], p_scb->hf_addr[4], p_scb->hf_addr[5]);
+        break;
+    case HFAG_CONSOLE_EVENT_DISCONNECTED:
+        snprintf(line, sizeof(line), "! disconnected %X\n", handle);
+        break;
+    case HFAG_CONSOLE_EVENT_AUDIO_OPEN:
+#if ( BTM_WBS_INCLUDED == WICED_TRUE )
+        snprintf(line, sizeof(line), "! audio_open %X %s\n", handle, p_scb->msbc_selected ? "msbc" : "cvsd");
+#else
+        snprintf(line, sizeof(line), "! audio_open %X cvsd\n", handle);
+#endif
+        break;
+    default:
+        snprintf(line, sizeof(line), "! audio_close %X\n", handle);
+        break;
+    }
+
+    pthread_mutex_lock(&console_event_lock);
+    if (event == HFAG_CONSOLE_EVENT_CONNECTED)
+    {
+        console_connected[handle - 1] = WICED_TRUE;
+    }
+    else if (event == HFAG_CONSOLE_EVENT_DISCONNECTED)
+    {
+        console_connected[handle - 1] = WICED_FALSE;
+    }
+    pthread_mutex_unlock(&console_event_lock);
+    hfag_console_post(line, HFAG_CONSOLE_TARGET_ALL, 0);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_cmd_exit
+ *******************************************************************************
+ * Summary:
+ *   Leaves the main loop
+ *
+ ******************************************************************************/
+static void hfag_console_cmd_exit(hfag_console_reply_t *p_reply, char *argv[])
+{
+    console_running = WICED_FALSE;
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_cmd_help
+ *******************************************************************************
+ * Summary:
+ *   Prints the menu, or lists the commands to a control client
+ *
+ ******************************************************************************/
+static void hfag_console_cmd_help(hfag_console_reply_t *p_reply, char *argv[])
+{
+    uint32_t i;
+
+    if (p_reply->p_client == NULL)
+    {
+        printf("%s\n", console_menu);
+        return;
+    }
+    for (i = 0; i < sizeof(console_commands) / sizeof(console_commands[0]); i++)
+    {
+        hfag_console_reply_data(p_reply, "%s%s%s", console_commands[i].p_name,
+                                (console_commands[i].p_usage[0] != '\0') ? " " : "", console_commands[i].p_usage);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_cmd_visibility
+ *******************************************************************************
+ * Summary:
+ *   Sets the discoverability and connectability
+ *
+ ******************************************************************************/
+static void hfag_console_cmd_visibility(hfag_console_reply_t *p_reply, char *argv[])
+{
+    hfag_cmd_t cmd = { HFAG_CMD_SET_VISIBILITY };
+    uint32_t discoverable;
+    uint32_t connectable;
+
+    if (!hfag_console_parse_uint(argv[0], 10, 1, &discoverable) ||
+        !hfag_console_parse_uint(argv[1], 10, 1, &connectable))
+    {
+        hfag_console_reply_error(p_reply, "invalid argument");
+        return;
+    }
+    cmd.arg[0] = (uint8_t)discoverable;
+    cmd.arg[1] = (uint8_t)connectable;
+    hfag_console_submit(p_reply, &cmd);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_cmd_pairing
+ *******************************************************************************
+ * Summary:
+ *   Allows or disallows pairing
+ *
+ ******************************************************************************/
+static void hfag_console_cmd_pairing(hfag_console_reply_t *p_reply, char *argv[])
+{
+    hfag_cmd_t cmd = { HFAG_CMD_SET_PAIRABILITY };
+    uint32_t allowed;
+
+    if (!hfag_console_parse_uint(argv[0], 10, 1, &allowed))
+    {
+        hfag_console_reply_error(p_reply, "invalid argument");
+        return;
+    }
+    cmd.arg[0] = (uint8_t)allowed;
+    hfag_console_submit(p_reply, &cmd);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_cmd_inquiry
+ *******************************************************************************
+ * Summary:
+ *   Starts or cancels the inquiry, results are printed by the application
+ *
+ ******************************************************************************/
+static void hfag_console_cmd_inquiry(hfag_console_reply_t *p_reply, char *argv[])
+{
+    hfag_cmd_t cmd = { HFAG_CMD_INQUIRY };
+    uint32_t enable;
+
+    if (!hfag_console_parse_uint(argv[0], 10, 1, &enable))
+    {
+        hfag_console_reply_error(p_reply, "invalid argument");
+        return;
+    }
+    cmd.arg[0] = (uint8_t)enable;
+    hfag_console_submit(p_reply, &cmd);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_cmd_connect
+ *******************************************************************************
+ * Summary:
+ *   Connects to a Handsfree Unit, the address bytes may be separated by
+ *   spaces, colons or dashes. Completion is reported by the open and
+ *   connected events.
+ *
+ ******************************************************************************/
+static void hfag_console_cmd_connect(hfag_console_reply_t *p_reply, char *argv[])
+{
+    hfag_cmd_t cmd = { HFAG_CMD_CONNECT };
+    char *p = argv[0];
+    char *p_end;
+    unsigned long byte;
+    uint32_t i;
+
+    for (i = 0; i < HFAG_CONSOLE_BDA_LEN; i++)
+    {
+        while ((*p == ' ') || (*p == ':') || (*p == '-'))
+        {
+            p++;
+        }
+        byte = strtoul(p, &p_end, 16);
+        if ((p_end == p) || (byte > 0xFF))
+        {
+            hfag_console_reply_error(p_reply, "invalid BD address");
+            return;
+        }
+        cmd.bd_addr[i] = (uint8_t)byte;
+        p = p_end;
+    }
+    hfag_console_submit(p_reply, &cmd);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_cmd_disconnect
+ *******************************************************************************
+ * Summary:
+ *   Disconnects a Handsfree Unit
+ *
+ ******************************************************************************/
+static void hfag_console_cmd_disconnect(hfag_console_reply_t *p_reply, char *argv[])
+{
+    hfag_cmd_t cmd = { HFAG_CMD_DISCONNECT };
+
+    if (hfag_console_parse_handle(p_reply, argv[0], &cmd.handle))
+    {
+        hfag_console_submit(p_reply, &cmd);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_cmd_audio_open
+ *******************************************************************************
+ * Summary:
+ *   Opens the SCO link of a Handsfree Unit
+ *
+ ******************************************************************************/
+static void hfag_console_cmd_audio_open(hfag_console_reply_t *p_reply, char *argv[])
+{
+    hfag_cmd_t cmd = { HFAG_CMD_AUDIO_OPEN };
+
+    if (hfag_console_parse_handle(p_reply, argv[0], &cmd.handle))
+    {
+        hfag_console_submit(p_reply, &cmd);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_cmd_audio_close
+ *******************************************************************************
+ * Summary:
+ *   Closes the SCO link of a Handsfree Unit
+ *
+ ******************************************************************************/
+static void hfag_console_cmd_audio_close(hfag_console_reply_t *p_reply, char *argv[])
+{
+    hfag_cmd_t cmd = { HFAG_CMD_AUDIO_CLOSE };
+
+    if (hfag_console_parse_handle(p_reply, argv[0], &cmd.handle))
+    {
+        hfag_console_submit(p_reply, &cmd);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_cmd_status
+ *******************************************************************************
+ * Summary:
+ *   Prints the connection details, or returns one line per service control
+ *   block to a control client
+ *
+ ******************************************************************************/
+static void hfag_console_cmd_status(hfag_console_reply_t *p_reply, char *argv[])
+{
+    const wiced_bt_hfp_ag_session_cb_t *p_scb;
+    wiced_bool_t connected;
+    uint32_t i;
+
+    if (p_reply->p_client == NULL)
+    {
+        hfag_print_hfp_context();
+        return;
+    }
+    for (i = 0; i < HANDSFREE_AG_NUM_SCB; i++)
+    {
+        p_scb = &hfag_control_cb.ag_scb[i];
+        pthread_mutex_lock(&console_event_lock);
+        connected = console_connected[i];
+        pthread_mutex_unlock(&console_event_lock);
+        hfag_console_reply_data(p_reply, "handle %X addr %02X:%02X:%02X:%02X:%02X:%02X connected %u audio %u sco %X",
+                                p_scb->app_handle,
+                                p_scb->hf_addr[0], p_scb->hf_addr[1], p_scb->hf_addr[2],
+                                p_scb->hf_addr[3], p_scb->hf_addr[4], p_scb->hf_addr[5],
+                                connected ? 1U : 0U, p_scb->b_sco_opened ? 1U : 0U, p_scb->sco_idx);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_cmd_send
+ *******************************************************************************
+ * Summary:
+ *   Sends an AG command string to a Handsfree Unit
+ *
+ ******************************************************************************/
+static void hfag_console_cmd_send(hfag_console_reply_t *p_reply, char *argv[])
+{
+    hfag_cmd_t cmd = { HFAG_CMD_SEND_STR };
+    size_t len = strlen(argv[1]);
+
+    if (!hfag_console_parse_handle(p_reply, argv[0], &cmd.handle))
+    {
+        return;
+    }
+    if (len > HFAG_CMDQ_STR_LEN)
+    {
+        hfag_console_reply_error(p_reply, "command string too long");
+        return;
+    }
+    memcpy(cmd.str, argv[1], len);
+    cmd.len = (uint8_t)len;
+    hfag_console_submit(p_reply, &cmd);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_cmd_latency
+ *******************************************************************************
+ * Summary:
+ *   Prints the audio latency of every session, or returns one line per
+ *   session and stage to a control client
+ *
+ ******************************************************************************/
+static void hfag_console_cmd_latency(hfag_console_reply_t *p_reply, char *argv[])
+{
+    audio_latency_t latency;
+    const latency_summary_t *p_summary;
+    uint32_t i, stage;
+
+    for (i = 0; i < HANDSFREE_AG_NUM_SCB; i++)
+    {
+        if (p_reply->p_client == NULL)
+        {
+            audio_print_latency((uint8_t)i);
+            continue;
+        }
+        if (!audio_get_latency((uint8_t)i, &latency))
+        {
+            continue;
+        }
+        for (stage = 0; stage < AUDIO_LATENCY_STAGES; stage++)
+        {
+            p_summary = &latency.stages[stage];
+            hfag_console_reply_data(p_reply, "handle %X stage %u samples %u p50 %u p99 %u max %u mean %u name %s",
+                                    i + 1, stage, p_summary->samples, p_summary->p50_us, p_summary->p99_us,
+                                    p_summary->max_us, p_summary->mean_us,
+                                    audio_latency_stage_name((audio_latency_stage_t)stage));
+        }
+        hfag_console_reply_data(p_reply, "handle %X untracked %u", i + 1, latency.untracked);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_cmd_gain
+ *******************************************************************************
+ * Summary:
+ *   Sets the conference mix gain of a Handsfree Unit
+ *
+ ******************************************************************************/
+static void hfag_console_cmd_gain(hfag_console_reply_t *p_reply, char *argv[])
+{
+    uint16_t handle;
+    uint32_t gain;
+
+    if (!hfag_console_parse_handle(p_reply, argv[0], &handle))
+    {
+        return;
+    }
+    if (!hfag_console_parse_uint(argv[1], 10, AUDIO_MIX_GAIN_MAX, &gain))
+    {
+        hfag_console_reply_error(p_reply, "Invalid gain");
+        return;
+    }
+    audio_set_mix_gain((uint8_t)(handle - 1), (uint16_t)gain);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_cmd_reconnect
+ *******************************************************************************
+ * Summary:
+ *   Prints the bonded peers and the time to reconnect, or returns one line
+ *   per peer and a summary line to a control client
+ *
+ ******************************************************************************/
+static void hfag_console_cmd_reconnect(hfag_console_reply_t *p_reply, char *argv[])
+{
+    hfag_reconnect_status_t status;
+    const hfag_reconnect_peer_info_t *p_info;
+    const latency_summary_t *p_summary = &status.time_to_reconnect;
+    uint32_t i;
+
+    if (p_reply->p_client == NULL)
+    {
+        hfag_reconnect_print();
+        return;
+    }
+    hfag_reconnect_get(&status);
+    for (i = 0; i < status.peers; i++)
+    {
+        p_info = &status.peer[i];
+        hfag_console_reply_data(p_reply, "mru %u addr %02X:%02X:%02X:%02X:%02X:%02X state %s attempts %u due_ms %u",
+                                i, p_info->bd_addr[0], p_info->bd_addr[1], p_info->bd_addr[2],
+                                p_info->bd_addr[3], p_info->bd_addr[4], p_info->bd_addr[5],
+                                p_info->p_state, p_info->attempts, p_info->due_ms);
+    }
+    hfag_console_reply_data(p_reply, "enabled %u inquiry %u pages %u failed %u given_up %u "
+                            "samples %u p50_ms %u p99_ms %u max_ms %u mean_ms %u",
+                            status.enabled ? 1U : 0U, status.inquiry ? 1U : 0U,
+                            status.pages, status.failures, status.given_up, p_summary->samples,
+                            p_summary->p50_us / 1000U, p_summary->p99_us / 1000U,
+                            p_summary->max_us / 1000U, p_summary->mean_us / 1000U);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_reply_data
+ *******************************************************************************
+ * Summary:
+ *   Sends one data line of a response
+ *
+ ******************************************************************************/
+static void hfag_console_reply_data(hfag_console_reply_t *p_reply, const char *p_format, ...)
+{
+    char line[HFAG_CONSOLE_LINE_LEN];
+    va_list args;
+    int len;
+
+    va_start(args, p_format);
+    len = vsnprintf(&line[2], sizeof(line) - 3, p_format, args);
+    va_end(args);
+    len = MIN(len, (int)sizeof(line) - 4);
+    if (p_reply->p_client == NULL)
+    {
+        printf("%s\n", &line[2]);
+        return;
+    }
+    line[0] = '=';
+    line[1] = ' ';
+    line[len + 2] = '\n';
+    hfag_console_client_send(p_reply->p_client, line, (uint32_t)len + 3);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_reply_error
+ *******************************************************************************
+ * Summary:
+ *   Ends a response with an error
+ *
+ ******************************************************************************/
+static void hfag_console_reply_error(hfag_console_reply_t *p_reply, const char *p_format, ...)
+{
+    char line[HFAG_CONSOLE_LINE_LEN];
+    va_list args;
+    int len;
+
+    va_start(args, p_format);
+    len = vsnprintf(&line[4], sizeof(line) - 5, p_format, args);
+    va_end(args);
+    len = MIN(len, (int)sizeof(line) - 6);
+    p_reply->failed = WICED_TRUE;
+    if (p_reply->p_client == NULL)
+    {
+        printf("%s\n", &line[4]);
+        return;
+    }
+    memcpy(line, "ERR ", 4);
+    line[len + 4] = '\n';
+    hfag_console_client_send(p_reply->p_client, line, (uint32_t)len + 5);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_parse_uint
+ *******************************************************************************
+ * Summary:
+ *   Parses a whole argument as an unsigned number no larger than max
+ *
+ ******************************************************************************/
+static wiced_bool_t hfag_console_parse_uint(const char *p_arg, int base, uint32_t max, uint32_t *p_value)
+{
+    char *p_end;
+    unsigned long value;
+
+    if (!isxdigit((unsigned char)*p_arg))
+    {
+        return WICED_FALSE;
+    }
+    value = strtoul(p_arg, &p_end, base);
+    if ((*p_end != '\0') || (value > max))
+    {
+        return WICED_FALSE;
+    }
+    *p_value = (uint32_t)value;
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_parse_handle
+ *******************************************************************************
+ * Summary:
+ *   Parses an application handle, hexadecimal as shown in the connection
+ *   details, and replies with an error if it is not valid
+ *
+ ******************************************************************************/
+static wiced_bool_t hfag_console_parse_handle(hfag_console_reply_t *p_reply, const char *p_arg, uint16_t *p_handle)
+{
+    uint32_t handle;
+
+    if (!hfag_console_parse_uint(p_arg, 16, UINT16_MAX, &handle) || !hfag_validate_app_handle((uint16_t)handle))
+    {
+        hfag_console_reply_error(p_reply, "Invalid Handle");
+        return WICED_FALSE;
+    }
+    *p_handle = (uint16_t)handle;
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_submit
+ *******************************************************************************
+ * Summary:
+ *   Queues a command for the Bluetooth stack thread. The response is sent by
+ *   hfag_console_cmd_done, and a client sends no further commands until then.
+ *
+ ******************************************************************************/
+static void hfag_console_submit(hfag_console_reply_t *p_reply, hfag_cmd_t *p_cmd)
+{
+    uint32_t target = HFAG_CONSOLE_TARGET_MENU;
+    uint32_t generation = 0;
+
+    if (p_reply->p_client != NULL)
+    {
+        target = (uint32_t)(p_reply->p_client - console_clients);
+        generation = p_reply->p_client->generation;
+    }
+    p_cmd->p_done = hfag_console_cmd_done;
+    p_cmd->cookie = (target << 24) | (generation & 0xFFFFFFU);
+    if (hfag_cmdq_submit(p_cmd) != WICED_BT_SUCCESS)
+    {
+        hfag_console_reply_error(p_reply, "command queue full");
+        return;
+    }
+    p_reply->deferred = WICED_TRUE;
+    if (p_reply->p_client != NULL)
+    {
+        p_reply->p_client->pending = WICED_TRUE;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_cmd_done
+ *******************************************************************************
+ * Summary:
+ *   Completion of a queued command on the Bluetooth stack thread, posts the
+ *   response to the client or the menu that sent it
+ *
+ ******************************************************************************/
+static void hfag_console_cmd_done(const hfag_cmd_t *p_cmd, wiced_result_t result)
+{
+    char line[HFAG_CONSOLE_LINE_LEN];
+
+    if (result == WICED_BT_SUCCESS)
+    {
+        snprintf(line, sizeof(line), "OK\n");
+    }
+    else if (result == WICED_BT_BADARG)
+    {
+        snprintf(line, sizeof(line), "ERR Invalid Handle\n");
+    }
+    else
+    {
+        snprintf(line, sizeof(line), "ERR %s returned error %d\n", hfag_cmdq_name(p_cmd->type), result);
+    }
+    hfag_console_post(line, (uint8_t)(p_cmd->cookie >> 24), p_cmd->cookie & 0xFFFFFFU);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_post
+ *******************************************************************************
+ * Summary:
+ *   Queues a line of the Bluetooth stack thread for the main loop. Events
+ *   that do not fit are dropped and counted.
+ *
+ ******************************************************************************/
+static void hfag_console_post(const char *p_line, uint8_t target, uint32_t generation)
+{
+    hfag_console_post_t *p_post;
+    uint32_t limit = (target < HFAG_CONSOLE_MAX_CLIENTS) ? HFAG_CONSOLE_POST_SLOTS : HFAG_CONSOLE_EVENT_QUEUE;
+    uint64_t one = 1;
+
+    pthread_mutex_lock(&console_event_lock);
+    if ((console_event_head - console_event_tail) < limit)
+    {
+        p_post = &console_posts[console_event_head % HFAG_CONSOLE_POST_SLOTS];
+        snprintf(p_post->line, sizeof(p_post->line), "%s", p_line);
+        p_post->target = target;
+        p_post->generation = generation;
+        console_event_head++;
+    }
+    else
+    {
+        console_event_drops++;
+    }
+    pthread_mutex_unlock(&console_event_lock);
+    if (console_event_fd >= 0)
+    {
+        (void)write(console_event_fd, &one, sizeof(one));
+    }
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_execute
+ *******************************************************************************
+ * Summary:
+ *   Runs one command line. Each argument but the last is one word, the last
+ *   takes the rest of the line. A control client gets OK unless the command
+ *   failed.
+ *
+ ******************************************************************************/
+static void hfag_console_execute(hfag_console_reply_t *p_reply, char *p_line)
+{
+    const hfag_console_command_t *p_command = NULL;
+    char *argv[HFAG_CONSOLE_MAX_ARGS] = { NULL };
+    char *p_name;
+    char *p;
+    uint32_t i;
+
+    p_name = p_line + strspn(p_line, " \t");
+    p = p_name + strcspn(p_name, " \t");
+    if (*p != '\0')
+    {
+        *p++ = '\0';
+    }
+    for (i = 0; i < sizeof(console_commands) / sizeof(console_commands[0]); i++)
+    {
+        if (strcmp(p_name, console_commands[i].p_name) == 0)
+        {
+            p_command = &console_commands[i];
+            break;
+        }
+    }
+    if (p_command == NULL)
+    {
+        hfag_console_reply_error(p_reply, "Invalid Input");
+        return;
+    }
+
+    for (i = 0; i < p_command->args; i++)
+    {
+        p += strspn(p, " \t");
+        if (*p == '\0')
+        {
+            hfag_console_reply_error(p_reply, "usage: %s %s", p_command->p_name, p_command->p_usage);
+            return;
+        }
+        argv[i] = p;
+        if (i + 1 < p_command->args)
+        {
+            p += strcspn(p, " \t");
+            if (*p != '\0')
+            {
+                *p++ = '\0';
+            }
+        }
+    }
+
+    p_command->p_handler(p_reply, argv);
+    if ((p_reply->p_client != NULL) && !p_reply->failed && !p_reply->deferred)
+    {
+        hfag_console_client_send(p_reply->p_client, "OK\n", 3);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_stdin_line
+ *******************************************************************************
+ * Summary:
+ *   Handles one line of the menu: a menu option, the answer to the prompt of
+ *   the current option, or a control command typed directly
+ *
+ ******************************************************************************/
+static void hfag_console_stdin_line(char *p_line)
+{
+    hfag_console_reply_t reply = { NULL, WICED_FALSE, WICED_FALSE };
+    const hfag_console_command_t *p_command;
+    uint32_t option;
+    size_t used;
+
+    if (p_console_prompting != NULL)
+    {
+        used = strlen(console_menu_line);
+        snprintf(&console_menu_line[used], sizeof(console_menu_line) - used, " %s", p_line);
+        console_prompt++;
+        if (console_prompt < p_console_prompting->args)
+        {
+            printf(p_console_prompting->p_prompts[console_prompt], AUDIO_MIX_GAIN_MAX);
+            return;
+        }
+        p_console_prompting = NULL;
+        hfag_console_execute(&reply, console_menu_line);
+        return;
+    }
+
+    p_line += strspn(p_line, " \t");
+    if (*p_line == '\0')
+    {
+        return;
+    }
+    if (!hfag_console_parse_uint(p_line, 10, UINT32_MAX, &option) || !isdigit((unsigned char)*p_line))
+    {
+        hfag_console_execute(&reply, p_line);
+        return;
+    }
+    if (option >= sizeof(console_commands) / sizeof(console_commands[0]))
+    {
+        printf("Invalid Input\n");
+        return;
+    }
+    p_command = &console_commands[option];
+    if (p_command->show_context)
+    {
+        hfag_print_hfp_context();
+    }
+    snprintf(console_menu_line, sizeof(console_menu_line), "%s", p_command->p_name);
+    if (p_command->args == 0)
+    {
+        hfag_console_execute(&reply, console_menu_line);
+        return;
+    }
+    p_console_prompting = p_command;
+    console_prompt = 0;
+    /* the gain prompt shows its range */
+    printf(p_command->p_prompts[0], AUDIO_MIX_GAIN_MAX);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_stdin_read
+ *******************************************************************************
+ * Summary:
+ *   Reads what is available on stdin and handles the complete lines. At the
+ *   end of the input the menu is no longer served.
+ *
+ ******************************************************************************/
+static void hfag_console_stdin_read(void)
+{
+    ssize_t n;
+    char *p_nl;
+    uint32_t len;
+
+    n = read(STDIN_FILENO, &console_stdin_buf[console_stdin_len], sizeof(console_stdin_buf) - 1 - console_stdin_len);
+    if (n <= 0)
+    {
+        if ((n < 0) && (errno == EINTR || errno == EAGAIN))
+        {
+            return;
+        }
+        epoll_ctl(console_epoll_fd, EPOLL_CTL_DEL, STDIN_FILENO, NULL);
+        return;
+    }
+    console_stdin_len += (uint32_t)n;
+    console_stdin_buf[console_stdin_len] = '\0';
+    while ((p_nl = strchr(console_stdin_buf, '\n')) != NULL)
+    {
+        *p_nl = '\0';
+        len = (uint32_t)(p_nl - console_stdin_buf) + 1;
+        if ((p_nl > console_stdin_buf) && (p_nl[-1] == '\r'))
+        {
+            p_nl[-1] = '\0';
+        }
+        hfag_console_stdin_line(console_stdin_buf);
+        memmove(console_stdin_buf, &console_stdin_buf[len], console_stdin_len - len + 1);
+        console_stdin_len -= len;
+    }
+    if (console_stdin_len == sizeof(console_stdin_buf) - 1)
+    {
+        printf("Invalid Input\n");
+        console_stdin_len = 0;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_listen
+ *******************************************************************************
+ * Summary:
+ *   Creates the control socket, replacing a stale socket file
+ *
+ ******************************************************************************/
+static wiced_bool_t hfag_console_listen(const char *p_path)
+{
+    struct sockaddr_un addr;
+    struct epoll_event ev;
+
+    if (strlen(p_path) >= sizeof(addr.sun_path))
+    {
+        printf("%s too long: %s\n", HFAG_CONFIG_CONTROL_SOCKET, p_path);
+        return WICED_FALSE;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, p_path);
+    strcpy(console_socket_path, p_path);
+
+    console_listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (console_listen_fd < 0)
+    {
+        printf("control socket: %s\n", strerror(errno));
+        return WICED_FALSE;
+    }
+    unlink(p_path);
+    if ((bind(console_listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) ||
+        (listen(console_listen_fd, HFAG_CONSOLE_MAX_CLIENTS) != 0))
+    {
+        printf("control socket %s: %s\n", p_path, strerror(errno));
+        close(console_listen_fd);
+        console_listen_fd = -1;
+        return WICED_FALSE;
+    }
+    ev.events = EPOLLIN;
+    ev.data.u64 = HFAG_CONSOLE_TAG_LISTEN;
+    epoll_ctl(console_epoll_fd, EPOLL_CTL_ADD, console_listen_fd, &ev);
+    printf("control socket %s\n", p_path);
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_accept
+ *******************************************************************************
+ * Summary:
+ *   Accepts a control client, clients beyond HFAG_CONSOLE_MAX_CLIENTS are
+ *   refused
+ *
+ ******************************************************************************/
+static void hfag_console_accept(void)
+{
+    hfag_console_client_t *p_client = NULL;
+    struct epoll_event ev;
+    uint32_t i;
+    int fd;
+
+    fd = accept4(console_listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0)
+    {
+        return;
+    }
+    for (i = 0; i < HFAG_CONSOLE_MAX_CLIENTS; i++)
+    {
+        if (console_clients[i].fd < 0)
+        {
+            p_client = &console_clients[i];
+            break;
+        }
+    }
+    if (p_client == NULL)
+    {
+        (void)send(fd, "ERR too many clients\n", 21, MSG_NOSIGNAL);
+        close(fd);
+        return;
+    }
+    p_client->fd = fd;
+    p_client->in_len = 0;
+    p_client->out_len = 0;
+    p_client->discarding = WICED_FALSE;
+    p_client->pending = WICED_FALSE;
+    p_client->generation++;
+    ev.events = EPOLLIN;
+    ev.data.u64 = HFAG_CONSOLE_TAG_CLIENT + i;
+    epoll_ctl(console_epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_client_close
+ *******************************************************************************
+ * Summary:
+ *   Disconnects a control client
+ *
+ ******************************************************************************/
+static void hfag_console_client_close(hfag_console_client_t *p_client)
+{
+    epoll_ctl(console_epoll_fd, EPOLL_CTL_DEL, p_client->fd, NULL);
+    close(p_client->fd);
+    p_client->fd = -1;
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_client_flush
+ *******************************************************************************
+ * Summary:
+ *   Sends the queued output of a client, and waits for the socket to become
+ *   writable if it is full
+ *
+ ******************************************************************************/
+static void hfag_console_client_flush(hfag_console_client_t *p_client)
+{
+    struct epoll_event ev;
+    ssize_t n;
+    uint32_t sent = 0;
+
+    while (sent < p_client->out_len)
+    {
+        n = send(p_client->fd, &p_client->out[sent], p_client->out_len - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+            {
+                hfag_console_client_close(p_client);
+                return;
+            }
+            break;
+        }
+        sent += (uint32_t)n;
+    }
+    memmove(p_client->out, &p_client->out[sent], p_client->out_len - sent);
+    p_client->out_len -= sent;
+
+    ev.events = (p_client->pending ? 0 : EPOLLIN) | ((p_client->out_len > 0) ? EPOLLOUT : 0);
+    ev.data.u64 = HFAG_CONSOLE_TAG_CLIENT + (uint64_t)(p_client - console_clients);
+    epoll_ctl(console_epoll_fd, EPOLL_CTL_MOD, p_client->fd, &ev);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_client_send
+ *******************************************************************************
+ * Summary:
+ *   Queues output for a client and sends it. A client that does not read
+ *   its output is disconnected once HFAG_CONSOLE_OUT_LEN is queued.
+ *
+ ******************************************************************************/
+static void hfag_console_client_send(hfag_console_client_t *p_client, const char *p_data, uint32_t len)
+{
+    if (p_client->fd < 0)
+    {
+        return;
+    }
+    if (len > sizeof(p_client->out) - p_client->out_len)
+    {
+        WICED_BT_TRACE("control client not reading, disconnected\n");
+        hfag_console_client_close(p_client);
+        return;
+    }
+    memcpy(&p_client->out[p_client->out_len], p_data, len);
+    p_client->out_len += len;
+    hfag_console_client_flush(p_client);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_client_read
+ *******************************************************************************
+ * Summary:
+ *   Reads the requests of a client and runs each complete line
+ *
+ ******************************************************************************/
+static void hfag_console_client_read(hfag_console_client_t *p_client)
+{
+    ssize_t n;
+
+    n = recv(p_client->fd, &p_client->in[p_client->in_len], sizeof(p_client->in) - 1 - p_client->in_len, 0);
+    if (n <= 0)
+    {
+        if ((n < 0) && ((errno == EINTR) || (errno == EAGAIN)))
+        {
+            return;
+        }
+        hfag_console_client_close(p_client);
+        return;
+    }
+    p_client->in_len += (uint32_t)n;
+    p_client->in[p_client->in_len] = '\0';
+    hfag_console_client_process(p_client);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_client_process
+ *******************************************************************************
+ * Summary:
+ *   Runs the complete lines of a client until one waits for the command
+ *   queue. The rest runs after its response.
+ *
+ ******************************************************************************/
+static void hfag_console_client_process(hfag_console_client_t *p_client)
+{
+    hfag_console_reply_t reply;
+    char *p_nl;
+    uint32_t len;
+
+    while ((p_client->fd >= 0) && !p_client->pending && ((p_nl = strchr(p_client->in, '\n')) != NULL))
+    {
+        *p_nl = '\0';
+        len = (uint32_t)(p_nl - p_client->in) + 1;
+        if ((p_nl > p_client->in) && (p_nl[-1] == '\r'))
+        {
+            p_nl[-1] = '\0';
+        }
+        if (p_client->discarding)
+        {
+            p_client->discarding = WICED_FALSE;
+        }
+        else if (p_client->in[strspn(p_client->in, " \t")] != '\0')
+        {
+            reply.p_client = p_client;
+            reply.failed = WICED_FALSE;
+            reply.deferred = WICED_FALSE;
+            hfag_console_execute(&reply, p_client->in);
+        }
+        memmove(p_client->in, &p_client->in[len], p_client->in_len - len + 1);
+        p_client->in_len -= len;
+    }
+    if (p_client->fd < 0)
+    {
+        return;
+    }
+    if (p_client->pending)
+    {
+        /* stop reading until the response */
+        hfag_console_client_flush(p_client);
+    }
+    else if (p_client->in_len == sizeof(p_client->in) - 1)
+    {
+        hfag_console_client_send(p_client, "ERR line too long\n", 18);
+        p_client->discarding = WICED_TRUE;
+        p_client->in_len = 0;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: hfag_console_posts_flush
+ *******************************************************************************
+ * Summary:
+ *   Sends the queued events of the stack thread to every control client, and
+ *   the responses of queued commands to the client or the menu that sent
+ *   them. A client resumes its remaining commands after its response.
+ *
+ ******************************************************************************/
+static void hfag_console_posts_flush(void)
+{
+    hfag_console_post_t post;
+    hfag_console_client_t *p_client;
+    uint64_t count;
+    uint32_t drops;
+    uint32_t i;
+
+    (void)read(console_event_fd, &count, sizeof(count));
+    for ( ; ; )
+    {
+        pthread_mutex_lock(&console_event_lock);
+        drops = console_event_drops;
+        console_event_drops = 0;
+        if (console_event_tail == console_event_head)
+        {
+            pthread_mutex_unlock(&console_event_lock);
+            break;
+        }
+        memcpy(&post, &console_posts[console_event_tail % HFAG_CONSOLE_POST_SLOTS], sizeof(post));
+        console_event_tail++;
+        pthread_mutex_unlock(&console_event_lock);
+
+        if (post.target == HFAG_CONSOLE_TARGET_ALL)
+        {
+            for (i = 0; i < HFAG_CONSOLE_MAX_CLIENTS; i++)
+            {
+                hfag_console_client_send(&console_clients[i], post.line, (uint32_t)strlen(post.line));
+            }
+        }
+        else if (post.target == HFAG_CONSOLE_TARGET_MENU)
+        {
+            /* the menu only reports failures, without the ERR prefix */
+            if (strncmp(post.line, "ERR ", 4) == 0)
+            {
+                printf("%s", &post.line[4]);
+            }
+        }
+        else if (post.target < HFAG_CONSOLE_MAX_CLIENTS)
+        {
+            p_client = &console_clients[post.target];
+            if ((p_client->fd >= 0) && p_client->pending &&
+                ((p_client->generation & 0xFFFFFFU) == post.generation))
+            {
+                p_client->pending = WICED_FALSE;
+                hfag_console_client_send(p_client, post.line, (uint32_t)strlen(post.line));
+                hfag_console_client_process(p_client);
+                if ((p_client->fd >= 0) && !p_client->pending)
+                {
+                    /* read again */
+                    hfag_console_client_flush(p_client);
+                }
+            }
+        }
+        if (drops != 0)
+        {
+            WICED_BT_TRACE("%u control events dropped\n", drops);
+        }
+    }
+}
@@ -0,0 +1,166 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/*******************************************************************************
+ * File Name: hfag_future.c
+ *
+ * Description: This file contains the completion object. Each part of the
+ * awaited work reports its status once, and the waiter wakes up when all
+ * parts have reported or the timeout expires. The state is kept under the
+ * lock, so a completion that comes before the wait is not lost.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ ******************************************************************************/
+#include <errno.h>
+#include <time.h>
+
+#include "hfag_future.h"
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: hfag_future_init
+ *******************************************************************************
+ * Summary:
+ *   Prepares a completion object for a number of parts
+ *
+ * Parameters:
+ *   hfag_future_t *p_future : completion object
+ *   uint32_t parts          : completions to wait for
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_future_init(hfag_future_t *p_future, uint32_t parts)
+{
+    pthread_condattr_t attr;
+
+    pthread_mutex_init(&p_future->lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&p_future->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    p_future->pending = parts;
+    p_future->status = WICED_BT_SUCCESS;
+}
+
+/*******************************************************************************
+ * Function Name: hfag_future_complete
+ *******************************************************************************
+ * Summary:
+ *   Completes one part. Any thread may call it, before or during the wait.
+ *
+ * Parameters:
+ *   hfag_future_t *p_future : completion object
+ *   wiced_result_t status   : result of the part
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_future_complete(hfag_future_t *p_future, wiced_result_t status)
+{
+    pthread_mutex_lock(&p_future->lock);
+    if (p_future->pending > 0)
+    {
+        p_future->pending--;
+        if ((status != WICED_BT_SUCCESS) && (p_future->status == WICED_BT_SUCCESS))
+        {
+            p_future->status = status;
+        }
+        if ((p_future->pending == 0) || (status != WICED_BT_SUCCESS))
+        {
+            pthread_cond_broadcast(&p_future->cond);
+        }
+    }
+    pthread_mutex_unlock(&p_future->lock);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_future_wait
+ *******************************************************************************
+ * Summary:
+ *   Waits until every part has completed, or returns early with the first
+ *   failure
+ *
+ * Parameters:
+ *   hfag_future_t *p_future : completion object
+ *   uint32_t timeout_ms     : longest wait, 0 - no limit
+ *
+ * Return:
+ *   wiced_result_t : WICED_BT_SUCCESS, the status of the first failed part,
+ *                    or WICED_BT_TIMEOUT
+ *
+ ******************************************************************************/
+wiced_result_t hfag_future_wait(hfag_future_t *p_future, uint32_t timeout_ms)
+{
+    struct timespec deadline;
+    wiced_result_t status;
+    int rc = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += (time_t)(timeout_ms / 1000U);
+    deadline.tv_nsec += (long)(timeout_ms % 1000U) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&p_future->lock);
+    while ((p_future->pending > 0) && (p_future->status == WICED_BT_SUCCESS) && (rc != ETIMEDOUT))
+    {
+        if (timeout_ms == 0)
+        {
+            pthread_cond_wait(&p_future->cond, &p_future->lock);
+        }
+        else
+        {
+            rc = pthread_cond_timedwait(&p_future->cond, &p_future->lock, &deadline);
+        }
+    }
+    status = p_future->status;
+    if ((status == WICED_BT_SUCCESS) && (p_future->pending > 0))
+    {
+        status = WICED_BT_TIMEOUT;
+    }
+    pthread_mutex_unlock(&p_future->lock);
+    return status;
+}
@@ -0,0 +1,972 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/*******************************************************************************
+ * File Name: hfag_reconnect.c
+ *
+ * Description: This file contains the reconnect scheduler. The bonded
+ * Handsfree Units are kept in a most recently used list, loaded from the key
+ * store. After the start and after a link loss, a supervision or LMP
+ * timeout of the ACL, they are paged one at a time, most recently used
+ * first, with exponential backoff and jitter between the attempts. A link
+ * ended by the peer on purpose is not reconnected. Pages are never started
+ * during an inquiry. A scheduler thread sleeps until the next attempt is due
+ * and queues it to the stack thread, which makes every decision, so the
+ * inquiry and the connections cannot change underneath it. The time from
+ * the start of an outage to the service level connection is recorded.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ ******************************************************************************/
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hfag.h"
+#include "hfag_cmdq.h"
+#include "hfag_config.h"
+#include "hfag_reconnect.h"
+#include "latency_hist.h"
+#include "wiced_bt_hfp_ag.h"
+#include "wiced_bt_trace.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define RECONNECT_MIN_MS            (1000)  /* default HFAG_RECONNECT_MIN_MS */
+#define RECONNECT_MAX_MS            (60000) /* default HFAG_RECONNECT_MAX_MS */
+#define RECONNECT_ATTEMPTS          (30)    /* default HFAG_RECONNECT_ATTEMPTS */
+#define RECONNECT_PAGE_TIMEOUT_NS   (20000000000ULL) /* open event never came */
+#define RECONNECT_RETRY_NS          (100000000ULL)   /* command queue was full */
+#define RECONNECT_NEVER             (UINT64_MAX)
+#define RECONNECT_NS_PER_MS         (1000000ULL)
+
+/* HCI disconnect reasons of a link loss, anything else ends the link on
+ * purpose, such as 0x13 (remote user) or 0x15 (remote power off) */
+#define RECONNECT_HCI_CONNECTION_TIMEOUT    (0x08U) /* supervision timeout */
+#define RECONNECT_HCI_LMP_TIMEOUT           (0x22U)
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+typedef enum
+{
+    RECONNECT_IDLE,
+    RECONNECT_SCHEDULED,            /* paged once due_ns has passed */
+    RECONNECT_PAGING,
+    RECONNECT_CONNECTED,
+} hfag_reconnect_state_t;
+
+typedef struct
+{
+    wiced_bt_device_address_t bd_addr;
+    hfag_reconnect_state_t state;
+    uint16_t handle;                /* while connected */
+    uint32_t attempts;              /* failed pages of the current outage */
+    uint64_t due_ns;
+    uint64_t lost_ns;               /* start of the current outage, 0 - none */
+    wiced_bool_t link_pending;      /* closed while the ACL was up, waiting for its reason */
+} hfag_reconnect_peer_t;
+
+/*******************************************************************************
+ *       FUNCTION DECLARATION
+ ******************************************************************************/
+static void *hfag_reconnect_thread(void *p_arg);
+static uint64_t hfag_reconnect_next_ns(void);
+static int hfag_reconnect_find(const wiced_bt_device_address_t bd_addr);
+static hfag_reconnect_peer_t *hfag_reconnect_promote(int index);
+static void hfag_reconnect_schedule(hfag_reconnect_peer_t *p_peer, uint64_t now_ns);
+static void hfag_reconnect_failed(hfag_reconnect_peer_t *p_peer, uint64_t now_ns);
+static void hfag_reconnect_lost(hfag_reconnect_peer_t *p_peer, uint8_t reason);
+static uint32_t hfag_reconnect_open_count(void);
+static uint32_t hfag_reconnect_random(void);
+static uint64_t hfag_reconnect_now_ns(void);
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static pthread_mutex_t reconnect_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t reconnect_cond;   /* CLOCK_MONOTONIC, wakes the scheduler */
+
+/* Most recently used first */
+static hfag_reconnect_peer_t reconnect_peers[HFAG_RECONNECT_MAX_PEERS];
+static uint32_t reconnect_count = 0;
+
+static wiced_bool_t reconnect_enabled = WICED_FALSE;
+static wiced_bool_t reconnect_inquiry_active = WICED_FALSE;
+static wiced_bool_t reconnect_kicked = WICED_FALSE;     /* a page command is queued */
+static wiced_bool_t reconnect_page_active = WICED_FALSE;
+static wiced_bt_device_address_t reconnect_page_addr;
+static uint64_t reconnect_page_deadline_ns = 0;
+
+/* Indexed by app handle - 1 */
+static wiced_bool_t reconnect_open[HANDSFREE_AG_NUM_SCB];
+static wiced_bool_t reconnect_local_close[HANDSFREE_AG_NUM_SCB];
+
+static uint32_t reconnect_min_ms = RECONNECT_MIN_MS;
+static uint32_t reconnect_max_ms = RECONNECT_MAX_MS;
+static uint32_t reconnect_max_attempts = RECONNECT_ATTEMPTS;
+static uint32_t reconnect_seed = 1;
+
+/* Time to reconnect in us */
+static latency_hist_t reconnect_hist;
+static uint32_t reconnect_pages = 0;
+static uint32_t reconnect_failures = 0;
+static uint32_t reconnect_given_up = 0;
+
+static const char *const reconnect_state_names[] =
+{
+    "idle",
+    "scheduled",
+    "paging",
+    "connected",
+};
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: hfag_reconnect_init
+ *******************************************************************************
+ * Summary:
+ *   Loads the bonded peers, called on the stack thread before the HFP AG
+ *   profile is started
+ *
+ * Parameters:
+ *   const wiced_bt_device_link_keys_t *p_keys : key store records, most
+ *                                               recently used first
+ *   uint8_t count                             : number of records
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_reconnect_init(const wiced_bt_device_link_keys_t *p_keys, uint8_t count)
+{
+    pthread_condattr_t attr;
+    uint32_t i;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&reconnect_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pthread_mutex_lock(&reconnect_lock);
+    memset(reconnect_peers, 0, sizeof(reconnect_peers));
+    memset(reconnect_open, 0, sizeof(reconnect_open));
+    memset(reconnect_local_close, 0, sizeof(reconnect_local_close));
+    latency_hist_reset(&reconnect_hist);
+    reconnect_count = 0;
+    for (i = 0; (i < count) && (reconnect_count < HFAG_RECONNECT_MAX_PEERS); i++)
+    {
+        if (hfag_reconnect_find(p_keys[i].bd_addr) < 0)
+        {
+            memcpy(reconnect_peers[reconnect_count++].bd_addr, p_keys[i].bd_addr, sizeof(wiced_bt_device_address_t));
+        }
+    }
+    pthread_mutex_unlock(&reconnect_lock);
+    WICED_BT_TRACE("reconnect: %u bonded peers\n", reconnect_count);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_reconnect_start
+ *******************************************************************************
+ * Summary:
+ *   Starts the scheduler once the application is ready for calls, and pages
+ *   the most recently used peers, as many as can be connected at once
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_reconnect_start(void)
+{
+    pthread_t thread;
+    uint64_t now_ns = hfag_reconnect_now_ns();
+    int value;
+    uint32_t i;
+
+    if (hfag_config_get_int(HFAG_CONFIG_RECONNECT, 1) == 0)
+    {
+        return;
+    }
+    value = hfag_config_get_int(HFAG_CONFIG_RECONNECT_MIN_MS, RECONNECT_MIN_MS);
+    reconnect_min_ms = (value > 0) ? (uint32_t)value : RECONNECT_MIN_MS;
+    value = hfag_config_get_int(HFAG_CONFIG_RECONNECT_MAX_MS, RECONNECT_MAX_MS);
+    reconnect_max_ms = (value >= (int)reconnect_min_ms) ? (uint32_t)value : reconnect_min_ms;
+    value = hfag_config_get_int(HFAG_CONFIG_RECONNECT_ATTEMPTS, RECONNECT_ATTEMPTS);
+    reconnect_max_attempts = (value > 0) ? (uint32_t)value : 0;
+    reconnect_seed = (uint32_t)(now_ns ^ (now_ns >> 32) ^ (uint64_t)getpid()) | 1U;
+
+    pthread_mutex_lock(&reconnect_lock);
+    reconnect_enabled = WICED_TRUE;
+    for (i = 0; (i < reconnect_count) && (i < HANDSFREE_AG_NUM_SCB); i++)
+    {
+        if (reconnect_peers[i].state == RECONNECT_IDLE)
+        {
+            reconnect_peers[i].lost_ns = now_ns;
+            reconnect_peers[i].attempts = 0;
+            hfag_reconnect_schedule(&reconnect_peers[i], now_ns);
+        }
+    }
+    pthread_mutex_unlock(&reconnect_lock);
+
+    if (pthread_create(&thread, NULL, hfag_reconnect_thread, NULL) != 0)
+    {
+        printf("Reconnect scheduler not started\n");
+        pthread_mutex_lock(&reconnect_lock);
+        reconnect_enabled = WICED_FALSE;
+        pthread_mutex_unlock(&reconnect_lock);
+        return;
+    }
+    pthread_detach(thread);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_reconnect_bonded
+ *******************************************************************************
+ * Summary:
+ *   Moves a newly bonded peer to the front of the list. If the list is
+ *   full, the least recently used peer that is neither connected nor paged
+ *   is forgotten, and the new peer is not tracked if there is none
+ *
+ * Parameters:
+ *   const wiced_bt_device_address_t bd_addr : peer address
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_reconnect_bonded(const wiced_bt_device_address_t bd_addr)
+{
+    hfag_reconnect_peer_t *p_peer;
+    int index;
+
+    pthread_mutex_lock(&reconnect_lock);
+    index = hfag_reconnect_find(bd_addr);
+    if ((index < 0) && (reconnect_count < HFAG_RECONNECT_MAX_PEERS))
+    {
+        index = (int)reconnect_count++;
+        memset(&reconnect_peers[index], 0, sizeof(reconnect_peers[index]));
+        memcpy(reconnect_peers[index].bd_addr, bd_addr, sizeof(wiced_bt_device_address_t));
+    }
+    else if (index < 0)
+    {
+        /* A live link or a page in flight keeps its entry */
+        for (index = (int)reconnect_count - 1; index >= 0; index--)
+        {
+            p_peer = &reconnect_peers[index];
+            if ((p_peer->state != RECONNECT_CONNECTED) && (p_peer->state != RECONNECT_PAGING))
+            {
+                break;
+            }
+        }
+        if (index < 0)
+        {
+            WICED_BT_TRACE("reconnect list full of connected or paged peers, new bond not tracked\n");
+            pthread_mutex_unlock(&reconnect_lock);
+            return;
+        }
+        memset(p_peer, 0, sizeof(*p_peer));
+        memcpy(p_peer->bd_addr, bd_addr, sizeof(wiced_bt_device_address_t));
+    }
+    (void)hfag_reconnect_promote(index);
+    pthread_mutex_unlock(&reconnect_lock);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_reconnect_open
+ *******************************************************************************
+ * Summary:
+ *   Tracks the result of a connection, paged by the scheduler, by a user or
+ *   by the peer
+ *
+ * Parameters:
+ *   uint16_t handle                         : app handle
+ *   const wiced_bt_device_address_t bd_addr : peer address
+ *   int status                              : open status, 0 - success
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_reconnect_open(uint16_t handle, const wiced_bt_device_address_t bd_addr, int status)
+{
+    hfag_reconnect_peer_t *p_peer = NULL;
+    wiced_bool_t paged;
+    int index;
+
+    pthread_mutex_lock(&reconnect_lock);
+    index = hfag_reconnect_find(bd_addr);
+    if (index >= 0)
+    {
+        p_peer = &reconnect_peers[index];
+    }
+    paged = (reconnect_page_active && (memcmp(reconnect_page_addr, bd_addr, sizeof(wiced_bt_device_address_t)) == 0)) ?
+                WICED_TRUE : WICED_FALSE;
+    if (paged)
+    {
+        reconnect_page_active = WICED_FALSE;
+    }
+
+    if (status == 0)
+    {
+        if ((handle >= 1) && (handle <= HANDSFREE_AG_NUM_SCB))
+        {
+            reconnect_open[handle - 1] = WICED_TRUE;
+            reconnect_local_close[handle - 1] = WICED_FALSE;
+        }
+        if (p_peer != NULL)
+        {
+            p_peer->state = RECONNECT_CONNECTED;
+            p_peer->handle = handle;
+            p_peer->link_pending = WICED_FALSE;
+        }
+    }
+    else if ((p_peer != NULL) && (p_peer->state == RECONNECT_PAGING))
+    {
+        hfag_reconnect_failed(p_peer, hfag_reconnect_now_ns());
+    }
+    pthread_cond_signal(&reconnect_cond);
+    pthread_mutex_unlock(&reconnect_lock);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_reconnect_connected
+ *******************************************************************************
+ * Summary:
+ *   Records the time to reconnect when the service level connection of a
+ *   bonded peer is up, and makes the peer the most recently used
+ *
+ * Parameters:
+ *   uint16_t handle : app handle
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_reconnect_connected(uint16_t handle)
+{
+    hfag_reconnect_peer_t *p_peer;
+    uint64_t elapsed_us;
+    uint32_t i;
+
+    pthread_mutex_lock(&reconnect_lock);
+    for (i = 0; i < reconnect_count; i++)
+    {
+        if ((reconnect_peers[i].state == RECONNECT_CONNECTED) && (reconnect_peers[i].handle == handle))
+        {
+            break;
+        }
+    }
+    if (i < reconnect_count)
+    {
+        p_peer = hfag_reconnect_promote((int)i);
+        if (p_peer->lost_ns != 0)
+        {
+            elapsed_us = (hfag_reconnect_now_ns() - p_peer->lost_ns) / 1000U;
+            latency_hist_record(&reconnect_hist, elapsed_us);
+            printf("Reconnected %02X:%02X:%02X:%02X:%02X:%02X in %u ms, %u failed pages\n",
+                    p_peer->bd_addr[0], p_peer->bd_addr[1], p_peer->bd_addr[2],
+                    p_peer->bd_addr[3], p_peer->bd_addr[4], p_peer->bd_addr[5],
+                    (uint32_t)(elapsed_us / 1000U), p_peer->attempts);
+        }
+        p_peer->lost_ns = 0;
+        p_peer->attempts = 0;
+    }
+    pthread_mutex_unlock(&reconnect_lock);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_reconnect_close
+ *******************************************************************************
+ * Summary:
+ *   Schedules the reconnection of a bonded peer whose link was lost. A
+ *   connection closed by a disconnect command or ended by the peer is not
+ *   reconnected. If the ACL is still up, the decision waits for
+ *   hfag_reconnect_link_down.
+ *
+ * Parameters:
+ *   uint16_t handle : app handle
+ *   uint8_t reason  : HCI disconnect reason of the ACL,
+ *                     HFAG_RECONNECT_REASON_NONE if it is still up
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_reconnect_close(uint16_t handle, uint8_t reason)
+{
+    hfag_reconnect_peer_t *p_peer;
+    wiced_bool_t local = WICED_FALSE;
+    uint32_t i;
+
+    pthread_mutex_lock(&reconnect_lock);
+    if ((handle >= 1) && (handle <= HANDSFREE_AG_NUM_SCB))
+    {
+        local = reconnect_local_close[handle - 1];
+        reconnect_open[handle - 1] = WICED_FALSE;
+        reconnect_local_close[handle - 1] = WICED_FALSE;
+    }
+    for (i = 0; i < reconnect_count; i++)
+    {
+        p_peer = &reconnect_peers[i];
+        if ((p_peer->state != RECONNECT_CONNECTED) || (p_peer->handle != handle))
+        {
+            continue;
+        }
+        p_peer->state = RECONNECT_IDLE;
+        if (!reconnect_enabled || local)
+        {
+            continue;
+        }
+        if (reason == HFAG_RECONNECT_REASON_NONE)
+        {
+            p_peer->link_pending = WICED_TRUE;
+        }
+        else
+        {
+            hfag_reconnect_lost(p_peer, reason);
+        }
+    }
+    pthread_cond_signal(&reconnect_cond);
+    pthread_mutex_unlock(&reconnect_lock);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_reconnect_link_down
+ *******************************************************************************
+ * Summary:
+ *   Completes the close of a peer whose profile connection closed before
+ *   its ACL went down
+ *
+ * Parameters:
+ *   const wiced_bt_device_address_t bd_addr : peer address
+ *   uint8_t reason                          : HCI disconnect reason
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_reconnect_link_down(const wiced_bt_device_address_t bd_addr, uint8_t reason)
+{
+    hfag_reconnect_peer_t *p_peer;
+    int index;
+
+    pthread_mutex_lock(&reconnect_lock);
+    index = hfag_reconnect_find(bd_addr);
+    if (index >= 0)
+    {
+        p_peer = &reconnect_peers[index];
+        if (p_peer->link_pending && (p_peer->state == RECONNECT_IDLE) && reconnect_enabled)
+        {
+            hfag_reconnect_lost(p_peer, reason);
+        }
+        p_peer->link_pending = WICED_FALSE;
+    }
+    pthread_cond_signal(&reconnect_cond);
+    pthread_mutex_unlock(&reconnect_lock);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_reconnect_disconnect
+ *******************************************************************************
+ * Summary:
+ *   Marks a connection as closed on request, it is not reconnected
+ *
+ * Parameters:
+ *   uint16_t handle : app handle
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_reconnect_disconnect(uint16_t handle)
+{
+    pthread_mutex_lock(&reconnect_lock);
+    if ((handle >= 1) && (handle <= HANDSFREE_AG_NUM_SCB))
+    {
+        reconnect_local_close[handle - 1] = WICED_TRUE;
+    }
+    pthread_mutex_unlock(&reconnect_lock);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_reconnect_inquiry
+ *******************************************************************************
+ * Summary:
+ *   Holds the pages while an inquiry runs
+ *
+ * Parameters:
+ *   wiced_bool_t active : inquiry started or completed
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_reconnect_inquiry(wiced_bool_t active)
+{
+    pthread_mutex_lock(&reconnect_lock);
+    reconnect_inquiry_active = active;
+    pthread_cond_signal(&reconnect_cond);
+    pthread_mutex_unlock(&reconnect_lock);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_reconnect_paging
+ *******************************************************************************
+ * Summary:
+ *   Tells if the scheduler is paging a peer, an inquiry must not start then
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE while a page is outstanding
+ *
+ ******************************************************************************/
+wiced_bool_t hfag_reconnect_paging(void)
+{
+    wiced_bool_t paging;
+
+    pthread_mutex_lock(&reconnect_lock);
+    paging = reconnect_page_active;
+    pthread_mutex_unlock(&reconnect_lock);
+    return paging;
+}
+
+/*******************************************************************************
+ * Function Name: hfag_reconnect_page
+ *******************************************************************************
+ * Summary:
+ *   Pages the most recently used peer that is due, called on the stack
+ *   thread through the command queue. Nothing is paged during an inquiry,
+ *   during another page, or if every service control block is in use.
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_reconnect_page(void)
+{
+    wiced_bt_device_address_t bd_addr;
+    hfag_reconnect_peer_t *p_peer;
+    wiced_bool_t page = WICED_FALSE;
+    uint64_t now_ns = hfag_reconnect_now_ns();
+    uint32_t i;
+
+    pthread_mutex_lock(&reconnect_lock);
+    reconnect_kicked = WICED_FALSE;
+    if (reconnect_page_active && (now_ns >= reconnect_page_deadline_ns))
+    {
+        reconnect_page_active = WICED_FALSE;
+        for (i = 0; i < reconnect_count; i++)
+        {
+            if (reconnect_peers[i].state == RECONNECT_PAGING)
+            {
+                hfag_reconnect_failed(&reconnect_peers[i], now_ns);
+            }
+        }
+    }
+    if (reconnect_enabled && !reconnect_page_active && !reconnect_inquiry_active &&
+        (hfag_reconnect_open_count() < HANDSFREE_AG_NUM_SCB))
+    {
+        for (i = 0; i < reconnect_count; i++)
+        {
+            p_peer = &reconnect_peers[i];
+            if ((p_peer->state == RECONNECT_SCHEDULED) && (p_peer->due_ns <= now_ns))
+            {
+                p_peer->state = RECONNECT_PAGING;
+                memcpy(bd_addr, p_peer->bd_addr, sizeof(bd_addr));
+                memcpy(reconnect_page_addr, p_peer->bd_addr, sizeof(bd_addr));
+                reconnect_page_active = WICED_TRUE;
+                reconnect_page_deadline_ns = now_ns + RECONNECT_PAGE_TIMEOUT_NS;
+                reconnect_pages++;
+                page = WICED_TRUE;
+                break;
+            }
+        }
+    }
+    pthread_cond_signal(&reconnect_cond);
+    pthread_mutex_unlock(&reconnect_lock);
+
+    /* The open event may come back before this returns */
+    if (page)
+    {
+        WICED_BT_TRACE("reconnect: paging %B\n", bd_addr);
+        wiced_bt_hfp_ag_connect((uint8_t *)bd_addr);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: hfag_reconnect_get
+ *******************************************************************************
+ * Summary:
+ *   Takes a snapshot of the bonded peers, in the order they are paged, and
+ *   of the time to reconnect
+ *
+ * Parameters:
+ *   hfag_reconnect_status_t *p_status : filled with the snapshot
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_reconnect_get(hfag_reconnect_status_t *p_status)
+{
+    const hfag_reconnect_peer_t *p_peer;
+    hfag_reconnect_peer_info_t *p_info;
+    uint64_t now_ns = hfag_reconnect_now_ns();
+    uint32_t i;
+
+    pthread_mutex_lock(&reconnect_lock);
+    p_status->enabled = reconnect_enabled;
+    p_status->inquiry = reconnect_inquiry_active;
+    p_status->peers = reconnect_count;
+    for (i = 0; i < reconnect_count; i++)
+    {
+        p_peer = &reconnect_peers[i];
+        p_info = &p_status->peer[i];
+        memcpy(p_info->bd_addr, p_peer->bd_addr, sizeof(wiced_bt_device_address_t));
+        p_info->p_state = reconnect_state_names[p_peer->state];
+        p_info->attempts = p_peer->attempts;
+        p_info->due_ms = ((p_peer->state == RECONNECT_SCHEDULED) && (p_peer->due_ns > now_ns)) ?
+                            (uint32_t)((p_peer->due_ns - now_ns) / RECONNECT_NS_PER_MS) : 0U;
+    }
+    latency_hist_summarize(&reconnect_hist, &p_status->time_to_reconnect);
+    p_status->pages = reconnect_pages;
+    p_status->failures = reconnect_failures;
+    p_status->given_up = reconnect_given_up;
+    pthread_mutex_unlock(&reconnect_lock);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_reconnect_print
+ *******************************************************************************
+ * Summary:
+ *   Prints the bonded peers in the order they are paged, and the time to
+ *   reconnect
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_reconnect_print(void)
+{
+    hfag_reconnect_status_t status;
+    const hfag_reconnect_peer_info_t *p_info;
+    const latency_summary_t *p_summary = &status.time_to_reconnect;
+    uint32_t i;
+
+    hfag_reconnect_get(&status);
+    printf("\n----------------RECONNECT (%s)--------------------\n", status.enabled ? "enabled" : "disabled");
+    printf("%-4s %-17s %-10s %8s %8s\n", "mru", "address", "state", "attempts", "due ms");
+    for (i = 0; i < status.peers; i++)
+    {
+        p_info = &status.peer[i];
+        printf("%-4u %02X:%02X:%02X:%02X:%02X:%02X %-10s %8u %8u\n", i,
+                p_info->bd_addr[0], p_info->bd_addr[1], p_info->bd_addr[2],
+                p_info->bd_addr[3], p_info->bd_addr[4], p_info->bd_addr[5],
+                p_info->p_state, p_info->attempts, p_info->due_ms);
+    }
+    printf("time to reconnect (ms): samples %u p50 %u p99 %u max %u mean %u\n", p_summary->samples,
+            p_summary->p50_us / 1000U, p_summary->p99_us / 1000U, p_summary->max_us / 1000U, p_summary->mean_us / 1000U);
+    printf("pages %u failed %u given up %u inquiry %u\n", status.pages, status.failures,
+            status.given_up, status.inquiry ? 1U : 0U);
+    printf("--------------------------------------------------------------------\n");
+}
+
+/*******************************************************************************
+ * Function Name: hfag_reconnect_thread
+ *******************************************************************************
+ * Summary:
+ *   Sleeps until a page is due and queues it to the stack thread. Only one
+ *   page command is queued at a time.
+ *
+ ******************************************************************************/
+static void *hfag_reconnect_thread(void *p_arg)
+{
+    hfag_cmd_t cmd;
+    struct timespec deadline;
+    uint64_t next_ns;
+    uint64_t now_ns;
+
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.type = HFAG_CMD_RECONNECT;
+
+    pthread_mutex_lock(&reconnect_lock);
+    while (reconnect_enabled)
+    {
+        now_ns = hfag_reconnect_now_ns();
+        next_ns = reconnect_kicked ? RECONNECT_NEVER : hfag_reconnect_next_ns();
+        if (next_ns <= now_ns)
+        {
+            reconnect_kicked = WICED_TRUE;
+            pthread_mutex_unlock(&reconnect_lock);
+            if (hfag_cmdq_submit(&cmd) == WICED_BT_SUCCESS)
+            {
+                pthread_mutex_lock(&reconnect_lock);
+                continue;
+            }
+            pthread_mutex_lock(&reconnect_lock);
+            reconnect_kicked = WICED_FALSE;
+            next_ns = now_ns + RECONNECT_RETRY_NS;
+        }
+        if (next_ns == RECONNECT_NEVER)
+        {
+            pthread_cond_wait(&reconnect_cond, &reconnect_lock);
+        }
+        else
+        {
+            deadline.tv_sec = (time_t)(next_ns / 1000000000U);
+            deadline.tv_nsec = (long)(next_ns % 1000000000U);
+            (void)pthread_cond_timedwait(&reconnect_cond, &reconnect_lock, &deadline);
+        }
+    }
+    pthread_mutex_unlock(&reconnect_lock);
+    return NULL;
+}
+
+/*******************************************************************************
+ * Function Name: hfag_reconnect_next_ns
+ *******************************************************************************
+ * Summary:
+ *   Returns when the stack thread has to run next, with the lock held
+ *
+ ******************************************************************************/
+static uint64_t hfag_reconnect_next_ns(void)
+{
+    uint64_t next_ns = RECONNECT_NEVER;
+    uint32_t i;
+
+    if (reconnect_page_active)
+    {
+        return reconnect_page_deadline_ns;
+    }
+    if (reconnect_inquiry_active || (hfag_reconnect_open_count() >= HANDSFREE_AG_NUM_SCB))
+    {
+        return RECONNECT_NEVER;
+    }
+    for (i = 0; i < reconnect_count; i++)
+    {
+        if ((reconnect_peers[i].state == RECONNECT_SCHEDULED) && (reconnect_peers[i].due_ns < next_ns))
+        {
+            next_ns = reconnect_peers[i].due_ns;
+        }
+    }
+    return next_ns;
+}
+
+/*******************************************************************************
+ * Function Name: hfag_reconnect_find
+ *******************************************************************************
+ * Summary:
+ *   Returns the list index of a peer, or -1
+ *
+ ******************************************************************************/
+static int hfag_reconnect_find(const wiced_bt_device_address_t bd_addr)
+{
+    uint32_t i;
+
+    for (i = 0; i < reconnect_count; i++)
+    {
+        if (memcmp(reconnect_peers[i].bd_addr, bd_addr, sizeof(wiced_bt_device_address_t)) == 0)
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+/*******************************************************************************
+ * Function Name: hfag_reconnect_promote
+ *******************************************************************************
+ * Summary:
+ *   Moves a peer to the front of the list and returns it
+ *
+ ******************************************************************************/
+static hfag_reconnect_peer_t *hfag_reconnect_promote(int index)
+{
+    hfag_reconnect_peer_t peer = reconnect_peers[index];
+
+    memmove(&reconnect_peers[1], &reconnect_peers[0], (size_t)index * sizeof(peer));
+    reconnect_peers[0] = peer;
+    return &reconnect_peers[0];
+}
+
+/*******************************************************************************
+ * Function Name: hfag_reconnect_schedule
+ *******************************************************************************
+ * Summary:
+ *   Sets the time of the next page. The first page of an outage is
+ *   immediate, then the delay doubles from HFAG_RECONNECT_MIN_MS up to
+ *   HFAG_RECONNECT_MAX_MS, of which a random half is taken off so that the
+ *   peers and several gateways do not page in lockstep.
+ *
+ ******************************************************************************/
+static void hfag_reconnect_schedule(hfag_reconnect_peer_t *p_peer, uint64_t now_ns)
+{
+    uint64_t delay_ms = 0;
+    uint32_t shift;
+
+    if (p_peer->attempts > 0)
+    {
+        shift = (p_peer->attempts - 1U < 16U) ? p_peer->attempts - 1U : 16U;
+        delay_ms = (uint64_t)reconnect_min_ms << shift;
+        if (delay_ms > reconnect_max_ms)
+        {
+            delay_ms = reconnect_max_ms;
+        }
+        delay_ms = delay_ms - (delay_ms / 2U) + (hfag_reconnect_random() % (delay_ms / 2U + 1U));
+    }
+    p_peer->state = RECONNECT_SCHEDULED;
+    p_peer->due_ns = now_ns + delay_ms * RECONNECT_NS_PER_MS;
+}
+
+/*******************************************************************************
+ * Function Name: hfag_reconnect_lost
+ *******************************************************************************
+ * Summary:
+ *   Starts an outage of a closed peer if its link timed out, the peer is
+ *   left alone if the link was ended on purpose. Called under
+ *   reconnect_lock.
+ *
+ ******************************************************************************/
+static void hfag_reconnect_lost(hfag_reconnect_peer_t *p_peer, uint8_t reason)
+{
+    uint64_t now_ns;
+
+    p_peer->link_pending = WICED_FALSE;
+    if ((reason != RECONNECT_HCI_CONNECTION_TIMEOUT) && (reason != RECONNECT_HCI_LMP_TIMEOUT))
+    {
+        WICED_BT_TRACE("link to %02X:%02X:%02X:%02X:%02X:%02X ended, reason 0x%02X, not reconnected\n",
+                       p_peer->bd_addr[0], p_peer->bd_addr[1], p_peer->bd_addr[2],
+                       p_peer->bd_addr[3], p_peer->bd_addr[4], p_peer->bd_addr[5], reason);
+        return;
+    }
+    now_ns = hfag_reconnect_now_ns();
+    p_peer->lost_ns = now_ns;
+    p_peer->attempts = 0;
+    hfag_reconnect_schedule(p_peer, now_ns);
+    printf("Link to %02X:%02X:%02X:%02X:%02X:%02X lost, reconnecting\n",
+            p_peer->bd_addr[0], p_peer->bd_addr[1], p_peer->bd_addr[2],
+            p_peer->bd_addr[3], p_peer->bd_addr[4], p_peer->bd_addr[5]);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_reconnect_failed
+ *******************************************************************************
+ * Summary:
+ *   Backs off after a failed page, or gives up after HFAG_RECONNECT_ATTEMPTS
+ *
+ ******************************************************************************/
+static void hfag_reconnect_failed(hfag_reconnect_peer_t *p_peer, uint64_t now_ns)
+{
+    p_peer->attempts++;
+    reconnect_failures++;
+    if ((reconnect_max_attempts != 0) && (p_peer->attempts >= reconnect_max_attempts))
+    {
+        p_peer->state = RECONNECT_IDLE;
+        p_peer->lost_ns = 0;
+        reconnect_given_up++;
+        printf("Reconnect to %02X:%02X:%02X:%02X:%02X:%02X given up after %u pages\n",
+                p_peer->bd_addr[0], p_peer->bd_addr[1], p_peer->bd_addr[2],
+                p_peer->bd_addr[3], p_peer->bd_addr[4], p_peer->bd_addr[5], p_peer->attempts);
+        return;
+    }
+    hfag_reconnect_schedule(p_peer, now_ns);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_reconnect_open_count
+ *******************************************************************************
+ * Summary:
+ *   Returns the number of service control blocks in use
+ *
+ ******************************************************************************/
+static uint32_t hfag_reconnect_open_count(void)
+{
+    uint32_t count = 0;
+    uint32_t i;
+
+    for (i = 0; i < HANDSFREE_AG_NUM_SCB; i++)
+    {
+        count += reconnect_open[i] ? 1U : 0U;
+    }
+    return count;
+}
+
+/*******************************************************************************
+ * Function Name: hfag_reconnect_random
+ *******************************************************************************
+ * Summary:
+ *   Returns a xorshift32 pseudo random number for the jitter
+ *
+ ******************************************************************************/
+static uint32_t hfag_reconnect_random(void)
+{
+    reconnect_seed ^= reconnect_seed << 13;
+    reconnect_seed ^= reconnect_seed >> 17;
+    reconnect_seed ^= reconnect_seed << 5;
+    return reconnect_seed;
+}
+
+/*******************************************************************************
+ * Function Name: hfag_reconnect_now_ns
+ *******************************************************************************
+ * Summary:
+ *   Returns the monotonic time in ns
+ *
+ ******************************************************************************/
+static uint64_t hfag_reconnect_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec;
+}
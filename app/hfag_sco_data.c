@@ -0,0 +1,117 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/*******************************************************************************
+ * File Name: hfag_sco_data.c
+ *
+ * Description: This file contains the SCO data path. Every received SCO
+ * packet is queued for playback in the audio session of its link and
+ * answered with one uplink packet, the conference mix for that link.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ ******************************************************************************/
+#include "wiced_bt_types.h"
+#include "wiced_bt_sco.h"
+#include "audio_platform_common.h"
+#include "hfag_sco_data.h"
+#include "hfag_trace.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define SCO_DATA_LEN                            (1024U)
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static uint8_t sco_uplink_data[SCO_DATA_LEN]; /* microphone audio sent on SCO */
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: hfag_sco_data_process
+ *******************************************************************************
+ * Summary:
+ *   Handles one received SCO packet: queues it for playback and sends the
+ *   uplink packet of the link. Called from the SCO data callback on the
+ *   Bluetooth stack thread.
+ *
+ * Parameters:
+ *   uint16_t sco_channel : sco channel
+ *   uint16_t length      : SCO data callback length
+ *   uint8_t* p_data      : incoming SCO pcm data
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_sco_data_process(uint16_t sco_channel, uint16_t length, uint8_t *p_data)
+{
+    uint8_t scb;
+
+    HFAG_TRACE_DEBUG( HFAG_TRACE_SCO_RX, sco_channel, length );
+    if ( length ) {
+        scb = hfag_sco_lookup( sco_channel );
+        if ( scb == HFAG_NO_SCB )
+        {
+            HFAG_TRACE_ERROR( HFAG_TRACE_SCO_UNKNOWN, sco_channel );
+            return;
+        }
+        alsa_write_pcm_data(scb, p_data, length);
+
+        wiced_result_t result = WICED_ERROR;
+        uint8_t *p_uplink = p_data;
+
+        /* Send the conference mix of the microphone and the other Handsfree
+         * Units, one uplink packet per received packet. The received audio
+         * is only looped back if no playback device runs the conference */
+        if ( ( length <= SCO_DATA_LEN ) && audio_capture_read( scb, sco_uplink_data, length ) )
+        {
+            p_uplink = sco_uplink_data;
+        }
+
+        result = wiced_bt_sco_write_buffer( sco_channel, p_uplink, length );
+        if ( WICED_BT_SUCCESS != result )
+        {
+            HFAG_TRACE_ERROR( HFAG_TRACE_SCO_TX_ERROR, sco_channel, result );
+        }
+    }
+}
+
+/* END OF FILE [] */
@@ -0,0 +1,557 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/*******************************************************************************
+ * File Name: hfag_startup.c
+ *
+ * Description: This file contains the startup profiler and the warm restart
+ * state. The end of every startup phase is timestamped and the breakdown is
+ * printed once the application is ready. Phases that run alongside the
+ * others record their own start.
+ *
+ * With HFAG_WARM_RESTART=1 a state file (HFAG_STATE_FILE) records the
+ * controller the last start brought up: the boot of the host, the HCI UART,
+ * its baud rate and the patch file that was downloaded. If a restart finds
+ * the same boot, UART, baud rate and an unchanged patch file, the firmware
+ * is still in the controller RAM and the patch file is not passed to the
+ * porting layer, which then skips the autobaud sequence and the download.
+ * Every start marks the firmware as unknown until BTM_ENABLED_EVT, so a
+ * start that fails or hangs is followed by a cold start. The visibility and
+ * pairing modes are kept in the same file and restored on start.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ ******************************************************************************/
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "hfag_config.h"
+#include "hfag_startup.h"
+#include "wiced_bt_trace.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define STARTUP_LINE_LEN            (320U)
+#define STARTUP_PATH_LEN            (256U)
+#define STARTUP_BOOT_ID_LEN         (40U)
+#define STARTUP_BOOT_ID_FILE        "/proc/sys/kernel/random/boot_id"
+
+#ifndef MIN
+#define MIN(a, b)                   (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b)                   (((a) > (b)) ? (a) : (b))
+#endif
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+typedef struct
+{
+    char boot_id[STARTUP_BOOT_ID_LEN];
+    char device[STARTUP_PATH_LEN];
+    uint32_t baud;
+    char patch[STARTUP_PATH_LEN];
+    uint64_t patch_size;
+    uint64_t patch_mtime_ns;
+    uint32_t firmware;                  /* 1 - the controller was enabled with this patch */
+    uint32_t discoverable;              /* HFAG_STARTUP_GAP_UNSET if not saved */
+    uint32_t connectable;
+    uint32_t pairable;
+} hfag_startup_state_t;
+
+/*******************************************************************************
+ *       FUNCTION DECLARATION
+ ******************************************************************************/
+static uint64_t hfag_startup_now_ns(void);
+static void hfag_startup_identify(hfag_startup_state_t *p_state, const char *p_patch_file,
+                                  const char *p_device, uint32_t baud);
+static wiced_bool_t hfag_startup_load(hfag_startup_state_t *p_state);
+static void hfag_startup_save(const hfag_startup_state_t *p_state);
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static const char *const startup_phase_names[HFAG_STARTUP_PHASES] =
+{
+    "arguments and BTSPY",
+    "UART, autobaud and patch",
+    "audio devices",
+    "stack init",
+    "controller enable",
+    "application init",
+    "handover",
+};
+
+static uint64_t startup_begin_ns = 0;
+static uint64_t startup_start_ns[HFAG_STARTUP_PHASES];    /* 0 - after the previous phase */
+static uint64_t startup_end_ns[HFAG_STARTUP_PHASES];
+static wiced_bool_t startup_warm = WICED_FALSE;
+
+/* Warm restart state, written on the main thread before the stack starts
+ * and on the stack thread afterwards */
+static wiced_bool_t startup_enabled = WICED_FALSE;
+static hfag_startup_state_t startup_state;
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: hfag_startup_begin
+ *******************************************************************************
+ * Summary:
+ *   Starts the startup profile, first thing in main
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_startup_begin(void)
+{
+    startup_begin_ns = hfag_startup_now_ns();
+    memset(startup_start_ns, 0, sizeof(startup_start_ns));
+    memset(startup_end_ns, 0, sizeof(startup_end_ns));
+}
+
+/*******************************************************************************
+ * Function Name: hfag_startup_start
+ *******************************************************************************
+ * Summary:
+ *   Records the start of a phase that runs in parallel with the following
+ *   phases
+ *
+ * Parameters:
+ *   hfag_startup_phase_t phase : phase that started
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_startup_start(hfag_startup_phase_t phase)
+{
+    if (phase < HFAG_STARTUP_PHASES)
+    {
+        startup_start_ns[phase] = hfag_startup_now_ns();
+    }
+}
+
+/*******************************************************************************
+ * Function Name: hfag_startup_mark
+ *******************************************************************************
+ * Summary:
+ *   Records the end of a startup phase
+ *
+ * Parameters:
+ *   hfag_startup_phase_t phase : phase that ended
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_startup_mark(hfag_startup_phase_t phase)
+{
+    if (phase < HFAG_STARTUP_PHASES)
+    {
+        startup_end_ns[phase] = hfag_startup_now_ns();
+    }
+}
+
+/*******************************************************************************
+ * Function Name: hfag_startup_report
+ *******************************************************************************
+ * Summary:
+ *   Prints the duration of every startup phase, when it was done and the
+ *   total. A phase that was not marked is shown as "-" and counted in the
+ *   next one.
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_startup_report(void)
+{
+    uint64_t prev_ns = startup_begin_ns;
+    uint64_t last_ns = startup_begin_ns;
+    uint64_t start_ns;
+    uint64_t phase_ns;
+    uint32_t i;
+
+    printf("------------------------------------------------------\n");
+    printf("%-28s %10s %13s\n", startup_warm ? "Startup (warm restart)" : "Startup (cold)", "took", "done at");
+    for (i = 0; i < HFAG_STARTUP_PHASES; i++)
+    {
+        if (startup_end_ns[i] == 0)
+        {
+            printf("  %-26s %10s\n", startup_phase_names[i], "-");
+            continue;
+        }
+        start_ns = (startup_start_ns[i] != 0) ? startup_start_ns[i] : prev_ns;
+
+        /* the stack thread may enable the controller before the heap is made */
+        phase_ns = (startup_end_ns[i] > start_ns) ? (startup_end_ns[i] - start_ns) : 0;
+        if (startup_start_ns[i] == 0)
+        {
+            prev_ns = start_ns + phase_ns;
+        }
+        last_ns = MAX(last_ns, start_ns + phase_ns);
+        printf("  %-26s %7u.%02u ms %7u.%02u ms%s\n", startup_phase_names[i],
+               (uint32_t)(phase_ns / 1000000U), (uint32_t)((phase_ns / 10000U) % 100U),
+               (uint32_t)((start_ns + phase_ns - startup_begin_ns) / 1000000U),
+               (uint32_t)(((start_ns + phase_ns - startup_begin_ns) / 10000U) % 100U),
+               (startup_start_ns[i] != 0) ? " (parallel)" : "");
+    }
+    printf("  %-26s %13s %7u.%02u ms\n", "total", "",
+           (uint32_t)((last_ns - startup_begin_ns) / 1000000U),
+           (uint32_t)(((last_ns - startup_begin_ns) / 10000U) % 100U));
+    printf("------------------------------------------------------\n");
+}
+
+/*******************************************************************************
+ * Function Name: hfag_startup_prepare
+ *******************************************************************************
+ * Summary:
+ *   Decides between a cold start and a warm restart before the porting layer
+ *   brings up the controller. On a warm restart the patch file name is
+ *   cleared so that the download is skipped. The firmware is recorded as
+ *   unknown until hfag_startup_controller_ready.
+ *
+ * Parameters:
+ *   char *p_patch_file   : patch file of the command line, cleared if warm
+ *   const char *p_device : HCI UART
+ *   uint32_t baud        : HCI baud rate
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE for a warm restart
+ *
+ ******************************************************************************/
+wiced_bool_t hfag_startup_prepare(char *p_patch_file, const char *p_device, uint32_t baud)
+{
+    hfag_startup_state_t saved;
+    wiced_bool_t loaded;
+
+    startup_enabled = (hfag_config_get_int(HFAG_CONFIG_WARM_RESTART, 0) != 0) ? WICED_TRUE : WICED_FALSE;
+    if (!startup_enabled)
+    {
+        return WICED_FALSE;
+    }
+
+    loaded = hfag_startup_load(&saved);
+    hfag_startup_identify(&startup_state, p_patch_file, p_device, baud);
+    startup_state.firmware = 0;
+    startup_state.discoverable = loaded ? saved.discoverable : HFAG_STARTUP_GAP_UNSET;
+    startup_state.connectable = loaded ? saved.connectable : HFAG_STARTUP_GAP_UNSET;
+    startup_state.pairable = loaded ? saved.pairable : HFAG_STARTUP_GAP_UNSET;
+
+    startup_warm = (loaded && (saved.firmware == 1) && (startup_state.patch[0] != '\0') &&
+                    (startup_state.boot_id[0] != '\0') &&
+                    (strcmp(saved.boot_id, startup_state.boot_id) == 0) &&
+                    (strcmp(saved.device, startup_state.device) == 0) &&
+                    (saved.baud == startup_state.baud) &&
+                    (strcmp(saved.patch, startup_state.patch) == 0) &&
+                    (saved.patch_size == startup_state.patch_size) &&
+                    (saved.patch_mtime_ns == startup_state.patch_mtime_ns)) ? WICED_TRUE : WICED_FALSE;
+
+    /* a start that does not reach BTM_ENABLED_EVT leaves the firmware unknown */
+    hfag_startup_save(&startup_state);
+    if (startup_warm)
+    {
+        printf("Warm restart: %s is already loaded, skipping the patch download\n", p_patch_file);
+        p_patch_file[0] = '\0';
+    }
+    return startup_warm;
+}
+
+/*******************************************************************************
+ * Function Name: hfag_startup_controller_ready
+ *******************************************************************************
+ * Summary:
+ *   Records that the controller runs the firmware of this start, called on
+ *   BTM_ENABLED_EVT
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_startup_controller_ready(void)
+{
+    if (startup_enabled)
+    {
+        startup_state.firmware = 1;
+        hfag_startup_save(&startup_state);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: hfag_startup_save_gap
+ *******************************************************************************
+ * Summary:
+ *   Keeps the visibility and pairing modes for the next start
+ *
+ * Parameters:
+ *   uint8_t discoverable : 0 or 1, HFAG_STARTUP_GAP_UNSET if unchanged
+ *   uint8_t connectable  : 0 or 1, HFAG_STARTUP_GAP_UNSET if unchanged
+ *   uint8_t pairable     : 0 or 1, HFAG_STARTUP_GAP_UNSET if unchanged
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_startup_save_gap(uint8_t discoverable, uint8_t connectable, uint8_t pairable)
+{
+    hfag_startup_state_t state;
+
+    if (!startup_enabled)
+    {
+        return;
+    }
+    memcpy(&state, &startup_state, sizeof(state));
+    if (discoverable != HFAG_STARTUP_GAP_UNSET)
+    {
+        state.discoverable = discoverable;
+    }
+    if (connectable != HFAG_STARTUP_GAP_UNSET)
+    {
+        state.connectable = connectable;
+    }
+    if (pairable != HFAG_STARTUP_GAP_UNSET)
+    {
+        state.pairable = pairable;
+    }
+    if (memcmp(&state, &startup_state, sizeof(state)) != 0)
+    {
+        memcpy(&startup_state, &state, sizeof(state));
+        hfag_startup_save(&startup_state);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: hfag_startup_saved_gap
+ *******************************************************************************
+ * Summary:
+ *   Returns the visibility and pairing modes of the previous run
+ *
+ * Parameters:
+ *   uint8_t *p_discoverable : 0 or 1, HFAG_STARTUP_GAP_UNSET if not saved
+ *   uint8_t *p_connectable  : 0 or 1, HFAG_STARTUP_GAP_UNSET if not saved
+ *   uint8_t *p_pairable     : 0 or 1, HFAG_STARTUP_GAP_UNSET if not saved
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if any mode was saved
+ *
+ ******************************************************************************/
+wiced_bool_t hfag_startup_saved_gap(uint8_t *p_discoverable, uint8_t *p_connectable, uint8_t *p_pairable)
+{
+    if (!startup_enabled)
+    {
+        return WICED_FALSE;
+    }
+    *p_discoverable = (uint8_t)startup_state.discoverable;
+    *p_connectable = (uint8_t)startup_state.connectable;
+    *p_pairable = (uint8_t)startup_state.pairable;
+    return ((*p_discoverable != HFAG_STARTUP_GAP_UNSET) || (*p_connectable != HFAG_STARTUP_GAP_UNSET) ||
+            (*p_pairable != HFAG_STARTUP_GAP_UNSET)) ? WICED_TRUE : WICED_FALSE;
+}
+
+/*******************************************************************************
+ * Function Name: hfag_startup_now_ns
+ *******************************************************************************
+ * Summary:
+ *   Returns the monotonic time in ns
+ *
+ ******************************************************************************/
+static uint64_t hfag_startup_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec;
+}
+
+/*******************************************************************************
+ * Function Name: hfag_startup_identify
+ *******************************************************************************
+ * Summary:
+ *   Fills in the host boot, the HCI UART and the identity of the patch file
+ *   of this start. A patch file that cannot be read has no identity.
+ *
+ ******************************************************************************/
+static void hfag_startup_identify(hfag_startup_state_t *p_state, const char *p_patch_file,
+                                  const char *p_device, uint32_t baud)
+{
+    struct stat st;
+    FILE *p_fp;
+
+    memset(p_state, 0, sizeof(*p_state));
+    p_fp = fopen(STARTUP_BOOT_ID_FILE, "r");
+    if (p_fp != NULL)
+    {
+        if (fgets(p_state->boot_id, sizeof(p_state->boot_id), p_fp) == NULL)
+        {
+            p_state->boot_id[0] = '\0';
+        }
+        p_state->boot_id[strcspn(p_state->boot_id, "\n")] = '\0';
+        fclose(p_fp);
+    }
+    snprintf(p_state->device, sizeof(p_state->device), "%s", p_device);
+    p_state->baud = baud;
+    if ((p_patch_file[0] != '\0') && (stat(p_patch_file, &st) == 0))
+    {
+        snprintf(p_state->patch, sizeof(p_state->patch), "%s", p_patch_file);
+        p_state->patch_size = (uint64_t)st.st_size;
+        p_state->patch_mtime_ns = (uint64_t)st.st_mtim.tv_sec * 1000000000U + (uint64_t)st.st_mtim.tv_nsec;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: hfag_startup_load
+ *******************************************************************************
+ * Summary:
+ *   Reads the state file, one "<key> <value>" line per field. Paths are the
+ *   rest of the line.
+ *
+ ******************************************************************************/
+static wiced_bool_t hfag_startup_load(hfag_startup_state_t *p_state)
+{
+    const char *p_file = hfag_config_get_str(HFAG_CONFIG_STATE_FILE, "hfag_state.conf");
+    char line[STARTUP_LINE_LEN];
+    unsigned long long size;
+    unsigned long long mtime_ns;
+    unsigned int value;
+    FILE *p_fp;
+    int pos;
+
+    memset(p_state, 0, sizeof(*p_state));
+    p_state->discoverable = HFAG_STARTUP_GAP_UNSET;
+    p_state->connectable = HFAG_STARTUP_GAP_UNSET;
+    p_state->pairable = HFAG_STARTUP_GAP_UNSET;
+    p_fp = fopen(p_file, "r");
+    if (p_fp == NULL)
+    {
+        return WICED_FALSE;
+    }
+    while (fgets(line, sizeof(line), p_fp) != NULL)
+    {
+        line[strcspn(line, "\n")] = '\0';
+        if (sscanf(line, "boot_id %39s", p_state->boot_id) == 1)
+        {
+            continue;
+        }
+        pos = 0;
+        if (strncmp(line, "device ", 7) == 0)
+        {
+            snprintf(p_state->device, sizeof(p_state->device), "%s", &line[7]);
+        }
+        else if (sscanf(line, "baud %u", &value) == 1)
+        {
+            p_state->baud = value;
+        }
+        else if ((sscanf(line, "patch %llu %llu %n", &size, &mtime_ns, &pos) == 2) && (pos > 0))
+        {
+            p_state->patch_size = size;
+            p_state->patch_mtime_ns = mtime_ns;
+            snprintf(p_state->patch, sizeof(p_state->patch), "%s", &line[pos]);
+        }
+        else if (sscanf(line, "firmware %u", &value) == 1)
+        {
+            p_state->firmware = value;
+        }
+        else if (sscanf(line, "discoverable %u", &value) == 1)
+        {
+            p_state->discoverable = MIN(value, HFAG_STARTUP_GAP_UNSET);
+        }
+        else if (sscanf(line, "connectable %u", &value) == 1)
+        {
+            p_state->connectable = MIN(value, HFAG_STARTUP_GAP_UNSET);
+        }
+        else if (sscanf(line, "pairable %u", &value) == 1)
+        {
+            p_state->pairable = MIN(value, HFAG_STARTUP_GAP_UNSET);
+        }
+    }
+    fclose(p_fp);
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: hfag_startup_save
+ *******************************************************************************
+ * Summary:
+ *   Rewrites the state file through a temporary file, so a crash leaves
+ *   either the old or the new state
+ *
+ ******************************************************************************/
+static void hfag_startup_save(const hfag_startup_state_t *p_state)
+{
+    const char *p_file = hfag_config_get_str(HFAG_CONFIG_STATE_FILE, "hfag_state.conf");
+    char tmp_file[STARTUP_PATH_LEN + 8];
+    FILE *p_out;
+
+    snprintf(tmp_file, sizeof(tmp_file), "%s.tmp", p_file);
+    p_out = fopen(tmp_file, "w");
+    if (p_out == NULL)
+    {
+        WICED_BT_TRACE("cannot write %s %d\n", tmp_file, errno);
+        return;
+    }
+    fprintf(p_out, "boot_id %s\n", p_state->boot_id);
+    fprintf(p_out, "device %s\n", p_state->device);
+    fprintf(p_out, "baud %u\n", p_state->baud);
+    fprintf(p_out, "patch %llu %llu %s\n", (unsigned long long)p_state->patch_size,
+            (unsigned long long)p_state->patch_mtime_ns, p_state->patch);
+    fprintf(p_out, "firmware %u\n", p_state->firmware);
+    fprintf(p_out, "discoverable %u\n", p_state->discoverable);
+    fprintf(p_out, "connectable %u\n", p_state->connectable);
+    fprintf(p_out, "pairable %u\n", p_state->pairable);
+    if ((fclose(p_out) != 0) || (rename(tmp_file, p_file) != 0))
+    {
+        WICED_BT_TRACE("cannot write %s %d\n", p_file, errno);
+        remove(tmp_file);
+    }
+}
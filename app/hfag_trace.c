@@ -0,0 +1,476 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/*******************************************************************************
+ * File Name: hfag_trace.c
+ *
+ * Description: This file contains the binary trace. Every thread that hits a
+ * trace point gets its own single-producer ring, so a trace point is a
+ * timestamp and a 32-byte store without locks or formatting. A background
+ * thread drains the rings every HFAG_TRACE_DRAIN_MS in timestamp order and
+ * either formats the records through WICED_BT_TRACE or appends them to
+ * HFAG_TRACE_FILE for tools/hfag_trace_decode. A ring is given back when
+ * its thread exits, so threads that are restarted with every call reuse the
+ * rings. Records that do not fit in a full ring, or of a thread that finds no
+ * free ring, are dropped and counted.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ ******************************************************************************/
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "hfag_config.h"
+#include "hfag_trace.h"
+#include "wiced_bt_trace.h"
+#include "wiced_bt_types.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define HFAG_TRACE_DRAIN_MS         (50U)
+#define HFAG_TRACE_LINE_LEN         (160U)
+
+#define TRACE_LOAD(p)               __atomic_load_n((p), __ATOMIC_RELAXED)
+#define TRACE_ADD(p, v)             __atomic_fetch_add((p), (v), __ATOMIC_RELAXED)
+#define TRACE_LOAD_ACQUIRE(p)       __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define TRACE_STORE_RELEASE(p, v)   __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define TRACE_CLAIM(p, pv, v)       __atomic_compare_exchange_n((p), (pv), (v), WICED_FALSE, \
+                                                                __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)
+
+/* Ring states */
+#define TRACE_RING_FREE             (0U)
+#define TRACE_RING_OWNED            (1U)
+#define TRACE_RING_RELEASED         (2U)    /* owner exited, free once drained */
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+/* Records of one thread. head and seq are only written by the owning
+ * thread, tail and reported_drops only by the drain thread. A ring goes
+ * back to the pool once its thread has exited and it has been drained. */
+typedef struct
+{
+    hfag_trace_record_t records[HFAG_TRACE_RING_RECORDS];
+    uint32_t head;
+    uint32_t tail;
+    uint32_t seq;
+    uint32_t drops;
+    uint32_t reported_drops;
+    uint32_t state;
+} hfag_trace_ring_t;
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static hfag_trace_ring_t trace_rings[HFAG_TRACE_MAX_THREADS];
+static __thread hfag_trace_ring_t *p_trace_ring = NULL;
+static pthread_key_t trace_ring_key;    /* releases the ring at thread exit */
+static pthread_once_t trace_ring_key_once = PTHREAD_ONCE_INIT;
+static uint32_t trace_orphan_drops = 0; /* records of threads without a ring */
+static uint32_t trace_orphan_reported = 0;
+static pthread_t trace_thread;
+static volatile wiced_bool_t trace_running = WICED_FALSE;
+static FILE *p_trace_file = NULL;
+static uint64_t trace_start_ns = 0;
+static const char *trace_formats[HFAG_TRACE_EVENT_COUNT] = { HFAG_TRACE_EVENTS(HFAG_TRACE_EVENT_FORMAT) };
+static const char trace_level_names[] = { '-', 'E', 'I', 'D' };
+
+/*******************************************************************************
+ *       FUNCTION DECLARATION
+ ******************************************************************************/
+static uint64_t hfag_trace_now_ns(clockid_t clock);
+static void hfag_trace_ring_key_create(void);
+static void hfag_trace_ring_release(void *p_ring);
+static hfag_trace_ring_t *hfag_trace_ring_claim(void);
+static void hfag_trace_report_drops(uint32_t thread, uint32_t drops);
+static void hfag_trace_output(const hfag_trace_record_t *p_record);
+static void hfag_trace_drain(void);
+static void *hfag_trace_thread(void *arg);
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: hfag_trace_now_ns
+ *******************************************************************************
+ * Summary:
+ *   Returns a clock in nanoseconds
+ *
+ ******************************************************************************/
+static uint64_t hfag_trace_now_ns(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000U) + (uint64_t)ts.tv_nsec;
+}
+
+/*******************************************************************************
+ * Function Name: hfag_trace_init
+ *******************************************************************************
+ * Summary:
+ *   Opens HFAG_TRACE_FILE, if set, and starts the thread that drains the
+ *   trace rings
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_trace_init(void)
+{
+    const char *p_file = hfag_config_get_str(HFAG_CONFIG_TRACE_FILE, NULL);
+    hfag_trace_file_header_t header;
+    int status;
+
+    if (trace_running)
+    {
+        return;
+    }
+    trace_start_ns = hfag_trace_now_ns(CLOCK_MONOTONIC);
+    if (p_file != NULL)
+    {
+        p_trace_file = fopen(p_file, "wb");
+        if (p_trace_file == NULL)
+        {
+            WICED_BT_TRACE("cannot open %s, tracing to the log\n", p_file);
+        }
+        else
+        {
+            memset(&header, 0, sizeof(header));
+            header.magic = HFAG_TRACE_MAGIC;
+            header.version = HFAG_TRACE_VERSION;
+            header.record_size = sizeof(hfag_trace_record_t);
+            header.start_ns = trace_start_ns;
+            header.start_realtime_ns = hfag_trace_now_ns(CLOCK_REALTIME);
+            fwrite(&header, sizeof(header), 1, p_trace_file);
+        }
+    }
+
+    trace_running = WICED_TRUE;
+    status = pthread_create(&trace_thread, NULL, hfag_trace_thread, NULL);
+    if (status != 0)
+    {
+        WICED_BT_TRACE("trace thread create failed %d\n", status);
+        trace_running = WICED_FALSE;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: hfag_trace_deinit
+ *******************************************************************************
+ * Summary:
+ *   Stops the drain thread, writes out the records still queued and closes
+ *   the trace file
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_trace_deinit(void)
+{
+    if (trace_running)
+    {
+        trace_running = WICED_FALSE;
+        pthread_join(trace_thread, NULL);
+    }
+    hfag_trace_drain();
+    if (p_trace_file != NULL)
+    {
+        fclose(p_trace_file);
+        p_trace_file = NULL;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: hfag_trace_ring_key_create
+ *******************************************************************************
+ * Summary:
+ *   Creates the thread key whose destructor gives a ring back
+ *
+ ******************************************************************************/
+static void hfag_trace_ring_key_create(void)
+{
+    (void)pthread_key_create(&trace_ring_key, hfag_trace_ring_release);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_trace_ring_release
+ *******************************************************************************
+ * Summary:
+ *   Called when a thread with a ring exits. The drain thread frees the ring
+ *   after it has output the last records.
+ *
+ ******************************************************************************/
+static void hfag_trace_ring_release(void *p_ring)
+{
+    TRACE_STORE_RELEASE(&((hfag_trace_ring_t *)p_ring)->state, TRACE_RING_RELEASED);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_trace_ring_claim
+ *******************************************************************************
+ * Summary:
+ *   Hands the calling thread a free ring on its first trace point. A thread
+ *   that finds all rings in use tries again on its next trace point.
+ *
+ ******************************************************************************/
+static hfag_trace_ring_t *hfag_trace_ring_claim(void)
+{
+    uint32_t expected;
+    uint32_t i;
+
+    if (p_trace_ring != NULL)
+    {
+        return p_trace_ring;
+    }
+    pthread_once(&trace_ring_key_once, hfag_trace_ring_key_create);
+    for (i = 0; i < HFAG_TRACE_MAX_THREADS; i++)
+    {
+        expected = TRACE_RING_FREE;
+        if (TRACE_CLAIM(&trace_rings[i].state, &expected, TRACE_RING_OWNED))
+        {
+            p_trace_ring = &trace_rings[i];
+            (void)pthread_setspecific(trace_ring_key, p_trace_ring);
+            break;
+        }
+    }
+    return p_trace_ring;
+}
+
+/*******************************************************************************
+ * Function Name: hfag_trace_write
+ *******************************************************************************
+ * Summary:
+ *   Stores one record in the ring of the calling thread. Called through the
+ *   HFAG_TRACE_ERROR, HFAG_TRACE_INFO and HFAG_TRACE_DEBUG macros.
+ *
+ * Parameters:
+ *   uint8_t level       : HFAG_TRACE_LEVEL_ERROR to HFAG_TRACE_LEVEL_DEBUG
+ *   uint16_t event      : hfag_trace_event_t
+ *   uint32_t a0 to a3   : arguments of the event format
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void hfag_trace_write(uint8_t level, uint16_t event, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3)
+{
+    hfag_trace_ring_t *p_ring = hfag_trace_ring_claim();
+    hfag_trace_record_t *p_record;
+    uint32_t head;
+
+    if (p_ring == NULL)
+    {
+        TRACE_ADD(&trace_orphan_drops, 1);
+        return;
+    }
+    head = p_ring->head;
+    if ((head - TRACE_LOAD_ACQUIRE(&p_ring->tail)) >= HFAG_TRACE_RING_RECORDS)
+    {
+        TRACE_ADD(&p_ring->drops, 1);
+        p_ring->seq++;
+        return;
+    }
+
+    p_record = &p_ring->records[head & (HFAG_TRACE_RING_RECORDS - 1)];
+    p_record->timestamp_ns = hfag_trace_now_ns(CLOCK_MONOTONIC);
+    p_record->event = event;
+    p_record->level = level;
+    p_record->thread = (uint8_t)(p_ring - trace_rings);
+    p_record->seq = p_ring->seq++;
+    p_record->args[0] = a0;
+    p_record->args[1] = a1;
+    p_record->args[2] = a2;
+    p_record->args[3] = a3;
+    TRACE_STORE_RELEASE(&p_ring->head, head + 1);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_trace_output
+ *******************************************************************************
+ * Summary:
+ *   Appends a record to the trace file, or formats it to the log
+ *
+ ******************************************************************************/
+static void hfag_trace_output(const hfag_trace_record_t *p_record)
+{
+    char line[HFAG_TRACE_LINE_LEN];
+    uint64_t us;
+
+    if (p_trace_file != NULL)
+    {
+        fwrite(p_record, sizeof(*p_record), 1, p_trace_file);
+        return;
+    }
+    if (p_record->event >= HFAG_TRACE_EVENT_COUNT)
+    {
+        return;
+    }
+    snprintf(line, sizeof(line), trace_formats[p_record->event],
+                        p_record->args[0], p_record->args[1], p_record->args[2], p_record->args[3]);
+    us = (p_record->timestamp_ns - trace_start_ns) / 1000U;
+    WICED_BT_TRACE("[%llu.%06llu] T%u %c %s\n", (unsigned long long)(us / 1000000U),
+                                        (unsigned long long)(us % 1000000U), p_record->thread,
+                                        trace_level_names[p_record->level & 3U], line);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_trace_drain
+ *******************************************************************************
+ * Summary:
+ *   Outputs the queued records of all rings, oldest first, and a
+ *   HFAG_TRACE_DROPPED record for every ring that lost records since the
+ *   last drain. Called from the drain thread, or once it has exited.
+ *
+ ******************************************************************************/
+static void hfag_trace_drain(void)
+{
+    hfag_trace_ring_t *p_ring;
+    hfag_trace_ring_t *p_oldest;
+    const hfag_trace_record_t *p_record;
+    uint32_t released[HFAG_TRACE_MAX_THREADS];
+    uint32_t drops;
+    uint32_t i;
+
+    /* A ring released before its last records are read is freed below */
+    for (i = 0; i < HFAG_TRACE_MAX_THREADS; i++)
+    {
+        released[i] = TRACE_LOAD_ACQUIRE(&trace_rings[i].state);
+    }
+
+    for (;;)
+    {
+        p_oldest = NULL;
+        for (i = 0; i < HFAG_TRACE_MAX_THREADS; i++)
+        {
+            p_ring = &trace_rings[i];
+            if (p_ring->tail == TRACE_LOAD_ACQUIRE(&p_ring->head))
+            {
+                continue;
+            }
+            if ((p_oldest == NULL) ||
+                (p_ring->records[p_ring->tail & (HFAG_TRACE_RING_RECORDS - 1)].timestamp_ns <
+                 p_oldest->records[p_oldest->tail & (HFAG_TRACE_RING_RECORDS - 1)].timestamp_ns))
+            {
+                p_oldest = p_ring;
+            }
+        }
+        if (p_oldest == NULL)
+        {
+            break;
+        }
+        p_record = &p_oldest->records[p_oldest->tail & (HFAG_TRACE_RING_RECORDS - 1)];
+        hfag_trace_output(p_record);
+        TRACE_STORE_RELEASE(&p_oldest->tail, p_oldest->tail + 1);
+    }
+
+    for (i = 0; i < HFAG_TRACE_MAX_THREADS; i++)
+    {
+        p_ring = &trace_rings[i];
+        drops = TRACE_LOAD(&p_ring->drops);
+        if (drops != p_ring->reported_drops)
+        {
+            hfag_trace_report_drops(i, drops - p_ring->reported_drops);
+            p_ring->reported_drops = drops;
+        }
+        if (released[i] == TRACE_RING_RELEASED)
+        {
+            TRACE_STORE_RELEASE(&p_ring->state, TRACE_RING_FREE);
+        }
+    }
+    drops = TRACE_LOAD(&trace_orphan_drops);
+    if (drops != trace_orphan_reported)
+    {
+        hfag_trace_report_drops(HFAG_TRACE_MAX_THREADS, drops - trace_orphan_reported);
+        trace_orphan_reported = drops;
+    }
+    if (p_trace_file != NULL)
+    {
+        fflush(p_trace_file);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: hfag_trace_report_drops
+ *******************************************************************************
+ * Summary:
+ *   Outputs a HFAG_TRACE_DROPPED record, thread HFAG_TRACE_MAX_THREADS
+ *   stands for the threads that found no free ring
+ *
+ ******************************************************************************/
+static void hfag_trace_report_drops(uint32_t thread, uint32_t drops)
+{
+    hfag_trace_record_t dropped;
+
+    memset(&dropped, 0, sizeof(dropped));
+    dropped.timestamp_ns = hfag_trace_now_ns(CLOCK_MONOTONIC);
+    dropped.event = HFAG_TRACE_DROPPED;
+    dropped.level = HFAG_TRACE_LEVEL_ERROR;
+    dropped.thread = (uint8_t)thread;
+    dropped.args[0] = drops;
+    dropped.args[1] = thread;
+    hfag_trace_output(&dropped);
+}
+
+/*******************************************************************************
+ * Function Name: hfag_trace_thread
+ *******************************************************************************
+ * Summary:
+ *   Drains the trace rings every HFAG_TRACE_DRAIN_MS
+ *
+ ******************************************************************************/
+static void *hfag_trace_thread(void *arg)
+{
+    struct timespec period = { 0, HFAG_TRACE_DRAIN_MS * 1000000L };
+
+    (void)arg;
+    while (trace_running)
+    {
+        hfag_trace_drain();
+        nanosleep(&period, NULL);
+    }
+    return NULL;
+}
@@ -0,0 +1,676 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/*******************************************************************************
+ * File Name: jitter_buffer.c
+ *
+ * Description: This file contains the adaptive jitter buffer for the SCO
+ * downlink. The SCO callback measures packet inter-arrival jitter while
+ * queueing into the SCO ring; the playback thread pulls fixed size blocks,
+ * keeps the queued depth close to the smallest stable target and conceals
+ * gaps and packets reported lost by the decoder by repeating the last pitch
+ * period with a fading gain.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ ******************************************************************************/
+#include <string.h>
+#include <time.h>
+
+#include "jitter_buffer.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define JB_MS_TO_SAMPLES(p_jb, ms)      ((p_jb)->sample_rate * (ms) / 1000U)
+#define JB_SAMPLES_TO_MS(p_jb, n)       ((uint32_t)((uint64_t)(n) * 1000U / (p_jb)->sample_rate))
+
+#define JB_INITIAL_DEPTH_MS             (20U)
+#define JB_MIN_DEPTH_MS                 (5U)
+#define JB_MAX_DEPTH_MS                 (120U)
+#define JB_GROW_STEP_MS                 (5U)    /* added on every underrun */
+#define JB_SHRINK_STEP_MS               (2U)    /* removed after a stable period */
+#define JB_STABLE_PERIOD_MS             (4000U)
+#define JB_JITTER_FACTOR                (2U)    /* depth floor = factor * jitter */
+#define JB_ARRIVAL_MAX_PACKETS          (2U)    /* bound of since_arrival, packets come in pairs over HCI */
+
+#define JB_PLC_FULL_GAIN_MS             (10U)   /* concealment at full level */
+#define JB_PLC_MAX_MS                   (60U)   /* then faded out to silence */
+#define JB_PLC_MIN_PITCH_US             (2500U)
+#define JB_PLC_MAX_PITCH_US             (15000U)
+#define JB_PLC_CORR_MS                  (10U)
+#define JB_XFADE_MS                     (2U)    /* concealment to audio cross-fade */
+
+#define JB_LOAD(p)                      __atomic_load_n((p), __ATOMIC_RELAXED)
+#define JB_STORE(p, v)                  __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define JB_LOAD_ACQUIRE(p)              __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define JB_STORE_RELEASE(p, v)          __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+#ifndef MIN
+#define MIN(a, b)                       (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b)                       (((a) > (b)) ? (a) : (b))
+#endif
+
+/*******************************************************************************
+ *       FUNCTION DECLARATION
+ ******************************************************************************/
+static uint64_t jb_now_us(void);
+static void jb_arrival(jitter_buffer_t *p_jb, uint16_t len);
+static wiced_bool_t jb_next_loss(jitter_buffer_t *p_jb, uint32_t *p_offset, uint32_t *p_len);
+static void jb_history_add(jitter_buffer_t *p_jb, const int16_t *p_pcm, uint32_t num_samples);
+static uint32_t jb_find_pitch(jitter_buffer_t *p_jb);
+static void jb_conceal(jitter_buffer_t *p_jb, int16_t *p_pcm, uint32_t num_samples);
+static uint32_t jb_read(jitter_buffer_t *p_jb, int16_t *p_pcm, uint32_t num_samples, uint32_t max_samples);
+static void jb_play(jitter_buffer_t *p_jb, int16_t *p_pcm, uint32_t num_samples);
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: jb_now_us
+ *******************************************************************************
+ * Summary:
+ *   Returns CLOCK_MONOTONIC in microseconds
+ *
+ ******************************************************************************/
+static uint64_t jb_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000U) + ((uint64_t)ts.tv_nsec / 1000U);
+}
+
+/*******************************************************************************
+ * Function Name: jitter_buffer_init
+ *******************************************************************************
+ * Summary:
+ *   Initializes the jitter buffer on top of an empty SCO ring. Must be called
+ *   while neither the producer nor the consumer is active.
+ *
+ * Parameters:
+ *   jitter_buffer_t *p_jb  : jitter buffer
+ *   audio_ring_t *p_ring   : ring holding the queued PCM
+ *   uint32_t sample_rate   : 8000 or 16000
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void jitter_buffer_init(jitter_buffer_t *p_jb, audio_ring_t *p_ring, uint32_t sample_rate)
+{
+    memset(p_jb, 0, sizeof(*p_jb));
+    p_jb->p_ring = p_ring;
+    p_jb->sample_rate = MIN(sample_rate, JB_MAX_SAMPLE_RATE);
+    p_jb->state = JB_STATE_BUFFERING;
+    p_jb->min_depth = JB_MS_TO_SAMPLES(p_jb, JB_MIN_DEPTH_MS);
+    p_jb->max_depth = MIN(JB_MS_TO_SAMPLES(p_jb, JB_MAX_DEPTH_MS), p_ring->size / sizeof(int16_t));
+    p_jb->target = MIN(JB_MS_TO_SAMPLES(p_jb, JB_INITIAL_DEPTH_MS), p_jb->max_depth);
+    p_jb->grow_step = JB_MS_TO_SAMPLES(p_jb, JB_GROW_STEP_MS);
+    p_jb->shrink_step = JB_MS_TO_SAMPLES(p_jb, JB_SHRINK_STEP_MS);
+    p_jb->stable_period = JB_MS_TO_SAMPLES(p_jb, JB_STABLE_PERIOD_MS);
+}
+
+/*******************************************************************************
+ * Function Name: jb_arrival
+ *******************************************************************************
+ * Summary:
+ *   Producer side. Updates the arrival statistics for a packet of len bytes
+ *
+ ******************************************************************************/
+static void jb_arrival(jitter_buffer_t *p_jb, uint16_t len)
+{
+    uint64_t now = jb_now_us();
+    uint32_t target_us;
+    int64_t nominal_us;
+    int64_t deviation_us;
+    uint32_t jitter_us;
+
+    if (p_jb->last_arrival_us != 0)
+    {
+        /* Deviation of the arrival interval from the duration of the previous
+         * packet. Positive means the packet is late */
+        nominal_us = (int64_t)p_jb->last_len * 1000000 / (int64_t)(p_jb->sample_rate * sizeof(int16_t));
+        deviation_us = (int64_t)(now - p_jb->last_arrival_us) - nominal_us;
+
+        jitter_us = p_jb->jitter_us;
+        jitter_us = (uint32_t)((int64_t)jitter_us +
+                        (((deviation_us < 0 ? -deviation_us : deviation_us) - (int64_t)jitter_us) / 16));
+        JB_STORE(&p_jb->jitter_us, jitter_us);
+
+        target_us = JB_SAMPLES_TO_MS(p_jb, JB_LOAD(&p_jb->target)) * 1000U;
+        if (deviation_us > (int64_t)target_us)
+        {
+            JB_STORE(&p_jb->late_packets, p_jb->late_packets + 1);
+        }
+    }
+    JB_STORE(&p_jb->last_arrival_us, now);
+    JB_STORE(&p_jb->last_len, len);
+    JB_STORE(&p_jb->packets, p_jb->packets + 1);
+}
+
+/*******************************************************************************
+ * Function Name: jitter_buffer_put
+ *******************************************************************************
+ * Summary:
+ *   Producer side, called from the SCO callback. Updates the arrival
+ *   statistics and queues the packet. Never blocks.
+ *
+ * Parameters:
+ *   jitter_buffer_t *p_jb  : jitter buffer
+ *   const uint8_t *p_data  : SCO PCM payload
+ *   uint16_t len           : length of p_data
+ *
+ * Return:
+ *   uint32_t : number of bytes queued
+ *
+ ******************************************************************************/
+uint32_t jitter_buffer_put(jitter_buffer_t *p_jb, const uint8_t *p_data, uint16_t len)
+{
+    jb_arrival(p_jb, len);
+
+    return audio_ring_write(p_jb->p_ring, p_data, len);
+}
+
+/*******************************************************************************
+ * Function Name: jitter_buffer_put_lost
+ *******************************************************************************
+ * Summary:
+ *   Producer side. Queues len bytes of placeholder audio for a packet the
+ *   decoder could not recover, so that the playout timing is kept. The
+ *   consumer replaces the placeholder with concealment. The marker is
+ *   published before the audio so the consumer can never play it.
+ *
+ * Parameters:
+ *   jitter_buffer_t *p_jb  : jitter buffer
+ *   uint16_t len           : length of the lost PCM, up to JB_MAX_LOST_LEN
+ *
+ * Return:
+ *   uint32_t : number of bytes queued
+ *
+ ******************************************************************************/
+uint32_t jitter_buffer_put_lost(jitter_buffer_t *p_jb, uint16_t len)
+{
+    static const uint8_t silence[JB_MAX_LOST_LEN];
+    audio_ring_t *p_ring = p_jb->p_ring;
+    uint32_t loss_tail = JB_LOAD_ACQUIRE(&p_jb->loss_tail);
+    uint32_t slot;
+
+    len = MIN(len, sizeof(silence)) & ~1U;
+    jb_arrival(p_jb, len);
+    JB_STORE(&p_jb->lost_packets, p_jb->lost_packets + 1);
+
+    /* Only the consumer frees space, so the write below cannot fail once
+     * there is room. Without a free marker the silence is played as is */
+    if ((len <= (p_ring->size - audio_ring_fill(p_ring))) &&
+        ((p_jb->loss_head - loss_tail) < JB_MAX_LOSSES))
+    {
+        slot = p_jb->loss_head % JB_MAX_LOSSES;
+        p_jb->loss_start[slot] = p_ring->head;
+        p_jb->loss_len[slot] = len;
+        JB_STORE_RELEASE(&p_jb->loss_head, p_jb->loss_head + 1);
+    }
+
+    return audio_ring_write(p_ring, silence, len);
+}
+
+/*******************************************************************************
+ * Function Name: jb_history_add
+ *******************************************************************************
+ * Summary:
+ *   Appends played samples to the concealment history
+ *
+ ******************************************************************************/
+static void jb_history_add(jitter_buffer_t *p_jb, const int16_t *p_pcm, uint32_t num_samples)
+{
+    uint32_t size = JB_MS_TO_SAMPLES(p_jb, JB_HISTORY_MS);
+    uint32_t keep;
+
+    if (num_samples >= size)
+    {
+        memcpy(p_jb->history, &p_pcm[num_samples - size], size * sizeof(int16_t));
+        p_jb->history_len = size;
+        return;
+    }
+    keep = MIN(p_jb->history_len, size - num_samples);
+    memmove(p_jb->history, &p_jb->history[p_jb->history_len - keep], keep * sizeof(int16_t));
+    memcpy(&p_jb->history[keep], p_pcm, num_samples * sizeof(int16_t));
+    p_jb->history_len = keep + num_samples;
+}
+
+/*******************************************************************************
+ * Function Name: jb_find_pitch
+ *******************************************************************************
+ * Summary:
+ *   Estimates the pitch period of the history by maximizing the normalized
+ *   cross-correlation of the most recent JB_PLC_CORR_MS with older audio.
+ *
+ * Return:
+ *   uint32_t : pitch period in samples, 0 if there is not enough history
+ *
+ ******************************************************************************/
+static uint32_t jb_find_pitch(jitter_buffer_t *p_jb)
+{
+    uint32_t min_lag = p_jb->sample_rate * JB_PLC_MIN_PITCH_US / 1000000U;
+    uint32_t max_lag = p_jb->sample_rate * JB_PLC_MAX_PITCH_US / 1000000U;
+    uint32_t corr_len = JB_MS_TO_SAMPLES(p_jb, JB_PLC_CORR_MS);
+    const int16_t *p_ref;
+    uint32_t best_lag = 0;
+    int64_t best_num = 0;
+    int64_t best_den = 1;
+    uint32_t lag;
+    uint32_t i;
+
+    if (p_jb->history_len < (corr_len + max_lag))
+    {
+        return 0;
+    }
+    p_ref = &p_jb->history[p_jb->history_len - corr_len];
+
+    for (lag = min_lag; lag <= max_lag; lag++)
+    {
+        const int16_t *p_cand = p_ref - lag;
+        int64_t num = 0;
+        int64_t den = 1;
+
+        for (i = 0; i < corr_len; i++)
+        {
+            num += (int32_t)p_ref[i] * p_cand[i];
+            den += (int32_t)p_cand[i] * p_cand[i];
+        }
+        /* compare num / sqrt(den) without the square root */
+        if ((num > 0) &&
+            ((double)num * num * best_den > (double)best_num * best_num * den))
+        {
+            best_num = num;
+            best_den = den;
+            best_lag = lag;
+        }
+    }
+
+    /* Unvoiced or silent audio: repeat the longest period to avoid buzz */
+    return (best_lag != 0) ? best_lag : max_lag;
+}
+
+/*******************************************************************************
+ * Function Name: jb_conceal
+ *******************************************************************************
+ * Summary:
+ *   Synthesizes concealment audio by repeating the last pitch period of the
+ *   history. The level is held for JB_PLC_FULL_GAIN_MS and then faded out
+ *   linearly, reaching silence after JB_PLC_MAX_MS.
+ *
+ ******************************************************************************/
+static void jb_conceal(jitter_buffer_t *p_jb, int16_t *p_pcm, uint32_t num_samples)
+{
+    uint32_t full = JB_MS_TO_SAMPLES(p_jb, JB_PLC_FULL_GAIN_MS);
+    uint32_t max = JB_MS_TO_SAMPLES(p_jb, JB_PLC_MAX_MS);
+    const int16_t *p_period;
+    uint32_t i;
+
+    if (!p_jb->concealing)
+    {
+        p_jb->concealing = WICED_TRUE;
+        p_jb->plc_run = 0;
+        p_jb->pitch = jb_find_pitch(p_jb);
+    }
+
+    if (p_jb->pitch == 0)
+    {
+        memset(p_pcm, 0, num_samples * sizeof(int16_t));
+        p_jb->plc_run += num_samples;
+    }
+    else
+    {
+        p_period = &p_jb->history[p_jb->history_len - p_jb->pitch];
+        for (i = 0; i < num_samples; i++, p_jb->plc_run++)
+        {
+            int32_t sample = p_period[p_jb->plc_run % p_jb->pitch];
+
+            if (p_jb->plc_run >= max)
+            {
+                sample = 0;
+            }
+            else if (p_jb->plc_run > full)
+            {
+                sample = sample * (int32_t)(max - p_jb->plc_run) / (int32_t)(max - full);
+            }
+            p_pcm[i] = (int16_t)sample;
+        }
+    }
+    p_jb->concealed_samples += num_samples;
+}
+
+/*******************************************************************************
+ * Function Name: jb_next_loss
+ *******************************************************************************
+ * Summary:
+ *   Consumer side. Retires the loss markers already played and looks up the
+ *   next one.
+ *
+ * Return:
+ *   wiced_bool_t : WICED_TRUE if a lost span is queued, p_offset is set to
+ *                  the samples before it and p_len to its remaining length
+ *
+ ******************************************************************************/
+static wiced_bool_t jb_next_loss(jitter_buffer_t *p_jb, uint32_t *p_offset, uint32_t *p_len)
+{
+    uint32_t tail = p_jb->p_ring->tail;
+    uint32_t loss_head = JB_LOAD_ACQUIRE(&p_jb->loss_head);
+    uint32_t slot;
+    int32_t ahead;
+    int32_t left;
+
+    while (p_jb->loss_tail != loss_head)
+    {
+        slot = p_jb->loss_tail % JB_MAX_LOSSES;
+        ahead = (int32_t)(p_jb->loss_start[slot] - tail);
+        left = ahead + (int32_t)p_jb->loss_len[slot];
+        if (left > 0)
+        {
+            *p_offset = (ahead > 0) ? ((uint32_t)ahead / sizeof(int16_t)) : 0;
+            *p_len = (uint32_t)(left - MAX(ahead, 0)) / sizeof(int16_t);
+            return WICED_TRUE;
+        }
+        JB_STORE_RELEASE(&p_jb->loss_tail, p_jb->loss_tail + 1);
+    }
+    return WICED_FALSE;
+}
+
+/*******************************************************************************
+ * Function Name: jb_read
+ *******************************************************************************
+ * Summary:
+ *   Reads num_samples of received audio. If the queued depth exceeds the
+ *   target, up to 1/8th more samples are consumed and compressed into the
+ *   block with a linear cross-fade. When the caller controls the rate this
+ *   only happens beyond one more packet of excess. Never consumes more than
+ *   max_samples.
+ *
+ * Return:
+ *   uint32_t : number of samples consumed from the ring
+ *
+ ******************************************************************************/
+static uint32_t jb_read(jitter_buffer_t *p_jb, int16_t *p_pcm, uint32_t num_samples, uint32_t max_samples)
+{
+    int16_t in[JB_MAX_CHUNK_SAMPLES + (JB_MAX_CHUNK_SAMPLES / 8)];
+    uint32_t fill = audio_ring_fill(p_jb->p_ring) / sizeof(int16_t);
+    uint32_t limit = num_samples + p_jb->target + p_jb->shrink_step;
+    uint32_t drop = 0;
+    uint32_t k;
+
+    if (p_jb->rate_controlled)
+    {
+        limit += JB_LOAD(&p_jb->last_len) / sizeof(int16_t);
+    }
+    if (fill > limit)
+    {
+        drop = MIN(fill - num_samples - p_jb->target, num_samples / 8);
+        drop = MIN(drop, max_samples - num_samples);
+    }
+
+    audio_ring_read(p_jb->p_ring, (uint8_t *)in, (num_samples + drop) * sizeof(int16_t));
+
+    if (drop == 0)
+    {
+        memcpy(p_pcm, in, num_samples * sizeof(int16_t));
+    }
+    else
+    {
+        for (k = 0; k < num_samples; k++)
+        {
+            p_pcm[k] = (int16_t)(((int32_t)in[k] * (int32_t)(num_samples - k) +
+                                  (int32_t)in[k + drop] * (int32_t)k) / (int32_t)num_samples);
+        }
+        p_jb->dropped_samples += drop;
+    }
+    return num_samples + drop;
+}
+
+/*******************************************************************************
+ * Function Name: jb_play
+ *******************************************************************************
+ * Summary:
+ *   Cross-fades received audio in from a preceding concealment and appends
+ *   it to the concealment history
+ *
+ ******************************************************************************/
+static void jb_play(jitter_buffer_t *p_jb, int16_t *p_pcm, uint32_t num_samples)
+{
+    if (p_jb->concealing)
+    {
+        int16_t plc[JB_MAX_CHUNK_SAMPLES];
+        uint32_t xfade = MIN(JB_MS_TO_SAMPLES(p_jb, JB_XFADE_MS), num_samples);
+        uint32_t k;
+
+        jb_conceal(p_jb, plc, xfade);
+        p_jb->concealed_samples -= xfade;
+        for (k = 0; k < xfade; k++)
+        {
+            p_pcm[k] = (int16_t)(((int32_t)plc[k] * (int32_t)(xfade - k) +
+                                  (int32_t)p_pcm[k] * (int32_t)k) / (int32_t)xfade);
+        }
+        p_jb->concealing = WICED_FALSE;
+    }
+    jb_history_add(p_jb, p_pcm, num_samples);
+}
+
+/*******************************************************************************
+ * Function Name: jitter_buffer_get
+ *******************************************************************************
+ * Summary:
+ *   Consumer side, called from the playback thread. Always produces
+ *   num_samples of audio: received PCM when enough is queued, concealment
+ *   otherwise. The target depth grows on every underrun, is never below
+ *   one packet plus JB_JITTER_FACTOR times the measured jitter, and shrinks
+ *   after JB_STABLE_PERIOD_MS without underruns. Spans queued by
+ *   jitter_buffer_put_lost are concealed in place.
+ *
+ * Parameters:
+ *   jitter_buffer_t *p_jb  : jitter buffer
+ *   int16_t *p_pcm         : output buffer
+ *   uint32_t num_samples   : samples to produce, up to JB_MAX_CHUNK_SAMPLES
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void jitter_buffer_get(jitter_buffer_t *p_jb, int16_t *p_pcm, uint32_t num_samples)
+{
+    uint32_t floor;
+    uint32_t fill;
+    uint32_t got;
+    uint32_t done;
+    uint32_t offset;
+    uint32_t lost;
+    uint32_t n;
+
+    num_samples = MIN(num_samples, JB_MAX_CHUNK_SAMPLES);
+
+    floor = MAX(p_jb->min_depth,
+                JB_JITTER_FACTOR * (uint32_t)((uint64_t)JB_LOAD(&p_jb->jitter_us) * p_jb->sample_rate / 1000000U));
+    floor += JB_LOAD(&p_jb->last_len) / sizeof(int16_t);
+    floor = MIN(floor, p_jb->max_depth);
+    if (p_jb->target < floor)
+    {
+        JB_STORE(&p_jb->target, floor);
+    }
+
+    fill = audio_ring_fill(p_jb->p_ring) / sizeof(int16_t);
+
+    if (p_jb->state == JB_STATE_BUFFERING)
+    {
+        if (fill < (p_jb->target + num_samples))
+        {
+            jb_conceal(p_jb, p_pcm, num_samples);
+            return;
+        }
+        p_jb->state = JB_STATE_PLAYING;
+    }
+
+    if (fill < num_samples)
+    {
+        /* Underrun: play what is left, conceal the rest and re-buffer */
+        got = audio_ring_read(p_jb->p_ring, (uint8_t *)p_pcm, fill * sizeof(int16_t)) / sizeof(int16_t);
+        jb_history_add(p_jb, p_pcm, got);
+        jb_conceal(p_jb, &p_pcm[got], num_samples - got);
+
+        p_jb->underruns++;
+        p_jb->stable_samples = 0;
+        p_jb->state = JB_STATE_BUFFERING;
+        JB_STORE(&p_jb->target, MIN(p_jb->target + p_jb->grow_step, p_jb->max_depth));
+        return;
+    }
+
+    for (done = 0; done < num_samples; done += n)
+    {
+        n = num_samples - done;
+        if (!jb_next_loss(p_jb, &offset, &lost))
+        {
+            offset = UINT32_MAX;
+        }
+
+        if (offset == 0)
+        {
+            n = MIN(n, lost);
+            audio_ring_skip(p_jb->p_ring, n * sizeof(int16_t));
+            jb_conceal(p_jb, &p_pcm[done], n);
+        }
+        else
+        {
+            n = MIN(n, offset);
+            jb_read(p_jb, &p_pcm[done], n, offset);
+            jb_play(p_jb, &p_pcm[done], n);
+        }
+    }
+
+    p_jb->stable_samples += num_samples;
+    if (p_jb->stable_samples >= p_jb->stable_period)
+    {
+        p_jb->stable_samples = 0;
+        if (p_jb->target > (floor + p_jb->shrink_step))
+        {
+            JB_STORE(&p_jb->target, p_jb->target - p_jb->shrink_step);
+        }
+    }
+}
+
+/*******************************************************************************
+ * Function Name: jitter_buffer_set_rate_controlled
+ *******************************************************************************
+ * Summary:
+ *   Consumer side. Tells the jitter buffer that the caller adjusts the
+ *   consumption rate to hold the depth at the target, so excess audio is
+ *   only dropped as a last resort.
+ *
+ * Parameters:
+ *   jitter_buffer_t *p_jb         : jitter buffer
+ *   wiced_bool_t rate_controlled  : WICED_TRUE while the caller holds the depth
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void jitter_buffer_set_rate_controlled(jitter_buffer_t *p_jb, wiced_bool_t rate_controlled)
+{
+    p_jb->rate_controlled = rate_controlled;
+}
+
+/*******************************************************************************
+ * Function Name: jitter_buffer_get_level
+ *******************************************************************************
+ * Summary:
+ *   Consumer side, takes a snapshot of the queued depth. since_arrival is
+ *   the audio played out since the last packet arrived, bounded by two
+ *   packet lengths since HCI transports often deliver SCO packets in pairs.
+ *   fill + since_arrival removes the arrival saw-tooth, a gap longer than
+ *   the bound shows as a lower depth.
+ *
+ * Parameters:
+ *   jitter_buffer_t *p_jb          : jitter buffer
+ *   jitter_buffer_level_t *p_level : filled with the current depth
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void jitter_buffer_get_level(jitter_buffer_t *p_jb, jitter_buffer_level_t *p_level)
+{
+    uint64_t arrival_us = JB_LOAD(&p_jb->last_arrival_us);
+    uint32_t packet = JB_LOAD(&p_jb->last_len) / sizeof(int16_t);
+    uint64_t elapsed_us = (arrival_us != 0) ? (jb_now_us() - arrival_us) : 0;
+
+    p_level->fill = audio_ring_fill(p_jb->p_ring) / sizeof(int16_t);
+    p_level->target = p_jb->target;
+    p_level->hysteresis = p_jb->shrink_step;
+    p_level->since_arrival = MIN((uint32_t)(elapsed_us * p_jb->sample_rate / 1000000U), JB_ARRIVAL_MAX_PACKETS * packet);
+    p_level->playing = (p_jb->state == JB_STATE_PLAYING) ? WICED_TRUE : WICED_FALSE;
+}
+
+/*******************************************************************************
+ * Function Name: jitter_buffer_get_stats
+ *******************************************************************************
+ * Summary:
+ *   Takes a snapshot of the jitter buffer statistics
+ *
+ * Parameters:
+ *   jitter_buffer_t *p_jb          : jitter buffer
+ *   jitter_buffer_stats_t *p_stats : filled with the current statistics
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void jitter_buffer_get_stats(jitter_buffer_t *p_jb, jitter_buffer_stats_t *p_stats)
+{
+    if (p_jb->sample_rate == 0)
+    {
+        memset(p_stats, 0, sizeof(*p_stats));
+        return;
+    }
+    p_stats->depth_ms = JB_SAMPLES_TO_MS(p_jb, audio_ring_fill(p_jb->p_ring) / sizeof(int16_t));
+    p_stats->target_ms = JB_SAMPLES_TO_MS(p_jb, JB_LOAD(&p_jb->target));
+    p_stats->jitter_us = JB_LOAD(&p_jb->jitter_us);
+    p_stats->packets = JB_LOAD(&p_jb->packets);
+    p_stats->late_packets = JB_LOAD(&p_jb->late_packets);
+    p_stats->lost_packets = JB_LOAD(&p_jb->lost_packets);
+    p_stats->underruns = JB_LOAD(&p_jb->underruns);
+    p_stats->concealed_ms = JB_SAMPLES_TO_MS(p_jb, JB_LOAD(&p_jb->concealed_samples));
+    p_stats->dropped_ms = JB_SAMPLES_TO_MS(p_jb, JB_LOAD(&p_jb->dropped_samples));
+}
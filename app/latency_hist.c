@@ -0,0 +1,308 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/*******************************************************************************
+ * File Name: latency_hist.c
+ *
+ * Description: This file contains the log-linear latency histograms used to
+ * break the audio latency down per stage. Recording is a bucket lookup and
+ * a few relaxed atomic updates so it can be done from the audio threads.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ ******************************************************************************/
+#include <string.h>
+
+#include "latency_hist.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define LATENCY_SUB_COUNT           (1U << LATENCY_HIST_SUB_BITS)
+
+#define LATENCY_LOAD(p)             __atomic_load_n((p), __ATOMIC_RELAXED)
+#define LATENCY_ADD(p, v)           __atomic_fetch_add((p), (v), __ATOMIC_RELAXED)
+#define LATENCY_LOAD_ACQUIRE(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define LATENCY_STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+/*******************************************************************************
+ *       FUNCTION DECLARATION
+ ******************************************************************************/
+static uint32_t latency_bucket(uint32_t value);
+static uint32_t latency_bucket_max(uint32_t bucket);
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: latency_bucket
+ *******************************************************************************
+ * Summary:
+ *   Maps a value to its bucket: values below LATENCY_SUB_COUNT are exact,
+ *   above that the power of two selects the group and the next
+ *   LATENCY_HIST_SUB_BITS bits the bucket within it
+ *
+ ******************************************************************************/
+static uint32_t latency_bucket(uint32_t value)
+{
+    uint32_t exponent;
+
+    if (value < LATENCY_SUB_COUNT)
+    {
+        return value;
+    }
+    exponent = 31U - (uint32_t)__builtin_clz(value);
+    return ((exponent - LATENCY_HIST_SUB_BITS + 1U) << LATENCY_HIST_SUB_BITS) +
+           ((value >> (exponent - LATENCY_HIST_SUB_BITS)) & (LATENCY_SUB_COUNT - 1U));
+}
+
+/*******************************************************************************
+ * Function Name: latency_bucket_max
+ *******************************************************************************
+ * Summary:
+ *   Returns the largest value that falls into a bucket
+ *
+ ******************************************************************************/
+static uint32_t latency_bucket_max(uint32_t bucket)
+{
+    uint32_t shift;
+    uint64_t low;
+
+    if (bucket < LATENCY_SUB_COUNT)
+    {
+        return bucket;
+    }
+    shift = (bucket >> LATENCY_HIST_SUB_BITS) - 1U;
+    low = (uint64_t)(LATENCY_SUB_COUNT + (bucket & (LATENCY_SUB_COUNT - 1U))) << shift;
+    return (uint32_t)(low + (1ULL << shift) - 1U);
+}
+
+/*******************************************************************************
+ * Function Name: latency_hist_reset
+ *******************************************************************************
+ * Summary:
+ *   Clears the histogram. Must not race with latency_hist_record.
+ *
+ * Parameters:
+ *   latency_hist_t *p_hist : histogram
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void latency_hist_reset(latency_hist_t *p_hist)
+{
+    memset(p_hist, 0, sizeof(*p_hist));
+}
+
+/*******************************************************************************
+ * Function Name: latency_hist_record
+ *******************************************************************************
+ * Summary:
+ *   Adds one latency value
+ *
+ * Parameters:
+ *   latency_hist_t *p_hist : histogram
+ *   uint64_t value_us      : latency in microseconds, saturated to 32 bits
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void latency_hist_record(latency_hist_t *p_hist, uint64_t value_us)
+{
+    uint32_t value = (value_us > UINT32_MAX) ? UINT32_MAX : (uint32_t)value_us;
+    uint32_t max = LATENCY_LOAD(&p_hist->max_us);
+
+    LATENCY_ADD(&p_hist->counts[latency_bucket(value)], 1U);
+    LATENCY_ADD(&p_hist->sum_us, (uint64_t)value);
+    LATENCY_ADD(&p_hist->samples, 1U);
+    while ((value > max) &&
+           !__atomic_compare_exchange_n(&p_hist->max_us, &max, value, WICED_TRUE,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+}
+
+/*******************************************************************************
+ * Function Name: latency_hist_summarize
+ *******************************************************************************
+ * Summary:
+ *   Computes the median, the 99th percentile, the maximum and the mean. The
+ *   percentiles are the upper bound of their bucket.
+ *
+ * Parameters:
+ *   latency_hist_t *p_hist         : histogram
+ *   latency_summary_t *p_summary   : filled with the summary
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void latency_hist_summarize(latency_hist_t *p_hist, latency_summary_t *p_summary)
+{
+    uint32_t counts[LATENCY_HIST_BUCKETS];
+    uint64_t total = 0;
+    uint64_t seen = 0;
+    uint64_t p50_rank;
+    uint64_t p99_rank;
+    uint32_t b;
+
+    memset(p_summary, 0, sizeof(*p_summary));
+    for (b = 0; b < LATENCY_HIST_BUCKETS; b++)
+    {
+        counts[b] = LATENCY_LOAD(&p_hist->counts[b]);
+        total += counts[b];
+    }
+    if (total == 0)
+    {
+        return;
+    }
+    p_summary->samples = (uint32_t)total;
+    p_summary->max_us = LATENCY_LOAD(&p_hist->max_us);
+    p_summary->mean_us = (uint32_t)(LATENCY_LOAD(&p_hist->sum_us) / total);
+
+    p50_rank = (total + 1U) / 2U;
+    p99_rank = total - (total / 100U);
+    for (b = 0; b < LATENCY_HIST_BUCKETS; b++)
+    {
+        seen += counts[b];
+        if ((p_summary->p50_us == 0) && (seen >= p50_rank))
+        {
+            p_summary->p50_us = latency_bucket_max(b);
+        }
+        if (seen >= p99_rank)
+        {
+            p_summary->p99_us = latency_bucket_max(b);
+            break;
+        }
+    }
+    if (p_summary->p50_us > p_summary->max_us)
+    {
+        p_summary->p50_us = p_summary->max_us;
+    }
+    if (p_summary->p99_us > p_summary->max_us)
+    {
+        p_summary->p99_us = p_summary->max_us;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: latency_stamps_reset
+ *******************************************************************************
+ * Summary:
+ *   Empties the timestamp queue. Must not race with the producer or consumer.
+ *
+ * Parameters:
+ *   latency_stamps_t *p_stamps : timestamp queue
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void latency_stamps_reset(latency_stamps_t *p_stamps)
+{
+    memset(p_stamps, 0, sizeof(*p_stamps));
+}
+
+/*******************************************************************************
+ * Function Name: latency_stamps_push
+ *******************************************************************************
+ * Summary:
+ *   Producer side. Records the timestamps of a queued packet.
+ *
+ * Parameters:
+ *   latency_stamps_t *p_stamps : timestamp queue
+ *   uint32_t pos               : ring byte offset just after the packet
+ *   uint64_t rx_ns             : arrival time
+ *   uint64_t queued_ns         : time the packet was queued
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the queue is full
+ *
+ ******************************************************************************/
+wiced_bool_t latency_stamps_push(latency_stamps_t *p_stamps, uint32_t pos, uint64_t rx_ns, uint64_t queued_ns)
+{
+    uint32_t slot;
+
+    if ((p_stamps->head - LATENCY_LOAD_ACQUIRE(&p_stamps->tail)) >= LATENCY_STAMPS)
+    {
+        LATENCY_ADD(&p_stamps->skipped, 1U);
+        return WICED_FALSE;
+    }
+    slot = p_stamps->head % LATENCY_STAMPS;
+    p_stamps->pos[slot] = pos;
+    p_stamps->rx_ns[slot] = rx_ns;
+    p_stamps->queued_ns[slot] = queued_ns;
+    LATENCY_STORE_RELEASE(&p_stamps->head, p_stamps->head + 1U);
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: latency_stamps_pop
+ *******************************************************************************
+ * Summary:
+ *   Consumer side. Takes the oldest packet if it has been read completely.
+ *
+ * Parameters:
+ *   latency_stamps_t *p_stamps : timestamp queue
+ *   uint32_t done_pos          : ring byte offset read so far
+ *   uint64_t *p_rx_ns          : arrival time of the packet
+ *   uint64_t *p_queued_ns      : time the packet was queued
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if no tracked packet has been read completely
+ *
+ ******************************************************************************/
+wiced_bool_t latency_stamps_pop(latency_stamps_t *p_stamps, uint32_t done_pos, uint64_t *p_rx_ns, uint64_t *p_queued_ns)
+{
+    uint32_t slot;
+
+    if (p_stamps->tail == LATENCY_LOAD_ACQUIRE(&p_stamps->head))
+    {
+        return WICED_FALSE;
+    }
+    slot = p_stamps->tail % LATENCY_STAMPS;
+    if ((int32_t)(done_pos - p_stamps->pos[slot]) < 0)
+    {
+        return WICED_FALSE;
+    }
+    *p_rx_ns = p_stamps->rx_ns[slot];
+    *p_queued_ns = p_stamps->queued_ns[slot];
+    LATENCY_STORE_RELEASE(&p_stamps->tail, p_stamps->tail + 1U);
+    return WICED_TRUE;
+}
@@ -48,7 +48,6 @@
 #include <fcntl.h>
 #include <errno.h>
 
-#include <ctype.h> 
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -63,25 +62,16 @@
 #include "utils_arg_parser.h"
 #include "wiced_bt_cfg.h"
 #include "hfag.h"
+#include "hfag_cmdq.h"
+#include "audio_platform_common.h"
+#include "hfag_console.h"
+#include "hfag_startup.h"
+#include "hfag_trace.h"
 
 /*******************************************************************************
  *                               MACROS
  ******************************************************************************/
 #define MAX_PATH                            (256U)
-#define BDA_LEN                             (6U)
-
-/*USER INPUT COMMANDS*/
-#define EXIT                                (0U)
-#define PRINT_MENU                          (1U)
-#define SET_VISIBILITY                      (2U)
-#define SET_PAIRING_MODE                    (3U)
-#define SET_INQUIRY                         (4U)
-#define HFAG_CONNECT                        (5U)
-#define HFAG_DISCONNECT                     (6U)
-#define HFAG_AUDIO_CONNECT                  (7U)
-#define HFAG_AUDIO_DISCONNECT               (8U)
-#define HFAG_PRINT_CONNECTION_DETAILS       (9U)
-#define HFAG_SEND_AG_COMMAND                (10U)
 
 #define DEV_NAME "/dev/gpiochip5"
 /******************************************************************************
@@ -91,22 +81,6 @@
 static char g_app_name[MAX_PATH];
 extern wiced_bt_device_address_t bt_device_address;
 
-static const char app_menu[] = "\n\
----------------------HFAG MENU-----------------------\n\n\
-    0.  Exit \n\
-    1.  Print Menu \n\
-    2.  Set Visibility \n\
-    3.  Set Pairing Mode\n\
-    4.  Set Inquiry \n\
-    5.  HFAG Connect \n\
-    6.  HFAG Disconnect \n\
-    7.  Audio Connect \n\
-    8.  Audio Disconnect \n\
-    9.  Print HFAG Connection Details\n\
-    10. Send AG cmd str\n\
-Choose option -> ";
-
-
 /****************************************************************************
  *                              FUNCTION DECLARATIONS
  ***************************************************************************/
@@ -156,32 +130,6 @@ void APPLICATION_START( void )
 }
 
 
-/*******************************************************************************
-* Function Name: my_atoi()
-********************************************************************************
-* Summary:
-*   check input is number or not
-*
-* Parameters:
-*   numArray: input string
-*   value: atoi value
-*
-* Return:
-*   None
-*
-*******************************************************************************/
-void my_atoi(char *numArray, int *value)
-{
-    int i;
-    const int len = strlen(numArray);
-
-    for (i = 0; i < len; i++)
-    {
-        if (!isdigit(numArray[i])) break;
-    }
-    *value = len == i ? atoi(numArray) : PRINT_MENU;
-}
-
 /******************************************************************************
  * Function Name: main()
  ******************************************************************************
@@ -198,7 +146,6 @@ void my_atoi(char *numArray, int *value)
  *****************************************************************************/
 int main( int argc, char* argv[] )
 {
-    int toggle_flag = 1;
     int len = 0; /* Length of application name */
     char patchFile[MAX_PATH]; /* Firmware patch file */
     char device[MAX_PATH]; /* Interface Device */
@@ -207,12 +154,12 @@ int main( int argc, char* argv[] )
     uint32_t patch_baud = 0; /* Patch downloading baud rate */
     int spy_inst = 0; /* BTSPY instance */
     uint8_t is_socket_tcp = 0; /* BTSPY communication socket */
-    unsigned int  choice = 0; /* Choice for User Input */
-    char input_choice[3] = {0,0,0}; /* User Input Str */
-    unsigned int handle; /* hasg application handle */
+    int status; /* exit status */
 
     cybt_controller_autobaud_config_t autobaud;
 
+    hfag_startup_begin();
+
     /* Parse the arguments */
     memset( patchFile,0,MAX_PATH );
     memset( device,0,MAX_PATH );
@@ -238,193 +185,19 @@ int main( int argc, char* argv[] )
     cy_bt_spy_comm_init( is_socket_tcp, spy_inst, peer_ip_addr );
     printf( "cy_bt_spy_comm_init done\n");
 
+    hfag_cmdq_init();
+    hfag_startup_mark( HFAG_STARTUP_ARGS );
+
+    /* Without a patch file the porting layer skips autobaud and download */
+    hfag_startup_prepare( patchFile, device, baud );
     cy_platform_bluetooth_init( patchFile, device, baud, patch_baud, &autobaud );
+    hfag_startup_report();
 
     //printf( "Linux CE HFAG project initialization complete...\n" );
-    printf("%s", app_menu);
-
-    for ( ; ; )
-    {
-        fflush(stdin);
-        if (scanf("%2s", input_choice) == EOF){
-            printf( "Enter discoverability fail!!\n");
-            choice = PRINT_MENU;
-        }
-        else{
-
-            my_atoi(input_choice, &choice);
-        }
-        switch(choice)
-        {
-        case EXIT:
-            exit(EXIT_SUCCESS);
-        case PRINT_MENU:
-            {
-                printf("%s\n", app_menu);
-            }
-            break;
-
-        case SET_VISIBILITY:
-            {
-                unsigned int discoverable;
-                unsigned int connectable;
-                printf("Enter discoverability: 0:Non Discoverable, 1: Discoverable\n");
-                if (scanf("%u", &discoverable) == EOF){
-                    printf( "Enter discoverability fail!!\n");
-                    break;
-                }
-                printf("\nEnter connectability: 0:Non Connectable, 1: Connectable\n");
-                if (scanf("%u", &connectable) == EOF){
-                    printf( "Enter connectability fail!!\n");
-                    break;
-                }
-                if ( hfag_handle_set_visibility((uint8_t)discoverable, (uint8_t)connectable) != WICED_BT_SUCCESS)
-                {
-                    WICED_BT_TRACE("hfag_handle_set_visibility retuned error\n");
-                }
-            }
-            break;
-
-        case SET_PAIRING_MODE:
-            {
-                unsigned int allowed;
-                printf("Enter if pairing is allowed: 0: Not allowed, 1: Allowed\n");
-                if (scanf("%d", &allowed) == EOF){
-                    printf( "Enter allowed fail!!\n");
-                    break;
-                }
-                if (hfag_handle_set_pairability((uint8_t)allowed) != WICED_BT_SUCCESS)
-                {
-                    WICED_BT_TRACE("hfag_handle_set_pairability retuned error\n");
-                }
-            }
-            break;
-
-        case SET_INQUIRY:
-            {
-                unsigned int enable;
-                printf("Enter if Inquiry has to be enabled/disabled: 0: Disabled, 1: Enabled\n");
-                if (scanf("%u", &enable) == EOF){
-                    printf( "Enter enable fail!!\n");
-                    break;
-                }
-                if ( !hfag_inquiry((uint8_t)enable) )
-                {
-                    WICED_BT_TRACE("hfag_inquiry retuned error");
-                }
-            }
-            break;
 
-        case HFAG_CONNECT:
-            {
-                BD_ADDR peer_bd_addr;
-                int i = 0;
-                unsigned int read;
-                printf("Enter Peer BD Address as displayed in Inquiry Results \n(Example: 11 22 33 44 55 66): \n");
-                for(i = 0; i < BDA_LEN; i++)
-                {
-                    if (scanf("%x", &read) == EOF){
-                        printf( "Enter BD_ADDR fail!!\n");
-                        break;
-                    }
-                    peer_bd_addr[i] = (unsigned char)read;
-                }
-                wiced_bt_hfp_ag_connect(peer_bd_addr);
-            }
-            break;
-
-        case HFAG_DISCONNECT:
-            {
-                hfag_print_hfp_context();
-                printf("Enter the Application Handle to disconnect as displayed in HFAG CONNECTION DETAILS: ");
-                if (scanf("%x", &handle) == EOF){
-                    printf( "Enter HFAG_DISCONNECT handle number fail!!\n");
-                    break;                    
-                }
-                if ( hfag_validate_app_handle( (uint16_t)handle ) )
-                {
-                    wiced_bt_hfp_ag_disconnect((uint16_t)handle);
-                }
-                else
-                {
-                    printf("Invalid Handle\n");
-                }
-            }
-            break;
-
-        case HFAG_AUDIO_CONNECT:
-            {
-                hfag_print_hfp_context();
-                printf("Enter the Application Handle as displayed in HFAG CONNECTION DETAILS: ");
-                if (scanf("%x", &handle) == EOF){
-                    printf( "Enter HFAG_AUDIO_CONNECT handle number fail!!\n");
-                    break;
-                }
-                if ( hfag_validate_app_handle( (uint16_t)handle ) )
-                {
-                    wiced_bt_hfp_ag_audio_open( (uint16_t)handle );
-                }
-                else
-                {
-                    printf("Invalid Handle\n");
-                }
-            }
-            break;
-
-        case HFAG_AUDIO_DISCONNECT:
-            {
-                hfag_print_hfp_context();
-                printf("Enter the Application Handle as displayed in HFAG CONNECTION DETAILS: ");
-                if (scanf("%x", &handle) == EOF){
-                    printf( "Enter HFAG_AUDIO_DISCONNECT handle number fail!!\n");
-                    break;
-                }
-                if ( hfag_validate_app_handle( (uint16_t)handle ) )
-                {
-                    wiced_bt_hfp_ag_audio_close( (uint16_t)handle );
-                }
-                else
-                {
-                    printf("Invalid Handle\n");
-                }
-            }
-            break;
-
-        case HFAG_PRINT_CONNECTION_DETAILS:
-            hfag_print_hfp_context();
-            break;
-
-        case HFAG_SEND_AG_COMMAND:
-            {
-                uint8_t ag_cmd[100];
-                int ch;
-                hfag_print_hfp_context();
-                printf("Enter the Application Handle as displayed in HFAG CONNECTION DETAILS: ");
-                if (scanf("%x", &handle) == EOF){
-                    printf( "Enter HFAG_SEND_AG_COMMAND handle number fail!!\n");
-                    break;
-                }
-                while ((ch = getchar()) != '\n');
-                if ( hfag_validate_app_handle( (uint16_t)handle ) )
-                {
-                    printf("Enter the AG cmd str: ");
-                    if (scanf("%[^\n]s",ag_cmd) == EOF){
-                        printf( "Enter AG cmd str fail!!\n");
-                        break;
-                    }
-                    wiced_bt_hfp_ag_send_cmd_str((uint16_t)handle, ag_cmd, strlen(ag_cmd));
-                }
-                else
-                {
-                    printf("Invalid Handle\n");
-                }
-            }
-            break;
-
-        default:
-            printf("Invalid Input\n");
-            break;
-        }
-    }
-    return EXIT_SUCCESS;
+    /* Serve the menu and the control socket until the exit command */
+    status = hfag_console_run();
+    close_audio_session();
+    hfag_trace_deinit();
+    return status;
 }
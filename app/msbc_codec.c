@@ -0,0 +1,452 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/*******************************************************************************
+ * File Name: msbc_codec.c
+ *
+ * Description: This file contains the host side mSBC codec for wideband
+ * speech over HCI. SCO packets do not have to be aligned with mSBC frames,
+ * the decoder searches for the H2 synchronization header, reports frames
+ * missing from the H2 sequence and checks the SBC CRC before decoding. The
+ * encoder frames every 120 samples as H2 + 57 byte mSBC frame + padding and
+ * hands the stream out in packets of any size.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ ******************************************************************************/
+#include <string.h>
+
+#include "msbc_codec.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define MSBC_H2_SYNC            (0x01U) /* first byte of the H2 header */
+#define MSBC_SYNCWORD           (0xADU)
+#define MSBC_NUM_BLOCKS         (15U)
+#define MSBC_NUM_SUBBANDS       (8U)
+#define MSBC_BITPOOL            (26U)
+#define MSBC_CRC_OFFSET         (3U)    /* CRC byte in the frame header */
+#define MSBC_CRC_INIT           (0x0FU)
+#define MSBC_CRC_POLY           (0x1DU) /* x^8 + x^4 + x^3 + x^2 + 1 */
+#define MSBC_SEQ_MASK           (3U)
+
+#ifndef SBC_SUCCESS
+#define SBC_SUCCESS             (0)
+#endif
+
+#ifndef MIN
+#define MIN(a, b)               (((a) < (b)) ? (a) : (b))
+#endif
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+/* Second H2 byte for sequence numbers 0 to 3, each bit of the sequence
+ * number is sent twice */
+static const uint8_t msbc_h2_seq[] = { 0x08, 0x38, 0xC8, 0xF8 };
+
+/* Header and scale factor bytes covered by the CRC of a mono 8 subband frame */
+static const uint8_t msbc_crc_bytes[] = { 1, 2, 4, 5, 6, 7 };
+
+/*******************************************************************************
+ *       FUNCTION DECLARATION
+ ******************************************************************************/
+static int32_t msbc_h2_seq_num(uint8_t h2);
+static uint8_t msbc_crc8(const uint8_t *p_frame);
+static void msbc_decoder_consume(msbc_decoder_t *p_dec, uint32_t len);
+static wiced_bool_t msbc_decode_frame(msbc_decoder_t *p_dec, const uint8_t *p_frame, int16_t *p_pcm);
+static wiced_bool_t msbc_encode_frame(msbc_encoder_t *p_enc, const int16_t *p_pcm, uint8_t *p_frame);
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: msbc_h2_seq_num
+ *******************************************************************************
+ * Summary:
+ *   Decodes the sequence number from the second H2 byte
+ *
+ * Return:
+ *   int32_t : sequence number, -1 if h2 is not a valid H2 byte
+ *
+ ******************************************************************************/
+static int32_t msbc_h2_seq_num(uint8_t h2)
+{
+    int32_t seq;
+
+    for (seq = 0; seq < (int32_t)sizeof(msbc_h2_seq); seq++)
+    {
+        if (msbc_h2_seq[seq] == h2)
+        {
+            return seq;
+        }
+    }
+    return -1;
+}
+
+/*******************************************************************************
+ * Function Name: msbc_crc8
+ *******************************************************************************
+ * Summary:
+ *   Computes the SBC header CRC of an mSBC frame
+ *
+ ******************************************************************************/
+static uint8_t msbc_crc8(const uint8_t *p_frame)
+{
+    uint8_t crc = MSBC_CRC_INIT;
+    uint32_t i;
+    uint32_t bit;
+
+    for (i = 0; i < sizeof(msbc_crc_bytes); i++)
+    {
+        crc ^= p_frame[msbc_crc_bytes[i]];
+        for (bit = 0; bit < 8; bit++)
+        {
+            crc = (uint8_t)((crc & 0x80U) ? ((crc << 1) ^ MSBC_CRC_POLY) : (crc << 1));
+        }
+    }
+    return crc;
+}
+
+/*******************************************************************************
+ * Function Name: msbc_decoder_init
+ *******************************************************************************
+ * Summary:
+ *   Initializes the mSBC decoder and the SBC library decoder state
+ *
+ * Parameters:
+ *   msbc_decoder_t *p_dec : decoder
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void msbc_decoder_init(msbc_decoder_t *p_dec)
+{
+    memset(p_dec, 0, sizeof(*p_dec));
+
+    p_dec->params.s32StaticMem = p_dec->static_mem;
+    p_dec->params.s32ScratchMem = p_dec->scratch_mem;
+    p_dec->params.numOfBlocks = MSBC_NUM_BLOCKS;
+    p_dec->params.numOfChannels = 1;
+    p_dec->params.numOfSubBands = MSBC_NUM_SUBBANDS;
+    p_dec->params.allocationMethod = 0; /* Loudness */
+    p_dec->params.mSBCEnabled = 1;
+
+    SBC_Decoder_decode_Init(&p_dec->params);
+}
+
+/*******************************************************************************
+ * Function Name: msbc_decoder_write
+ *******************************************************************************
+ * Summary:
+ *   Appends received SCO data to the reassembly buffer. Frames must be taken
+ *   out with msbc_decoder_read before more data fits.
+ *
+ * Parameters:
+ *   msbc_decoder_t *p_dec  : decoder
+ *   const uint8_t *p_data  : SCO payload
+ *   uint32_t len           : length of p_data
+ *
+ * Return:
+ *   uint32_t : number of bytes taken, at least MSBC_PACKET_LEN once all
+ *              frames have been read
+ *
+ ******************************************************************************/
+uint32_t msbc_decoder_write(msbc_decoder_t *p_dec, const uint8_t *p_data, uint32_t len)
+{
+    len = MIN(len, sizeof(p_dec->buf) - p_dec->len);
+    memcpy(&p_dec->buf[p_dec->len], p_data, len);
+    p_dec->len += len;
+    return len;
+}
+
+/*******************************************************************************
+ * Function Name: msbc_decoder_consume
+ *******************************************************************************
+ * Summary:
+ *   Removes len bytes from the front of the reassembly buffer
+ *
+ ******************************************************************************/
+static void msbc_decoder_consume(msbc_decoder_t *p_dec, uint32_t len)
+{
+    memmove(p_dec->buf, &p_dec->buf[len], p_dec->len - len);
+    p_dec->len -= len;
+}
+
+/*******************************************************************************
+ * Function Name: msbc_decoder_read
+ *******************************************************************************
+ * Summary:
+ *   Takes the next frame out of the reassembly buffer. Frames skipped in
+ *   the H2 sequence are reported as lost before the frame that follows
+ *   them, frames failing the CRC or the decoder are reported as bad. Only
+ *   MSBC_FRAME_GOOD fills p_pcm.
+ *
+ * Parameters:
+ *   msbc_decoder_t *p_dec          : decoder
+ *   int16_t *p_pcm                 : MSBC_SAMPLES_PER_FRAME output samples
+ *   msbc_frame_status_t *p_status  : status of the frame
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE when no complete frame is buffered
+ *
+ ******************************************************************************/
+wiced_bool_t msbc_decoder_read(msbc_decoder_t *p_dec, int16_t *p_pcm, msbc_frame_status_t *p_status)
+{
+    const uint8_t *p_frame;
+    uint32_t skip;
+    int32_t seq;
+
+    if (p_dec->pending_lost > 0)
+    {
+        p_dec->pending_lost--;
+        p_dec->lost_frames++;
+        *p_status = MSBC_FRAME_LOST;
+        return WICED_TRUE;
+    }
+
+    /* Look for H2 followed by the mSBC syncword, keeping a partial header at
+     * the end of the buffer */
+    for (skip = 0; (skip + MSBC_H2_LEN) < p_dec->len; skip++)
+    {
+        if ((p_dec->buf[skip] == MSBC_H2_SYNC) &&
+            (msbc_h2_seq_num(p_dec->buf[skip + 1]) >= 0) &&
+            (p_dec->buf[skip + MSBC_H2_LEN] == MSBC_SYNCWORD))
+        {
+            break;
+        }
+    }
+    if (skip > 0)
+    {
+        /* A single padding byte follows every frame */
+        if (!p_dec->synced || (skip > 1))
+        {
+            p_dec->skipped_bytes += skip;
+        }
+        if (p_dec->synced && (skip > 1))
+        {
+            p_dec->synced = WICED_FALSE;
+            p_dec->sync_losses++;
+        }
+        msbc_decoder_consume(p_dec, skip);
+    }
+    if (p_dec->len < (MSBC_H2_LEN + MSBC_FRAME_LEN))
+    {
+        return WICED_FALSE;
+    }
+
+    seq = msbc_h2_seq_num(p_dec->buf[1]);
+    if (p_dec->seq_valid && ((uint32_t)seq != p_dec->next_seq))
+    {
+        /* Report the gap first, this frame is read on a later call */
+        p_dec->pending_lost = ((uint32_t)seq - p_dec->next_seq) & MSBC_SEQ_MASK;
+        p_dec->next_seq = (uint8_t)seq;
+        return msbc_decoder_read(p_dec, p_pcm, p_status);
+    }
+    p_dec->synced = WICED_TRUE;
+    p_dec->seq_valid = WICED_TRUE;
+    p_dec->next_seq = (uint8_t)((seq + 1) & MSBC_SEQ_MASK);
+
+    p_frame = &p_dec->buf[MSBC_H2_LEN];
+    if ((msbc_crc8(p_frame) == p_frame[MSBC_CRC_OFFSET]) && msbc_decode_frame(p_dec, p_frame, p_pcm))
+    {
+        p_dec->frames++;
+        *p_status = MSBC_FRAME_GOOD;
+    }
+    else
+    {
+        p_dec->bad_frames++;
+        *p_status = MSBC_FRAME_BAD;
+    }
+    msbc_decoder_consume(p_dec, MSBC_H2_LEN + MSBC_FRAME_LEN);
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: msbc_decode_frame
+ *******************************************************************************
+ * Summary:
+ *   Decodes one mSBC frame with the SBC library
+ *
+ ******************************************************************************/
+static wiced_bool_t msbc_decode_frame(msbc_decoder_t *p_dec, const uint8_t *p_frame, int16_t *p_pcm)
+{
+    return (SBC_Decoder_decoder(&p_dec->params, (UINT8 *)p_frame, MSBC_FRAME_LEN, (SINT16 *)p_pcm) == SBC_SUCCESS) ?
+                WICED_TRUE : WICED_FALSE;
+}
+
+/*******************************************************************************
+ * Function Name: msbc_encoder_init
+ *******************************************************************************
+ * Summary:
+ *   Initializes the mSBC encoder and the SBC library encoder state
+ *
+ * Parameters:
+ *   msbc_encoder_t *p_enc : encoder
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void msbc_encoder_init(msbc_encoder_t *p_enc)
+{
+    memset(p_enc, 0, sizeof(*p_enc));
+
+    p_enc->params.s16SamplingFreq = SBC_sf16000;
+    p_enc->params.s16ChannelMode = SBC_MONO;
+    p_enc->params.s16NumOfSubBands = MSBC_NUM_SUBBANDS;
+    p_enc->params.s16NumOfChannels = 1;
+    p_enc->params.s16NumOfBlocks = MSBC_NUM_BLOCKS;
+    p_enc->params.s16AllocationMethod = SBC_LOUDNESS;
+    p_enc->params.s16BitPool = MSBC_BITPOOL;
+    p_enc->params.mSBCEnabled = 1;
+
+    SBC_Encoder_Init(&p_enc->params);
+
+    p_enc->pos = sizeof(p_enc->packet);
+}
+
+/*******************************************************************************
+ * Function Name: msbc_encoder_pending
+ *******************************************************************************
+ * Summary:
+ *   Returns the bytes of the current packet that have not been read yet
+ *
+ * Parameters:
+ *   msbc_encoder_t *p_enc : encoder
+ *
+ * Return:
+ *   uint32_t : bytes left, 0 when msbc_encoder_encode may be called
+ *
+ ******************************************************************************/
+uint32_t msbc_encoder_pending(msbc_encoder_t *p_enc)
+{
+    return sizeof(p_enc->packet) - p_enc->pos;
+}
+
+/*******************************************************************************
+ * Function Name: msbc_encode_frame
+ *******************************************************************************
+ * Summary:
+ *   Encodes one mSBC frame with the SBC library. The header is rewritten in
+ *   the mSBC form since the library may emit a regular SBC header.
+ *
+ ******************************************************************************/
+static wiced_bool_t msbc_encode_frame(msbc_encoder_t *p_enc, const int16_t *p_pcm, uint8_t *p_frame)
+{
+    p_enc->params.ps16PcmBuffer = (SINT16 *)p_pcm;
+    p_enc->params.pu8Packet = p_frame;
+    SBC_Encoder(&p_enc->params);
+    if (p_enc->params.u16PacketLength != MSBC_FRAME_LEN)
+    {
+        return WICED_FALSE;
+    }
+
+    p_frame[0] = MSBC_SYNCWORD;
+    p_frame[1] = 0;
+    p_frame[2] = 0;
+    p_frame[MSBC_CRC_OFFSET] = msbc_crc8(p_frame);
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: msbc_encoder_encode
+ *******************************************************************************
+ * Summary:
+ *   Encodes MSBC_SAMPLES_PER_FRAME samples into the next H2 framed packet.
+ *   A frame that fails to encode is sent as an invalid frame so the peer
+ *   conceals it and the sequence stays continuous.
+ *
+ * Parameters:
+ *   msbc_encoder_t *p_enc  : encoder
+ *   const int16_t *p_pcm   : MSBC_SAMPLES_PER_FRAME input samples
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the previous packet is still pending
+ *
+ ******************************************************************************/
+wiced_bool_t msbc_encoder_encode(msbc_encoder_t *p_enc, const int16_t *p_pcm)
+{
+    uint8_t *p_frame = &p_enc->packet[MSBC_H2_LEN];
+
+    if (msbc_encoder_pending(p_enc) != 0)
+    {
+        return WICED_FALSE;
+    }
+
+    p_enc->packet[0] = MSBC_H2_SYNC;
+    p_enc->packet[1] = msbc_h2_seq[p_enc->seq];
+    p_enc->seq = (uint8_t)((p_enc->seq + 1) & MSBC_SEQ_MASK);
+
+    if (msbc_encode_frame(p_enc, p_pcm, p_frame))
+    {
+        p_enc->frames++;
+    }
+    else
+    {
+        memset(p_frame, 0, MSBC_FRAME_LEN);
+        p_enc->errors++;
+    }
+    p_enc->packet[MSBC_PACKET_LEN - 1] = 0;
+    p_enc->pos = 0;
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: msbc_encoder_read
+ *******************************************************************************
+ * Summary:
+ *   Copies up to len bytes of the current packet
+ *
+ * Parameters:
+ *   msbc_encoder_t *p_enc  : encoder
+ *   uint8_t *p_data        : destination buffer
+ *   uint32_t len           : size of p_data
+ *
+ * Return:
+ *   uint32_t : number of bytes copied
+ *
+ ******************************************************************************/
+uint32_t msbc_encoder_read(msbc_encoder_t *p_enc, uint8_t *p_data, uint32_t len)
+{
+    len = MIN(len, msbc_encoder_pending(p_enc));
+    memcpy(p_data, &p_enc->packet[p_enc->pos], len);
+    p_enc->pos += len;
+    return len;
+}
@@ -0,0 +1,406 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/*******************************************************************************
+ * File Name: resampler.c
+ *
+ * Description: This file contains the implementation of the polyphase FIR
+ * sample rate converter. A Blackman windowed sinc prototype is split into
+ * RESAMPLER_PHASES sub-filters, the output is interpolated between the two
+ * sub-filters around the exact fractional position so that any ratio can be
+ * used. The inner product uses SSE2 or NEON when the compiler targets them.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ ******************************************************************************/
+#include <math.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "resampler.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define RESAMPLER_CUTOFF            (0.92)  /* fraction of the lower Nyquist rate */
+#define RESAMPLER_HIST_SIZE         (RESAMPLER_MAX_TAPS + RESAMPLER_MAX_INPUT)
+#define RESAMPLER_Q15_ONE           (32768)
+
+#ifndef M_PI
+#define M_PI                        (3.14159265358979323846)
+#endif
+#ifndef MIN
+#define MIN(a, b)                   (((a) < (b)) ? (a) : (b))
+#endif
+
+/*******************************************************************************
+ *       FUNCTION DECLARATION
+ ******************************************************************************/
+static double resampler_kernel(double t, double fc, uint32_t taps);
+static int32_t resampler_dot(const int16_t *p_x, const int16_t *p_h, uint32_t taps);
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: resampler_kernel
+ *******************************************************************************
+ * Summary:
+ *   Evaluates the windowed sinc prototype filter
+ *
+ * Parameters:
+ *   double t      : distance from the filter center in input frames
+ *   double fc     : cutoff relative to the input Nyquist rate
+ *   uint32_t taps : filter length in input frames
+ *
+ * Return:
+ *   double : filter value, not normalized
+ *
+ ******************************************************************************/
+static double resampler_kernel(double t, double fc, uint32_t taps)
+{
+    double x = M_PI * fc * t;
+    double sinc = (fabs(x) < 1e-9) ? fc : (fc * sin(x) / x);
+    double window = 0.42 + (0.5 * cos(2.0 * M_PI * t / taps)) + (0.08 * cos(4.0 * M_PI * t / taps));
+
+    return sinc * window;
+}
+
+/*******************************************************************************
+ * Function Name: resampler_dot
+ *******************************************************************************
+ * Summary:
+ *   Inner product of taps input frames with one Q15 sub-filter
+ *
+ * Parameters:
+ *   const int16_t *p_x : input frames
+ *   const int16_t *p_h : sub-filter coefficients
+ *   uint32_t taps      : number of taps, multiple of 8
+ *
+ * Return:
+ *   int32_t : Q15 scaled sum
+ *
+ ******************************************************************************/
+static int32_t resampler_dot(const int16_t *p_x, const int16_t *p_h, uint32_t taps)
+{
+    uint32_t i;
+#if defined(__SSE2__)
+    __m128i acc = _mm_setzero_si128();
+
+    for (i = 0; i < taps; i += 8)
+    {
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)&p_x[i]),
+                                                _mm_loadu_si128((const __m128i *)&p_h[i])));
+    }
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(acc);
+#elif defined(__ARM_NEON)
+    int32x4_t acc = vdupq_n_s32(0);
+    int32x2_t sum;
+    int16x8_t x;
+    int16x8_t h;
+
+    for (i = 0; i < taps; i += 8)
+    {
+        x = vld1q_s16(&p_x[i]);
+        h = vld1q_s16(&p_h[i]);
+        acc = vmlal_s16(acc, vget_low_s16(x), vget_low_s16(h));
+        acc = vmlal_s16(acc, vget_high_s16(x), vget_high_s16(h));
+    }
+    sum = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+    sum = vpadd_s32(sum, sum);
+    return vget_lane_s32(sum, 0);
+#else
+    int32_t acc = 0;
+
+    for (i = 0; i < taps; i++)
+    {
+        acc += (int32_t)p_x[i] * p_h[i];
+    }
+    return acc;
+#endif
+}
+
+/*******************************************************************************
+ * Function Name: resampler_simd_name
+ *******************************************************************************
+ * Summary:
+ *   Returns the instruction set used for the inner product
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   const char * : "sse2", "neon" or "scalar"
+ *
+ ******************************************************************************/
+const char *resampler_simd_name(void)
+{
+#if defined(__SSE2__)
+    return "sse2";
+#elif defined(__ARM_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+/*******************************************************************************
+ * Function Name: resampler_init
+ *******************************************************************************
+ * Summary:
+ *   Designs the sub-filters for in_rate to out_rate and resets the state.
+ *   The filter is made longer when down-sampling so that the transition
+ *   band stays the same relative to the output rate.
+ *
+ * Parameters:
+ *   resampler_t *p_rs : resampler
+ *   uint32_t in_rate  : input sampling rate
+ *   uint32_t out_rate : output sampling rate
+ *
+ * Return:
+ *   wiced_bool_t : WICED_FALSE if the ratio is not supported
+ *
+ ******************************************************************************/
+wiced_bool_t resampler_init(resampler_t *p_rs, uint32_t in_rate, uint32_t out_rate)
+{
+    double h[RESAMPLER_MAX_TAPS];
+    double fc;
+    double sum;
+    uint32_t center;
+    uint32_t peak;
+    uint32_t p;
+    uint32_t k;
+    int32_t c;
+    int32_t total;
+
+    if ((in_rate == 0) || (out_rate == 0) ||
+        (in_rate > (out_rate * (RESAMPLER_MAX_TAPS / RESAMPLER_BASE_TAPS))))
+    {
+        return WICED_FALSE;
+    }
+
+    memset(p_rs->coeff, 0, sizeof(p_rs->coeff));
+    p_rs->in_rate = in_rate;
+    p_rs->out_rate = out_rate;
+    p_rs->nominal_step = ((uint64_t)in_rate << 32) / out_rate;
+    p_rs->step = p_rs->nominal_step;
+    p_rs->taps = RESAMPLER_BASE_TAPS * ((in_rate + out_rate - 1) / out_rate);
+    fc = RESAMPLER_CUTOFF * ((out_rate < in_rate) ? ((double)out_rate / in_rate) : 1.0);
+    center = (p_rs->taps / 2) - 1;
+
+    /* Row p is the filter for an output p / RESAMPLER_PHASES frames after
+     * hist[i + center]. Each row is normalized to unity gain at DC. */
+    for (p = 0; p <= RESAMPLER_PHASES; p++)
+    {
+        sum = 0.0;
+        peak = 0;
+        for (k = 0; k < p_rs->taps; k++)
+        {
+            h[k] = resampler_kernel((double)center + ((double)p / RESAMPLER_PHASES) - k, fc, p_rs->taps);
+            sum += h[k];
+            if (fabs(h[k]) > fabs(h[peak]))
+            {
+                peak = k;
+            }
+        }
+        total = 0;
+        for (k = 0; k < p_rs->taps; k++)
+        {
+            c = (int32_t)lrint(h[k] * RESAMPLER_Q15_ONE / sum);
+            c = (c > INT16_MAX) ? INT16_MAX : ((c < INT16_MIN) ? INT16_MIN : c);
+            p_rs->coeff[p][k] = (int16_t)c;
+            total += c;
+        }
+        p_rs->coeff[p][peak] += (int16_t)(RESAMPLER_Q15_ONE - total);
+    }
+
+    resampler_reset(p_rs);
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: resampler_reset
+ *******************************************************************************
+ * Summary:
+ *   Clears the filter history, keeping the filter design
+ *
+ * Parameters:
+ *   resampler_t *p_rs : resampler
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void resampler_reset(resampler_t *p_rs)
+{
+    memset(p_rs->hist, 0, sizeof(p_rs->hist));
+    p_rs->hist_len = p_rs->taps - 1;
+    p_rs->pos = 0;
+}
+
+/*******************************************************************************
+ * Function Name: resampler_set_drift
+ *******************************************************************************
+ * Summary:
+ *   Fine tunes the conversion ratio to follow a clock offset between the
+ *   input and the output. Positive values consume input faster.
+ *
+ * Parameters:
+ *   resampler_t *p_rs : resampler
+ *   int32_t ppb       : ratio correction in parts per billion
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void resampler_set_drift(resampler_t *p_rs, int32_t ppb)
+{
+    p_rs->step = (uint64_t)((int64_t)p_rs->nominal_step + (((int64_t)p_rs->nominal_step * ppb) / 1000000000));
+}
+
+/*******************************************************************************
+ * Function Name: resampler_input_frames
+ *******************************************************************************
+ * Summary:
+ *   Returns the number of input frames resampler_process() needs to produce
+ *   exactly out_frames output frames
+ *
+ * Parameters:
+ *   const resampler_t *p_rs : resampler
+ *   uint32_t out_frames     : wanted output frames
+ *
+ * Return:
+ *   uint32_t : input frames
+ *
+ ******************************************************************************/
+uint32_t resampler_input_frames(const resampler_t *p_rs, uint32_t out_frames)
+{
+    uint64_t last;
+    uint32_t need;
+
+    if (out_frames == 0)
+    {
+        return 0;
+    }
+    last = p_rs->pos + ((uint64_t)(out_frames - 1) * p_rs->step);
+    need = (uint32_t)(last >> 32) + p_rs->taps;
+    return (need > p_rs->hist_len) ? (need - p_rs->hist_len) : 0;
+}
+
+/*******************************************************************************
+ * Function Name: resampler_process
+ *******************************************************************************
+ * Summary:
+ *   Converts in_frames input frames and returns as many output frames as
+ *   they complete, up to out_max. Input left over when out_max is reached is
+ *   kept for the next call as far as it fits.
+ *
+ * Parameters:
+ *   resampler_t *p_rs     : resampler
+ *   const int16_t *p_in   : input frames
+ *   uint32_t in_frames    : number of input frames
+ *   int16_t *p_out        : output frames
+ *   uint32_t out_max      : size of p_out in frames
+ *
+ * Return:
+ *   uint32_t : number of output frames written
+ *
+ ******************************************************************************/
+uint32_t resampler_process(resampler_t *p_rs, const int16_t *p_in, uint32_t in_frames,
+                           int16_t *p_out, uint32_t out_max)
+{
+    uint32_t produced = 0;
+    uint32_t n;
+    uint32_t i;
+    uint32_t phase;
+    uint32_t consumed;
+    uint64_t x;
+    int64_t mu;
+    int64_t out;
+    int32_t a;
+    int32_t b;
+
+    for (;;)
+    {
+        n = MIN(in_frames, RESAMPLER_HIST_SIZE - p_rs->hist_len);
+        memcpy(&p_rs->hist[p_rs->hist_len], p_in, n * sizeof(int16_t));
+        p_rs->hist_len += n;
+        p_in += n;
+        in_frames -= n;
+
+        while (produced < out_max)
+        {
+            i = (uint32_t)(p_rs->pos >> 32);
+            if ((i + p_rs->taps) > p_rs->hist_len)
+            {
+                break;
+            }
+            /* sub-filter index and Q15 position between it and the next */
+            x = (uint64_t)(uint32_t)p_rs->pos * RESAMPLER_PHASES;
+            phase = (uint32_t)(x >> 32);
+            mu = (int64_t)((x >> 17) & 0x7FFFU);
+
+            a = resampler_dot(&p_rs->hist[i], p_rs->coeff[phase], p_rs->taps);
+            b = resampler_dot(&p_rs->hist[i], p_rs->coeff[phase + 1], p_rs->taps);
+            out = a + ((((int64_t)b - a) * mu) >> 15);
+            out = (out + (RESAMPLER_Q15_ONE / 2)) >> 15;
+            p_out[produced++] = (int16_t)((out > INT16_MAX) ? INT16_MAX : ((out < INT16_MIN) ? INT16_MIN : out));
+            p_rs->pos += p_rs->step;
+        }
+
+        consumed = MIN((uint32_t)(p_rs->pos >> 32), p_rs->hist_len);
+        memmove(p_rs->hist, &p_rs->hist[consumed], (p_rs->hist_len - consumed) * sizeof(int16_t));
+        p_rs->hist_len -= consumed;
+        p_rs->pos -= (uint64_t)consumed << 32;
+
+        if ((in_frames == 0) || (produced >= out_max))
+        {
+            break;
+        }
+    }
+
+    n = MIN(in_frames, RESAMPLER_HIST_SIZE - p_rs->hist_len);
+    memcpy(&p_rs->hist[p_rs->hist_len], p_in, n * sizeof(int16_t));
+    p_rs->hist_len += n;
+    return produced;
+}
@@ -0,0 +1,769 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: sco_recorder.c
+ *
+ * Description: This file contains the call recorder. The SCO path only copies
+ * the downlink and uplink PCM into a ring per session and direction, a
+ * background thread batches the rings into large aligned writes to WAV files
+ * and rotates the files by duration or size.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+
+/*******************************************************************************
+ *      INCLUDES
+ ******************************************************************************/
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "audio_platform_common.h"
+#include "audio_ring.h"
+#include "hfag_config.h"
+#include "sco_recorder.h"
+#include "wiced_bt_trace.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define SCO_RECORDER_RING_SIZE          (64U * 1024U)   /* 2 s of wideband PCM */
+#define SCO_RECORDER_BATCH_SIZE         (64U * 1024U)   /* bytes per file write */
+#define SCO_RECORDER_ALIGN              (4096U)         /* O_DIRECT buffer and offset alignment */
+#define SCO_RECORDER_DRAIN_MS           (100U)
+#define SCO_RECORDER_MAX_FILE_BYTES     (0x7FFF0000U)   /* WAV sizes are 32-bit */
+#define SCO_RECORDER_SILENCE_LEN        (256U)
+#define SCO_RECORDER_NAME_LEN           (256U)
+#define WAV_HEADER_LEN                  (44U)
+
+#define RECORDER_LOAD(p)                __atomic_load_n((p), __ATOMIC_RELAXED)
+#define RECORDER_LOAD_ACQUIRE(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define RECORDER_STORE_RELEASE(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+#ifndef MIN
+#define MIN(a, b)                       (((a) < (b)) ? (a) : (b))
+#endif
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+typedef enum
+{
+    SCO_RECORDER_IDLE,                  /* owned by start */
+    SCO_RECORDER_ACTIVE,                /* recording, the ring is filled */
+    SCO_RECORDER_CLOSING,               /* stopped, the writer finishes the file */
+    SCO_RECORDER_RESTART,               /* closing with the next call waiting, the writer starts it */
+} sco_recorder_state_t;
+
+/* One recorded direction of a session. The ring is filled on the Bluetooth
+ * stack thread, everything else but state and the next call is only touched
+ * by the writer thread while the stream is not idle. Leaving CLOSING or
+ * RESTART is done under recorder_lock */
+typedef struct
+{
+    uint32_t state;
+    audio_ring_t ring;
+    uint8_t ring_mem[SCO_RECORDER_RING_SIZE];
+
+    uint8_t *p_batch;                   /* SCO_RECORDER_ALIGN aligned */
+    uint32_t batch_len;
+    int fd;
+    wiced_bool_t failed;                /* file could not be written, drop until stop */
+    uint32_t part;
+    uint32_t sample_rate;
+    uint32_t data_bytes;                /* PCM in the current file */
+    uint64_t opened_ns;
+    char stem[SCO_RECORDER_NAME_LEN];   /* directory, call start time and session */
+    char next_stem[SCO_RECORDER_NAME_LEN]; /* call waiting in SCO_RECORDER_RESTART */
+    uint32_t next_sample_rate;
+
+    uint32_t files;
+    uint64_t bytes;
+    uint32_t write_errors;
+} sco_recorder_stream_t;
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static sco_recorder_stream_t recorder_streams[AUDIO_MAX_SESSIONS][SCO_RECORDER_DIRECTIONS];
+static const char *recorder_dir_names[SCO_RECORDER_DIRECTIONS] = { "downlink", "uplink" };
+static const uint8_t recorder_silence[SCO_RECORDER_SILENCE_LEN];
+static pthread_t recorder_thread;
+static pthread_mutex_t recorder_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t recorder_cond;
+static volatile wiced_bool_t recorder_running = WICED_FALSE;
+static const char *p_recorder_dir = ".";
+static uint32_t recorder_rotate_s = 0;
+static uint32_t recorder_rotate_bytes = 0;
+static wiced_bool_t recorder_direct = WICED_FALSE;
+
+/*******************************************************************************
+ *       FUNCTION DECLARATION
+ ******************************************************************************/
+static uint64_t sco_recorder_now_ns(void);
+static void sco_recorder_deadline(struct timespec *p_ts, uint32_t ms);
+static void sco_recorder_begin(sco_recorder_stream_t *p_stream, const char *p_stem, uint32_t sample_rate);
+static void sco_recorder_wav_header(uint8_t *p_hdr, uint32_t sample_rate, uint32_t data_bytes);
+static wiced_bool_t sco_recorder_write_all(int fd, const uint8_t *p_data, uint32_t len);
+static void sco_recorder_open(sco_recorder_stream_t *p_stream, sco_recorder_dir_t dir);
+static void sco_recorder_close(sco_recorder_stream_t *p_stream);
+static void sco_recorder_drain(sco_recorder_stream_t *p_stream, sco_recorder_dir_t dir);
+static void *sco_recorder_thread(void *arg);
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: sco_recorder_init
+ *******************************************************************************
+ * Summary:
+ *   Reads the recorder settings (HFAG_RECORD, off by default) and starts the
+ *   writer thread. Nothing is recorded unless the recorder is enabled.
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void sco_recorder_init(void)
+{
+    pthread_condattr_t attr;
+    sco_recorder_stream_t *p_stream;
+    uint32_t i;
+    uint32_t dir;
+    int value;
+    int status;
+
+    if (recorder_running || (hfag_config_get_int(HFAG_CONFIG_RECORD, 0) == 0))
+    {
+        return;
+    }
+    p_recorder_dir = hfag_config_get_str(HFAG_CONFIG_RECORD_DIR, ".");
+    value = hfag_config_get_int(HFAG_CONFIG_RECORD_ROTATE_S, 0);
+    recorder_rotate_s = (value > 0) ? (uint32_t)value : 0;
+    value = hfag_config_get_int(HFAG_CONFIG_RECORD_ROTATE_MB, 0);
+    recorder_rotate_bytes = ((value > 0) && (value < (int)(SCO_RECORDER_MAX_FILE_BYTES >> 20))) ?
+                            ((uint32_t)value << 20) : SCO_RECORDER_MAX_FILE_BYTES;
+    recorder_direct = hfag_config_get_int(HFAG_CONFIG_RECORD_DIRECT, 0) ? WICED_TRUE : WICED_FALSE;
+
+    for (i = 0; i < AUDIO_MAX_SESSIONS; i++)
+    {
+        for (dir = 0; dir < SCO_RECORDER_DIRECTIONS; dir++)
+        {
+            p_stream = &recorder_streams[i][dir];
+            p_stream->state = SCO_RECORDER_IDLE;
+            p_stream->fd = -1;
+            audio_ring_init(&p_stream->ring, p_stream->ring_mem, sizeof(p_stream->ring_mem));
+            if (posix_memalign((void **)&p_stream->p_batch, SCO_RECORDER_ALIGN, SCO_RECORDER_BATCH_SIZE) != 0)
+            {
+                WICED_BT_TRACE("recorder buffer allocation failed\n");
+                sco_recorder_deinit();
+                return;
+            }
+        }
+    }
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&recorder_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    recorder_running = WICED_TRUE;
+    status = pthread_create(&recorder_thread, NULL, sco_recorder_thread, NULL);
+    if (status != 0)
+    {
+        WICED_BT_TRACE("recorder thread create failed %d\n", status);
+        recorder_running = WICED_FALSE;
+        sco_recorder_deinit();
+        return;
+    }
+    printf("Recording calls to %s\n", p_recorder_dir);
+}
+
+/*******************************************************************************
+ * Function Name: sco_recorder_deinit
+ *******************************************************************************
+ * Summary:
+ *   Stops every recording, waits for the writer thread to complete the files
+ *   and releases the buffers
+ *
+ * Parameters:
+ *   None
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void sco_recorder_deinit(void)
+{
+    uint32_t i;
+    uint32_t dir;
+
+    if (recorder_running)
+    {
+        for (i = 0; i < AUDIO_MAX_SESSIONS; i++)
+        {
+            sco_recorder_stop((uint8_t)i);
+        }
+        pthread_mutex_lock(&recorder_lock);
+        recorder_running = WICED_FALSE;
+        pthread_cond_broadcast(&recorder_cond);
+        pthread_mutex_unlock(&recorder_lock);
+        pthread_join(recorder_thread, NULL);
+        pthread_cond_destroy(&recorder_cond);
+    }
+    for (i = 0; i < AUDIO_MAX_SESSIONS; i++)
+    {
+        for (dir = 0; dir < SCO_RECORDER_DIRECTIONS; dir++)
+        {
+            free(recorder_streams[i][dir].p_batch);
+            recorder_streams[i][dir].p_batch = NULL;
+        }
+    }
+}
+
+/*******************************************************************************
+ * Function Name: sco_recorder_start
+ *******************************************************************************
+ * Summary:
+ *   Starts recording both directions of a session, called from the Bluetooth
+ *   stack thread when the SCO link opens. The files are named after the call
+ *   start time and created by the writer thread. This does not block: a
+ *   direction whose previous file is still being completed starts recording
+ *   once the writer is done with it.
+ *
+ * Parameters:
+ *   uint8_t session     : session index, HFP handle - 1
+ *   uint32_t sample_rate: rate of the SCO PCM
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void sco_recorder_start(uint8_t session, uint32_t sample_rate)
+{
+    sco_recorder_stream_t *p_stream;
+    struct tm tm;
+    time_t now;
+    char stamp[32];
+    char stem[SCO_RECORDER_NAME_LEN];
+    uint32_t state;
+    uint32_t dir;
+
+    if (!recorder_running || (session >= AUDIO_MAX_SESSIONS))
+    {
+        return;
+    }
+    now = time(NULL);
+    localtime_r(&now, &tm);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm);
+    snprintf(stem, sizeof(stem), "%s/call_%s_s%u", p_recorder_dir, stamp, session);
+
+    for (dir = 0; dir < SCO_RECORDER_DIRECTIONS; dir++)
+    {
+        p_stream = &recorder_streams[session][dir];
+
+        /* The file of the previous call may still be completing, the writer
+         * then starts this call when it is done. The lock is only held for
+         * state changes, never for file I/O */
+        pthread_mutex_lock(&recorder_lock);
+        state = RECORDER_LOAD_ACQUIRE(&p_stream->state);
+        if (state == SCO_RECORDER_CLOSING)
+        {
+            snprintf(p_stream->next_stem, sizeof(p_stream->next_stem), "%s", stem);
+            p_stream->next_sample_rate = sample_rate;
+            RECORDER_STORE_RELEASE(&p_stream->state, SCO_RECORDER_RESTART);
+        }
+        pthread_mutex_unlock(&recorder_lock);
+
+        if (state == SCO_RECORDER_CLOSING)
+        {
+            WICED_BT_TRACE("recorder session %u %s still completing, recording postponed\n",
+                           session, recorder_dir_names[dir]);
+        }
+        else if (state != SCO_RECORDER_IDLE)
+        {
+            WICED_BT_TRACE("recorder session %u %s busy, not recorded\n", session, recorder_dir_names[dir]);
+        }
+        else
+        {
+            sco_recorder_begin(p_stream, stem, sample_rate);
+        }
+    }
+}
+
+/*******************************************************************************
+ * Function Name: sco_recorder_stop
+ *******************************************************************************
+ * Summary:
+ *   Stops recording a session. The writer thread completes the files in the
+ *   background, this does not block.
+ *
+ * Parameters:
+ *   uint8_t session: session index, HFP handle - 1
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void sco_recorder_stop(uint8_t session)
+{
+    sco_recorder_stream_t *p_stream;
+    uint32_t dir;
+
+    if (!recorder_running || (session >= AUDIO_MAX_SESSIONS))
+    {
+        return;
+    }
+    pthread_mutex_lock(&recorder_lock);
+    for (dir = 0; dir < SCO_RECORDER_DIRECTIONS; dir++)
+    {
+        p_stream = &recorder_streams[session][dir];
+        /* A postponed call that ends before it started is not recorded */
+        if ((RECORDER_LOAD(&p_stream->state) == SCO_RECORDER_ACTIVE) ||
+            (RECORDER_LOAD(&p_stream->state) == SCO_RECORDER_RESTART))
+        {
+            RECORDER_STORE_RELEASE(&p_stream->state, SCO_RECORDER_CLOSING);
+        }
+    }
+    pthread_cond_broadcast(&recorder_cond);
+    pthread_mutex_unlock(&recorder_lock);
+}
+
+/*******************************************************************************
+ * Function Name: sco_recorder_write
+ *******************************************************************************
+ * Summary:
+ *   Records PCM of one direction of a session. This only copies the audio
+ *   into the ring of the stream and never blocks, audio is dropped if the
+ *   writer falls behind.
+ *
+ * Parameters:
+ *   uint8_t session         : session index, HFP handle - 1
+ *   sco_recorder_dir_t dir  : downlink or uplink
+ *   const uint8_t *p_pcm    : mono 16-bit PCM, NULL records silence
+ *   uint32_t len            : length of the PCM in bytes
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void sco_recorder_write(uint8_t session, sco_recorder_dir_t dir, const uint8_t *p_pcm, uint32_t len)
+{
+    sco_recorder_stream_t *p_stream;
+    uint32_t n;
+
+    if ((session >= AUDIO_MAX_SESSIONS) || (dir >= SCO_RECORDER_DIRECTIONS))
+    {
+        return;
+    }
+    p_stream = &recorder_streams[session][dir];
+    if (RECORDER_LOAD_ACQUIRE(&p_stream->state) != SCO_RECORDER_ACTIVE)
+    {
+        return;
+    }
+    if (p_pcm != NULL)
+    {
+        audio_ring_write(&p_stream->ring, p_pcm, len);
+        return;
+    }
+    while (len > 0)
+    {
+        n = MIN(len, SCO_RECORDER_SILENCE_LEN);
+        audio_ring_write(&p_stream->ring, recorder_silence, n);
+        len -= n;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: sco_recorder_get_stats
+ *******************************************************************************
+ * Summary:
+ *   Returns the recording statistics of the current or last call of a
+ *   session, both directions combined
+ *
+ * Parameters:
+ *   uint8_t session                : session index, HFP handle - 1
+ *   sco_recorder_stats_t *p_stats  : statistics
+ *
+ * Return:
+ *   None
+ *
+ ******************************************************************************/
+void sco_recorder_get_stats(uint8_t session, sco_recorder_stats_t *p_stats)
+{
+    sco_recorder_stream_t *p_stream;
+    audio_ring_stats_t ring_stats;
+    uint32_t dir;
+
+    memset(p_stats, 0, sizeof(*p_stats));
+    p_stats->enabled = recorder_running;
+    if (!recorder_running || (session >= AUDIO_MAX_SESSIONS))
+    {
+        return;
+    }
+    for (dir = 0; dir < SCO_RECORDER_DIRECTIONS; dir++)
+    {
+        p_stream = &recorder_streams[session][dir];
+        audio_ring_get_stats(&p_stream->ring, &ring_stats);
+        p_stats->files += RECORDER_LOAD(&p_stream->files);
+        p_stats->bytes += RECORDER_LOAD(&p_stream->bytes);
+        p_stats->write_errors += RECORDER_LOAD(&p_stream->write_errors);
+        p_stats->dropped_bytes += ring_stats.dropped_bytes;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: sco_recorder_now_ns
+ *******************************************************************************
+ * Summary:
+ *   Returns CLOCK_MONOTONIC in nanoseconds
+ *
+ ******************************************************************************/
+static uint64_t sco_recorder_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000U) + (uint64_t)ts.tv_nsec;
+}
+
+/*******************************************************************************
+ * Function Name: sco_recorder_deadline
+ *******************************************************************************
+ * Summary:
+ *   Returns the CLOCK_MONOTONIC time ms milliseconds from now
+ *
+ ******************************************************************************/
+static void sco_recorder_deadline(struct timespec *p_ts, uint32_t ms)
+{
+    uint64_t ns = sco_recorder_now_ns() + ((uint64_t)ms * 1000000U);
+
+    p_ts->tv_sec = (time_t)(ns / 1000000000U);
+    p_ts->tv_nsec = (long)(ns % 1000000000U);
+}
+
+/*******************************************************************************
+ * Function Name: sco_recorder_begin
+ *******************************************************************************
+ * Summary:
+ *   Resets a stream for a new call and hands it to the recording side.
+ *   Called by start for an idle stream, or by the writer thread under
+ *   recorder_lock for a postponed call once the previous file is complete.
+ *
+ ******************************************************************************/
+static void sco_recorder_begin(sco_recorder_stream_t *p_stream, const char *p_stem, uint32_t sample_rate)
+{
+    audio_ring_reset(&p_stream->ring);
+    p_stream->batch_len = 0;
+    p_stream->failed = WICED_FALSE;
+    p_stream->part = 0;
+    p_stream->sample_rate = sample_rate;
+    RECORDER_STORE_RELEASE(&p_stream->files, 0);
+    RECORDER_STORE_RELEASE(&p_stream->bytes, 0);
+    RECORDER_STORE_RELEASE(&p_stream->write_errors, 0);
+    snprintf(p_stream->stem, sizeof(p_stream->stem), "%s", p_stem);
+    RECORDER_STORE_RELEASE(&p_stream->state, SCO_RECORDER_ACTIVE);
+}
+
+/*******************************************************************************
+ * Function Name: sco_recorder_wav_header
+ *******************************************************************************
+ * Summary:
+ *   Builds the WAV header of mono 16-bit PCM
+ *
+ ******************************************************************************/
+static void sco_recorder_wav_header(uint8_t *p_hdr, uint32_t sample_rate, uint32_t data_bytes)
+{
+    const uint32_t fields[][3] =
+    {
+        /* offset, value, length */
+        { 4,  36U + data_bytes,                 4 },
+        { 16, 16,                               4 },
+        { 20, 1,                                2 }, /* PCM */
+        { 22, 1,                                2 }, /* mono */
+        { 24, sample_rate,                      4 },
+        { 28, sample_rate * sizeof(int16_t),    4 },
+        { 32, sizeof(int16_t),                  2 },
+        { 34, 16,                               2 },
+        { 40, data_bytes,                       4 },
+    };
+    uint32_t i;
+    uint32_t j;
+
+    memcpy(&p_hdr[0], "RIFF", 4);
+    memcpy(&p_hdr[8], "WAVEfmt ", 8);
+    memcpy(&p_hdr[36], "data", 4);
+    for (i = 0; i < sizeof(fields) / sizeof(fields[0]); i++)
+    {
+        for (j = 0; j < fields[i][2]; j++)
+        {
+            p_hdr[fields[i][0] + j] = (uint8_t)(fields[i][1] >> (8 * j));
+        }
+    }
+}
+
+/*******************************************************************************
+ * Function Name: sco_recorder_write_all
+ *******************************************************************************
+ * Summary:
+ *   Writes a whole buffer to a file, retrying short and interrupted writes
+ *
+ ******************************************************************************/
+static wiced_bool_t sco_recorder_write_all(int fd, const uint8_t *p_data, uint32_t len)
+{
+    ssize_t n;
+
+    while (len > 0)
+    {
+        n = write(fd, p_data, len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return WICED_FALSE;
+        }
+        p_data += n;
+        len -= (uint32_t)n;
+    }
+    return WICED_TRUE;
+}
+
+/*******************************************************************************
+ * Function Name: sco_recorder_open
+ *******************************************************************************
+ * Summary:
+ *   Creates the next file of a stream. The batch starts with room for the
+ *   WAV header, which is written when the file is completed. With
+ *   HFAG_RECORD_DIRECT the page cache is bypassed if the file system allows.
+ *
+ ******************************************************************************/
+static void sco_recorder_open(sco_recorder_stream_t *p_stream, sco_recorder_dir_t dir)
+{
+    char name[SCO_RECORDER_NAME_LEN + 32];
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+
+    snprintf(name, sizeof(name), "%s_%s_%u.wav", p_stream->stem, recorder_dir_names[dir], p_stream->part);
+    p_stream->fd = -1;
+#ifdef O_DIRECT
+    if (recorder_direct)
+    {
+        p_stream->fd = open(name, flags | O_DIRECT, 0644);
+    }
+#endif
+    if (p_stream->fd < 0)
+    {
+        p_stream->fd = open(name, flags, 0644);
+    }
+    if (p_stream->fd < 0)
+    {
+        WICED_BT_TRACE("cannot create %s: %s\n", name, strerror(errno));
+        p_stream->failed = WICED_TRUE;
+        RECORDER_STORE_RELEASE(&p_stream->write_errors, p_stream->write_errors + 1);
+        return;
+    }
+    memset(p_stream->p_batch, 0, WAV_HEADER_LEN);
+    p_stream->batch_len = WAV_HEADER_LEN;
+    p_stream->data_bytes = 0;
+    p_stream->opened_ns = sco_recorder_now_ns();
+    p_stream->part++;
+    RECORDER_STORE_RELEASE(&p_stream->files, p_stream->files + 1);
+}
+
+/*******************************************************************************
+ * Function Name: sco_recorder_close
+ *******************************************************************************
+ * Summary:
+ *   Writes the rest of the batch and the WAV header and closes the file. The
+ *   tail is not a whole batch, so direct I/O is turned off for it.
+ *
+ ******************************************************************************/
+static void sco_recorder_close(sco_recorder_stream_t *p_stream)
+{
+    uint8_t hdr[WAV_HEADER_LEN];
+    wiced_bool_t ok;
+
+    if (p_stream->fd < 0)
+    {
+        return;
+    }
+#ifdef O_DIRECT
+    fcntl(p_stream->fd, F_SETFL, fcntl(p_stream->fd, F_GETFL) & ~O_DIRECT);
+#endif
+    ok = sco_recorder_write_all(p_stream->fd, p_stream->p_batch, p_stream->batch_len);
+    sco_recorder_wav_header(hdr, p_stream->sample_rate, p_stream->data_bytes);
+    ok = ok && (pwrite(p_stream->fd, hdr, sizeof(hdr), 0) == (ssize_t)sizeof(hdr));
+    ok = (close(p_stream->fd) == 0) && ok;
+    if (!ok)
+    {
+        RECORDER_STORE_RELEASE(&p_stream->write_errors, p_stream->write_errors + 1);
+    }
+    p_stream->fd = -1;
+    p_stream->batch_len = 0;
+}
+
+/*******************************************************************************
+ * Function Name: sco_recorder_drain
+ *******************************************************************************
+ * Summary:
+ *   Moves the queued PCM of a stream into its batch, writes whole batches so
+ *   that every write but the last of a file is aligned, and rotates the file
+ *   when it reaches HFAG_RECORD_ROTATE_S or HFAG_RECORD_ROTATE_MB
+ *
+ ******************************************************************************/
+static void sco_recorder_drain(sco_recorder_stream_t *p_stream, sco_recorder_dir_t dir)
+{
+    uint32_t n;
+
+    if (p_stream->failed)
+    {
+        audio_ring_skip(&p_stream->ring, audio_ring_fill(&p_stream->ring));
+        return;
+    }
+    if ((p_stream->fd >= 0) && (recorder_rotate_s != 0) &&
+        ((sco_recorder_now_ns() - p_stream->opened_ns) >= ((uint64_t)recorder_rotate_s * 1000000000U)))
+    {
+        sco_recorder_close(p_stream);
+    }
+
+    while (audio_ring_fill(&p_stream->ring) > 0)
+    {
+        if (p_stream->fd < 0)
+        {
+            sco_recorder_open(p_stream, dir);
+            if (p_stream->failed)
+            {
+                audio_ring_skip(&p_stream->ring, audio_ring_fill(&p_stream->ring));
+                return;
+            }
+        }
+        n = MIN(SCO_RECORDER_BATCH_SIZE - p_stream->batch_len, recorder_rotate_bytes - p_stream->data_bytes);
+        n = audio_ring_read(&p_stream->ring, &p_stream->p_batch[p_stream->batch_len], n);
+        p_stream->batch_len += n;
+        p_stream->data_bytes += n;
+        RECORDER_STORE_RELEASE(&p_stream->bytes, p_stream->bytes + n);
+
+        if (p_stream->batch_len == SCO_RECORDER_BATCH_SIZE)
+        {
+            if (!sco_recorder_write_all(p_stream->fd, p_stream->p_batch, p_stream->batch_len))
+            {
+                WICED_BT_TRACE("recorder write failed: %s\n", strerror(errno));
+                RECORDER_STORE_RELEASE(&p_stream->write_errors, p_stream->write_errors + 1);
+                p_stream->failed = WICED_TRUE;
+                sco_recorder_close(p_stream);
+                audio_ring_skip(&p_stream->ring, audio_ring_fill(&p_stream->ring));
+                return;
+            }
+            p_stream->batch_len = 0;
+        }
+        if (p_stream->data_bytes == recorder_rotate_bytes)
+        {
+            sco_recorder_close(p_stream);
+        }
+    }
+}
+
+/*******************************************************************************
+ * Function Name: sco_recorder_thread
+ *******************************************************************************
+ * Summary:
+ *   Writer thread, drains the streams every SCO_RECORDER_DRAIN_MS or when a
+ *   recording stops, and hands stopped streams back once their files are
+ *   complete, or starts the call that was postponed meanwhile
+ *
+ ******************************************************************************/
+static void *sco_recorder_thread(void *arg)
+{
+    sco_recorder_stream_t *p_stream;
+    struct timespec deadline;
+    wiced_bool_t running = WICED_TRUE;
+    uint32_t state;
+    uint32_t i;
+    uint32_t dir;
+
+    (void)arg;
+    while (running)
+    {
+        pthread_mutex_lock(&recorder_lock);
+        running = recorder_running;
+        if (running)
+        {
+            sco_recorder_deadline(&deadline, SCO_RECORDER_DRAIN_MS);
+            pthread_cond_timedwait(&recorder_cond, &recorder_lock, &deadline);
+        }
+        pthread_mutex_unlock(&recorder_lock);
+
+        for (i = 0; i < AUDIO_MAX_SESSIONS; i++)
+        {
+            for (dir = 0; dir < SCO_RECORDER_DIRECTIONS; dir++)
+            {
+                p_stream = &recorder_streams[i][dir];
+                state = RECORDER_LOAD_ACQUIRE(&p_stream->state);
+                if (state == SCO_RECORDER_IDLE)
+                {
+                    continue;
+                }
+                sco_recorder_drain(p_stream, (sco_recorder_dir_t)dir);
+                if (state == SCO_RECORDER_ACTIVE)
+                {
+                    continue;
+                }
+                sco_recorder_close(p_stream);
+                /* start may have postponed the next call meanwhile */
+                pthread_mutex_lock(&recorder_lock);
+                if (RECORDER_LOAD(&p_stream->state) == SCO_RECORDER_RESTART)
+                {
+                    sco_recorder_begin(p_stream, p_stream->next_stem, p_stream->next_sample_rate);
+                }
+                else
+                {
+                    RECORDER_STORE_RELEASE(&p_stream->state, SCO_RECORDER_IDLE);
+                }
+                pthread_mutex_unlock(&recorder_lock);
+            }
+        }
+    }
+    return NULL;
+}
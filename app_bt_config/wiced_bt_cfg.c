@@ -129,7 +129,7 @@ const wiced_bt_cfg_l2cap_application_t wiced_bt_cfg_l2cap_app = /* Application m
 /* BR Setting */
 const wiced_bt_cfg_br_t wiced_bt_cfg_br =
 {
-    .br_max_simultaneous_links = 1,
+    .br_max_simultaneous_links = HANDSFREE_AG_NUM_SCB,
     .br_max_rx_pdu_size = 1024,
     .device_class = {0x24, 0x04, 0x18},                     /**< Local device class */
 
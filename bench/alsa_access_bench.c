@@ -0,0 +1,265 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: alsa_access_bench.c
+ *
+ * Description: Benchmark comparing the CPU cost of SND_PCM_ACCESS_RW_INTERLEAVED
+ * (snd_pcm_writei) and SND_PCM_ACCESS_MMAP_INTERLEAVED (snd_pcm_mmap_begin/
+ * commit) playback, reported as CPU time per second of audio.
+ *
+ * Usage: alsa_access_bench [device] [seconds] [rate]
+ *   device  : ALSA PCM, "null" measures the pure access cost (default)
+ *   seconds : audio duration per mode (default 20)
+ *   rate    : sampling rate, 8000 or 16000 (default 16000)
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+*      INCLUDES
+*******************************************************************************/
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "alsa/asoundlib.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define BENCH_LATENCY_US            (40000U)
+#define BENCH_BLOCK_MS              (10U)
+#define BENCH_MAX_BLOCK_FRAMES      (480U)
+#define BENCH_TONE_HZ               (440.0)
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static int16_t tone[BENCH_MAX_BLOCK_FRAMES];
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: bench_cpu_ns
+ *******************************************************************************
+ * Summary:
+ *   Returns the CPU time consumed by the process in nanoseconds
+ *
+ ******************************************************************************/
+static uint64_t bench_cpu_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000U) + (uint64_t)ts.tv_nsec;
+}
+
+/*******************************************************************************
+ * Function Name: bench_wall_ns
+ *******************************************************************************
+ * Summary:
+ *   Returns CLOCK_MONOTONIC in nanoseconds
+ *
+ ******************************************************************************/
+static uint64_t bench_wall_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000U) + (uint64_t)ts.tv_nsec;
+}
+
+/*******************************************************************************
+ * Function Name: bench_write_block
+ *******************************************************************************
+ * Summary:
+ *   Writes one block of the test tone with the selected access method. The
+ *   PCM is blocking, so the call is paced by the device.
+ *
+ * Return:
+ *   int : 0 on success, negative ALSA error otherwise
+ *
+ ******************************************************************************/
+static int bench_write_block(snd_pcm_t *p_pcm, int mmap_access, snd_pcm_uframes_t block)
+{
+    const snd_pcm_channel_area_t *p_areas;
+    snd_pcm_uframes_t offset;
+    snd_pcm_uframes_t frames;
+    snd_pcm_uframes_t done = 0;
+    snd_pcm_sframes_t ret;
+    int err;
+
+    while (done < block)
+    {
+        if (!mmap_access)
+        {
+            ret = snd_pcm_writei(p_pcm, &tone[done], block - done);
+        }
+        else
+        {
+            err = snd_pcm_wait(p_pcm, 1000);
+            if (err < 0)
+            {
+                ret = err;
+            }
+            else
+            {
+                frames = block - done;
+                err = snd_pcm_mmap_begin(p_pcm, &p_areas, &offset, &frames);
+                if (err < 0)
+                {
+                    ret = err;
+                }
+                else
+                {
+                    memcpy((uint8_t *)p_areas[0].addr + ((p_areas[0].first + (offset * p_areas[0].step)) / 8),
+                                                    &tone[done], frames * sizeof(int16_t));
+                    ret = snd_pcm_mmap_commit(p_pcm, offset, frames);
+                }
+            }
+            if ((ret >= 0) && (snd_pcm_state(p_pcm) == SND_PCM_STATE_PREPARED) &&
+                (snd_pcm_avail_update(p_pcm) == 0))
+            {
+                snd_pcm_start(p_pcm);
+            }
+        }
+        if (ret < 0)
+        {
+            ret = snd_pcm_recover(p_pcm, (int)ret, 1);
+            if (ret < 0)
+            {
+                return (int)ret;
+            }
+            continue;
+        }
+        done += (snd_pcm_uframes_t)ret;
+    }
+    return 0;
+}
+
+/*******************************************************************************
+ * Function Name: bench_run
+ *******************************************************************************
+ * Summary:
+ *   Plays the requested duration with one access method and prints the CPU
+ *   cost per second of audio
+ *
+ * Return:
+ *   int : 0 on success, -1 if the device does not support the access method
+ *
+ ******************************************************************************/
+static int bench_run(const char *p_device, int mmap_access, unsigned int seconds, unsigned int rate)
+{
+    snd_pcm_t *p_pcm = NULL;
+    snd_pcm_uframes_t block = rate * BENCH_BLOCK_MS / 1000U;
+    uint64_t blocks = (uint64_t)seconds * 1000U / BENCH_BLOCK_MS;
+    uint64_t cpu_start, wall_start, cpu, wall;
+    uint64_t i;
+    int err;
+
+    err = snd_pcm_open(&p_pcm, p_device, SND_PCM_STREAM_PLAYBACK, 0);
+    if (err < 0)
+    {
+        printf("snd_pcm_open %s failed: %s\n", p_device, snd_strerror(err));
+        return -1;
+    }
+    err = snd_pcm_set_params(p_pcm, SND_PCM_FORMAT_S16_LE,
+                             mmap_access ? SND_PCM_ACCESS_MMAP_INTERLEAVED : SND_PCM_ACCESS_RW_INTERLEAVED,
+                             1, rate, 1, BENCH_LATENCY_US);
+    if (err < 0)
+    {
+        printf("%-10s not supported by %s: %s\n", mmap_access ? "mmap" : "read/write",
+                                                    p_device, snd_strerror(err));
+        snd_pcm_close(p_pcm);
+        return -1;
+    }
+
+    cpu_start = bench_cpu_ns();
+    wall_start = bench_wall_ns();
+    for (i = 0; i < blocks; i++)
+    {
+        err = bench_write_block(p_pcm, mmap_access, block);
+        if (err < 0)
+        {
+            printf("write failed: %s\n", snd_strerror(err));
+            break;
+        }
+    }
+    cpu = bench_cpu_ns() - cpu_start;
+    wall = bench_wall_ns() - wall_start;
+    snd_pcm_drop(p_pcm);
+    snd_pcm_close(p_pcm);
+
+    printf("%-10s %6.1f s audio in %7.2f s wall, cpu %9.3f ms total, %7.3f ms per audio second\n",
+            mmap_access ? "mmap" : "read/write", (double)i * BENCH_BLOCK_MS / 1000.0,
+            (double)wall / 1e9, (double)cpu / 1e6,
+            (i == 0) ? 0.0 : ((double)cpu / 1e6) / ((double)i * BENCH_BLOCK_MS / 1000.0));
+    return 0;
+}
+
+/******************************************************************************
+ * Function Name: main()
+ ******************************************************************************
+ * Summary:
+ *   Benchmark entry function
+ *
+ *****************************************************************************/
+int main(int argc, char *argv[])
+{
+    const char *p_device = (argc > 1) ? argv[1] : "null";
+    unsigned int seconds = (argc > 2) ? (unsigned int)atoi(argv[2]) : 20U;
+    unsigned int rate = (argc > 3) ? (unsigned int)atoi(argv[3]) : 16000U;
+    unsigned int i;
+
+    if ((rate == 0) || ((rate * BENCH_BLOCK_MS / 1000U) > BENCH_MAX_BLOCK_FRAMES) || (seconds == 0))
+    {
+        printf("usage: %s [device] [seconds] [rate <= %u]\n", argv[0],
+                                    BENCH_MAX_BLOCK_FRAMES * 1000U / BENCH_BLOCK_MS);
+        return EXIT_FAILURE;
+    }
+    for (i = 0; i < BENCH_MAX_BLOCK_FRAMES; i++)
+    {
+        tone[i] = (int16_t)(8000.0 * sin(2.0 * M_PI * BENCH_TONE_HZ * i / rate));
+    }
+
+    printf("device %s, %u Hz mono S16_LE, %u ms blocks\n", p_device, rate, BENCH_BLOCK_MS);
+    bench_run(p_device, 0, seconds, rate);
+    bench_run(p_device, 1, seconds, rate);
+    return EXIT_SUCCESS;
+}
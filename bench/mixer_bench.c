@@ -0,0 +1,240 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: mixer_bench.c
+ *
+ * Description: Benchmark of the conference mixer. For 1 to BENCH_MAX_STREAMS
+ * Handsfree Units it times one conference block as the playback thread runs
+ * it: the speaker mix of all downlinks plus one N-1 uplink mix per unit
+ * including the microphone. A scalar mix that sums the other units again for
+ * every uplink is timed alongside for reference. Costs are reported per block
+ * and as the share of one core needed in real time.
+ *
+ * Usage: mixer_bench [block frames] [rate]
+ *   block frames : frames per block, at most 1024 (default 480)
+ *   rate         : device rate in Hz (default 48000)
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+*      INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "audio_mixer.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define BENCH_MAX_STREAMS           (8U)
+#define BENCH_AUDIO_SECONDS         (300U)  /* audio mixed per stream count */
+
+#ifndef MIN
+#define MIN(a, b)                   (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b)                   (((a) > (b)) ? (a) : (b))
+#endif
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static int16_t downlink[BENCH_MAX_STREAMS][AUDIO_MIXER_MAX_FRAMES];
+static int16_t mic[AUDIO_MIXER_MAX_FRAMES];
+static int16_t speaker[AUDIO_MIXER_MAX_FRAMES];
+static int16_t uplink[BENCH_MAX_STREAMS][AUDIO_MIXER_MAX_FRAMES];
+static int16_t gain[BENCH_MAX_STREAMS];
+static audio_mixer_t mixer;
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: bench_cpu_ns
+ *******************************************************************************
+ * Summary:
+ *   Returns the CPU time consumed by the calling thread in nanoseconds
+ *
+ ******************************************************************************/
+static uint64_t bench_cpu_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000U) + (uint64_t)ts.tv_nsec;
+}
+
+/*******************************************************************************
+ * Function Name: bench_conference
+ *******************************************************************************
+ * Summary:
+ *   Mixes one block of the conference of num_streams units with the mixer
+ *
+ ******************************************************************************/
+static void bench_conference(uint32_t num_streams, uint32_t frames)
+{
+    uint32_t i;
+
+    audio_mixer_begin(&mixer, frames);
+    for (i = 0; i < num_streams; i++)
+    {
+        audio_mixer_add(&mixer, downlink[i], gain[i]);
+    }
+    audio_mixer_output(&mixer, speaker);
+    audio_mixer_add(&mixer, mic, AUDIO_MIXER_GAIN_UNITY);
+    for (i = 0; i < num_streams; i++)
+    {
+        audio_mixer_output_without(&mixer, downlink[i], gain[i], uplink[i]);
+    }
+}
+
+/*******************************************************************************
+ * Function Name: bench_conference_scalar
+ *******************************************************************************
+ * Summary:
+ *   Mixes the same block sample by sample, summing the other units again for
+ *   every uplink
+ *
+ ******************************************************************************/
+static void bench_conference_scalar(uint32_t num_streams, uint32_t frames)
+{
+    uint32_t i;
+    uint32_t j;
+    uint32_t n;
+    int32_t sum;
+
+    for (n = 0; n < frames; n++)
+    {
+        sum = 0;
+        for (i = 0; i < num_streams; i++)
+        {
+            sum += ((int32_t)downlink[i][n] * gain[i]) >> AUDIO_MIXER_GAIN_SHIFT;
+        }
+        speaker[n] = (int16_t)MAX(MIN(sum, INT16_MAX), INT16_MIN);
+    }
+    for (i = 0; i < num_streams; i++)
+    {
+        for (n = 0; n < frames; n++)
+        {
+            sum = mic[n];
+            for (j = 0; j < num_streams; j++)
+            {
+                if (j != i)
+                {
+                    sum += ((int32_t)downlink[j][n] * gain[j]) >> AUDIO_MIXER_GAIN_SHIFT;
+                }
+            }
+            uplink[i][n] = (int16_t)MAX(MIN(sum, INT16_MAX), INT16_MIN);
+        }
+    }
+}
+
+/******************************************************************************
+ * Function Name: main()
+ ******************************************************************************
+ * Summary:
+ *   Benchmark entry function
+ *
+ *****************************************************************************/
+int main(int argc, char *argv[])
+{
+    uint32_t frames = (argc > 1) ? (uint32_t)atoi(argv[1]) : 480U;
+    uint32_t rate = (argc > 2) ? (uint32_t)atoi(argv[2]) : 48000U;
+    uint32_t blocks;
+    uint32_t streams;
+    uint32_t b;
+    uint32_t i;
+    uint64_t start;
+    uint64_t mixer_ns;
+    uint64_t scalar_ns;
+    double block_us;
+
+    if ((frames == 0) || (frames > AUDIO_MIXER_MAX_FRAMES) || (rate == 0))
+    {
+        printf("usage: %s [block frames <= %u] [rate]\n", argv[0], AUDIO_MIXER_MAX_FRAMES);
+        return EXIT_FAILURE;
+    }
+    srand(1);
+    for (i = 0; i < BENCH_MAX_STREAMS; i++)
+    {
+        for (b = 0; b < frames; b++)
+        {
+            downlink[i][b] = (int16_t)((rand() % 32768) - 16384);
+        }
+        /* half of the units at unity gain, which has its own fast path */
+        gain[i] = (int16_t)(((i % 2) == 0) ? AUDIO_MIXER_GAIN_UNITY : (AUDIO_MIXER_GAIN_UNITY * 3 / 4));
+    }
+    for (b = 0; b < frames; b++)
+    {
+        mic[b] = (int16_t)((rand() % 32768) - 16384);
+    }
+    blocks = (uint32_t)(((uint64_t)rate * BENCH_AUDIO_SECONDS) / frames);
+
+    block_us = (double)frames * 1e6 / rate;
+    printf("conference of 1 to %u units, %u frame blocks (%.1f ms at %u Hz), mixer (%s)\n",
+            BENCH_MAX_STREAMS, frames, block_us / 1000.0, rate, audio_mixer_simd_name());
+    printf("%7s %14s %10s %14s %10s %8s\n", "streams", "mixer us/blk", "cpu %", "scalar us/blk", "cpu %", "speedup");
+
+    for (streams = 1; streams <= BENCH_MAX_STREAMS; streams++)
+    {
+        start = bench_cpu_ns();
+        for (b = 0; b < blocks; b++)
+        {
+            bench_conference(streams, frames);
+            /* keep the stores alive */
+            __asm__ volatile("" : : "r"(uplink) : "memory");
+        }
+        mixer_ns = bench_cpu_ns() - start;
+
+        start = bench_cpu_ns();
+        for (b = 0; b < blocks; b++)
+        {
+            bench_conference_scalar(streams, frames);
+            __asm__ volatile("" : : "r"(uplink) : "memory");
+        }
+        scalar_ns = bench_cpu_ns() - start;
+
+        printf("%7u %14.3f %10.4f %14.3f %10.4f %7.1fx\n", streams,
+                (double)mixer_ns / 1e3 / blocks, (double)mixer_ns / 1e7 / BENCH_AUDIO_SECONDS,
+                (double)scalar_ns / 1e3 / blocks, (double)scalar_ns / 1e7 / BENCH_AUDIO_SECONDS,
+                (mixer_ns == 0) ? 0.0 : (double)scalar_ns / mixer_ns);
+    }
+    return EXIT_SUCCESS;
+}
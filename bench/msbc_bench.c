@@ -0,0 +1,217 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: msbc_bench.c
+ *
+ * Description: Benchmark of the host side mSBC codec. Encodes a speech-like
+ * test signal into H2 framed packets, then reassembles and decodes them from
+ * SCO packets of a fixed size, and reports frames per second of CPU time on
+ * one core. Real time wideband speech needs 133.3 frames per second in each
+ * direction.
+ *
+ * Usage: msbc_bench [frames] [sco packet length]
+ *   frames            : frames per direction, at least 400 (default 200000)
+ *   sco packet length : bytes per SCO packet fed to the decoder (default 60)
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+*      INCLUDES
+*******************************************************************************/
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "msbc_codec.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define BENCH_SIGNAL_FRAMES         (400U)  /* 3 s of test signal, reused */
+#define BENCH_MAX_SCO_LEN           (255U)
+#define BENCH_FRAMES_PER_SECOND     ((double)MSBC_SAMPLE_RATE / MSBC_SAMPLES_PER_FRAME)
+
+#ifndef MIN
+#define MIN(a, b)                   (((a) < (b)) ? (a) : (b))
+#endif
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static int16_t signal_pcm[BENCH_SIGNAL_FRAMES][MSBC_SAMPLES_PER_FRAME];
+static uint8_t stream[BENCH_SIGNAL_FRAMES * MSBC_PACKET_LEN];
+static msbc_encoder_t encoder;
+static msbc_decoder_t decoder;
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: bench_cpu_ns
+ *******************************************************************************
+ * Summary:
+ *   Returns the CPU time consumed by the calling thread in nanoseconds
+ *
+ ******************************************************************************/
+static uint64_t bench_cpu_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000U) + (uint64_t)ts.tv_nsec;
+}
+
+/*******************************************************************************
+ * Function Name: bench_signal_init
+ *******************************************************************************
+ * Summary:
+ *   Generates a voiced test signal: harmonics of a gliding pitch under a
+ *   syllable rate envelope, with some noise
+ *
+ ******************************************************************************/
+static void bench_signal_init(void)
+{
+    double phase = 0.0;
+    uint32_t n = 0;
+    uint32_t f;
+    uint32_t i;
+    uint32_t h;
+
+    srand(1);
+    for (f = 0; f < BENCH_SIGNAL_FRAMES; f++)
+    {
+        for (i = 0; i < MSBC_SAMPLES_PER_FRAME; i++, n++)
+        {
+            double t = (double)n / MSBC_SAMPLE_RATE;
+            double pitch = 140.0 + 40.0 * sin(2.0 * M_PI * 0.7 * t);
+            double envelope = 0.5 + 0.5 * sin(2.0 * M_PI * 4.0 * t);
+            double sample = 0.0;
+
+            phase += 2.0 * M_PI * pitch / MSBC_SAMPLE_RATE;
+            for (h = 1; h <= 12; h++)
+            {
+                sample += sin(phase * h) / h;
+            }
+            sample = 6000.0 * envelope * sample + (double)((rand() % 401) - 200);
+            signal_pcm[f][i] = (int16_t)sample;
+        }
+    }
+}
+
+/*******************************************************************************
+ * Function Name: bench_report
+ *******************************************************************************
+ * Summary:
+ *   Prints the throughput of one direction
+ *
+ ******************************************************************************/
+static void bench_report(const char *p_name, uint32_t frames, uint64_t cpu_ns)
+{
+    double fps = (cpu_ns == 0) ? 0.0 : (double)frames * 1e9 / (double)cpu_ns;
+
+    printf("%-7s %8u frames in %8.3f ms cpu, %10.0f frames/s per core, %7.3f us per frame, %6.0fx real time\n",
+            p_name, frames, (double)cpu_ns / 1e6, fps,
+            (frames == 0) ? 0.0 : ((double)cpu_ns / 1e3) / frames, fps / BENCH_FRAMES_PER_SECOND);
+}
+
+/******************************************************************************
+ * Function Name: main()
+ ******************************************************************************
+ * Summary:
+ *   Benchmark entry function
+ *
+ *****************************************************************************/
+int main(int argc, char *argv[])
+{
+    uint32_t frames = (argc > 1) ? (uint32_t)atoi(argv[1]) : 200000U;
+    uint32_t sco_len = (argc > 2) ? (uint32_t)atoi(argv[2]) : MSBC_PACKET_LEN;
+    int16_t pcm[MSBC_SAMPLES_PER_FRAME];
+    msbc_frame_status_t status;
+    uint32_t counts[MSBC_FRAME_LOST + 1] = { 0 };
+    uint64_t start;
+    uint64_t cpu;
+    uint32_t pos;
+    uint32_t len;
+    uint32_t f;
+
+    if ((frames < BENCH_SIGNAL_FRAMES) || (sco_len == 0) || (sco_len > BENCH_MAX_SCO_LEN))
+    {
+        printf("usage: %s [frames >= %u] [sco packet length <= %u]\n", argv[0],
+                                    BENCH_SIGNAL_FRAMES, BENCH_MAX_SCO_LEN);
+        return EXIT_FAILURE;
+    }
+    bench_signal_init();
+    msbc_encoder_init(&encoder);
+    msbc_decoder_init(&decoder);
+
+    printf("mSBC 16 kHz mono, %u frames per direction, %u byte SCO packets\n", frames, sco_len);
+
+    start = bench_cpu_ns();
+    for (f = 0; f < frames; f++)
+    {
+        uint32_t slot = f % BENCH_SIGNAL_FRAMES;
+
+        msbc_encoder_encode(&encoder, signal_pcm[slot]);
+        msbc_encoder_read(&encoder, &stream[slot * MSBC_PACKET_LEN], MSBC_PACKET_LEN);
+    }
+    cpu = bench_cpu_ns() - start;
+    bench_report("encode", frames, cpu);
+
+    /* The stored stream wraps at BENCH_SIGNAL_FRAMES, so the H2 sequence
+     * stays continuous only if that is a multiple of 4 */
+    start = bench_cpu_ns();
+    for (f = 0, pos = 0; f < frames; )
+    {
+        len = MIN(sco_len, sizeof(stream) - pos);
+        len = msbc_decoder_write(&decoder, &stream[pos], len);
+        pos = (pos + len) % sizeof(stream);
+        while ((f < frames) && msbc_decoder_read(&decoder, pcm, &status))
+        {
+            counts[status]++;
+            f++;
+        }
+    }
+    cpu = bench_cpu_ns() - start;
+    bench_report("decode", frames, cpu);
+
+    printf("decoded %u good, %u bad, %u lost, %u sync losses, encode errors %u\n",
+            counts[MSBC_FRAME_GOOD], counts[MSBC_FRAME_BAD], counts[MSBC_FRAME_LOST],
+            decoder.sync_losses, encoder.errors);
+    return EXIT_SUCCESS;
+}
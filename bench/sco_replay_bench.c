@@ -0,0 +1,527 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: sco_replay_bench.c
+ *
+ * Description: Offline benchmark of the SCO audio path. Replays a synthetic
+ * or recorded SCO stream into the audio pipeline through
+ * hfag_sco_data_process(), the SCO data callback of hfag.c: every packet is
+ * queued for playback and answered with an uplink packet. Packets are
+ * delivered in real time or faster, with optional delivery jitter and packet
+ * loss, to one or more Handsfree Units.
+ * Reports the throughput, the distribution of the time spent per packet and
+ * the CPU time of the process, followed by the pipeline statistics. The
+ * audio devices are those of HFAG_AUDIO_BACKEND, null by default.
+ *
+ * Usage: sco_replay_bench [-c nb|wb|cvsd] [-p packet bytes] [-s seconds]
+ *                         [-x speed] [-j jitter ms] [-l loss %] [-u units]
+ *                         [-f sco file] [-m max p99 us]
+ *   -c : nb - 8 kHz PCM coded by the controller, wb - mSBC,
+ *        cvsd - transparent air mode coded on the host (default wb)
+ *   -p : bytes per SCO packet (default 7.5 ms of SCO data)
+ *   -s : seconds of audio per unit (default 30)
+ *   -x : delivery speed, 1 real time, 0 as fast as possible (default 1)
+ *   -j : packets are delivered up to this late, in order (default 0)
+ *   -l : share of packets that never arrive (default 0)
+ *   -u : Handsfree Units in the call (default 1)
+ *   -f : SCO payload recorded in the format of -c, replayed in a loop
+ *   -m : exit with failure if the 99th percentile exceeds this (regression gate)
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+*      INCLUDES
+*******************************************************************************/
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "audio_platform_common.h"
+#include "cvsd_codec.h"
+#include "hfag_sco_data.h"
+#include "msbc_codec.h"
+#include "wiced_bt_sco.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define BENCH_MAX_PACKET_LEN        (1024U) /* SCO_DATA_LEN of hfag_sco_data.c */
+#define BENCH_SIGNAL_SECONDS        (6U)    /* synthetic stream, replayed in a loop */
+#define BENCH_PACKET_MS             (7.5)   /* default packet duration */
+
+#ifndef MIN
+#define MIN(a, b)                   (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b)                   (((a) > (b)) ? (a) : (b))
+#endif
+
+/*******************************************************************************
+ *       STRUCTURES AND ENUMERATIONS
+ ******************************************************************************/
+typedef enum
+{
+    BENCH_CODEC_NB,
+    BENCH_CODEC_WB,
+    BENCH_CODEC_CVSD,
+    BENCH_CODECS,
+} bench_codec_t;
+
+typedef struct
+{
+    const char *p_name;
+    const char *p_description;
+    uint32_t sample_rate;
+    uint32_t bytes_per_second;      /* SCO data rate over HCI */
+} bench_codec_info_t;
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static const bench_codec_info_t bench_codecs[BENCH_CODECS] =
+{
+    { "nb",   "narrowband PCM",         8000,  16000 },
+    { "wb",   "wideband mSBC",          16000, 8000  },
+    { "cvsd", "narrowband CVSD",        8000,  8000  },
+};
+static msbc_encoder_t msbc_encoder;
+static cvsd_encoder_t cvsd_encoder;
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: bench_now_ns
+ *******************************************************************************
+ * Summary:
+ *   Returns the time of a clock in nanoseconds
+ *
+ ******************************************************************************/
+static uint64_t bench_now_ns(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000U) + (uint64_t)ts.tv_nsec;
+}
+
+/*******************************************************************************
+ * Function Name: bench_sleep_until
+ *******************************************************************************
+ * Summary:
+ *   Sleeps until a CLOCK_MONOTONIC time in nanoseconds
+ *
+ ******************************************************************************/
+static void bench_sleep_until(uint64_t ns)
+{
+    struct timespec ts;
+
+    ts.tv_sec = (time_t)(ns / 1000000000U);
+    ts.tv_nsec = (long)(ns % 1000000000U);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0)
+    {
+    }
+}
+
+/*******************************************************************************
+ * Function Name: bench_signal
+ *******************************************************************************
+ * Summary:
+ *   Returns sample n of a voiced test signal: harmonics of a gliding pitch
+ *   under a syllable rate envelope
+ *
+ ******************************************************************************/
+static int16_t bench_signal(uint32_t n, uint32_t rate, double *p_phase)
+{
+    double t = (double)n / rate;
+    double pitch = 140.0 + 40.0 * sin(2.0 * M_PI * 0.7 * t);
+    double envelope = 0.5 + 0.5 * sin(2.0 * M_PI * 4.0 * t);
+    double sample = 0.0;
+    uint32_t h;
+
+    *p_phase += 2.0 * M_PI * pitch / rate;
+    for (h = 1; (h <= 12) && (pitch * h < rate / 2); h++)
+    {
+        sample += sin(*p_phase * h) / h;
+    }
+    return (int16_t)(6000.0 * envelope * sample);
+}
+
+/*******************************************************************************
+ * Function Name: bench_stream_generate
+ *******************************************************************************
+ * Summary:
+ *   Codes BENCH_SIGNAL_SECONDS of the test signal as the SCO payload of a
+ *   codec. The mSBC stream is a multiple of 4 frames so that the H2
+ *   sequence stays continuous when it is replayed in a loop.
+ *
+ ******************************************************************************/
+static uint8_t *bench_stream_generate(bench_codec_t codec, uint32_t *p_len)
+{
+    const bench_codec_info_t *p_codec = &bench_codecs[codec];
+    uint32_t samples = p_codec->sample_rate * BENCH_SIGNAL_SECONDS;
+    int16_t pcm[MSBC_SAMPLES_PER_FRAME];
+    uint8_t *p_stream;
+    double phase = 0.0;
+    uint32_t len = p_codec->bytes_per_second * BENCH_SIGNAL_SECONDS;
+    uint32_t n = 0;
+    uint32_t i;
+
+    p_stream = malloc(len);
+    if (p_stream == NULL)
+    {
+        return NULL;
+    }
+    while (n < samples)
+    {
+        for (i = 0; i < MSBC_SAMPLES_PER_FRAME; i++)
+        {
+            pcm[i] = bench_signal(n + i, p_codec->sample_rate, &phase);
+        }
+        switch (codec)
+        {
+        case BENCH_CODEC_NB:
+            memcpy(&p_stream[n * sizeof(int16_t)], pcm, sizeof(pcm));
+            break;
+        case BENCH_CODEC_WB:
+            msbc_encoder_encode(&msbc_encoder, pcm);
+            msbc_encoder_read(&msbc_encoder, &p_stream[(n / MSBC_SAMPLES_PER_FRAME) * MSBC_PACKET_LEN],
+                              MSBC_PACKET_LEN);
+            break;
+        default:
+            cvsd_encode(&cvsd_encoder, pcm, MSBC_SAMPLES_PER_FRAME, &p_stream[n]);
+            break;
+        }
+        n += MSBC_SAMPLES_PER_FRAME;
+    }
+    *p_len = len;
+    return p_stream;
+}
+
+/*******************************************************************************
+ * Function Name: bench_stream_load
+ *******************************************************************************
+ * Summary:
+ *   Reads a recorded SCO payload file
+ *
+ ******************************************************************************/
+static uint8_t *bench_stream_load(const char *p_file, uint32_t *p_len)
+{
+    FILE *p_fp = fopen(p_file, "rb");
+    uint8_t *p_stream = NULL;
+    long len;
+
+    if (p_fp == NULL)
+    {
+        perror(p_file);
+        return NULL;
+    }
+    if ((fseek(p_fp, 0, SEEK_END) == 0) && ((len = ftell(p_fp)) > 0) && (fseek(p_fp, 0, SEEK_SET) == 0))
+    {
+        p_stream = malloc((size_t)len);
+        if ((p_stream != NULL) && (fread(p_stream, 1, (size_t)len, p_fp) == (size_t)len))
+        {
+            *p_len = (uint32_t)len;
+        }
+        else
+        {
+            free(p_stream);
+            p_stream = NULL;
+        }
+    }
+    fclose(p_fp);
+    if (p_stream == NULL)
+    {
+        printf("%s: empty or unreadable\n", p_file);
+    }
+    return p_stream;
+}
+
+/*******************************************************************************
+ * Function Name: bench_compare
+ *******************************************************************************
+ * Summary:
+ *   qsort comparison of two per-packet times
+ *
+ ******************************************************************************/
+static int bench_compare(const void *p_a, const void *p_b)
+{
+    uint64_t a = *(const uint64_t *)p_a;
+    uint64_t b = *(const uint64_t *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+/*******************************************************************************
+ * Function Name: bench_percentile_us
+ *******************************************************************************
+ * Summary:
+ *   Returns a percentile of sorted per-packet times in microseconds
+ *
+ ******************************************************************************/
+static double bench_percentile_us(const uint64_t *p_sorted, uint32_t count, double percentile)
+{
+    uint32_t i;
+
+    if (count == 0)
+    {
+        return 0.0;
+    }
+    i = (uint32_t)(percentile / 100.0 * (count - 1) + 0.5);
+    return (double)p_sorted[MIN(i, count - 1)] / 1e3;
+}
+
+/*******************************************************************************
+ * Function Name: bench_cpu_ms
+ *******************************************************************************
+ * Summary:
+ *   Converts a getrusage time to milliseconds
+ *
+ ******************************************************************************/
+static double bench_cpu_ms(const struct timeval *p_tv)
+{
+    return (double)p_tv->tv_sec * 1e3 + (double)p_tv->tv_usec / 1e3;
+}
+
+/******************************************************************************
+ * Function Name: main()
+ ******************************************************************************
+ * Summary:
+ *   Benchmark entry function
+ *
+ *****************************************************************************/
+int main(int argc, char *argv[])
+{
+    bench_codec_t codec = BENCH_CODEC_WB;
+    const bench_codec_info_t *p_codec;
+    const char *p_file = NULL;
+    uint32_t packet_len = 0;
+    uint32_t seconds = 30;
+    double speed = 1.0;
+    double jitter_ms = 0.0;
+    double loss = 0.0;
+    uint32_t units = 1;
+    double max_p99_us = 0.0;
+    playback_config_params params;
+    uint8_t packet[BENCH_MAX_PACKET_LEN];
+    struct rusage usage_start;
+    struct rusage usage_end;
+    uint8_t *p_stream;
+    uint32_t stream_len = 0;
+    uint64_t *p_times;
+    uint64_t interval_ns;
+    uint64_t start_ns;
+    uint64_t wall_ns;
+    uint64_t thread_ns;
+    uint64_t due_ns = 0;
+    uint64_t t;
+    uint32_t packets;
+    uint32_t delivered = 0;
+    uint32_t lost = 0;
+    uint32_t loopback = 0;
+    uint32_t offset;
+    uint32_t n;
+    uint32_t k;
+    uint32_t u;
+    double audio_s;
+    double cpu_ms;
+    double p99;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:p:s:x:j:l:u:f:m:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c':
+            for (codec = 0; codec < BENCH_CODECS; codec++)
+            {
+                if (strcmp(optarg, bench_codecs[codec].p_name) == 0)
+                {
+                    break;
+                }
+            }
+            break;
+        case 'p': packet_len = (uint32_t)atoi(optarg);  break;
+        case 's': seconds = (uint32_t)atoi(optarg);     break;
+        case 'x': speed = atof(optarg);                 break;
+        case 'j': jitter_ms = atof(optarg);             break;
+        case 'l': loss = atof(optarg);                  break;
+        case 'u': units = (uint32_t)atoi(optarg);       break;
+        case 'f': p_file = optarg;                      break;
+        case 'm': max_p99_us = atof(optarg);            break;
+        default:  codec = BENCH_CODECS;                 break;
+        }
+    }
+    if (codec < BENCH_CODECS)
+    {
+        p_codec = &bench_codecs[codec];
+        if (packet_len == 0)
+        {
+            packet_len = (uint32_t)(p_codec->bytes_per_second * BENCH_PACKET_MS / 1000.0);
+        }
+    }
+    if ((codec >= BENCH_CODECS) || (packet_len == 0) || (packet_len > BENCH_MAX_PACKET_LEN) ||
+        (seconds == 0) || (speed < 0.0) || (jitter_ms < 0.0) || (loss < 0.0) || (loss > 100.0) ||
+        (units == 0) || (units > AUDIO_MAX_SESSIONS))
+    {
+        printf("usage: %s [-c nb|wb|cvsd] [-p packet bytes <= %u] [-s seconds] [-x speed, 0 unpaced]\n"
+               "          [-j jitter ms] [-l loss %%] [-u units <= %u] [-f sco file] [-m max p99 us]\n",
+               argv[0], BENCH_MAX_PACKET_LEN, AUDIO_MAX_SESSIONS);
+        return EXIT_FAILURE;
+    }
+
+    msbc_encoder_init(&msbc_encoder);
+    cvsd_encoder_init(&cvsd_encoder);
+    p_stream = (p_file != NULL) ? bench_stream_load(p_file, &stream_len) : bench_stream_generate(codec, &stream_len);
+    packets = (uint32_t)(((uint64_t)p_codec->bytes_per_second * seconds) / packet_len);
+    p_times = malloc((size_t)packets * units * sizeof(uint64_t));
+    if ((p_stream == NULL) || (p_times == NULL))
+    {
+        return EXIT_FAILURE;
+    }
+    interval_ns = (uint64_t)packet_len * 1000000000U / p_codec->bytes_per_second;
+
+    /* Run without a sound card unless a backend is chosen */
+    setenv("HFAG_AUDIO_BACKEND", "null", 0);
+    open_audio_session();
+    memset(&params, 0, sizeof(params));
+    params.sampling_freq = (int16_t)p_codec->sample_rate;
+    params.msbc = (codec == BENCH_CODEC_WB);
+    params.cvsd = (codec == BENCH_CODEC_CVSD);
+    for (u = 0; u < units; u++)
+    {
+        init_audio((uint8_t)u, params);
+    }
+
+    printf("\n%s (%s), %u unit(s), %u byte packets every %.3f ms, %u s of audio, ",
+            p_codec->p_name, p_codec->p_description, units, packet_len, (double)interval_ns / 1e6, seconds);
+    if (speed > 0.0)
+    {
+        printf("%.1fx real time\n", speed);
+    }
+    else
+    {
+        printf("unpaced\n");
+    }
+    printf("jitter up to %.1f ms, loss %.1f %%, source %s\n", jitter_ms, loss, (p_file != NULL) ? p_file : "synthetic");
+
+    srand(1);
+    getrusage(RUSAGE_SELF, &usage_start);
+    thread_ns = bench_now_ns(CLOCK_THREAD_CPUTIME_ID);
+    start_ns = bench_now_ns(CLOCK_MONOTONIC);
+    for (k = 0; k < packets; k++)
+    {
+        /* A late packet holds back the ones behind it, they arrive in a burst */
+        t = (uint64_t)k * interval_ns + (uint64_t)(jitter_ms * 1e6 * rand() / RAND_MAX);
+        due_ns = MAX(due_ns, t);
+        if (speed > 0.0)
+        {
+            bench_sleep_until(start_ns + (uint64_t)(due_ns / speed));
+        }
+
+        offset = (uint32_t)(((uint64_t)k * packet_len) % stream_len);
+        for (n = 0; n < packet_len; n += MIN(packet_len - n, stream_len - ((offset + n) % stream_len)))
+        {
+            memcpy(&packet[n], &p_stream[(offset + n) % stream_len],
+                   MIN(packet_len - n, stream_len - ((offset + n) % stream_len)));
+        }
+
+        for (u = 0; u < units; u++)
+        {
+            if ((loss > 0.0) && ((100.0 * rand() / RAND_MAX) < loss))
+            {
+                lost++;
+                continue;
+            }
+            /* The SCO data callback of hfag.c, SCO index u is unit u */
+            t = bench_now_ns(CLOCK_MONOTONIC);
+            hfag_sco_data_process((uint16_t)u, (uint16_t)packet_len, packet);
+            p_times[delivered++] = bench_now_ns(CLOCK_MONOTONIC) - t;
+            if (p_bench_sco_uplink == packet)
+            {
+                loopback++;
+            }
+        }
+    }
+    wall_ns = bench_now_ns(CLOCK_MONOTONIC) - start_ns;
+    thread_ns = bench_now_ns(CLOCK_THREAD_CPUTIME_ID) - thread_ns;
+    getrusage(RUSAGE_SELF, &usage_end);
+
+    audio_s = (double)packets * interval_ns / 1e9;
+    printf("\n----------------SCO REPLAY RESULTS--------------------------------\n");
+    printf("packets delivered %u lost %u, uplink looped back %u\n", delivered, lost, loopback);
+    printf("throughput %.0f packets/s, %.1f s of audio per unit in %.3f s wall (%.1fx real time)\n",
+            (wall_ns == 0) ? 0.0 : (double)delivered * 1e9 / wall_ns, audio_s, (double)wall_ns / 1e9,
+            (wall_ns == 0) ? 0.0 : audio_s * 1e9 / wall_ns);
+
+    qsort(p_times, delivered, sizeof(uint64_t), bench_compare);
+    p99 = bench_percentile_us(p_times, delivered, 99.0);
+    printf("per packet us: min %.2f p50 %.2f p90 %.2f p99 %.2f p99.9 %.2f max %.2f\n",
+            bench_percentile_us(p_times, delivered, 0.0), bench_percentile_us(p_times, delivered, 50.0),
+            bench_percentile_us(p_times, delivered, 90.0), p99,
+            bench_percentile_us(p_times, delivered, 99.9), bench_percentile_us(p_times, delivered, 100.0));
+
+    cpu_ms = bench_cpu_ms(&usage_end.ru_utime) - bench_cpu_ms(&usage_start.ru_utime) +
+             bench_cpu_ms(&usage_end.ru_stime) - bench_cpu_ms(&usage_start.ru_stime);
+    printf("cpu: process %.1f ms (user %.1f sys %.1f), %.2f %% of one core, %.3f ms per second of audio per unit\n",
+            cpu_ms, bench_cpu_ms(&usage_end.ru_utime) - bench_cpu_ms(&usage_start.ru_utime),
+            bench_cpu_ms(&usage_end.ru_stime) - bench_cpu_ms(&usage_start.ru_stime),
+            (wall_ns == 0) ? 0.0 : cpu_ms * 1e8 / wall_ns, cpu_ms / audio_s / units);
+    printf("cpu: SCO path %.1f ms, %.3f ms per second of audio per unit\n",
+            (double)thread_ns / 1e6, (double)thread_ns / 1e6 / audio_s / units);
+
+    for (u = 0; u < units; u++)
+    {
+        audio_print_stats((uint8_t)u);
+        audio_print_latency((uint8_t)u);
+        deinit_audio((uint8_t)u);
+    }
+    close_audio_session();
+    free(p_times);
+    free(p_stream);
+
+    if ((max_p99_us > 0.0) && (p99 > max_p99_us))
+    {
+        printf("FAIL: p99 %.2f us exceeds %.2f us\n", p99, max_p99_us);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
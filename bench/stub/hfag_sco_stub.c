@@ -0,0 +1,60 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: hfag_sco_stub.c
+ *
+ * Description: Stand-ins for the parts of hfag.c and of the Bluetooth stack
+ * that the SCO data path calls. The SCO map sends SCO index n to audio
+ * session n, the uplink packets are dropped.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+#include "audio_platform_common.h"
+#include "hfag_sco_data.h"
+#include "wiced_bt_sco.h"
+
+const uint8_t *p_bench_sco_uplink = NULL;
+
+uint8_t hfag_sco_lookup(uint16_t sco_channel)
+{
+    return (sco_channel < AUDIO_MAX_SESSIONS) ? (uint8_t)sco_channel : HFAG_NO_SCB;
+}
+
+wiced_result_t wiced_bt_sco_write_buffer(uint16_t sco_index, uint8_t *p_buf, uint16_t len)
+{
+    (void)sco_index;
+    (void)len;
+    p_bench_sco_uplink = p_buf;
+    return WICED_BT_SUCCESS;
+}
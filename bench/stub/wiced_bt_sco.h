@@ -0,0 +1,55 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: wiced_bt_sco.h
+ *
+ * Description: Stand-in for the Bluetooth stack SCO header, used by the
+ * benchmarks that run the SCO data path without linking the stack. The
+ * uplink packets are kept by bench/stub/hfag_sco_stub.c instead of being
+ * sent.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+#ifndef WICED_BT_SCO_H_
+#define WICED_BT_SCO_H_
+
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/* Buffer of the last uplink packet, the received packet if it was looped back */
+extern const uint8_t *p_bench_sco_uplink;
+
+wiced_result_t wiced_bt_sco_write_buffer(uint16_t sco_index, uint8_t *p_buf, uint16_t len);
+
+#endif /* WICED_BT_SCO_H_ */
@@ -0,0 +1,115 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: audio_backend.h
+ *
+ * Description: This file contains the interface between the audio pipeline
+ * and the audio output and input devices. A backend owns the device threads
+ * and paces them, the pipeline only fills and consumes blocks of mono 16-bit
+ * PCM from their callbacks.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+#ifndef AUDIO_BACKEND_H_
+#define AUDIO_BACKEND_H_
+
+/*******************************************************************************
+*      INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/*******************************************************************************
+*       MACROS
+*******************************************************************************/
+#define AUDIO_BACKEND_CHUNK_MS          (10U)   /* default block deadline */
+
+/*******************************************************************************
+*       STRUCTURES AND ENUMERATIONS
+*******************************************************************************/
+typedef enum
+{
+    AUDIO_BACKEND_PLAYBACK,
+    AUDIO_BACKEND_CAPTURE,
+    AUDIO_BACKEND_DIRECTIONS,
+} audio_backend_dir_t;
+
+/* Called from the stream thread once per block. Playback fills p_pcm,
+ * capture consumes it. delay_frames is the device delay, negative if it is
+ * not known */
+typedef void (*audio_backend_cb_t)(int16_t *p_pcm, uint32_t num_frames, int32_t delay_frames);
+
+typedef struct
+{
+    const char *p_mode;                 /* transfer method */
+    wiced_bool_t running;
+    uint32_t chunk_frames;              /* frames per callback */
+    int32_t latency_us;                 /* last device latency, -1 if not known */
+    int32_t buffer_us;                  /* device buffer, -1 if not known */
+    const char *p_buffer_mode;          /* how the buffer size was chosen */
+    uint32_t xruns;
+    uint32_t errors;                    /* unrecoverable device errors */
+    uint32_t transfers;
+    uint32_t wakeups;
+    uint64_t frames;                    /* frames read or written */
+    uint64_t blocked_ns;                /* time spent waiting for the device */
+    uint64_t transfer_ns;               /* time spent reading or writing */
+} audio_backend_stats_t;
+
+/* Operations of one backend, all called from the Bluetooth stack thread.
+ * open and close keep the device configured across calls, start and stop
+ * run the stream thread of one direction. max_frames is the latency
+ * deadline of one block, backends use the largest block of whole device
+ * periods that meets it. A stream thread that stops on a device error
+ * reports running FALSE, start joins it and starts a new one. */
+typedef struct
+{
+    const char *p_name;
+    wiced_bool_t (*open)(audio_backend_dir_t dir, uint32_t sample_rate);
+    void (*close)(audio_backend_dir_t dir);
+    wiced_bool_t (*start)(audio_backend_dir_t dir, uint32_t max_frames, audio_backend_cb_t p_cb);
+    void (*stop)(audio_backend_dir_t dir);
+    void (*set_volume)(uint8_t volume);
+    void (*get_stats)(audio_backend_dir_t dir, audio_backend_stats_t *p_stats);
+} audio_backend_t;
+
+/*******************************************************************************
+*       VARIABLE DEFINITIONS
+*******************************************************************************/
+extern const audio_backend_t audio_backend_alsa;
+extern const audio_backend_t audio_backend_null;   /* discards playback, silent capture */
+extern const audio_backend_t audio_backend_file;   /* records playback to a WAV file */
+extern const audio_backend_t audio_backend_pulse;  /* built with HFAG_AUDIO_PULSE */
+
+#endif /* AUDIO_BACKEND_H_ */
@@ -0,0 +1,86 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: audio_mixer.h
+ *
+ * Description: This file contains the data types and function prototypes of
+ * the block based conference mixer. Mono 16-bit streams are summed with a
+ * per-stream gain into 32-bit accumulators and saturated to 16 bits once per
+ * output, so that every N-1 mix is derived from the full mix.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+#ifndef AUDIO_MIXER_H_
+#define AUDIO_MIXER_H_
+
+/*******************************************************************************
+*      INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/*******************************************************************************
+*       MACROS
+*******************************************************************************/
+#define AUDIO_MIXER_MAX_FRAMES      (1024U) /* frames per block */
+#define AUDIO_MIXER_GAIN_SHIFT      (14U)
+#define AUDIO_MIXER_GAIN_UNITY      (1 << AUDIO_MIXER_GAIN_SHIFT) /* Q14 */
+#define AUDIO_MIXER_GAIN_MAX        (INT16_MAX) /* just below +6 dB */
+
+/*******************************************************************************
+*       STRUCTURES AND ENUMERATIONS
+*******************************************************************************/
+/* Sum of the streams added since audio_mixer_begin() */
+typedef struct
+{
+    uint32_t num_frames;
+    uint32_t num_streams;
+    int32_t  acc[AUDIO_MIXER_MAX_FRAMES];
+} audio_mixer_t;
+
+/*******************************************************************************
+*       FUNCTION DEFINITIONS
+*******************************************************************************/
+void audio_mixer_begin(audio_mixer_t *p_mixer, uint32_t num_frames);
+
+void audio_mixer_add(audio_mixer_t *p_mixer, const int16_t *p_in, int16_t gain);
+
+void audio_mixer_output(const audio_mixer_t *p_mixer, int16_t *p_out);
+
+void audio_mixer_output_without(const audio_mixer_t *p_mixer, const int16_t *p_in, int16_t gain,
+                                int16_t *p_out);
+
+const char *audio_mixer_simd_name(void);
+
+#endif /* AUDIO_MIXER_H_ */
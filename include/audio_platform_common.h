@@ -46,12 +46,16 @@
 *      INCLUDES
 *******************************************************************************/
 #include <stdio.h>
+#include "wiced_bt_types.h"
 #include "wiced_memory.h"
+#include "latency_hist.h"
 
 /*******************************************************************************
 *       MACROS
 *******************************************************************************/
 /* #define AUDIO_TESTING */
+#define AUDIO_MAX_SESSIONS          (3U)    /* Handsfree Units with concurrent audio */
+#define AUDIO_MIX_GAIN_MAX          (199U)  /* percent */
 
 /*******************************************************************************
 *       STRUCTURES AND ENUMERATIONS
@@ -65,17 +69,53 @@ typedef struct playback_config_params_tag
     int16_t num_of_blocks;         /*4, 8, 12 or 16*/
     int16_t allocation_method;    /*loudness or SNR*/
     int16_t bit_pool;
+    int16_t msbc;                 /*1 if SCO carries mSBC, decoded on the host*/
+    int16_t cvsd;                 /*1 if SCO carries CVSD (transparent air mode), decoded on the host*/
 } playback_config_params;
 
+typedef enum
+{
+    AUDIO_LATENCY_INGEST,                 /* SCO callback to queued in the jitter buffer */
+    AUDIO_LATENCY_QUEUE,                  /* queued to written to the device */
+    AUDIO_LATENCY_DEVICE,                 /* resampler and device delay after the write */
+    AUDIO_LATENCY_TOTAL,                  /* SCO callback to DAC */
+    AUDIO_LATENCY_STAGES,
+} audio_latency_stage_t;
+
+/* Playback latency of a session in us */
+typedef struct
+{
+    latency_summary_t stages[AUDIO_LATENCY_STAGES];
+    uint32_t untracked;                   /* packets not tracked */
+} audio_latency_t;
+
 /*******************************************************************************
 *       FUNCTION DEFINITIONS
 *******************************************************************************/
-void init_audio(playback_config_params pb_config_params);
+void init_audio(uint8_t session, playback_config_params pb_config_params);
 
-void deinit_audio(void);
+void deinit_audio(uint8_t session);
 
-void alsa_write_pcm_data(uint8_t* p_rx_media, uint16_t media_len);
+void open_audio_session(void);
+
+void close_audio_session(void);
+
+void alsa_write_pcm_data(uint8_t session, uint8_t* p_rx_media, uint16_t media_len);
 
 void alsa_set_volume(uint8_t volume);
 
+wiced_bool_t audio_capture_read(uint8_t session, uint8_t* p_data, uint16_t len);
+
+int32_t audio_get_clock_drift_ppb(uint8_t session);
+
+void audio_set_mix_gain(uint8_t session, uint16_t percent);
+
+void audio_print_stats(uint8_t session);
+
+void audio_print_latency(uint8_t session);
+
+wiced_bool_t audio_get_latency(uint8_t session, audio_latency_t *p_latency);
+
+const char *audio_latency_stage_name(audio_latency_stage_t stage);
+
 #endif /* AUDIO_PLATFORM_COMMON_H_ */
@@ -0,0 +1,102 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: audio_ring.h
+ *
+ * Description: This file contains the data types and function prototypes of
+ * the single-producer/single-consumer lock-free PCM ring used to hand SCO
+ * audio from the Bluetooth stack thread to the audio threads.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+#ifndef AUDIO_RING_H_
+#define AUDIO_RING_H_
+
+/*******************************************************************************
+*      INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/*******************************************************************************
+*       MACROS
+*******************************************************************************/
+#define AUDIO_RING_CACHE_LINE_SIZE      (64U)
+
+/*******************************************************************************
+*       STRUCTURES AND ENUMERATIONS
+*******************************************************************************/
+/* Ring control block. head is only written by the producer and tail is only
+ * written by the consumer, each on its own cache line. Both are free running
+ * byte counters, the buffer index is obtained by masking with (size - 1) */
+typedef struct
+{
+    uint8_t  *p_buf;
+    uint32_t size;                  /* buffer size, power of two */
+    uint32_t mask;
+
+    uint32_t head __attribute__((aligned(AUDIO_RING_CACHE_LINE_SIZE)));
+    uint32_t peak_fill;             /* producer side statistics */
+    uint32_t overruns;
+    uint32_t dropped_bytes;
+
+    uint32_t tail __attribute__((aligned(AUDIO_RING_CACHE_LINE_SIZE)));
+} audio_ring_t;
+
+typedef struct
+{
+    uint32_t fill;                  /* bytes currently queued */
+    uint32_t peak_fill;             /* highest fill level seen */
+    uint32_t overruns;              /* writes rejected because the ring was full */
+    uint32_t dropped_bytes;         /* bytes discarded by rejected writes */
+} audio_ring_stats_t;
+
+/*******************************************************************************
+*       FUNCTION DEFINITIONS
+*******************************************************************************/
+wiced_bool_t audio_ring_init(audio_ring_t *p_ring, uint8_t *p_buf, uint32_t size);
+
+void audio_ring_reset(audio_ring_t *p_ring);
+
+uint32_t audio_ring_write(audio_ring_t *p_ring, const uint8_t *p_data, uint32_t len);
+
+uint32_t audio_ring_read(audio_ring_t *p_ring, uint8_t *p_data, uint32_t len);
+
+uint32_t audio_ring_skip(audio_ring_t *p_ring, uint32_t len);
+
+uint32_t audio_ring_fill(audio_ring_t *p_ring);
+
+void audio_ring_get_stats(audio_ring_t *p_ring, audio_ring_stats_t *p_stats);
+
+#endif /* AUDIO_RING_H_ */
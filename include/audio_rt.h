@@ -0,0 +1,87 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: audio_rt.h
+ *
+ * Description: This file contains the function prototypes of the real-time
+ * setup of the audio path: scheduling policy and CPU affinity of the audio
+ * threads, memory locking and prefaulting, and the page fault and context
+ * switch counters of the audio threads.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+#ifndef AUDIO_RT_H_
+#define AUDIO_RT_H_
+
+/*******************************************************************************
+*      INCLUDES
+*******************************************************************************/
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/*******************************************************************************
+*       MACROS
+*******************************************************************************/
+#define AUDIO_RT_PRIORITY_DEFAULT   (50)        /* SCHED_FIFO priority */
+#define AUDIO_RT_STACK_PREFAULT     (64U * 1024U) /* stack touched by every audio thread */
+
+/*******************************************************************************
+*       STRUCTURES AND ENUMERATIONS
+*******************************************************************************/
+typedef struct
+{
+    uint64_t minor_faults;
+    uint64_t major_faults;                  /* faults that needed I/O */
+    uint64_t voluntary_switches;            /* the thread blocked */
+    uint64_t involuntary_switches;          /* the thread was preempted */
+} audio_rt_usage_t;
+
+/*******************************************************************************
+*       FUNCTION DEFINITIONS
+*******************************************************************************/
+void audio_rt_init(void);
+
+void audio_rt_prefault(void *p_mem, size_t len);
+
+int audio_rt_thread_create(pthread_t *p_thread, const char *p_name, void *(*p_fn)(void *), void *p_arg);
+
+void audio_rt_promote_self(const char *p_name);
+
+void audio_rt_get_usage(wiced_bool_t thread, audio_rt_usage_t *p_usage);
+
+void audio_rt_print_settings(void);
+
+#endif /* AUDIO_RT_H_ */
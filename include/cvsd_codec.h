@@ -0,0 +1,98 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: cvsd_codec.h
+ *
+ * Description: This file contains the data types and function prototypes of
+ * the host side CVSD codec used for narrowband speech when the SCO link is
+ * set up in transparent air mode. One SCO byte carries 8 CVSD bits at
+ * 64 kHz, which is one 8 kHz PCM sample, half of the HCI bandwidth of
+ * 16-bit PCM.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+#ifndef CVSD_CODEC_H_
+#define CVSD_CODEC_H_
+
+/*******************************************************************************
+*      INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+#include "resampler.h"
+
+/*******************************************************************************
+*       MACROS
+*******************************************************************************/
+#define CVSD_PCM_RATE               (8000U)
+#define CVSD_BIT_RATE               (64000U) /* one bit per 64 kHz sample */
+#define CVSD_BITS_PER_SAMPLE        (CVSD_BIT_RATE / CVSD_PCM_RATE)
+
+/*******************************************************************************
+*       STRUCTURES AND ENUMERATIONS
+*******************************************************************************/
+/* Delta modulator state, accumulator and step size in Q10 */
+typedef struct
+{
+    int32_t accum;
+    int32_t step;
+    uint32_t bits;                  /* last bits, newest in bit 0 */
+} cvsd_state_t;
+
+typedef struct
+{
+    cvsd_state_t state;
+    resampler_t rs;                 /* 64 kHz to 8 kHz */
+} cvsd_decoder_t;
+
+typedef struct
+{
+    cvsd_state_t state;
+    resampler_t rs;                 /* 8 kHz to 64 kHz */
+    uint32_t underruns;             /* bytes sent as idle pattern */
+} cvsd_encoder_t;
+
+/*******************************************************************************
+*       FUNCTION DEFINITIONS
+*******************************************************************************/
+wiced_bool_t cvsd_decoder_init(cvsd_decoder_t *p_dec);
+
+uint32_t cvsd_decode(cvsd_decoder_t *p_dec, const uint8_t *p_data, uint32_t len,
+                     int16_t *p_pcm, uint32_t max_samples);
+
+wiced_bool_t cvsd_encoder_init(cvsd_encoder_t *p_enc);
+
+void cvsd_encode(cvsd_encoder_t *p_enc, const int16_t *p_pcm, uint32_t num_samples, uint8_t *p_data);
+
+#endif /* CVSD_CODEC_H_ */
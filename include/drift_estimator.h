@@ -0,0 +1,91 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: drift_estimator.h
+ *
+ * Description: This file contains the data types and function prototypes of
+ * the estimator that tracks the rate offset between the Bluetooth SCO clock
+ * and the ALSA device clock and derives the resampler ratio correction that
+ * keeps the downlink buffer depth constant.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+#ifndef DRIFT_ESTIMATOR_H_
+#define DRIFT_ESTIMATOR_H_
+
+/*******************************************************************************
+*      INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/*******************************************************************************
+*       MACROS
+*******************************************************************************/
+#define DRIFT_MAX_PPM               (1000)  /* correction limit */
+
+/*******************************************************************************
+*       STRUCTURES AND ENUMERATIONS
+*******************************************************************************/
+/* Updated from the playback thread only, offset_ppb and correction_ppb may
+ * be read from any thread */
+typedef struct
+{
+    double   error_ms;              /* filtered depth error */
+    double   baseline_ms;           /* device delay when the loop locked */
+    double   delay_sum_ms;          /* device delay accumulated while settling */
+    uint32_t delay_samples;
+    double   integral_ppm;          /* converges to the clock offset */
+    uint32_t settle_ms;             /* time left before the loop locks */
+    wiced_bool_t locked;
+    int32_t  offset_ppb;            /* estimated SCO clock offset */
+    int32_t  correction_ppb;        /* resampler ratio correction */
+    uint32_t locks;
+} drift_estimator_t;
+
+/*******************************************************************************
+*       FUNCTION DEFINITIONS
+*******************************************************************************/
+void drift_estimator_init(drift_estimator_t *p_de);
+
+void drift_estimator_restart(drift_estimator_t *p_de);
+
+int32_t drift_estimator_update(drift_estimator_t *p_de, double depth_error_ms, double device_delay_ms,
+                               double dt_ms, wiced_bool_t playing);
+
+int32_t drift_estimator_get_offset_ppb(const drift_estimator_t *p_de);
+
+int32_t drift_estimator_get_correction_ppb(const drift_estimator_t *p_de);
+
+#endif /* DRIFT_ESTIMATOR_H_ */
@@ -53,15 +53,13 @@
 /******************************************************************************
  *          MACROS
  *****************************************************************************/
-//#define AUDIO_DEBUG
-//#define DUMP_SCO_TO_FILE
 //#define SAVE_PAIRING_KEY
 
 /* SDP Record for Hands-Free AG */
 #define HDLR_HANDSFREE_AG                   0x10001
 #define HANDSFREE_AG_SCN                    0x01
 #define HANDSFREE_AG_DEVICE_NAME            "Handsfree AG"
-#define HANDSFREE_AG_NUM_SCB                1
+#define HANDSFREE_AG_NUM_SCB                3   /* concurrent Handsfree Units */
 #define HFAG_SDP_DB_SIZE                    (80U)
 
 #if (BTM_WBS_INCLUDED == TRUE )
@@ -98,7 +96,4 @@ wiced_result_t hfag_handle_set_visibility( uint8_t discoverability, uint8_t conn
 void hfag_print_hfp_context( void );
 uint8_t hfag_validate_app_handle( uint16_t handle );
 
-void wait_init_done();
-void notify_init_done();
-
 #endif /* __APP_HFAG_H__ */
@@ -0,0 +1,103 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: hfag_cmdq.h
+ *
+ * Description: This file contains the data types and function prototypes of
+ * the control command queue. Any thread can submit Bluetooth stack requests,
+ * which are run in order on the stack thread and completed through a
+ * callback on that thread.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+#ifndef HFAG_CMDQ_H_
+#define HFAG_CMDQ_H_
+
+/*******************************************************************************
+*      INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/*******************************************************************************
+*       MACROS
+*******************************************************************************/
+#define HFAG_CMDQ_DEPTH             (32U)   /* commands waiting, a power of two */
+#define HFAG_CMDQ_STR_LEN           (255U)  /* longest AG command string */
+
+/*******************************************************************************
+*       STRUCTURES AND ENUMERATIONS
+*******************************************************************************/
+typedef enum
+{
+    HFAG_CMD_SET_VISIBILITY,        /* arg[0] discoverable, arg[1] connectable */
+    HFAG_CMD_SET_PAIRABILITY,       /* arg[0] allowed */
+    HFAG_CMD_INQUIRY,               /* arg[0] enable */
+    HFAG_CMD_CONNECT,               /* bd_addr */
+    HFAG_CMD_DISCONNECT,            /* handle */
+    HFAG_CMD_AUDIO_OPEN,            /* handle */
+    HFAG_CMD_AUDIO_CLOSE,           /* handle */
+    HFAG_CMD_SEND_STR,              /* handle, str and len */
+    HFAG_CMD_RECONNECT,             /* pages the bonded peer that is due */
+} hfag_cmd_type_t;
+
+typedef struct hfag_cmd hfag_cmd_t;
+
+/* Completion of a command, called on the Bluetooth stack thread. The result
+ * is WICED_BT_BADARG if the handle is not connected. Connections and audio
+ * links are reported later by the HFP events. */
+typedef void (hfag_cmd_done_t)(const hfag_cmd_t *p_cmd, wiced_result_t result);
+
+struct hfag_cmd
+{
+    hfag_cmd_type_t type;
+    uint16_t handle;
+    wiced_bt_device_address_t bd_addr;
+    uint8_t arg[2];
+    uint8_t len;
+    uint8_t str[HFAG_CMDQ_STR_LEN];
+    hfag_cmd_done_t *p_done;        /* may be NULL */
+    uint32_t cookie;                /* passed back to p_done */
+};
+
+/*******************************************************************************
+*       FUNCTION DEFINITIONS
+*******************************************************************************/
+void hfag_cmdq_init(void);
+
+wiced_result_t hfag_cmdq_submit(const hfag_cmd_t *p_cmd);
+
+const char *hfag_cmdq_name(hfag_cmd_type_t type);
+
+#endif /* HFAG_CMDQ_H_ */
@@ -0,0 +1,108 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: hfag_config.h
+ *
+ * Description: This file contains the accessors for the runtime settings of
+ * the handsfree AG. Settings are read from HFAG_* environment variables so
+ * that they can be changed without touching the porting layer command-line.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+#ifndef HFAG_CONFIG_H_
+#define HFAG_CONFIG_H_
+
+/******************************************************************************
+ *          MACROS
+ *****************************************************************************/
+/* Playback PCM access: 0 - read/write interleaved, 1 - mmap interleaved */
+#define HFAG_CONFIG_ALSA_MMAP               "HFAG_ALSA_MMAP"
+/* ALSA playback buffer in us, 0 - tuned per sink device */
+#define HFAG_CONFIG_ALSA_LATENCY            "HFAG_ALSA_LATENCY"
+/* File the tuned ALSA playback buffers are kept in */
+#define HFAG_CONFIG_ALSA_LATENCY_FILE       "HFAG_ALSA_LATENCY_FILE"
+/* Sampling rate the ALSA devices are kept open at, 8000 to 48000 */
+#define HFAG_CONFIG_ALSA_RATE               "HFAG_ALSA_RATE"
+/* Audio devices: alsa, pulse, null (discarded, silent microphone) or file */
+#define HFAG_CONFIG_AUDIO_BACKEND           "HFAG_AUDIO_BACKEND"
+/* WAV file written by the file audio backend */
+#define HFAG_CONFIG_AUDIO_FILE              "HFAG_AUDIO_FILE"
+/* Latency deadline of one audio device block in ms, 1 to 20 */
+#define HFAG_CONFIG_AUDIO_BLOCK_MS          "HFAG_AUDIO_BLOCK_MS"
+/* Frames per block of the pulse audio backend, 10 ms by default */
+#define HFAG_CONFIG_PULSE_QUANTUM           "HFAG_PULSE_QUANTUM"
+/* Record the SCO audio of every call to WAV files: 0 or 1 */
+#define HFAG_CONFIG_RECORD                  "HFAG_RECORD"
+/* Directory the call recordings are written to */
+#define HFAG_CONFIG_RECORD_DIR              "HFAG_RECORD_DIR"
+/* Start a new recording file after this many seconds, 0 - never */
+#define HFAG_CONFIG_RECORD_ROTATE_S         "HFAG_RECORD_ROTATE_S"
+/* Start a new recording file after this many MiB, 0 - never */
+#define HFAG_CONFIG_RECORD_ROTATE_MB        "HFAG_RECORD_ROTATE_MB"
+/* Write the recordings with O_DIRECT, bypassing the page cache: 0 or 1 */
+#define HFAG_CONFIG_RECORD_DIRECT           "HFAG_RECORD_DIRECT"
+/* SCHED_FIFO priority of the audio threads, 0 - default policy */
+#define HFAG_CONFIG_RT_PRIORITY             "HFAG_RT_PRIORITY"
+/* CPUs the audio threads are pinned to, e.g. "2" or "2-3" */
+#define HFAG_CONFIG_RT_CPUS                 "HFAG_RT_CPUS"
+/* Lock the process memory with mlockall: 0 or 1 */
+#define HFAG_CONFIG_RT_MLOCK                "HFAG_RT_MLOCK"
+/* Path of the Unix-domain control socket, no socket if unset */
+#define HFAG_CONFIG_CONTROL_SOCKET          "HFAG_CONTROL_SOCKET"
+/* Binary trace file for tools/hfag_trace_decode, the trace is logged if unset */
+#define HFAG_CONFIG_TRACE_FILE              "HFAG_TRACE_FILE"
+/* Longest wait in s for the controller enable and the audio devices, 0 - no limit */
+#define HFAG_CONFIG_INIT_TIMEOUT_S          "HFAG_INIT_TIMEOUT_S"
+/* Skip the patch download if the controller still runs it: 0 or 1 */
+#define HFAG_CONFIG_WARM_RESTART            "HFAG_WARM_RESTART"
+/* File the warm restart state is kept in */
+#define HFAG_CONFIG_STATE_FILE              "HFAG_STATE_FILE"
+/* Page the bonded Handsfree Units after a start or a link loss: 0 or 1 */
+#define HFAG_CONFIG_RECONNECT               "HFAG_RECONNECT"
+/* Delay in ms before the second page of an outage, doubled after each failure */
+#define HFAG_CONFIG_RECONNECT_MIN_MS        "HFAG_RECONNECT_MIN_MS"
+/* Longest delay in ms between two pages of a peer */
+#define HFAG_CONFIG_RECONNECT_MAX_MS        "HFAG_RECONNECT_MAX_MS"
+/* Failed pages before a peer is given up, 0 - never */
+#define HFAG_CONFIG_RECONNECT_ATTEMPTS      "HFAG_RECONNECT_ATTEMPTS"
+/* Narrowband SCO in transparent air mode, CVSD coded on the host: 0 or 1 */
+#define HFAG_CONFIG_SCO_TRANSPARENT         "HFAG_SCO_TRANSPARENT"
+
+/******************************************************************************
+ *          FUNCTION PROTOTYPES
+ *****************************************************************************/
+const char *hfag_config_get_str( const char *p_name, const char *p_default );
+int hfag_config_get_int( const char *p_name, int default_value );
+
+#endif /* HFAG_CONFIG_H_ */
@@ -0,0 +1,78 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: hfag_console.h
+ *
+ * Description: This file contains the function prototypes of the console of
+ * the Handsfree Audio Gateway: the epoll main loop that serves the menu on
+ * stdin and the scriptable Unix-domain control socket, and the event
+ * notifications sent to the control clients.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+#ifndef HFAG_CONSOLE_H_
+#define HFAG_CONSOLE_H_
+
+/*******************************************************************************
+*      INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/*******************************************************************************
+*       MACROS
+*******************************************************************************/
+#define HFAG_CONSOLE_MAX_CLIENTS        (8U)
+#define HFAG_CONSOLE_LINE_LEN           (256U)  /* longest request or event line */
+
+/*******************************************************************************
+*       STRUCTURES AND ENUMERATIONS
+*******************************************************************************/
+typedef enum
+{
+    HFAG_CONSOLE_EVENT_OPEN,            /* service level connection attempt done */
+    HFAG_CONSOLE_EVENT_CONNECTED,
+    HFAG_CONSOLE_EVENT_DISCONNECTED,
+    HFAG_CONSOLE_EVENT_AUDIO_OPEN,
+    HFAG_CONSOLE_EVENT_AUDIO_CLOSE,
+} hfag_console_event_t;
+
+/*******************************************************************************
+*       FUNCTION DEFINITIONS
+*******************************************************************************/
+int hfag_console_run(void);
+
+void hfag_console_event(hfag_console_event_t event, uint16_t handle, int status);
+
+#endif /* HFAG_CONSOLE_H_ */
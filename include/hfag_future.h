@@ -0,0 +1,75 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: hfag_future.h
+ *
+ * Description: This file contains the completion object used to wait for
+ * work that finishes on other threads, such as the start of the Bluetooth
+ * stack.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+#ifndef HFAG_FUTURE_H_
+#define HFAG_FUTURE_H_
+
+/*******************************************************************************
+*      INCLUDES
+*******************************************************************************/
+#include <pthread.h>
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/*******************************************************************************
+*       STRUCTURES AND ENUMERATIONS
+*******************************************************************************/
+/* Completes when every part has completed. Completions before the wait are
+ * kept, so the order of the threads does not matter. */
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;            /* CLOCK_MONOTONIC */
+    uint32_t pending;               /* parts not completed yet */
+    wiced_result_t status;          /* WICED_BT_SUCCESS or the first failure */
+} hfag_future_t;
+
+/*******************************************************************************
+*       FUNCTION DEFINITIONS
+*******************************************************************************/
+void hfag_future_init(hfag_future_t *p_future, uint32_t parts);
+
+void hfag_future_complete(hfag_future_t *p_future, wiced_result_t status);
+
+wiced_result_t hfag_future_wait(hfag_future_t *p_future, uint32_t timeout_ms);
+
+#endif /* HFAG_FUTURE_H_ */
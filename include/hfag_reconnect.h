@@ -0,0 +1,112 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: hfag_reconnect.h
+ *
+ * Description: This file contains the function prototypes of the reconnect
+ * scheduler, which pages the bonded Handsfree Units after a start or a link
+ * loss, most recently used first.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+#ifndef HFAG_RECONNECT_H_
+#define HFAG_RECONNECT_H_
+
+/*******************************************************************************
+*      INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+#include "latency_hist.h"
+
+/*******************************************************************************
+*       MACROS
+*******************************************************************************/
+#define HFAG_RECONNECT_MAX_PEERS    (8U)    /* bonded peers remembered */
+#define HFAG_RECONNECT_REASON_NONE  (0x00U) /* ACL still up when the profile closed */
+
+/*******************************************************************************
+*       STRUCTURES AND ENUMERATIONS
+*******************************************************************************/
+/* A bonded peer as seen by hfag_reconnect_get */
+typedef struct
+{
+    wiced_bt_device_address_t bd_addr;
+    const char *p_state;            /* idle, scheduled, paging or connected */
+    uint32_t attempts;              /* failed pages of the current outage */
+    uint32_t due_ms;                /* until the next page, if scheduled */
+} hfag_reconnect_peer_info_t;
+
+typedef struct
+{
+    wiced_bool_t enabled;
+    wiced_bool_t inquiry;           /* pages are held */
+    uint32_t peers;                 /* entries of the peer list, MRU first */
+    hfag_reconnect_peer_info_t peer[HFAG_RECONNECT_MAX_PEERS];
+    latency_summary_t time_to_reconnect;    /* in us */
+    uint32_t pages;
+    uint32_t failures;
+    uint32_t given_up;
+} hfag_reconnect_status_t;
+
+/*******************************************************************************
+*       FUNCTION DEFINITIONS
+*******************************************************************************/
+void hfag_reconnect_init(const wiced_bt_device_link_keys_t *p_keys, uint8_t count);
+
+void hfag_reconnect_start(void);
+
+void hfag_reconnect_bonded(const wiced_bt_device_address_t bd_addr);
+
+void hfag_reconnect_open(uint16_t handle, const wiced_bt_device_address_t bd_addr, int status);
+
+void hfag_reconnect_connected(uint16_t handle);
+
+void hfag_reconnect_close(uint16_t handle, uint8_t reason);
+
+void hfag_reconnect_link_down(const wiced_bt_device_address_t bd_addr, uint8_t reason);
+
+void hfag_reconnect_disconnect(uint16_t handle);
+
+void hfag_reconnect_inquiry(wiced_bool_t active);
+
+wiced_bool_t hfag_reconnect_paging(void);
+
+void hfag_reconnect_page(void);
+
+void hfag_reconnect_get(hfag_reconnect_status_t *p_status);
+
+void hfag_reconnect_print(void);
+
+#endif /* HFAG_RECONNECT_H_ */
@@ -0,0 +1,66 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: hfag_sco_data.h
+ *
+ * Description: This file contains the SCO data path of the Audio Gateway,
+ * the work done for every SCO packet received over HCI. It is kept apart
+ * from the Bluetooth stack glue of hfag.c so that the SCO replay benchmark
+ * runs the same code.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+#ifndef HFAG_SCO_DATA_H_
+#define HFAG_SCO_DATA_H_
+
+/*******************************************************************************
+*      INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+
+/*******************************************************************************
+*       MACROS
+*******************************************************************************/
+#define HFAG_NO_SCB                             (0xFFU)
+
+/*******************************************************************************
+*       FUNCTION DEFINITIONS
+*******************************************************************************/
+/* Service control block of a SCO link, HFAG_NO_SCB if no link matches.
+ * Implemented by hfag.c, the benchmark has its own SCO map. */
+uint8_t hfag_sco_lookup(uint16_t sco_channel);
+
+void hfag_sco_data_process(uint16_t sco_channel, uint16_t length, uint8_t *p_data);
+
+#endif /* HFAG_SCO_DATA_H_ */
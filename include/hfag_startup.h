@@ -0,0 +1,92 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: hfag_startup.h
+ *
+ * Description: This file contains the startup phases, the startup profiler
+ * and the warm restart state of the Handsfree Audio Gateway.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+#ifndef HFAG_STARTUP_H_
+#define HFAG_STARTUP_H_
+
+/*******************************************************************************
+*      INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/*******************************************************************************
+*       MACROS
+*******************************************************************************/
+#define HFAG_STARTUP_GAP_UNSET      (0xFFU) /* mode not saved, or not changed */
+
+/*******************************************************************************
+*       STRUCTURES AND ENUMERATIONS
+*******************************************************************************/
+/* Startup phases in order, each is marked when it ends. A phase runs after
+ * the previous one unless its start is recorded with hfag_startup_start. */
+typedef enum
+{
+    HFAG_STARTUP_ARGS,              /* argument parsing and BTSPY */
+    HFAG_STARTUP_FIRMWARE,          /* porting layer: UART, autobaud, patch download */
+    HFAG_STARTUP_AUDIO,             /* audio devices, while the controller is enabled */
+    HFAG_STARTUP_STACK,             /* wiced_bt_stack_init and the heap */
+    HFAG_STARTUP_ENABLE,            /* controller reset until BTM_ENABLED_EVT */
+    HFAG_STARTUP_APP,               /* EIR, SDP, HFP AG and the restored state */
+    HFAG_STARTUP_READY,             /* main thread released */
+    HFAG_STARTUP_PHASES,
+} hfag_startup_phase_t;
+
+/*******************************************************************************
+*       FUNCTION DEFINITIONS
+*******************************************************************************/
+void hfag_startup_begin(void);
+
+void hfag_startup_start(hfag_startup_phase_t phase);
+
+void hfag_startup_mark(hfag_startup_phase_t phase);
+
+void hfag_startup_report(void);
+
+wiced_bool_t hfag_startup_prepare(char *p_patch_file, const char *p_device, uint32_t baud);
+
+void hfag_startup_controller_ready(void);
+
+void hfag_startup_save_gap(uint8_t discoverable, uint8_t connectable, uint8_t pairable);
+
+wiced_bool_t hfag_startup_saved_gap(uint8_t *p_discoverable, uint8_t *p_connectable, uint8_t *p_pairable);
+
+#endif /* HFAG_STARTUP_H_ */
@@ -0,0 +1,146 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: hfag_trace.h
+ *
+ * Description: This file contains the data types, event list and macros of
+ * the binary trace. Trace points store a fixed-size record (timestamp, event
+ * id and four arguments) in a lock-free ring of the calling thread, the
+ * records are formatted by a background thread or written to a file for
+ * tools/hfag_trace_decode. Trace points above HFAG_TRACE_LEVEL are compiled
+ * out.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+#ifndef HFAG_TRACE_H_
+#define HFAG_TRACE_H_
+
+/*******************************************************************************
+*      INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+
+/*******************************************************************************
+*       MACROS
+*******************************************************************************/
+#define HFAG_TRACE_LEVEL_OFF        (0)
+#define HFAG_TRACE_LEVEL_ERROR      (1)
+#define HFAG_TRACE_LEVEL_INFO       (2)
+#define HFAG_TRACE_LEVEL_DEBUG      (3)     /* per packet and per block events */
+
+#ifndef HFAG_TRACE_LEVEL
+#define HFAG_TRACE_LEVEL            HFAG_TRACE_LEVEL_INFO
+#endif
+
+#define HFAG_TRACE_MAX_THREADS      (16U)   /* rings, given back at thread exit */
+#define HFAG_TRACE_RING_RECORDS     (512U)  /* per thread, power of two */
+#define HFAG_TRACE_MAGIC            (0x52544648U) /* "HFTR" */
+#define HFAG_TRACE_VERSION          (1U)
+
+/* Trace events: id and format of up to four 32-bit arguments. New events
+ * are added at the end so that older trace files still decode */
+#define HFAG_TRACE_EVENTS(X) \
+    X(HFAG_TRACE_DROPPED,           "%u records of thread %u dropped") \
+    X(HFAG_TRACE_HFP_EVENT,         "HFP AG event 0x%x handle %u") \
+    X(HFAG_TRACE_SCO_RX,            "SCO rx sco_index %u length %u") \
+    X(HFAG_TRACE_SCO_UNKNOWN,       "SCO data on unknown sco_index %u") \
+    X(HFAG_TRACE_SCO_TX_ERROR,      "wiced_bt_sco_write_buffer error, sco_index = %u, result = %u") \
+    X(HFAG_TRACE_SESSION_INVALID,   "invalid audio session %u") \
+    X(HFAG_TRACE_ALSA_WRITE,        "alsa frames written %d") \
+    X(HFAG_TRACE_ALSA_SHORT_WRITE,  "alsa short write (expected %u, wrote %u)")
+
+#define HFAG_TRACE_EVENT_ID(id, fmt)        id,
+#define HFAG_TRACE_EVENT_FORMAT(id, fmt)    fmt,
+
+/* Trace points take an event and up to four integer arguments */
+#define HFAG_TRACE_EMIT(level, ...)         HFAG_TRACE_EMIT_(level, __VA_ARGS__, 0, 0, 0, 0, 0)
+#define HFAG_TRACE_EMIT_(level, event, a0, a1, a2, a3, ...) \
+    hfag_trace_write((level), (event), (uint32_t)(a0), (uint32_t)(a1), (uint32_t)(a2), (uint32_t)(a3))
+
+#if (HFAG_TRACE_LEVEL >= HFAG_TRACE_LEVEL_ERROR)
+#define HFAG_TRACE_ERROR(...)               HFAG_TRACE_EMIT(HFAG_TRACE_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define HFAG_TRACE_ERROR(...)               ((void)0)
+#endif
+#if (HFAG_TRACE_LEVEL >= HFAG_TRACE_LEVEL_INFO)
+#define HFAG_TRACE_INFO(...)                HFAG_TRACE_EMIT(HFAG_TRACE_LEVEL_INFO, __VA_ARGS__)
+#else
+#define HFAG_TRACE_INFO(...)                ((void)0)
+#endif
+#if (HFAG_TRACE_LEVEL >= HFAG_TRACE_LEVEL_DEBUG)
+#define HFAG_TRACE_DEBUG(...)               HFAG_TRACE_EMIT(HFAG_TRACE_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define HFAG_TRACE_DEBUG(...)               ((void)0)
+#endif
+
+/*******************************************************************************
+*       STRUCTURES AND ENUMERATIONS
+*******************************************************************************/
+typedef enum
+{
+    HFAG_TRACE_EVENTS(HFAG_TRACE_EVENT_ID)
+    HFAG_TRACE_EVENT_COUNT,
+} hfag_trace_event_t;
+
+/* One trace point, 32 bytes */
+typedef struct
+{
+    uint64_t timestamp_ns;                  /* CLOCK_MONOTONIC */
+    uint16_t event;                         /* hfag_trace_event_t */
+    uint8_t level;
+    uint8_t thread;                         /* ring index */
+    uint32_t seq;                           /* per thread, gaps are drops */
+    uint32_t args[4];
+} hfag_trace_record_t;
+
+/* Start of a trace file, followed by records */
+typedef struct
+{
+    uint32_t magic;                         /* HFAG_TRACE_MAGIC */
+    uint16_t version;                       /* HFAG_TRACE_VERSION */
+    uint16_t record_size;
+    uint64_t start_ns;                      /* CLOCK_MONOTONIC when tracing started */
+    uint64_t start_realtime_ns;             /* CLOCK_REALTIME at the same time */
+} hfag_trace_file_header_t;
+
+/*******************************************************************************
+*       FUNCTION DEFINITIONS
+*******************************************************************************/
+void hfag_trace_init(void);
+
+void hfag_trace_deinit(void);
+
+void hfag_trace_write(uint8_t level, uint16_t event, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+
+#endif /* HFAG_TRACE_H_ */
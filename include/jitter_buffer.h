@@ -0,0 +1,154 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: jitter_buffer.h
+ *
+ * Description: This file contains the data types and function prototypes of
+ * the adaptive jitter buffer placed in front of the ALSA playback. The jitter
+ * buffer works on mono 16-bit PCM.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+#ifndef JITTER_BUFFER_H_
+#define JITTER_BUFFER_H_
+
+/*******************************************************************************
+*      INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+#include "audio_ring.h"
+
+/*******************************************************************************
+*       MACROS
+*******************************************************************************/
+#define JB_MAX_CHUNK_SAMPLES        (512U)  /* largest jitter_buffer_get request */
+#define JB_MAX_SAMPLE_RATE          (16000U)
+#define JB_HISTORY_MS               (30U)   /* PCM history used for concealment */
+#define JB_HISTORY_SAMPLES          (JB_MAX_SAMPLE_RATE * JB_HISTORY_MS / 1000U)
+#define JB_MAX_LOSSES               (16U)   /* pending lost packet markers */
+#define JB_MAX_LOST_LEN             (JB_MAX_CHUNK_SAMPLES * 2U) /* bytes per lost packet */
+
+/*******************************************************************************
+*       STRUCTURES AND ENUMERATIONS
+*******************************************************************************/
+typedef enum
+{
+    JB_STATE_BUFFERING,     /* waiting for the target depth, output is concealed */
+    JB_STATE_PLAYING,
+} jitter_buffer_state_t;
+
+typedef struct
+{
+    audio_ring_t *p_ring;
+    uint32_t sample_rate;
+
+    /* Producer (SCO callback) side */
+    uint64_t last_arrival_us;
+    uint32_t last_len;
+    uint32_t jitter_us;             /* RFC 3550 style inter-arrival jitter */
+    uint32_t packets;
+    uint32_t late_packets;          /* arrived later than the target depth */
+    uint32_t lost_packets;          /* reported lost by the decoder */
+
+    /* Lost packet markers, ring byte offsets of the placeholder audio. Slots
+     * are filled by the producer, loss_tail is only written by the consumer */
+    uint32_t loss_start[JB_MAX_LOSSES];
+    uint32_t loss_len[JB_MAX_LOSSES];
+    uint32_t loss_head;
+    uint32_t loss_tail;
+
+    /* Consumer (playback thread) side, all depths in samples */
+    jitter_buffer_state_t state;
+    uint32_t target;
+    uint32_t min_depth;
+    uint32_t max_depth;
+    uint32_t grow_step;
+    uint32_t shrink_step;
+    uint32_t stable_samples;        /* played since the last underrun or shrink */
+    uint32_t stable_period;
+    wiced_bool_t rate_controlled;   /* depth is held by the caller's resampler */
+
+    int16_t  history[JB_HISTORY_SAMPLES];
+    uint32_t history_len;
+    wiced_bool_t concealing;
+    uint32_t pitch;                 /* concealment period, 0 means silence */
+    uint32_t plc_run;               /* samples concealed in the current gap */
+
+    uint32_t underruns;
+    uint32_t concealed_samples;
+    uint32_t dropped_samples;       /* removed while shrinking the depth */
+} jitter_buffer_t;
+
+typedef struct
+{
+    uint32_t depth_ms;              /* queued audio */
+    uint32_t target_ms;
+    uint32_t jitter_us;
+    uint32_t packets;
+    uint32_t late_packets;
+    uint32_t lost_packets;
+    uint32_t underruns;
+    uint32_t concealed_ms;
+    uint32_t dropped_ms;
+} jitter_buffer_stats_t;
+
+/* Consumer side snapshot used for clock drift tracking, depths in samples */
+typedef struct
+{
+    uint32_t fill;                  /* queued */
+    uint32_t target;
+    uint32_t hysteresis;            /* excess tolerated before shrinking */
+    uint32_t since_arrival;         /* played since the last packet arrived */
+    wiced_bool_t playing;
+} jitter_buffer_level_t;
+
+/*******************************************************************************
+*       FUNCTION DEFINITIONS
+*******************************************************************************/
+void jitter_buffer_init(jitter_buffer_t *p_jb, audio_ring_t *p_ring, uint32_t sample_rate);
+
+uint32_t jitter_buffer_put(jitter_buffer_t *p_jb, const uint8_t *p_data, uint16_t len);
+
+uint32_t jitter_buffer_put_lost(jitter_buffer_t *p_jb, uint16_t len);
+
+void jitter_buffer_get(jitter_buffer_t *p_jb, int16_t *p_pcm, uint32_t num_samples);
+
+void jitter_buffer_set_rate_controlled(jitter_buffer_t *p_jb, wiced_bool_t rate_controlled);
+
+void jitter_buffer_get_level(jitter_buffer_t *p_jb, jitter_buffer_level_t *p_level);
+
+void jitter_buffer_get_stats(jitter_buffer_t *p_jb, jitter_buffer_stats_t *p_stats);
+
+#endif /* JITTER_BUFFER_H_ */
@@ -0,0 +1,110 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: latency_hist.h
+ *
+ * Description: This file contains the data types and function prototypes of
+ * the lock-free log-linear latency histograms and of the queue of packet
+ * timestamps that follows SCO packets from arrival to playback.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+#ifndef LATENCY_HIST_H_
+#define LATENCY_HIST_H_
+
+/*******************************************************************************
+*      INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/*******************************************************************************
+*       MACROS
+*******************************************************************************/
+/* Every power of two is split into 2^LATENCY_HIST_SUB_BITS linear buckets,
+ * which bounds the error of a percentile to 1 / 2^LATENCY_HIST_SUB_BITS */
+#define LATENCY_HIST_SUB_BITS       (3U)
+#define LATENCY_HIST_BUCKETS        ((32U - LATENCY_HIST_SUB_BITS + 1U) << LATENCY_HIST_SUB_BITS)
+#define LATENCY_STAMPS              (64U)   /* packets tracked at a time */
+
+/*******************************************************************************
+*       STRUCTURES AND ENUMERATIONS
+*******************************************************************************/
+/* Values are in microseconds. Any thread may record, readers take
+ * snapshots without locking */
+typedef struct
+{
+    uint32_t counts[LATENCY_HIST_BUCKETS];
+    uint32_t samples;
+    uint32_t max_us;
+    uint64_t sum_us;
+} latency_hist_t;
+
+typedef struct
+{
+    uint32_t samples;
+    uint32_t p50_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+    uint32_t mean_us;
+} latency_summary_t;
+
+/* Single producer single consumer queue of packet timestamps, pos is the
+ * ring byte offset just after the packet */
+typedef struct
+{
+    uint32_t pos[LATENCY_STAMPS];
+    uint64_t rx_ns[LATENCY_STAMPS];
+    uint64_t queued_ns[LATENCY_STAMPS];
+    uint32_t head;                  /* written by the producer */
+    uint32_t tail;                  /* written by the consumer */
+    uint32_t skipped;               /* packets not tracked, queue full */
+} latency_stamps_t;
+
+/*******************************************************************************
+*       FUNCTION DEFINITIONS
+*******************************************************************************/
+void latency_hist_reset(latency_hist_t *p_hist);
+
+void latency_hist_record(latency_hist_t *p_hist, uint64_t value_us);
+
+void latency_hist_summarize(latency_hist_t *p_hist, latency_summary_t *p_summary);
+
+void latency_stamps_reset(latency_stamps_t *p_stamps);
+
+wiced_bool_t latency_stamps_push(latency_stamps_t *p_stamps, uint32_t pos, uint64_t rx_ns, uint64_t queued_ns);
+
+wiced_bool_t latency_stamps_pop(latency_stamps_t *p_stamps, uint32_t done_pos, uint64_t *p_rx_ns, uint64_t *p_queued_ns);
+
+#endif /* LATENCY_HIST_H_ */
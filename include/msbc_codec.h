@@ -0,0 +1,127 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: msbc_codec.h
+ *
+ * Description: This file contains the data types and function prototypes of
+ * the host side mSBC codec used for wideband speech when the SCO data is
+ * routed over HCI. The decoder reassembles H2 framed mSBC frames from SCO
+ * packets of any size, the encoder produces the H2 framed uplink stream.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+#ifndef MSBC_CODEC_H_
+#define MSBC_CODEC_H_
+
+/*******************************************************************************
+*      INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+#include "sbc_types.h"
+#include "sbc_decoder.h"
+#include "sbc_encoder.h"
+
+/*******************************************************************************
+*       MACROS
+*******************************************************************************/
+#define MSBC_SAMPLE_RATE            (16000U)
+#define MSBC_FRAME_LEN              (57U)   /* SBC frame, header to padding */
+#define MSBC_H2_LEN                 (2U)    /* synchronization header */
+#define MSBC_PACKET_LEN             (60U)   /* H2 + frame + one padding byte */
+#define MSBC_SAMPLES_PER_FRAME      (120U)  /* 15 blocks of 8 subbands */
+#define MSBC_PCM_LEN                (MSBC_SAMPLES_PER_FRAME * 2U) /* BYTES */
+#define MSBC_STATIC_MEM_SIZE        (1920U) /* BYTES */
+#define MSBC_SCRATCH_MEM_SIZE       (2048U) /* BYTES */
+
+/*******************************************************************************
+*       STRUCTURES AND ENUMERATIONS
+*******************************************************************************/
+typedef enum
+{
+    MSBC_FRAME_GOOD,
+    MSBC_FRAME_BAD,         /* CRC or decode error, PCM is not valid */
+    MSBC_FRAME_LOST,        /* missing from the H2 sequence, PCM is not valid */
+} msbc_frame_status_t;
+
+typedef struct
+{
+    SBC_DEC_PARAMS params;
+    SINT32 static_mem[MSBC_STATIC_MEM_SIZE / sizeof(SINT32)];
+    SINT32 scratch_mem[MSBC_SCRATCH_MEM_SIZE / sizeof(SINT32)];
+
+    uint8_t buf[2U * MSBC_PACKET_LEN];  /* reassembly of partial packets */
+    uint32_t len;
+    wiced_bool_t synced;
+    wiced_bool_t seq_valid;
+    uint8_t next_seq;                   /* expected H2 sequence number */
+    uint32_t pending_lost;              /* frames to report lost before the next one */
+
+    uint32_t frames;                    /* decoded without error */
+    uint32_t bad_frames;
+    uint32_t lost_frames;
+    uint32_t sync_losses;
+    uint32_t skipped_bytes;             /* discarded while searching for H2 */
+} msbc_decoder_t;
+
+typedef struct
+{
+    SBC_ENC_PARAMS params;
+
+    uint8_t packet[MSBC_PACKET_LEN];    /* H2 framed frame being sent */
+    uint32_t pos;                       /* bytes of packet already sent */
+    uint8_t seq;                        /* next H2 sequence number */
+
+    uint32_t frames;
+    uint32_t errors;
+} msbc_encoder_t;
+
+/*******************************************************************************
+*       FUNCTION DEFINITIONS
+*******************************************************************************/
+void msbc_decoder_init(msbc_decoder_t *p_dec);
+
+uint32_t msbc_decoder_write(msbc_decoder_t *p_dec, const uint8_t *p_data, uint32_t len);
+
+wiced_bool_t msbc_decoder_read(msbc_decoder_t *p_dec, int16_t *p_pcm, msbc_frame_status_t *p_status);
+
+void msbc_encoder_init(msbc_encoder_t *p_enc);
+
+uint32_t msbc_encoder_pending(msbc_encoder_t *p_enc);
+
+wiced_bool_t msbc_encoder_encode(msbc_encoder_t *p_enc, const int16_t *p_pcm);
+
+uint32_t msbc_encoder_read(msbc_encoder_t *p_enc, uint8_t *p_data, uint32_t len);
+
+#endif /* MSBC_CODEC_H_ */
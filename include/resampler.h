@@ -0,0 +1,94 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: resampler.h
+ *
+ * Description: This file contains the data types and function prototypes of
+ * the polyphase FIR sample rate converter used between the SCO sampling rate
+ * (8 or 16 kHz) and the native rate of the ALSA devices.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+#ifndef RESAMPLER_H_
+#define RESAMPLER_H_
+
+/*******************************************************************************
+*      INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/*******************************************************************************
+*       MACROS
+*******************************************************************************/
+#define RESAMPLER_PHASES            (48U)   /* filter phases per input frame */
+#define RESAMPLER_BASE_TAPS         (32U)   /* taps per phase when up-sampling */
+#define RESAMPLER_MAX_TAPS          (256U)  /* multiple of 8, allows 8:1 down-sampling */
+#define RESAMPLER_MAX_INPUT         (1024U) /* frames buffered per call */
+
+/*******************************************************************************
+*       STRUCTURES AND ENUMERATIONS
+*******************************************************************************/
+/* Mono S16 resampler. pos and step are 32.32 fixed point input positions,
+ * hist keeps the input frames that are still under the filter */
+typedef struct
+{
+    uint32_t in_rate;
+    uint32_t out_rate;
+    uint32_t taps;
+    uint64_t nominal_step;          /* in_rate / out_rate */
+    uint64_t step;                  /* input frames per output frame */
+    uint64_t pos;                   /* position of the next output in hist */
+    uint32_t hist_len;              /* frames in hist */
+    int16_t  hist[RESAMPLER_MAX_TAPS + RESAMPLER_MAX_INPUT];
+    int16_t  coeff[RESAMPLER_PHASES + 1][RESAMPLER_MAX_TAPS];
+} resampler_t;
+
+/*******************************************************************************
+*       FUNCTION DEFINITIONS
+*******************************************************************************/
+wiced_bool_t resampler_init(resampler_t *p_rs, uint32_t in_rate, uint32_t out_rate);
+
+void resampler_reset(resampler_t *p_rs);
+
+void resampler_set_drift(resampler_t *p_rs, int32_t ppb);
+
+uint32_t resampler_input_frames(const resampler_t *p_rs, uint32_t out_frames);
+
+uint32_t resampler_process(resampler_t *p_rs, const int16_t *p_in, uint32_t in_frames,
+                           int16_t *p_out, uint32_t out_max);
+
+const char *resampler_simd_name(void);
+
+#endif /* RESAMPLER_H_ */
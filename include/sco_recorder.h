@@ -0,0 +1,86 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: sco_recorder.h
+ *
+ * Description: This file contains the data types and function prototypes of
+ * the call recorder, which writes the downlink and uplink PCM of every
+ * session to WAV files from a background thread.
+ *
+ * Related Document: See README.md
+ *
+ ******************************************************************************/
+#ifndef SCO_RECORDER_H_
+#define SCO_RECORDER_H_
+
+/*******************************************************************************
+*      INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include "wiced_bt_types.h"
+
+/*******************************************************************************
+*       STRUCTURES AND ENUMERATIONS
+*******************************************************************************/
+typedef enum
+{
+    SCO_RECORDER_DOWNLINK,                  /* received from the Handsfree Unit */
+    SCO_RECORDER_UPLINK,                    /* sent to the Handsfree Unit */
+    SCO_RECORDER_DIRECTIONS,
+} sco_recorder_dir_t;
+
+typedef struct
+{
+    wiced_bool_t enabled;
+    uint32_t files;                         /* files completed or open */
+    uint64_t bytes;                         /* PCM bytes written */
+    uint32_t dropped_bytes;                 /* lost because the writer fell behind */
+    uint32_t write_errors;
+} sco_recorder_stats_t;
+
+/*******************************************************************************
+*       FUNCTION DEFINITIONS
+*******************************************************************************/
+void sco_recorder_init(void);
+
+void sco_recorder_deinit(void);
+
+void sco_recorder_start(uint8_t session, uint32_t sample_rate);
+
+void sco_recorder_stop(uint8_t session);
+
+void sco_recorder_write(uint8_t session, sco_recorder_dir_t dir, const uint8_t *p_pcm, uint32_t len);
+
+void sco_recorder_get_stats(uint8_t session, sco_recorder_stats_t *p_stats);
+
+#endif /* SCO_RECORDER_H_ */
@@ -0,0 +1,153 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: jitter_buffer_test.c
+ *
+ * Description: Unit test of the consumer side depth snapshot of the jitter
+ * buffer. since_arrival follows the audio played out since the last packet
+ * arrived and stops growing at two packet lengths.
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+*      INCLUDES
+*******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "audio_ring.h"
+#include "jitter_buffer.h"
+
+/*******************************************************************************
+ *       MACROS
+ ******************************************************************************/
+#define TEST_SAMPLE_RATE            (8000U)
+#define TEST_PACKET_SAMPLES         (60U)   /* 7.5 ms */
+#define TEST_RING_SIZE              (4096U)
+
+#define TEST_CHECK(cond)            test_check((cond), #cond, __LINE__)
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static uint32_t test_failures = 0;
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: test_check
+ *******************************************************************************
+ * Summary:
+ *   Reports a failed condition
+ *
+ ******************************************************************************/
+static void test_check(int ok, const char *p_cond, int line)
+{
+    if (!ok)
+    {
+        printf("FAIL line %d: %s\n", line, p_cond);
+        test_failures++;
+    }
+}
+
+/*******************************************************************************
+ * Function Name: test_sleep_ms
+ *******************************************************************************
+ * Summary:
+ *   Sleeps for at least ms milliseconds
+ *
+ ******************************************************************************/
+static void test_sleep_ms(uint32_t ms)
+{
+    struct timespec ts = { (time_t)(ms / 1000U), (long)(ms % 1000U) * 1000000L };
+
+    while (nanosleep(&ts, &ts) != 0)
+    {
+    }
+}
+
+/*******************************************************************************
+ * Function Name: main
+ *******************************************************************************
+ * Summary:
+ *   Queues packets into a jitter buffer and checks since_arrival before the
+ *   first packet, between two packet lengths and long after the last packet
+ *
+ ******************************************************************************/
+int main(void)
+{
+    static uint8_t ring_mem[TEST_RING_SIZE];
+    static const uint8_t packet[TEST_PACKET_SAMPLES * sizeof(int16_t)];
+    audio_ring_t ring;
+    jitter_buffer_t jb;
+    jitter_buffer_level_t level;
+
+    audio_ring_init(&ring, ring_mem, sizeof(ring_mem));
+    jitter_buffer_init(&jb, &ring, TEST_SAMPLE_RATE);
+
+    /* Nothing arrived yet */
+    jitter_buffer_get_level(&jb, &level);
+    TEST_CHECK(level.since_arrival == 0);
+    TEST_CHECK(level.fill == 0);
+
+    /* A packet that is 1.5 packet lengths old is not clamped to one packet */
+    jitter_buffer_put(&jb, packet, sizeof(packet));
+    test_sleep_ms(TEST_PACKET_SAMPLES * 1500U / TEST_SAMPLE_RATE);
+    jitter_buffer_get_level(&jb, &level);
+    TEST_CHECK(level.fill == TEST_PACKET_SAMPLES);
+    TEST_CHECK(level.since_arrival > TEST_PACKET_SAMPLES);
+    TEST_CHECK(level.since_arrival <= 2 * TEST_PACKET_SAMPLES);
+
+    /* Long after the last packet the bound is two packet lengths */
+    test_sleep_ms(50);
+    jitter_buffer_get_level(&jb, &level);
+    TEST_CHECK(level.since_arrival == 2 * TEST_PACKET_SAMPLES);
+
+    /* The bound follows the length of the last packet */
+    jitter_buffer_put(&jb, packet, sizeof(packet) / 2);
+    test_sleep_ms(50);
+    jitter_buffer_get_level(&jb, &level);
+    TEST_CHECK(level.since_arrival == TEST_PACKET_SAMPLES);
+
+    if (test_failures != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    printf("jitter_buffer_test passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,171 @@
+/*
+* Copyright 2022, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*/
+/******************************************************************************
+ * File Name: hfag_trace_decode.c
+ *
+ * Description: Offline decoder of the binary trace written to
+ * HFAG_TRACE_FILE. The records of all threads are sorted by timestamp and
+ * printed with the event formats of include/hfag_trace.h.
+ *
+ * Usage: hfag_trace_decode <trace file>
+ *
+ * Related Document: See README.md
+ *
+ *****************************************************************************/
+
+/*******************************************************************************
+*      INCLUDES
+*******************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "hfag_trace.h"
+
+/*******************************************************************************
+ *       VARIABLE DEFINITIONS
+ ******************************************************************************/
+static const char *trace_formats[HFAG_TRACE_EVENT_COUNT] = { HFAG_TRACE_EVENTS(HFAG_TRACE_EVENT_FORMAT) };
+static const char trace_level_names[] = { '-', 'E', 'I', 'D' };
+
+/*******************************************************************************
+ *       FUNCTION DEFINITION
+ ******************************************************************************/
+
+/******************************************************************************
+ * Function Name: decode_compare
+ ******************************************************************************
+ * Summary:
+ *   qsort() order of records: timestamp, then thread and sequence number
+ *
+ *****************************************************************************/
+static int decode_compare(const void *p_a, const void *p_b)
+{
+    const hfag_trace_record_t *p_ra = (const hfag_trace_record_t *)p_a;
+    const hfag_trace_record_t *p_rb = (const hfag_trace_record_t *)p_b;
+
+    if (p_ra->timestamp_ns != p_rb->timestamp_ns)
+    {
+        return (p_ra->timestamp_ns < p_rb->timestamp_ns) ? -1 : 1;
+    }
+    if (p_ra->thread != p_rb->thread)
+    {
+        return (p_ra->thread < p_rb->thread) ? -1 : 1;
+    }
+    return (p_ra->seq < p_rb->seq) ? -1 : (p_ra->seq > p_rb->seq);
+}
+
+/******************************************************************************
+ * Function Name: main()
+ ******************************************************************************
+ * Summary:
+ *   Decoder entry function
+ *
+ *****************************************************************************/
+int main(int argc, char *argv[])
+{
+    hfag_trace_file_header_t header;
+    hfag_trace_record_t *p_records = NULL;
+    hfag_trace_record_t *p_record;
+    size_t count = 0;
+    size_t size = 0;
+    time_t start;
+    uint64_t us;
+    FILE *p_fp;
+    size_t i;
+
+    if (argc != 2)
+    {
+        printf("usage: %s <trace file>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    p_fp = fopen(argv[1], "rb");
+    if (p_fp == NULL)
+    {
+        perror(argv[1]);
+        return EXIT_FAILURE;
+    }
+    if ((fread(&header, sizeof(header), 1, p_fp) != 1) || (header.magic != HFAG_TRACE_MAGIC) ||
+        (header.version != HFAG_TRACE_VERSION) || (header.record_size != sizeof(hfag_trace_record_t)))
+    {
+        printf("%s is not a version %u trace file\n", argv[1], HFAG_TRACE_VERSION);
+        fclose(p_fp);
+        return EXIT_FAILURE;
+    }
+
+    for (;;)
+    {
+        if (count == size)
+        {
+            size = (size == 0) ? 4096 : (size * 2);
+            p_record = realloc(p_records, size * sizeof(hfag_trace_record_t));
+            if (p_record == NULL)
+            {
+                printf("out of memory after %zu records\n", count);
+                break;
+            }
+            p_records = p_record;
+        }
+        if (fread(&p_records[count], sizeof(hfag_trace_record_t), 1, p_fp) != 1)
+        {
+            break;
+        }
+        count++;
+    }
+    fclose(p_fp);
+    qsort(p_records, count, sizeof(hfag_trace_record_t), decode_compare);
+
+    start = (time_t)(header.start_realtime_ns / 1000000000U);
+    printf("trace started %s%zu records\n", ctime(&start), count);
+    for (i = 0; i < count; i++)
+    {
+        p_record = &p_records[i];
+        us = (p_record->timestamp_ns - header.start_ns) / 1000U;
+        printf("[%llu.%06llu] T%u %c ", (unsigned long long)(us / 1000000U), (unsigned long long)(us % 1000000U),
+                                    p_record->thread, trace_level_names[p_record->level & 3U]);
+        if (p_record->event < HFAG_TRACE_EVENT_COUNT)
+        {
+            printf(trace_formats[p_record->event], p_record->args[0], p_record->args[1],
+                                    p_record->args[2], p_record->args[3]);
+        }
+        else
+        {
+            printf("unknown event %u: %u %u %u %u", p_record->event, p_record->args[0], p_record->args[1],
+                                    p_record->args[2], p_record->args[3]);
+        }
+        printf("\n");
+    }
+    free(p_records);
+    return EXIT_SUCCESS;
+}